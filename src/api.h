@@ -386,6 +386,16 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
  *   - smthread pin count
  *   - is in storage manager
  *   - transaction ID of any attached transaction
+ * - lock contention profile (see ss_m::lock_profile_collect and
+ *   ss_m::enable_lock_profile), hottest first
+ *   Columns are:
+ *   - address of the lock or latch
+ *   - kind of lock (latch_t, mcs_rwlock, tatas_lock, ...)
+ *   - name given to the lock, if any
+ *   - call site (code address) that waited
+ *   - number of waits
+ *   - total and maximum wait time in microseconds
+ *   - histogram of wait times (<1us, <10us, <100us, <1ms, <10ms, more)
 */
  /**\example vtable_example.cpp */
 
@@ -104,23 +104,40 @@ latch_t::~latch_t()
 }
 
 
-/**\var static __thread latch_holder_t* latch_holder_t::thread_local_holders;
- * \brief Linked list of all latches held by this thread.
+/**\var static __thread latch_holder_t* latch_holder_t::thread_local_table;
+ * \brief Fixed-size table of the latches held by this thread.
  * \ingroup TLS
  *
  * \details
  * Every time we want to grab a latch,
  * we have to create a latch_holder_t; we do that with the
- * holder_search class, which searches this list to make sure
+ * holder_search class, which probes a few slots of this table, starting
+ * at a slot picked by hashing the latch address, to make sure
  * we(this thread) doesn't already hold the latch and if not,
- * it creates a new latch_holder_t for the new latch acquisition,
- * and stuffs the latch_holder_t in this list.  If we do already
+ * it claims a free slot for the new latch acquisition.
+ * A slot is free when its mode is LATCH_NL.  If we do already
  * have hold the latch in some capacity, the holder_search returns
  * that existing latch_holder_t.
  * So we can tell if this thread holds a given latch, and we can
  * find all latches held by this thread, but we can't find
  * all the holders of a given latch.
  *
+ * The table is allocated on the first latch operation of the thread
+ * and freed in latch_t::on_thread_destroy.
+ *
+ * \sa latch_holder_t
+ */
+__thread latch_holder_t* latch_holder_t::thread_local_table(NULL);
+
+/**\var static __thread latch_holder_t* latch_holder_t::thread_local_holders;
+ * \brief Overflow list of latches held by this thread.
+ * \ingroup TLS
+ *
+ * \details
+ * Holds the latch_holder_t instances that did not fit in the probe
+ * window of thread_local_table (a thread holding many latches whose
+ * addresses hash alike).  Normally empty.
+ *
  * \sa latch_holder_t
  */
 __thread latch_holder_t* latch_holder_t::thread_local_holders(NULL);
@@ -210,10 +227,10 @@ public:
  * \details
  *
  * Constructor looks through all the holders in the 
- * implied list starting with the latch_holder_t passed in as the sole
- * constructor argument.  
+ * given holder table and in the implied list starting with the 
+ * latch_holder_t passed in as the second constructor argument.  
  *
- * It prints info about each latch_holder_t in the list.
+ * It prints info about each latch_holder_t in use.
  *
  * \sa latch_holder_t.
  */
@@ -221,6 +238,14 @@ class  holders_print
 {
 private:
     holder_list _holders;
+    void print(latch_holder_t *table)
+    {
+        if(!table) return;
+        for(int i=0; i < latch_holder_t::table_size; i++) 
+        {
+            if(table[i]._mode != LATCH_NL) table[i].print(cerr);
+        }
+    }
     void print(holder_list holders)
     {
         holder_list::iterator it=holders.begin();
@@ -230,9 +255,10 @@ private:
         }
     }
 public:
-    holders_print(latch_holder_t *list) 
+    holders_print(latch_holder_t *table, latch_holder_t *list) 
     : _holders(list)
     {
+        print(table);
         print(_holders);
     }
 };
@@ -241,8 +267,8 @@ public:
  * \brief Finds all latches held by this thread.
  *
  * \details
- * Searches a thread-local list for a latch_holder_t that is a
- * reference to the given latch_t.
+ * Probes the thread-local holder table, then the overflow list,
+ * for a latch_holder_t that is a reference to the given latch_t.
  *
  * \sa latch_holder_t.
  */
@@ -266,83 +292,160 @@ public:
         return c;
     }
 
+    /// count # times we find a given latch in use in the table. 
+    /// For debugging, asserts.
+    static int count(latch_holder_t const* table, latch_t const* l) 
+    {
+        int c=0;
+        for(int i=0; i < latch_holder_t::table_size; i++) 
+            if(table[i]._latch == l && table[i]._mode != LATCH_NL) c++;
+        return c;
+    }
+
+    /// home slot of the given latch in the holder table
+    static int slot(latch_t const* l) 
+    {
+        // Fibonacci hashing: latches are often laid out at a
+        // fixed stride (buffer pool frames), which the low bits
+        // of the address alone would map onto few slots.
+        w_base_t::uint8_t h = w_base_t::uint8_t(l) * 
+                                    0x9e3779b97f4a7c15ull;
+        return int(h >> 58) & (latch_holder_t::table_size-1);
+    }
+
+    /// the calling thread's holder table, allocated on first use
+    static latch_holder_t* table() 
+    {
+        latch_holder_t* t = latch_holder_t::thread_local_table;
+        if(!t) {
+            t = new latch_holder_t[latch_holder_t::table_size];
+            latch_holder_t::thread_local_table = t;
+        }
+        return t;
+    }
+
 private:
     holder_list _holders;
     latch_holder_t* &_freelist;
-    holder_list::iterator _end;
-    holder_list::iterator _it;
+    latch_holder_t* _h;
+    bool            _in_list;
 
 public:
     /// Insert latch_holder_t for given latch if not already there.
     holder_search(latch_t const* l)
         : _holders(latch_holder_t::thread_local_holders),
           _freelist(latch_holder_t::thread_local_freelist),
-          _end(_holders.end()),
-          _it(find(_holders, l))
+          _h(NULL),
+          _in_list(false)
     {
-        // if we didn't find the latch in the list,
-        // create a new latch_holder_t (with mode LATCH_NL)
+        latch_holder_t* t = table();
+        latch_holder_t* free_slot = NULL;
+        int s = slot(l);
+        for(int i=0; i < latch_holder_t::table_window; i++) {
+            latch_holder_t* h = &t[(s+i) & (latch_holder_t::table_size-1)];
+            if(h->_mode == LATCH_NL) {
+                if(!free_slot) free_slot = h;
+            } else if(h->_latch == l) {
+                _h = h;
+                break;
+            }
+        }
+        if(!_h && _holders.begin() != _holders.end()) {
+            holder_list::iterator it = find(_holders, l);
+            if(it != _holders.end()) {
+                _h = it;
+                _in_list = true;
+            }
+        }
+        // if we didn't find the latch,
+        // hand out a clean latch_holder_t (with mode LATCH_NL)
         // to return, just so that the value() method always
         // returns a non-null ptr.  It might be used, might not.
-        if(_it == _end) {
-            latch_holder_t* h = _freelist;
-            if(h) _freelist = h->_next;
-            // need to clear out the latch either way
-            if(h)
-                // h->latch_holder_t(); // reinit
-                h = new(h) latch_holder_t();
-            else
-                h = new latch_holder_t;
-            _holders.push_front(h);
-            _it = _holders.begin();
+        if(!_h) {
+            if(free_slot) {
+                _h = free_slot;
+                _h->_latch = NULL;
+                _h->_count = 0;
+            } else {
+                latch_holder_t* h = _freelist;
+                if(h) _freelist = h->_next;
+                // need to clear out the latch either way
+                if(h)
+                    // h->latch_holder_t(); // reinit
+                    h = new(h) latch_holder_t();
+                else
+                    h = new latch_holder_t;
+                _holders.push_front(h);
+                _h = h;
+                _in_list = true;
+            }
         }
-        w_assert2(count(_holders, l) <= 1);
+        w_assert2(count(_holders, l) + count(t, l) <= 1);
     }
 
     ~holder_search() 
     {
-        if(_it == _end || _it->_mode != LATCH_NL)
+        // table slots free themselves by dropping to LATCH_NL
+        if(!_in_list || _h->_mode != LATCH_NL)
             return;
         
         // don't hang onto it in the holders list  if it's not latched.
-        latch_holder_t* h = _holders.unlink(_it);
+        latch_holder_t* h = _holders.unlink(holder_list::iterator(_h));
         h->_next = _freelist;
         _freelist = h;
     }
 
     latch_holder_t* operator->() { return this->value(); }
 
-    latch_holder_t* value() { return (_it == _end)? 
-        (latch_holder_t *)(NULL) : &(*_it); }
+    latch_holder_t* value() { return _h; }
 }; // holder_search
 
 /**\cond skip */
 // For debugging purposes, let's string together all the thread_local
-// lists so that we can print all the latches and their
+// tables and lists so that we can print all the latches and their
 // holders.   smthread_t calls on_thread_init and on_thread_destroy.
+// Optimized builds keep only each thread's own table: registering
+// every thread costs a global lock per thread start and end.
+#if W_DEBUG_LEVEL > 0
 #include <map>
-typedef std::map<sthread_t*, latch_holder_t**> holder_list_list_t;
+typedef std::pair<latch_holder_t**, latch_holder_t**> holder_tls_t;
+typedef std::map<sthread_t*, holder_tls_t> holder_list_list_t;
 static holder_list_list_t holder_list_list;
 
 // It's not that this needs to be queue-based, but we want to avoid
 // pthreads API use directly as much as possible.
 static queue_based_block_lock_t    holder_list_list_lock;
+#endif
 
-void latch_t::on_thread_init(sthread_t *who) 
+void latch_t::on_thread_init(sthread_t * W_IFDEBUG1(who)) 
 {
+#if W_DEBUG_LEVEL > 0
     CRITICAL_SECTION(cs, holder_list_list_lock);
     holder_list_list.insert(std::make_pair(who, 
-				&latch_holder_t::thread_local_holders));
+				holder_tls_t(&latch_holder_t::thread_local_table,
+				             &latch_holder_t::thread_local_holders)));
+#endif
 }
 
-void latch_t::on_thread_destroy(sthread_t *who) 
+void latch_t::on_thread_destroy(sthread_t * W_IFDEBUG1(who)) 
 {
+#if W_DEBUG_LEVEL > 0
     {
        CRITICAL_SECTION(cs, holder_list_list_lock);
        holder_list_list.erase(who);
     }
+#endif
 
     w_assert3(!latch_holder_t::thread_local_holders);
+    latch_holder_t* table = latch_holder_t::thread_local_table;
+    if(table) {
+#if W_DEBUG_LEVEL > 2
+        for(int i=0; i < latch_holder_t::table_size; i++) 
+            w_assert3(table[i]._mode == LATCH_NL);
+#endif
+        delete [] table;
+        latch_holder_t::thread_local_table = NULL;
+    }
     latch_holder_t* freelist = latch_holder_t::thread_local_freelist;
     while(freelist) {
         latch_holder_t* node = freelist;
@@ -358,6 +461,8 @@ w_rc_t
 latch_t::latch_acquire(latch_mode_t mode, sthread_t::timeout_in_ms timeout) 
 {
     w_assert1(mode != LATCH_NL); 
+    // charge waits on the underlying lock to the latch and our caller
+    LOCK_PROFILE_WAITER(w, this, "latch_t");
     holder_search me(this);
     return _acquire(mode, timeout, me.value());
 }
@@ -416,12 +521,25 @@ w_rc_t latch_t::_acquire(latch_mode_t new_mode,
 
     // pin: special case for plp
     if(new_mode == LATCH_NLS || new_mode == LATCH_NLX) {
-	if(me->_latch != this) {
+	if(me->_latch == this && 
+		(me->_mode == LATCH_SH || me->_mode == LATCH_EX)) {
+	    // we really hold it; that will do
+	    atomic_inc_uint(&_total_count);
+	    me->_count++;
+	    return (RCOK);
+	}
+	if(me->_latch != this || me->_mode == LATCH_NL) {
 	    me->_latch = this;
-	    me->_count = 1;
+	    me->_mode = new_mode;
+	    me->_count = 0;
+	} else if(new_mode == LATCH_NLX) {
+	    // once held in NLX, it stays NLX until released
+	    me->_mode = LATCH_NLX;
 	}
-	_lock.set_plp(new_mode == LATCH_NLS);
-	me->_mode = new_mode;
+	// count the acquires so that we stop "holding" it only when
+	// the last of them is released
+	me->_count++;
+	_lock.set_plp(me->_mode == LATCH_NLS);
 	return (RCOK);
     }
 		
@@ -593,8 +711,8 @@ latch_t::_release(latch_holder_t* me)
 
     // pin: special case for plp
     if(me->_mode == LATCH_NLS || me->_mode == LATCH_NLX) {
+	if(--me->_count) return;
 	me->_mode = LATCH_NL;
-	me->_count = 0;
 	_lock.unset_plp();
 	return;
     }
@@ -697,7 +815,9 @@ void latch_holder_t::print(ostream &o) const
 {
     o << "Holder " << latch_t::latch_mode_str[int(_mode)] 
         << " cnt=" << _count 
+#if W_DEBUG_LEVEL > 0
     << " threadid/" << ::hex << w_base_t::uint8_t(_threadid) 
+#endif
     << " latch:";
     if(_latch) {
         o  << *_latch << endl;
@@ -752,12 +872,14 @@ void print_latch(const latch_t *l)
 void print_my_latches()
 {
     FUNC(print_my_latches);
-    holders_print all(latch_holder_t::thread_local_holders);
+    holders_print all(latch_holder_t::thread_local_table,
+                      latch_holder_t::thread_local_holders);
 }
 
 void print_all_latches()
 {
     FUNC(print_all_latches);
+#if W_DEBUG_LEVEL > 0
 // Don't protect: this is for use in a debugger.
 // It's absolutely dangerous to use in a running
 // storage manager, since these lists will be
@@ -777,7 +899,8 @@ void print_all_latches()
 		DBG(<<"");
         sthread_t* who = iter->first;
 		DBG(<<" who " << (void *)(who));
-        latch_holder_t **whoslist = iter->second;
+        latch_holder_t **whostable = iter->second.first;
+        latch_holder_t **whoslist = iter->second.second;
 		DBG(<<" whoslist " << (void *)(whoslist));
 		if(who) {
         cerr << "{ Thread id:" << ::dec << who->id 
@@ -789,8 +912,12 @@ void print_all_latches()
          << endl << "\t";
 		}
 		DBG(<<"");
-        holders_print whose(*whoslist); 
+        holders_print whose(*whostable, *whoslist); 
         cerr <<  "} " << endl << flush;
     }
     cerr <<  "}" << endl << flush ;
+#else
+    cerr << "ALL LATCHES: holders are registered only in debugging builds"
+         << endl << flush;
+#endif
 }
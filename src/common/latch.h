@@ -73,6 +73,18 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 enum latch_mode_t { LATCH_NL = 0, LATCH_SH = 1, LATCH_EX = 2,
 		    LATCH_NLS = 4, LATCH_NLX = 8 }; // pin: for plp
 
+/**\brief True if a latch held in mode \e held will do for a request
+ * in mode \e wanted.
+ * \details
+ * A request that skips latching (LATCH_NLS, LATCH_NLX) is satisfied
+ * by any mode: the frame of a page read in for it, for instance,
+ * is really latched in EX mode.
+ */
+inline bool latch_mode_covers(latch_mode_t held, latch_mode_t wanted)
+{
+    if(wanted == LATCH_NLS || wanted == LATCH_NLX) return true;
+    return held >= wanted;
+}
 
 
 class latch_t;
@@ -83,12 +95,19 @@ extern ostream &operator<<(ostream &, const latch_t &);
  *\details Every time we want to grab a latch,
  * we have to create a latch_holder_t. 
  * We do that with the holder_search class, 
- * which searches a TLS list to make sure  we(this thread) 
+ * which searches a small TLS table (indexed by a hash of the
+ * latch address) to make sure  we(this thread) 
  * doesn't already hold the latch, and, if not,
- * it creates a new latch_holder_t for the new latch acquisition.
- * It then stuffs the latch_holder_t in the TLS list.  
+ * it claims a free latch_holder_t for the new latch acquisition.
+ * If the table has no free slot near the latch's home slot, the
+ * latch_holder_t goes in an overflow TLS list instead.
  * If we do already have hold the latch in some capacity, 
  * the holder_search returns that existing latch_holder_t.
+ *
+ * A thread's own table is what lets it re-acquire a latch it holds,
+ * so it is kept in all builds.  The full tracking, i.e. the holder's
+ * thread id and the registry of every thread's table that
+ * print_all_latches walks, exists only when W_DEBUG_LEVEL > 0.
  * \sa holder_search
  */
 class latch_holder_t 
@@ -111,14 +130,20 @@ public:
 /**\bug GNATS 66 LATCH_CAN_BLOCK_LONG we haven't tested with this in place,
  and we need to decide which policy should be the default.
 */
+    static __thread latch_holder_t* thread_local_table;
     static __thread latch_holder_t* thread_local_holders;
     static __thread latch_holder_t* thread_local_freelist;
 
+    /// Size of the per-thread holder table and of the probe window.
+    enum { table_size = 64, table_window = 8 };
+
     latch_t*     _latch;
     latch_mode_t _mode;
     int          _count;
 private:
-    sthread_t*   _threadid; // REMOVE ME (for debuging)
+#if W_DEBUG_LEVEL > 0
+    sthread_t*   _threadid; // for debugging only
+#endif
 
     // disabled
     latch_holder_t &operator=(latch_holder_t const &other); 
@@ -128,13 +153,17 @@ public:
     latch_holder_t* _next;
     
     latch_holder_t()
-    : _latch(NULL), _mode(LATCH_NL), _count(0), _threadid(NULL)
+    : _latch(NULL), _mode(LATCH_NL), _count(0)
     {
+#if W_DEBUG_LEVEL > 0
         _threadid = sthread_t::me();
+#endif
     }
 
     bool operator==(latch_holder_t const &other) const {
+#if W_DEBUG_LEVEL > 0
         if(_threadid != other._threadid) return false;
+#endif
         return _latch == other._latch && 
               _mode == other._mode && _count == other._count;    
     }
@@ -151,18 +180,27 @@ public:
  * The mode of subsequent acquire()s must be at or above the level 
  * of the currently held latch.  
  * Each of these individual locks must be released.
+ *
+ * Only debugging builds carry a name in the latch; in optimized builds
+ * the latch is just the R/W lock and its count, which keeps the 
+ * per-frame latches in the buffer pool small.
  * \sa latch_holder_t
  */
+#if W_DEBUG_LEVEL > 0
 class latch_t : public sthread_named_base_t {
+#else
+class latch_t : public sthread_base_t {
+#endif
 
 public:
     /**\cond skip */
     /// Used for debugging support:
     /// Link together all the thread-local storage for latch holders in a list,
-    /// so that we can print this info later.
+    /// so that we can print this info later.  No-op unless W_DEBUG_LEVEL > 0.
     static void             on_thread_init(sthread_t *);
     /// Used for debugging support:
-    /// Remove thread's latch info from the list.
+    /// Remove thread's latch info from the list and free the
+    /// thread's holder table.
     static void             on_thread_destroy(sthread_t *);
     /**\endcond skip */
     
@@ -176,8 +214,12 @@ public:
     // Return a unique id for the latch.For debugging.
     inline const void *     id() const { return &_lock; } 
     
-    /// Change the name of the latch.
+    /// Change the name of the latch. No-op in optimized builds.
     inline void             setname(const char *const desc);
+#if W_DEBUG_LEVEL == 0
+    /// Name of the latch. Always empty in optimized builds.
+    const char*             name() const { return ""; }
+#endif
 
     /// Acquire the latch in given mode. \sa  timeout_t.
     w_rc_t                  latch_acquire(
@@ -262,9 +304,11 @@ private:
 
 
 inline void
-latch_t::setname(const char* const desc)
+latch_t::setname(const char* const W_IFDEBUG1(desc))
 {
+#if W_DEBUG_LEVEL > 0
     rename("l:", desc);
+#endif
 }
 
 inline bool
@@ -66,7 +66,7 @@ const char     *argv0(NULL);
 
 void usage(ostream &o, int ex)
 {
-    o << "usage: " << argv0 << " -t <1|2|3> [-v]" << endl;
+    o << "usage: " << argv0 << " -t <1|2|3|4> [-v] [-n <thr>] [-i <iter>]" << endl;
     ::exit(ex);
 }
 
@@ -675,8 +675,52 @@ void latch_thread_t::test3(int i, testKind t)
 	DO_PTHREAD(pthread_cond_signal(&done));
 }
 
+#include <stime.h>
+
+// test 4: more latches than fit in a thread's holder table
+#define NUM_LATCHES  (2*latch_holder_t::table_size)
+#define TREE_FANOUT  (NUM_LATCHES/4)
+#define TREE_DEPTH   4
+
+latch_t  many_latches[NUM_LATCHES];
+int      num_threads = NUM_THREADS; // -n, for test 4 only
+int      iterations = 100000; // -i, for test 4 only
+
+// Throughput: every thread crabs down a tree of latches (SH on the
+// way down, EX on 1 leaf in 8) as a short B-tree descent would, 
+// after first holding all the latches at once so that some of them 
+// overflow the holder table.
 void latch_thread_t::test4()
 {
+    int j;
+    for(j=0; j < NUM_LATCHES; j++) {
+        W_COERCE(many_latches[j].latch_acquire(LATCH_SH));
+    }
+    for(j=0; j < NUM_LATCHES; j++) {
+        w_assert1(many_latches[j].held_by_me() == 1);
+    }
+    for(j=0; j < NUM_LATCHES; j++) {
+        many_latches[j].latch_release();
+        w_assert1(many_latches[j].held_by_me() == 0);
+    }
+
+    unsigned int seed = _self._id + 1;
+    for(int i=0; i < iterations; i++) {
+        latch_t* parent = &many_latches[0];
+        W_COERCE(parent->latch_acquire(LATCH_SH));
+        for(int level=1; level < TREE_DEPTH; level++) {
+            seed = seed * 1103515245 + 12345;
+            latch_t* child = &many_latches[level*TREE_FANOUT +
+                                    (seed >> 16) % TREE_FANOUT];
+            latch_mode_t mode = (level == TREE_DEPTH-1 && (seed & 0x70) == 0)?
+                                    LATCH_EX : LATCH_SH;
+            W_COERCE(child->latch_acquire(mode));
+            w_assert2(child->held_by_me() == 1);
+            parent->latch_release();
+            parent = child;
+        }
+        parent->latch_release();
+    }
 }
 
 void latch_thread_t::run()
@@ -718,6 +762,10 @@ void latch_thread_t::run()
         test3(-1, all_ex);
         break;
 
+    case 4:
+        test4();
+        break;
+
     default:
         usage(cerr, testnum);
     }
@@ -741,7 +789,7 @@ void sync_all (latch_thread_t **t)
 		CRITICAL_SECTION(cs, print_mutex);
         cerr << "{ sync_all START  syncing all " << endl; /*}*/
     }
-    for(int i=0; i < NUM_THREADS; i++)
+    for(int i=0; i < num_threads; i++)
     {
         latch_thread_t::sync_other(t[i]);
     }
@@ -753,9 +801,9 @@ void sync_all (latch_thread_t **t)
 
 	{
 		CRITICAL_SECTION(cs, done_mutex);
-		do {
+		while(done_count < num_threads-1) {
 			DO_PTHREAD(pthread_cond_wait(&done, &done_mutex));
-		} while(done_count < NUM_THREADS-1);
+		}
 
 	}
     if(verbose)  {
@@ -769,7 +817,7 @@ int main(int argc, char ** argv)
     argv0 = argv[0];
     int errors=0;
     char c;
-    while ((c = getopt(argc, argv, "t:vh")) != EOF) {
+    while ((c = getopt(argc, argv, "t:n:i:vh")) != EOF) {
         switch (c) {
         case 'v':
             verbose=true;
@@ -780,19 +828,28 @@ int main(int argc, char ** argv)
         case 't':
             testnum = atoi(optarg);
             break;
+        case 'n':
+            num_threads = atoi(optarg);
+            break;
+        case 'i':
+            iterations = atoi(optarg);
+            break;
         default:
             errors++;
             break;
         }
     }
-    if(errors > 0) {
+    // tests 1-3 are scripted for exactly NUM_THREADS threads
+    if(testnum != 4) num_threads = NUM_THREADS;
+    if(errors > 0 || num_threads < 1) {
        usage(cerr, 1);
     }
 
-    latch_thread_t **latch_thread = new latch_thread_t *[NUM_THREADS];
+    stime_t start(stime_t::now());
+    latch_thread_t **latch_thread = new latch_thread_t *[num_threads];
 
     int i;
-    for (i = 0; i < NUM_THREADS; i++)  {
+    for (i = 0; i < num_threads; i++)  {
         latch_thread[i] = new latch_thread_t(i);
         w_assert1(latch_thread[i]);
         W_COERCE(latch_thread[i]->fork());
@@ -820,18 +877,29 @@ int main(int argc, char ** argv)
         sync_all(latch_thread);
         sync_all(latch_thread);
         break;
+    case 4:
+        // threads run independently
+        break;
     default:
         usage(cerr, testnum);
         break;
     }
 
-    for (i = 0; i < NUM_THREADS; i++)  {
+    for (i = 0; i < num_threads; i++)  {
         W_COERCE( latch_thread[i]->join());
         delete latch_thread[i];
     }
 
     delete [] latch_thread;
 
+    if(testnum == 4) {
+        double secs = double(stime_t::now() - start);
+        double acquires = double(num_threads) * iterations * TREE_DEPTH;
+        cout << "test 4: " << num_threads << " threads, "
+            << acquires << " latch acquires in " << secs << " secs, "
+            << (secs > 0 ? acquires/secs : 0) << " acquires/sec" << endl;
+    }
+
     // TODO: make this test the stats also
     if(verbose)
     sthread_t::dump_stats(cout);
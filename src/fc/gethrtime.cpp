@@ -56,10 +56,12 @@ hrtime_t gethrtime()
 
 hrtime_t gethrtime()
 {
+    // Like the Solaris gethrtime(), this is elapsed (not cpu) time
+    // from an arbitrary point in the past.
     struct timespec tsp;
-    long e = clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tsp);
+    long e = clock_gettime(CLOCK_MONOTONIC, &tsp);
     w_assert0(e == 0);
-    return tsp.tv_nsec; // nanosecs
+    return hrtime_t(tsp.tv_sec) * 1000000000 + tsp.tv_nsec; // nanosecs
 }
 
 #endif // __APPLE__
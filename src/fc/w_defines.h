@@ -162,6 +162,15 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 #define MAYBE_UNUSED
 #endif
 
+/* Start loading the cache line holding *p, for reading, without
+ * waiting for it.  Only a hint: p need not be a valid address.
+ */
+#ifdef __GNUC__
+#define W_PREFETCH(p) __builtin_prefetch((const void*)(p), 0, 3)
+#else
+#define W_PREFETCH(p) ((void) (p))
+#endif
+
 #include <sys/types.h>
 using namespace std;
 
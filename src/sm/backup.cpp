@@ -0,0 +1,219 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+// -*- mode:c++; c-basic-offset:4 -*-
+
+#define SM_SOURCE
+#define BACKUP_C
+
+#include "sm_int_1.h"
+#include "bf_core.h"
+#include "log_archiver.h"
+#include "backup.h"
+
+#include <algorithm>
+#include <sys/stat.h>
+
+// The log holds back one backup's worth of partitions: one at a time.
+static pthread_mutex_t backup_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// A run of pages read or written at once.  Runs start at multiples of
+// max_many_pages, so that each is covered by one page write mutex.
+static const int backup_run_sz = smlevel_0::max_many_pages * sizeof(page_s);
+
+void
+backup_m::_make_info_name(const char* backup, char* buf, int bufsz)
+{
+    w_ostrstream s(buf, bufsz);
+    s << backup << ".info" << ends;
+}
+
+/*
+ * Open a file to copy from.  O_DIRECT if the file system lets us, so
+ * that a backup doesn't flush the volume's pages out of the OS cache.
+ */
+static rc_t
+backup_open_src(const char* name, int& fd)
+{
+    rc_t rc = me()->open(name,
+                    smthread_t::OPEN_RDONLY | smthread_t::OPEN_RAW, 0, fd);
+    if(rc.is_error()) {
+        W_DO(me()->open(name, smthread_t::OPEN_RDONLY, 0, fd));
+    }
+    return RCOK;
+}
+
+/*
+ * Copy size bytes from the start of file "from" to file "to".  With a
+ * vid, "from" is its device, and each run is read under the page write
+ * mutex of its pages.
+ */
+rc_t
+backup_m::_copy(int from, int to, smlevel_0::fileoff_t size,
+                int mb_per_sec, const vid_t& vid)
+{
+    // aligned, for O_DIRECT
+    void* buf = 0;
+    if(posix_memalign(&buf, SM_PAGESIZE, backup_run_sz) != 0) {
+        return RC(eOUTOFMEMORY);
+    }
+
+    rc_t rc;
+    hrtime_t start = gethrtime();
+    for(smlevel_0::fileoff_t off = 0; off < size; off += backup_run_sz) {
+        int n = int(std::min(size - off, smlevel_0::fileoff_t(backup_run_sz)));
+        if(vid != vid_t::null) {
+            lpid_t pid(vid, 0, shpid_t(off / sizeof(page_s)));
+            CRITICAL_SECTION(cs, page_write_mutex_t::locate(pid));
+            rc = me()->pread(from, (char*) buf, n, off);
+        } else {
+            rc = me()->pread(from, (char*) buf, n, off);
+        }
+        if(!rc.is_error()) rc = me()->pwrite(to, (const char*) buf, n, off);
+        if(rc.is_error()) break;
+        ADD_TSTAT(backup_pages, n / sizeof(page_s));
+
+        if(mb_per_sec > 0) {
+            // where we'd be at mb_per_sec
+            double secs = double(off + n) / (double(mb_per_sec) * 1024*1024);
+            hrtime_t due = start + hrtime_t(secs * 1e9);
+            hrtime_t now = gethrtime();
+            if(due > now) {
+                INC_TSTAT(backup_throttle_sleeps);
+                me()->sleep(int((due - now) / 1000000) + 1, "backup throttle");
+            }
+        }
+    }
+    free(buf);
+    return rc;
+}
+
+rc_t
+backup_m::backup_volume(const vid_t& vid, const char* dest,
+                        int mb_per_sec, backup_info_t& info)
+{
+    if(!io->is_mounted(vid)) return RC(eBADVOL);
+    char devname[max_devname];
+    strncpy(devname, io->dev_name(vid), sizeof(devname));
+    devname[sizeof(devname)-1] = '\0';
+
+    CRITICAL_SECTION(cs, backup_mutex);
+
+    info = backup_info_t();
+    info.magic = backup_info_t::magic_val;
+    info.version = backup_info_t::version_val;
+    info.vid = vid;
+    info.lvid = io->get_lvid(vid);
+
+    // Pages dirty in the buffer pool are newer than on disk from their
+    // rec_lsn on; pages dirtied from now on, from the end of the log on.
+    if(log) {
+        info.begin = std::min(log->curr_lsn(), bf->min_rec_lsn());
+        log->set_backup_lsn(info.begin);
+    }
+
+    int from, to;
+    rc_t rc = backup_open_src(devname, from);
+    if(!rc.is_error()) {
+        rc = me()->open(dest, smthread_t::OPEN_WRONLY | smthread_t::OPEN_CREATE
+                        | smthread_t::OPEN_TRUNC, 0666, to);
+        if(!rc.is_error()) {
+            sthread_t::filestat_t st;
+            rc = me()->fstat(from, st);
+            if(!rc.is_error()) rc = _copy(from, to, st.st_size, mb_per_sec, vid);
+            if(!rc.is_error()) rc = me()->fsync(to);
+            W_COERCE(me()->close(to));
+        }
+        W_COERCE(me()->close(from));
+    }
+
+    if(log) {
+        info.end = log->curr_lsn();
+        if(!rc.is_error()) rc = log->flush(info.end);
+        log->set_backup_lsn(lsn_t::max);
+    }
+    W_DO(rc);
+
+    char iname[max_devname];
+    _make_info_name(dest, iname, sizeof(iname));
+    W_DO(me()->open(iname, smthread_t::OPEN_WRONLY | smthread_t::OPEN_CREATE
+                    | smthread_t::OPEN_TRUNC, 0666, to));
+    rc = me()->pwrite(to, &info, sizeof(info), 0);
+    if(!rc.is_error()) rc = me()->fsync(to);
+    W_COERCE(me()->close(to));
+    return rc;
+}
+
+rc_t
+backup_m::read_info(const char* backup, backup_info_t& info)
+{
+    char iname[max_devname];
+    _make_info_name(backup, iname, sizeof(iname));
+    int fd;
+    if(me()->open(iname, smthread_t::OPEN_RDONLY, 0, fd).is_error()) {
+        return RC(eBADBACKUP);
+    }
+    rc_t rc = me()->pread(fd, &info, sizeof(info), 0);
+    W_COERCE(me()->close(fd));
+    if(rc.is_error() || !info.valid()) return RC(eBADBACKUP);
+    return RCOK;
+}
+
+rc_t
+backup_m::copy_back(const char* backup, const char* device)
+{
+    int from, to;
+    W_DO(backup_open_src(backup, from));
+    rc_t rc = me()->open(device, smthread_t::OPEN_WRONLY
+                    | smthread_t::OPEN_CREATE | smthread_t::OPEN_TRUNC,
+                    0666, to);
+    if(!rc.is_error()) {
+        sthread_t::filestat_t st;
+        rc = me()->fstat(from, st);
+        if(!rc.is_error()) rc = _copy(from, to, st.st_size, 0, vid_t::null);
+        if(!rc.is_error()) rc = me()->fsync(to);
+        W_COERCE(me()->close(to));
+    }
+    W_COERCE(me()->close(from));
+    return rc;
+}
+
+rc_t
+backup_m::redo(const backup_info_t& info, int& applied)
+{
+    applied = 0;
+    if(!log) return RCOK;
+
+    // The log recycles its oldest partitions first: if it still has
+    // the one begin is in, it has all we need.
+    char fname[max_devname];
+    log_m::make_log_name(info.begin.hi(), fname, sizeof(fname));
+    struct stat st;
+    if(stat(fname, &st) == 0) {
+        return log_archiver_t::redo_log(info.begin, info.vid, 0, applied);
+    }
+    if(archiver) {
+        return archiver->restore_volume(info.vid, applied);
+    }
+    return RC(eBACKUPLOGGONE);
+}
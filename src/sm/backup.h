@@ -0,0 +1,104 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+// -*- mode:c++; c-basic-offset:4 -*-
+
+#ifndef BACKUP_H
+#define BACKUP_H
+
+#include "w_defines.h"
+
+/**\cond skip */
+/*
+ * Written next to a backup, as <backup>.info: what the backup is of,
+ * and the log range that makes the fuzzy copy consistent.
+ */
+struct backup_info_t {
+    enum {
+        magic_val = 0x4255504b, // "BUPK"
+        version_val = 1
+    };
+    w_base_t::uint4_t   magic;
+    w_base_t::uint4_t   version;
+    lvid_t              lvid;
+    vid_t               vid;
+    w_base_t::uint2_t   pad;
+    w_base_t::uint4_t   pad2;
+    lsn_t               begin;  // redo from here ...
+    lsn_t               end;    // ... to at least here
+
+    bool valid() const {
+        return magic == magic_val && version == version_val;
+    }
+};
+/**\endcond skip */
+
+/**\brief Online backup of volumes.
+ *
+ * \details
+ * A backup is a copy of the device file of a volume, taken while
+ * transactions update it.  The copy reads the device file directly,
+ * never through the buffer pool, in runs of max_many_pages pages,
+ * each under the page write mutex that the page cleaners hold while
+ * they write those pages, so no page is copied half written.
+ *
+ * The copy is fuzzy: pages dirty in the buffer pool, or updated
+ * while it runs, are copied as they are on disk.  Redoing the log
+ * from the oldest rec_lsn in the buffer pool when the copy starts
+ * (begin) to the end of the log when it finishes (end) makes it
+ * consistent; both are written to <backup>.info.  The log keeps its
+ * partitions from begin on while the copy runs.  To restore a backup
+ * after the log has recycled begin, keep a log archive (sm_archdir).
+ */
+class backup_m : public smlevel_1 {
+public:
+    /**\brief Copy mounted volume vid to file dest.
+     * @param[in] mb_per_sec Copy at most this many MB a second;
+     * 0 means as fast as the disks go.
+     */
+    static rc_t         backup_volume(
+        const vid_t&          vid,
+        const char*           dest,
+        int                   mb_per_sec,
+        backup_info_t&        info);
+
+    static rc_t         read_info(const char* backup, backup_info_t& info);
+
+    /**\brief Copy a backup over a device, which must not be mounted.
+     */
+    static rc_t         copy_back(const char* backup, const char* device);
+
+    /**\brief Redo the updates since the backup to the pages of the
+     * restored volume.  Must be called in a transaction with logging
+     * turned off.
+     */
+    static rc_t         redo(const backup_info_t& info, int& applied);
+
+private:
+    static rc_t         _copy(int from, int to, smlevel_0::fileoff_t size,
+                              int mb_per_sec, const vid_t& vid);
+    static void         _make_info_name(const char* backup,
+                                        char* buf, int bufsz);
+};
+
+#endif
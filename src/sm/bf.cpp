@@ -229,7 +229,7 @@ bfcb_t::update_rec_lsn(latch_mode_t mode)
     DBG(<<"pid " << pid() <<" mode=" 
                     << int(mode) << " rec_lsn=" << this->curr_rec_lsn());
     // Sanity check:
-    w_assert1(latch.mode() >= mode);
+    w_assert1(latch_mode_covers(latch.mode(), mode));
     w_assert1(latch.is_latched());
 
 
@@ -372,41 +372,49 @@ private:
     lsn_t                       _lsn;
 };
 
-// bf_filter_sweep_t : used by page cleaner
-// is_good for non-zero dirty pages whose volume matches that given and
-// either:
-//  - page is not hot
-//  - page is hot and given urgent flag is true
-class bf_filter_sweep_t : public bf_filter_t {
+/*********************************************************************
+ *
+ *  class bf_dirty_set_t
+ *
+ *  A cleaner's view of the dirty pages of its volume, gathered in one
+ *  sweep of the buffer pool: in page id order, to write adjacent
+ *  pages in one I/O, and in rec_lsn order, to write first the pages
+ *  that keep the log from being truncated.
+ *
+ *********************************************************************/
+class bf_dirty_set_t {
 public:
-  NORET                         bf_filter_sweep_t(bool urgent, vid_t v);
-    bool                        is_good(const bfcb_t& p) const;
-private:
-  bool                          _urgent;
-    vid_t                       _vol;
-};
+    NORET                       bf_dirty_set_t(int max);
+    NORET                       ~bf_dirty_set_t();
+
+    void                        clear() { _count = 0; }
+    void                        add(const bfcb_t& b);
+    int                         count() const { return _count; }
+
+    int                         choose(
+        int                         budget,
+        int                         old_segment,
+        bool                        old_hot_too,
+        bool                        hot_too,
+        lpid_t*                     pids);
 
-// bf_filter_sweep_old_t : used by page cleaner
-// is_good for non-zero dirty pages whose volume matches that given and
-// its rec_lsn matches the given segment and
-// either:
-//  - page is not hot
-//  - page is hot and given urgent flag is true
-//
-// In other words, it's the same as bf_filter_sweep_t with one add'l
-// criterion: that the page_lsn is in the given segment.
-// This is used to ignore the other pages and thereby give priority 
-// to old pages; when the number of open log segments is > 2.
-class bf_filter_sweep_old_t : public bf_filter_t {
-public:
-    NORET                        bf_filter_sweep_old_t( 
-                                    int log_segment, 
-                                    bool urgent, vid_t v);
-    bool                         is_good(const bfcb_t& p) const;
 private:
-    int                          _segment;
-    vid_t                        _vol;
-    bool _urgent;
+    struct entry_t {
+        lpid_t                      pid;
+        lsn_t                       rec_lsn;
+        bool                        hot;
+        bool                        chosen;
+    };
+    int                         _count;
+    entry_t*                    _entries;
+    entry_t**                   _by_lsn;
+
+    static int                  _cmp_pid(const void* x, const void* y);
+    static int                  _cmp_lsn(const void* x, const void* y);
+
+    // disabled
+    NORET                       bf_dirty_set_t(const bf_dirty_set_t&);
+    bf_dirty_set_t&             operator=(const bf_dirty_set_t&);
 };
 
 class page_writer_thread_t : public smthread_t 
@@ -638,8 +646,14 @@ bf_cleaner_thread_t::run()
     DBG( << " cleaner " << _id << " activated" << endl );
 #endif
 
+    bf_dirty_set_t dirty(bf_m::npages());
+
     int ntimes = 0;
 
+    // How hard we are pushing, from 0 (wait to be kicked) to 1
+    // (sweep again at once); see below.
+    double urgency = 0;
+
     // do this even if no page writers; we'll see sweeps but nothing should
     // be flushed by page writers.
     _ndirty = 0;
@@ -648,18 +662,22 @@ bf_cleaner_thread_t::run()
         INC_TSTAT(bf_cleaner_sweeps);
         {
             // give other threads a chance at the mutex
-            usleep(100*1000);
+            usleep(5*1000);
             CRITICAL_SECTION(cs, _cleaner_mutex); 
             /*
-             *  Wait for wakeup signal
+             *  Wait for wakeup signal; or, while we are in a hurry,
+             *  sweep again anyway, the sooner the more of a hurry.
              */
             while( !_kick_count && !_retire) {
                 // Not enough to warrant re-sweeping.. go to sleep
                 struct timespec when;
-                // 10 seconds
-                sthread_t::timeout_to_timespec(10000, when);
+                // 10 seconds, or under 0.1 second in a hurry
+                sthread_t::timeout_to_timespec(
+                        urgency > 0 ? int(95*(1 - urgency)) + 1 : 10000, 
+                        when);
                 DO_PTHREAD_TIMED(pthread_cond_timedwait( 
                         &_activate_cond, &_cleaner_mutex, &when));
+                if(urgency > 0) break;
             } // else don't go to sleep - just re-sweep
 
             _kick_count = 0;
@@ -667,78 +685,84 @@ bf_cleaner_thread_t::run()
               break;
         }
 
+        /*
+         *  Gather the dirty pages of our volume, and count all 
+         *  of them, which sets _ndirty right again.
+         */
+        dirty.clear();
+        int ndirty = 0;
+        for (long i = 0; i < smlevel_0::bf->npages(); i++)  
+        {
+            bfcb_t &b = bf_core_m::_buftab[i];
+            /* 
+             * Use the refbit as an indicator of how hot it is
+             */
+            if ( (b.set_hotbit(b.refbit())) )
+                b.decr_hotbit();
+
+            // Q: why decrement it here?
+            // find() default is 0
+            // unfix() default is 1
+            // A: the only time it will be > 0 here is if
+            // some caller of unfix or unfix_dirty  or
+            // fix  explicitly gave a larger-than-one hint
+            // This happens by default with certain page types (see
+            // MAKEPAGE macro in *.h) like extent pages.
+            // The pin API allows a vas to set the refbit on
+            // a pinned page as well.
+            // In any case, this bit is only a hint. 
+            // It has nothing to do with the actual latch count.
+            w_assert3( b.hotbit() >= 0);
+
+            if(b.dirty() && b.pid().page) {
+                ndirty++;
+                if(b.pid().vol() == vol()) dirty.add(b);
+            }
+        }
+        _ndirty = ndirty;
 
         /*
-          Figure out how much of a hurry we're in, 
-          based on the number of full log segments:
-          0-1: don't even bother
-          2-6: take non-hot pages
-          7-8: flush everything
+          Figure out how much of a hurry we're in.
+          The log: with 0-2 open partitions, don't even bother; 
+          with more, write the pages whose rec_lsn is in the oldest,
+          which hold up its reuse, and past 4 the hot ones too.
+          The pool: past _dirty_threshold dirty pages (1/8 of it), 
+          write the pages over it, oldest rec_lsn first, and past 3/4,
+          hot ones too.
+          The sooner either would run out, the sooner we sweep again.
          */
-        bf_filter_t* filter = 0;
-        bool prioritize_old_pages = false;
+        double log_pressure = 0;
+        int old_segment = 0;
+        bool old_hot_too = false;
         if(smlevel_0::log) 
         {
-          int oldest_segment = smlevel_0::log->global_min_lsn().file();
-          int open_segments = 
+            int oldest_segment = smlevel_0::log->global_min_lsn().file();
+            int open_segments = 
                           smlevel_0::log->curr_lsn().file() - 
                           oldest_segment + 1;
 
-          if(open_segments > 2) {
-              prioritize_old_pages = open_segments > 4;
-              filter = new bf_filter_sweep_old_t(oldest_segment, 
-                                        prioritize_old_pages, vol());
-          }
+            if(open_segments > 2) {
+                old_segment = oldest_segment;
+                old_hot_too = open_segments > 4;
+                log_pressure = double(open_segments - 2) / 
+                            std::max(1, smlevel_0::max_openlog - 4);
+            }
         }
-
-        if(!filter && _ndirty > _dirty_threshold) 
-        {
-            // no log... just try to keep the pool from overfilling
-            bool urgent = _ndirty > 3*smlevel_0::bf->npages()/4;
-            filter = new bf_filter_sweep_t(urgent, vol());
+        int full = 3*smlevel_0::bf->npages()/4;
+        double dirty_pressure = double(ndirty - _dirty_threshold) /
+                            std::max(1, full - _dirty_threshold);
+        urgency = std::min(1.0, std::max(0.0, 
+                            std::max(log_pressure, dirty_pressure)));
+
+        // our share of the pages over the threshold
+        int budget = 0;
+        if(ndirty > _dirty_threshold) {
+            budget = int(double(ndirty - _dirty_threshold) 
+                            * dirty.count() / ndirty) + 1;
         }
-        if(!filter)
-          continue; // never mind
+        int count = dirty.choose(budget, old_segment, old_hot_too, 
+                            ndirty > full, pids);
 
-        /*
-         *  Get list of dirty pids
-         */
-        int count = 0;
-        {
-            for (long i = 0; i < smlevel_0::bf->npages(); i++)  
-            {
-                /* 
-                 * Use the refbit as an indicator of how hot it is
-                 * Set it before we apply the filter.
-                 */
-                if ( (bf_core_m::_buftab[i].set_hotbit(
-                            bf_core_m::_buftab[i].refbit())
-                            ) )
-                    bf_core_m::_buftab[i].decr_hotbit();
-
-                // Q: why decrement it here?
-                // find() default is 0
-                // unfix() default is 1
-                // A: the only time it will be > 0 here is if
-                // some caller of unfix or unfix_dirty  or
-                // fix  explicitly gave a larger-than-one hint
-                // This happens by default with certain page types (see
-                // MAKEPAGE macro in *.h) like extent pages.
-                // The pin API allows a vas to set the refbit on
-                // a pinned page as well.
-                // In any case, this bit is only a hint. 
-                // It has nothing to do with the actual latch count.
-                w_assert3( bf_core_m::_buftab[i].hotbit() >= 0);
-
-                if ( filter->is_good(bf_core_m::_buftab[i]))
-                {
-                    // We're not expecting null pids:
-                    w_assert9(bf_core_m::_buftab[i].pid().page != 0);
-                    pids[count++] = bf_core_m::_buftab[i].pid();
-                }
-            }
-            delete filter;
-        }
         // Retire does NOT require the background flushing to finish its
         // job before it stops, but it DOES require that all its
         // subordinate threads are cleaned up before it returns.
@@ -765,8 +789,8 @@ bf_cleaner_thread_t::run()
 
             ++ntimes;
 
-            // Sort the pages and delegate to slave page cleaners to
-            // clean the given pages.
+            // Delegate to slave page cleaners to clean the given 
+            // pages (in page id order).
             w_rc_t rc = bf_m::_clean_buf( &_pwc, 
                             // smlevel_0::max_many_pages, 
                             count, 
@@ -779,6 +803,9 @@ bf_cleaner_thread_t::run()
                 W_COERCE(rc);
             }
             atomic_add_int_delta(_ndirty, -count);
+        } else {
+            // nothing we may write yet: wait to be kicked
+            urgency = 0;
         }
         
     } // while !_retire
@@ -967,6 +994,33 @@ bf_m::is_cached(const bfcb_t* b)
         return _core->_in_htab(b);
 }
 
+/*********************************************************************
+ * bf_m::is_resident(pid)
+ *
+ * True if the page is in the buffer pool.  Otherwise the page
+ * may be read directly from the volume (by someone holding a
+ * lock that keeps it from being updated meanwhile).
+ **********************************************************************/
+bool
+bf_m::is_resident(const lpid_t& pid)
+{
+        return _core->is_resident(pid);
+}
+
+
+/*********************************************************************
+ * bf_m::prefetch(pid)
+ *
+ * A hint that the page will be fixed soon: start loading what the
+ * lookup of the page in the buffer pool will touch into the CPU
+ * cache.  Does nothing if the sm_cache_prefetch option is off.
+ **********************************************************************/
+void
+bf_m::prefetch(const lpid_t& pid)
+{
+    if(do_cache_prefetch) _core->prefetch(pid);
+}
+
 
 /*********************************************************************
  *
@@ -1019,7 +1073,8 @@ bf_m::_fix(
             // latch already acquired
             w_assert1(b);
             w_assert1(b->latch.is_mine() || 
-                    (mode == LATCH_SH && b->latch.held_by_me())
+                    ((mode == LATCH_SH || mode == LATCH_NLS) && 
+                     b->latch.held_by_me())
                     );
             easy_find = (found=true); //double assignment
         } else if( ! _cleaner_threads->is_empty() ) {
@@ -1044,8 +1099,13 @@ bf_m::_fix(
             << " found " <<  int(found)  
             );
 
+    // a large scan reads into its own frames 
+    bf_ring_t* ring = me()->scan_ring();
+
     if(!found) {
-        bfcb_t* v = _core->replacement(); 
+        bfcb_t* v = 0;
+        if(ring) v = ring->victim(_core);
+        if(!v) v = _core->replacement(); 
         if(!v) return RC(fcFULL);
 
         // Now replacement() gives us the latch  and we hold it through
@@ -1270,6 +1330,7 @@ bf_m::_fix(
         b->set_pid(pid);
         w_assert2(!b->dirty());                 // dirty flag and rec_lsn are
         w_assert2(b->curr_rec_lsn() == lsn_t::null);// cleared inside ::_replace_out
+        if(ring && !no_read) ring->add(b);
 
         // publish will leave us with the given latch mode,
         // downgrading or releasing the latch as necessary
@@ -1298,7 +1359,7 @@ bf_m::_fix(
     w_assert3( (b->frame()->pid == pid) || 
             no_read || ignore_store_id); // compares stores too
 
-    w_assert1(b->latch.mode() >= mode);
+    w_assert1(latch_mode_covers(b->latch.mode(), mode));
     b->update_rec_lsn(mode);
 
     DBG(<<"pid " << pid <<" mode=" 
@@ -1476,6 +1537,56 @@ bf_m::is_mine(const page_s* buf)
     return _core->is_mine(b);
 }
 
+/*********************************************************************
+ *
+ *  bf_ring_t::bf_ring_t(frames, threshold)
+ *
+ *  A ring of "frames" frames for a scan, that it starts to use 
+ *  once it has read "threshold" pages into the buffer pool.
+ *
+ *********************************************************************/
+NORET
+bf_ring_t::bf_ring_t(int frames, int threshold)
+    : _nframes(frames), _threshold(threshold), _reads(0), _next(0)
+{
+    w_assert1(frames > 0);
+    _frames = new bfcb_t*[frames];
+    _pids = new bfpid_t[frames];
+    for(int i = 0; i < frames; i++) _frames[i] = 0;
+}
+
+NORET
+bf_ring_t::~bf_ring_t()
+{
+    delete[] _frames;
+    delete[] _pids;
+}
+
+bfcb_t*
+bf_ring_t::victim(bf_core_m* core)
+{
+    if(_reads < _threshold || !_frames[_next]) {
+        return (bfcb_t*)0;
+    }
+    bfcb_t* v = core->ring_replacement(_frames[_next], _pids[_next]);
+    if(v) {
+        INC_TSTAT(bf_ring_recycled);
+    } else {
+        INC_TSTAT(bf_ring_fallback);
+    }
+    return v;
+}
+
+void
+bf_ring_t::add(bfcb_t* b)
+{
+    // below the threshold a scan reads like anyone else
+    if(_reads++ < _threshold) return;
+    _frames[_next] = b;
+    _pids[_next] = b->pid();
+    if(++_next == _nframes) _next = 0;
+}
+
 const latch_t*             
 bf_m::my_latch(const page_s* buf) 
 {
@@ -1696,6 +1807,115 @@ bf_m::discard_pinned_page(const page_s* buf)
     }
 }
 
+/*********************************************************************
+ *
+ *  bf_dirty_set_t
+ *
+ *********************************************************************/
+NORET
+bf_dirty_set_t::bf_dirty_set_t(int max) : _count(0)
+{
+    _entries = new entry_t[max];
+    _by_lsn = new entry_t*[max];
+}
+
+NORET
+bf_dirty_set_t::~bf_dirty_set_t()
+{
+    delete[] _entries;
+    delete[] _by_lsn;
+}
+
+void
+bf_dirty_set_t::add(const bfcb_t& b)
+{
+    entry_t &e = _entries[_count++];
+    e.pid = b.pid();
+    e.rec_lsn = b.curr_rec_lsn();
+    e.hot = b.hotbit() != 0;
+    e.chosen = false;
+}
+
+int
+bf_dirty_set_t::_cmp_pid(const void* x, const void* y)
+{
+    return cmp_lpid(&((const entry_t*)x)->pid, &((const entry_t*)y)->pid);
+}
+
+int
+bf_dirty_set_t::_cmp_lsn(const void* x, const void* y)
+{
+    const lsn_t &l1 = (*(entry_t* const*)x)->rec_lsn;
+    const lsn_t &l2 = (*(entry_t* const*)y)->rec_lsn;
+    return l1 < l2 ? -1 : (l2 < l1 ? 1 : 0);
+}
+
+/*********************************************************************
+ *
+ *  bf_dirty_set_t::choose(budget, old_segment, old_hot_too, hot_too, pids)
+ *
+ *  Choose the pages to write, and return them in pids, in page id
+ *  order, and how many there are:
+ *  - those whose rec_lsn is in log partition old_segment or before,
+ *    which keep it from being reused (if not hot, or old_hot_too);
+ *  - then more, oldest rec_lsn first, until there are budget in all
+ *    (if not hot, or hot_too);
+ *  - and with each, the other dirty pages in its run of 
+ *    max_many_pages (the most one write takes; see _clean_segment),
+ *    hot or not, as they cost no more I/Os.
+ *
+ *********************************************************************/
+int
+bf_dirty_set_t::choose(
+    int         budget,
+    int         old_segment,
+    bool        old_hot_too,
+    bool        hot_too,
+    lpid_t*     pids)
+{
+    qsort(_entries, _count, sizeof(entry_t), _cmp_pid);
+    for(int i = 0; i < _count; i++) _by_lsn[i] = &_entries[i];
+    qsort(_by_lsn, _count, sizeof(entry_t*), _cmp_lsn);
+
+    int chosen = 0;
+    for(int i = 0; i < _count; i++) {
+        entry_t &e = *_by_lsn[i];
+        bool old = old_segment && e.rec_lsn.valid() &&
+                    int(e.rec_lsn.file()) <= old_segment;
+        if(!old && chosen >= budget) break;
+        if(e.hot && !(old ? old_hot_too : hot_too)) {
+            INC_TSTAT(bf_sweep_page_hot_skipped);
+            continue;
+        }
+        if(old) INC_TSTAT(bf_cleaner_old_pages);
+        e.chosen = true;
+        chosen++;
+    }
+    if(chosen == 0) return 0;
+
+    int count = 0;
+    for(int i = 0; i < _count; ) {
+        // the dirty pages of one run
+        int end = i+1;
+        bool any = _entries[i].chosen;
+        while(end < _count 
+                && _entries[end].pid.vol() == _entries[i].pid.vol()
+                && _entries[end].pid.page / smlevel_0::max_many_pages 
+                    == _entries[i].pid.page / smlevel_0::max_many_pages) {
+            any = any || _entries[end].chosen;
+            end++;
+        }
+        if(any) {
+            for(int j = i; j < end; j++) {
+                if(!_entries[j].chosen) INC_TSTAT(bf_cleaner_coalesced);
+                pids[count++] = _entries[j].pid;
+            }
+        }
+        i = end;
+    }
+    return count;
+}
+
 void page_writer_thread_t::run() 
 {
 
@@ -2729,6 +2949,39 @@ bf_m::force_volume(vid_t vid, bool flush)
 }
 
 
+/*********************************************************************
+ *
+ *  bf_m::force_unlogged(buf)
+ *
+ *  Write out a page that the caller has fixed EX and updated without
+ *  logging, and mark it clean.  Unlike restart's redo, media recovery
+ *  redoes updates older than anything in the log, so the page can't
+ *  be given a rec_lsn and left to the cleaners.  The page's lsn can
+ *  still be one the log has not made durable yet (media recovery
+ *  redoes the log's tail too), so flush the log to it first (WAL).
+ *
+ *********************************************************************/
+rc_t
+bf_m::force_unlogged(const page_s* buf)
+{
+    bfcb_t* b = get_cb(buf);
+    w_assert1(b && b->latch.is_mine());
+    if(!b->dirty()) return RCOK;
+
+    // before taking the page mutex, which the cleaners wait on
+    if(log && buf->lsn1.valid()) {
+        INC_TSTAT(bf_log_flush_lsn);
+        W_DO(log->flush(buf->lsn1));
+    }
+
+    // same order as the cleaners: latch, then page mutex
+    CRITICAL_SECTION(cs, page_write_mutex_t::locate(b->pid()));
+    W_DO(_write_out(buf, 1));
+    b->mark_clean();
+    return RCOK;
+}
+
+
 /*********************************************************************
  *
  *  bf_m::force_until_lsn(lsn, flush)
@@ -3214,59 +3467,6 @@ bf_filter_none_t::is_good(const bfcb_t& p) const
     return p.pid() != lpid_t::null;
 }
 
-NORET
-bf_filter_sweep_t::bf_filter_sweep_t(bool urgent, vid_t v)
-  : _urgent(urgent), _vol(v)
-{
-}
-
-bool
-bf_filter_sweep_t::is_good(const bfcb_t& p) const
-{
-    if( p.pid()._stid.vol != _vol)  return false;
-    if( ! p.pid().page)             return false;
-
-    if( p.hotbit() ) {
-        // skip hot pages even if they are dirty.
-        // however, if the pool is too full
-        // we'll include the dirty hot pages
-        //
-        if (!_urgent) {
-            INC_TSTAT(bf_sweep_page_hot_skipped);
-            return false; 
-        }
-    }
-    return p.dirty();
-}
-
-NORET
-bf_filter_sweep_old_t::bf_filter_sweep_old_t(int log_segment, 
-        bool urgent, vid_t v )
-    : _segment(log_segment), _vol(v), _urgent(urgent)
-{
-}
-
-bool bf_filter_sweep_old_t::is_good(const bfcb_t& p) const
-{
-    if( p.pid()._stid.vol != _vol)       return false;
-    if( ! p.pid().page)                  return false;
-    if( ! p.curr_rec_lsn().hi() == _segment ) return false;
-
-    if( p.hotbit() ) {
-        // skip hot pages even if they are dirty.
-        // however, if the pool is too full
-        // we'll include the dirty hot pages
-        //
-        if (!_urgent) {
-            INC_TSTAT(bf_sweep_page_hot_skipped);
-            return false; 
-        }
-    }
-    
-    // can't afford to skip hot pages any more
-    return p.dirty();
-}
-
 NORET
 bf_filter_lsn_t::bf_filter_lsn_t(const lsn_t& lsn)  
     : _lsn(lsn)
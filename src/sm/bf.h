@@ -99,6 +99,8 @@ public:
     static int                   npages();
 
     static bool                  is_cached(const bfcb_t* e);
+    static bool                  is_resident(const lpid_t& pid);
+    static void                  prefetch(const lpid_t& pid);
 
     static rc_t                  fix(
         page_s*&                           page,
@@ -188,6 +190,7 @@ public:
     static rc_t                  force_volume(
         vid_t                             vid, 
         bool                             flush = false);
+    static rc_t                  force_unlogged(const page_s* buf);
 
     static bool                 is_mine(const page_s* buf) ;
     static const latch_t*       my_latch(const page_s* buf) ;
@@ -282,6 +285,42 @@ private:
 
 };
 
+/**\brief The frames of a large scan.
+ * \details
+ * Once a scan has read more than a threshold of pages into the
+ * buffer pool, each page it reads after that replaces the one it read
+ * a ring's length before, instead of a frame the clock picks, so the
+ * scan stops displacing everyone else's pages.  A frame someone else
+ * has come to use (or dirtied) leaves the ring, and the clock picks
+ * instead.
+ *
+ * A scan installs its ring in its thread with smthread_t::set_scan_ring
+ * while it fixes pages; see scan_file_i.
+ */
+class bf_ring_t {
+public:
+    NORET                       bf_ring_t(int frames, int threshold);
+    NORET                       ~bf_ring_t();
+
+    /// The frame for the next page the scan reads, EX-latched
+    /// and out of the hash table, or NULL.
+    bfcb_t*                     victim(bf_core_m* core);
+    /// The scan has read a page into b.
+    void                        add(bfcb_t* b);
+
+private:
+    int                         _nframes;
+    int                         _threshold;
+    int                         _reads;
+    int                         _next;
+    bfcb_t**                    _frames;
+    bfpid_t*                    _pids;
+
+    // disabled
+    NORET                       bf_ring_t(const bf_ring_t&);
+    bf_ring_t&                  operator=(const bf_ring_t&);
+};
+
 inline rc_t
 bf_m::fix(
     page_s*&            ret_page,
@@ -116,12 +116,14 @@ void bfcb_t::check() const
     // I can only make checks when I hold the latch at least in SH mode.
     int count = latch.held_by_me(); 
     bool mine = latch.is_mine();  // true iff I hold it in EX mode
+    // fixed without latching: the latch counts nothing
+    bool unlatched = (latch.mode() == LATCH_NLS || latch.mode() == LATCH_NLX);
     if(count > 0) {
         if(mine) {
             // EX mode
             // NOTE: the latch_cnt can be > 1 because THIS thread can
             // hold it more than once.
-            w_assert2(latch.latch_cnt() == count);
+            w_assert2(unlatched || latch.latch_cnt() == count);
 
             // NOTE: the pin count can be > 1 because the
             // protocol is : pin_frame, then latch
@@ -138,7 +140,7 @@ void bfcb_t::check() const
             // is waiting for the latch.
             // w_assert2(latch.latch_cnt() <= _pin_cnt);
             w_assert2(_pin_cnt >= 1);
-            w_assert2(latch.mode() == LATCH_SH);
+            w_assert2(unlatched || latch.mode() == LATCH_SH);
         }
     }
 }
@@ -300,6 +302,26 @@ bfcb_t::print_frame(ostream& o, bool in_htab)
     return o;
 }
 
+/*
+ * Latch a frame for fix, charging any wait for the latch to the
+ * thread's transaction.  The clock is read only if the latch
+ * cannot be had right away.
+ */
+static w_rc_t
+latch_frame(bfcb_t* p, latch_mode_t mode, 
+        sthread_t::timeout_in_ms timeout = sthread_base_t::WAIT_FOREVER)
+{
+    if(timeout != sthread_base_t::WAIT_IMMEDIATE && xct()) {
+        w_rc_t rc = p->latch.latch_acquire(mode, 
+                                sthread_base_t::WAIT_IMMEDIATE);
+        if(!rc.is_error() || rc.err_num() != sthread_t::stTIMEOUT)
+            return rc;
+        xct_wait_timer_t w(xct_wait_latch);
+        return p->latch.latch_acquire(mode, timeout);
+    }
+    return p->latch.latch_acquire(mode, timeout);
+}
+
 /*********************************************************************
  *
  *  bf_core_m::latched_by_me(p)
@@ -559,6 +581,34 @@ bf_core_m::get_cb(const bfpid_t& p, bfcb_t*& ret) const
     return false;
 }
 
+/*********************************************************************
+ *
+ *  bf_core_m::is_resident(p)
+ *
+ *  Returns true if page "p" is in the buffer pool, either in the
+ *  hash table or in-transit-out.  If it is neither, the copy on
+ *  disk is current as of the time of the call.
+ *
+ *********************************************************************/
+bool
+bf_core_m::is_resident(const bfpid_t& p) const
+{
+    // Holding the transit bucket mutex keeps the page from
+    // being moved between the hash table and the in-transit-out
+    // list while we look.
+    transit_bucket_t &tb = transit_bucket_t::get(p);
+    CRITICAL_SECTION(cs, tb._tb_mutex); // PROTOCOL
+
+    if(tb.is_in_transit_out(p)) return true;
+
+    bfcb_t* f = _htab->lookup(p);
+    if (f)  {
+        f->unpin_frame(); // lookup pinned it
+        return true;
+    }
+    return false;
+}
+
 /* This pair atomically updates a singly linked list.
  */
 bfcb_t* bfcb_unused_list::take() {
@@ -756,7 +806,7 @@ bf_core_m::grab(
         _htab->_table[idx[i]]._lock.release(); // PROTOCOL
         cs.exit(); // PROTOCOL
         
-        rc_t rc = p->latch.latch_acquire(mode, timeout); // PROTOCOL
+        rc_t rc = latch_frame(p, mode, timeout); // PROTOCOL
         if (rc.is_error()) {
             /*
              *  Clean up and bail out.
@@ -838,6 +888,20 @@ bf_core_m::grab(
    
  */
 
+/*********************************************************************
+ *
+ *  bf_core_m::prefetch(pid)
+ *
+ *  Start loading the hash table buckets for "pid" into the CPU cache,
+ *  so that a find() of the page soon after doesn't stall on them.
+ *
+ *********************************************************************/
+void
+bf_core_m::prefetch(const bfpid_t& pid) const
+{
+    _htab->prefetch(pid);
+}
+
 w_rc_t 
 bf_core_m::find(
     bfcb_t*&          ret,
@@ -857,6 +921,10 @@ bf_core_m::find(
 
     if( (p=_htab->lookup(pid)) == NULL )
         return RC(eFRAMENOTFOUND);
+
+    // The caller looks at the page header as soon as we return;
+    // get it on its way while we latch the frame.
+    if(do_cache_prefetch) W_PREFETCH(p->frame());
     
 
     w_assert2(p->pin_cnt() > 0);
@@ -870,7 +938,7 @@ bf_core_m::find(
 
     INC_TSTAT(bf_hit_cnt);
 
-    w_rc_t rc = p->latch.latch_acquire(mode, timeout); // PROTOCOL
+    w_rc_t rc = latch_frame(p, mode, timeout); // PROTOCOL
     if (rc.is_error())  {
         /*
          *  Clean up and bail out.
@@ -903,7 +971,7 @@ bf_core_m::find(
 
     ret = p;
     w_assert2((pid == p->frame()->pid) && (pid == p->pid()));
-    w_assert1(p->latch.mode() >= mode); 
+    w_assert1(latch_mode_covers(p->latch.mode(), mode)); 
     w_assert1(p->latch.held_by_me() >= 1); // since mode is not NL
     if(mode == LATCH_EX || mode == LATCH_NLX) {
         w_assert1(p->latch.is_mine()); 
@@ -1160,7 +1228,7 @@ bf_core_m::pin(bfcb_t* p, latch_mode_t mode)
     }
 
     // now acquire the latch (maybe again)
-    w_rc_t rc = p->latch.latch_acquire(mode) ; // PROTOCOL
+    w_rc_t rc = latch_frame(p, mode) ; // PROTOCOL
     p->check();
     w_assert1(p->pin_cnt() > 0);
     return rc;    
@@ -1490,6 +1558,14 @@ bool bf_core_m::can_replace(bfcb_t* p, int rounds)
                 }
                 break;
 
+            case ring_rounds:
+                // A scan's own frame: clean, and nobody else has 
+                // given it more than the scan's refbit since.
+                if( !p->dirty() && p->refbit() <= 1 && !p->hotbit() ) {
+                    found=true; 
+                }
+                break;
+
             case 0: 
                 // nothing is satisfactory. Not used at the moment.
                 w_assert0(0); 
@@ -1659,108 +1735,144 @@ bf_core_m::replacement()
          * Found one!
          *
          * Now we have to lock the htbucket down and check for real.
-         *
-         * It may be that the frame's page has changed, or
-         * that it was removed from the htable, or that its
-         * status changed to something unacceptable.
-         *
-         * Note 1: once we hold the bucket lock, the page
-         * cannot change from unpinned to pinned. So, we
-         * remove it immediately while we still hold the
-         * bucket lock. If a thread tries to grab() this
-         * frame, it will block on the main mutex (which we
-         * hold) until we've had a chance to put this frame in
-         * its new home.
-         *
-         * Note 2: the page could get moved by a cuckoo hash
-         * insert. if that happens while we're finding the
-         * page, the hash may point to the wrong bucket. While
-         * we *could* deal with this (by retrying to locate
-         * this page) we don't currently bother to do so. 
-         * Instead we just look for another victim.
          */
-            
-        int idx = p->hash();
         bfpid_t pid = p->pid();
+        bfcb_t* v = _claim(p, pid, rounds);
+        if(v) return v;
+        // drat! try again
+    }
+}
 
-        transit_bucket_t* volatile tb = &transit_bucket_t::get(pid);
-        {
-        CRITICAL_SECTION(tcs, tb->_tb_mutex); // PROTOCOL
+/*********************************************************************
+ *
+ *  bf_core_m::ring_replacement(p, pid)
+ *
+ *  Like replacement(), but the frame is p, which a scan read pid into
+ *  (see bf_ring_t), and it is not taken if it has changed hands or
+ *  other threads use the page.  Returns p, EX-latched, or NULL.
+ *
+ *********************************************************************/
+bfcb_t* 
+bf_core_m::ring_replacement(bfcb_t* p, const bfpid_t& pid)
+{
+    if(p->pid() != pid || !_in_htab(p) || !can_replace(p, ring_rounds)) {
+        return (bfcb_t*)0;
+    }
+    return _claim(p, pid, ring_rounds);
+}
 
-        htab::bucket &b = _htab->_table[idx];
+/*********************************************************************
+ *
+ *  bf_core_m::_claim(p, pid, rounds)
+ *
+ *  Take p, a candidate for replacement holding pid, out of the hash
+ *  table, if it still is one: see replacement().  Returns p,
+ *  EX-latched, or NULL.
+ *
+ *********************************************************************/
+bfcb_t*
+bf_core_m::_claim(bfcb_t* p, const bfpid_t& pid, int rounds)
+{
+    /*
+     * It may be that the frame's page has changed, or
+     * that it was removed from the htable, or that its
+     * status changed to something unacceptable.
+     *
+     * Note 1: once we hold the bucket lock, the page
+     * cannot change from unpinned to pinned. So, we
+     * remove it immediately while we still hold the
+     * bucket lock. If a thread tries to grab() this
+     * frame, it will block on the main mutex (which we
+     * hold) until we've had a chance to put this frame in
+     * its new home.
+     *
+     * Note 2: the page could get moved by a cuckoo hash
+     * insert. if that happens while we're finding the
+     * page, the hash may point to the wrong bucket. While
+     * we *could* deal with this (by retrying to locate
+     * this page) we don't currently bother to do so. 
+     * Instead we just look for another victim.
+     */
         
-        w_assert2(b._lock.is_mine()==false);
+    int idx = p->hash();
+
+    transit_bucket_t* volatile tb = &transit_bucket_t::get(pid);
+    {
+    CRITICAL_SECTION(tcs, tb->_tb_mutex); // PROTOCOL
+
+    htab::bucket &b = _htab->_table[idx];
+    
+    w_assert2(b._lock.is_mine()==false);
+    {
+        CRITICAL_SECTION(bcs, b._lock); // PROTOCOL
+        w_assert2(b._lock.is_mine());
+
+        w_rc_t rc = p->latch.latch_acquire(LATCH_EX, WAIT_IMMEDIATE); 
+        // otherwise who knows what other threads are doing...
+        if(!rc.is_error()) 
         {
-            CRITICAL_SECTION(bcs, b._lock); // PROTOCOL
-            w_assert2(b._lock.is_mine());
+            // I don't like this - other threads hold onto the
+            // page mutex for a long time (_write_out, _replace_out).
+            //
+            // Rather than preventing the replacement() from happening,
+            // we should cope with the disappearance of the page.
+            //
+            // We try the page mutex.
 
-            w_rc_t rc = p->latch.latch_acquire(LATCH_EX, WAIT_IMMEDIATE); 
-            // otherwise who knows what other threads are doing...
-            if(!rc.is_error()) 
-            {
-                // I don't like this - other threads hold onto the
-                // page mutex for a long time (_write_out, _replace_out).
-                //
-                // Rather than preventing the replacement() from happening,
-                // we should cope with the disappearance of the page.
-                //
-                // We try the page mutex.
-
-                pthread_mutex_t* page_write_mutex = 
-                    page_write_mutex_t::locate(pid);
-                if(pthread_mutex_trylock(page_write_mutex) == EBUSY) {
-                    page_write_mutex = NULL;
-                }
+            pthread_mutex_t* page_write_mutex = 
+                page_write_mutex_t::locate(pid);
+            if(pthread_mutex_trylock(page_write_mutex) == EBUSY) {
+                page_write_mutex = NULL;
+            }
 
-                // hold onto it long enough to do the following check
-                // If the pointer is null, 
-                // it means we don't have the mutex, and auto_release does nothing.
-                auto_release_t<pthread_mutex_t> cs(page_write_mutex);
+            // hold onto it long enough to do the following check
+            // If the pointer is null, 
+            // it means we don't have the mutex, and auto_release does nothing.
+            auto_release_t<pthread_mutex_t> cs(page_write_mutex);
 
-                if(page_write_mutex) // we hold the mutex...
+            if(page_write_mutex) // we hold the mutex...
+            {
+                // In event of race, the pid in the frame could have changed
+                if(b.get_frame(pid) == p && // We have the htab bucket lock. 
+                    p->pid() == pid && 
+                    _in_htab(p) && // could have been removed altogether
+                    can_replace(p, rounds) && 
+                    _htab->remove(p))  // changes p->hash_func
                 {
-                    // In event of race, the pid in the frame could have changed
-                    if(b.get_frame(pid) == p && // We have the htab bucket lock. 
-                        p->pid() == pid && 
-                        _in_htab(p) && // could have been removed altogether
-                        can_replace(p, rounds) && 
-                        _htab->remove(p))  // changes p->hash_func
-                    {
-                        w_assert2(p->hash() == idx);
-                        w_assert2(!_in_htab(p));
-                        // Note : we have both the transit-bucket lock and
-                        // the htab bucket lock here.
-                        p->set_old_pid(); // now old_pid_valid() is true.
-                        if(p->dirty())  {
-                            tb->make_in_transit_out(p->pid());
-                        }
-                        w_assert1(p->frame() != 0);
-                        // In this case, the frame is latched
-                        w_assert1(p->latch.is_mine() == true);
-                        return p;
+                    w_assert2(p->hash() == idx);
+                    w_assert2(!_in_htab(p));
+                    // Note : we have both the transit-bucket lock and
+                    // the htab bucket lock here.
+                    p->set_old_pid(); // now old_pid_valid() is true.
+                    if(p->dirty())  {
+                        tb->make_in_transit_out(p->pid());
                     }
+                    w_assert1(p->frame() != 0);
+                    // In this case, the frame is latched
+                    w_assert1(p->latch.is_mine() == true);
+                    return p;
                 }
+            }
 
 #if SM_PLP_TRACING
-        if (_ptrace_level>=PLP_TRACE_PAGE) {
-            gettimeofday(&my_time, NULL);
-            CRITICAL_SECTION(plpcs,_ptrace_lock);
-            _ptrace_out << p->pid() << " " << pthread_self() << " " << p->latch.mode() << " "
-                        << my_time.tv_sec << "." << my_time.tv_usec << endl;
-            plpcs.exit();
-        }
+    if (_ptrace_level>=PLP_TRACE_PAGE) {
+        gettimeofday(&my_time, NULL);
+        CRITICAL_SECTION(plpcs,_ptrace_lock);
+        _ptrace_out << p->pid() << " " << pthread_self() << " " << p->latch.mode() << " "
+                    << my_time.tv_sec << "." << my_time.tv_usec << endl;
+        plpcs.exit();
+    }
 #endif
 
-                p->latch.latch_release();
-            } 
-            // We didn't acquire the latch if rc.is_error
-            // so let's assert here
-            w_assert1(p->latch.is_mine() == false);
-        } // end critical section
-        
-        } // end critical section
-        // drat! try again
-    }
+            p->latch.latch_release();
+        } 
+        // We didn't acquire the latch if rc.is_error
+        // so let's assert here
+        w_assert1(p->latch.is_mine() == false);
+    } // end critical section
+    
+    } // end critical section
+    return (bfcb_t*)0;
 }
 
 
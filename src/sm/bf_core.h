@@ -121,8 +121,13 @@ public:
     static int                   collect(vtable_t&, bool names_too);
 
     bool                         get_cb(const bfpid_t& p, bfcb_t*& ret) const;
+    bool                         is_resident(const bfpid_t& p) const;
+    void                         prefetch(const bfpid_t& p) const;
 
     bfcb_t*                      replacement();
+    bfcb_t*                      ring_replacement(
+        bfcb_t*                       p,
+        const bfpid_t&                pid);
     w_rc_t                       grab(
         bfcb_t*&                      ret,
         const bfpid_t&                p,
@@ -184,6 +189,8 @@ public:
 
     friend ostream&              operator<<(ostream& out, const bf_core_m& mgr);
  
+    /// rounds for can_replace: a frame a scan recycles (bf_ring_t)
+    enum { ring_rounds = -1 };
     static bool                  can_replace(bfcb_t* p, int rounds);
 
     void                         htab_stats(bf_htab_stats_t &out) const;
@@ -191,6 +198,10 @@ public:
 private:
     struct init_thread_t;
     w_rc_t                      _remove(bfcb_t*& p);
+    bfcb_t*                     _claim(
+        bfcb_t*                      p,
+        const bfpid_t&               pid,
+        int                          rounds);
     bool                        _in_htab(const bfcb_t* e) const;
 
     // FOR DEBUGGING:
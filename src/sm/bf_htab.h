@@ -132,8 +132,10 @@ public: // grot: this should be protected
     class bucket {
     public:
         // According to Ryan, no noticable contention on this, so
-        // (fast/not-scalable) tatas locks seem to be ok. 
-        tatas_lock            _lock;
+        // (fast/not-scalable) tatas-style locks seem to be ok; but
+        // a holder can be descheduled when we run more threads than
+        // cores, so waiters park after a bounded spin.
+        spin_park_lock        _lock;
         bfcb_t* volatile      _slots[SLOT_COUNT];
         int                   _count;
         NORET               bucket() : _count(0) { 
@@ -184,6 +186,14 @@ public:
     void   stats(bf_htab_stats_t &) const;
 
     bfcb_t *lookup(bfpid_t const &pid) const;
+
+    // Start loading the buckets lookup(pid) will search into
+    // the CPU cache.
+    void   prefetch(bfpid_t const &pid) const {
+        for(int i=0; i < HASH_COUNT; i++) {
+            W_PREFETCH(&_table[hash(i, pid)]);
+        }
+    }
     bfcb_t *_lookup_harsh(bfpid_t const &pid) const; 
     bool   _lookup(const lpid_t &pid) const; // for unit-testing only
 
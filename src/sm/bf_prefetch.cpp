@@ -86,6 +86,10 @@ bf_prefetch_thread_t::_table[
 #define FAI bf_prefetch_thread_t::pf_failure
 #define FTL bf_prefetch_thread_t::pf_fatal
 #define LST 
+// A page fetched before the thread started on it is fixed by
+// the fetching thread, and the request is dropped (requested->init):
+// the thread only looks at the current frame, so it would never
+// finish a frame left behind as grabbed.
 //        pf_request        
 //        |        pf_get_error        
 //        |        |        pf_start_fix        
@@ -97,7 +101,7 @@ bf_prefetch_thread_t::_table[
 { /*init      */
         REQ,        INI,         FTL,         FTL,         FTL,           FTL,          INI
 },{/*requested */
-        REQ,        REQ,         TRS,         FTL,         GRB,           FAI,          REQ
+        REQ,        REQ,         TRS,         FTL,         INI,           FAI,          REQ
 },{/*in_transit*/
         FTL,        TRS,         FTL,         AVL,         GRB,           FAI,          FTL
 },{/*available */
@@ -376,11 +380,15 @@ bf_prefetch_thread_t::run()
     DBGTHRD(<< "acquiring mutex");
     CRITICAL_SECTION(cs, _prefetch_mutex);
 
-    DBGTHRD(<< "awaiting kick");
-    DO_PTHREAD(pthread_cond_wait(&_activate, &_prefetch_mutex));
-
     while(!_retire) {
         i = _f;
+        if(_info[i]._status != pf_requested) {
+            // The kick for a request or for retire() may have come
+            // before we got here, so look before waiting for one.
+            DBGTHRD(<< "awaiting kick");
+            DO_PTHREAD(pthread_cond_wait(&_activate, &_prefetch_mutex));
+            continue;
+        }
         DBGTHRD(<< "kicked i=" << i);
         {
             frame_info         &inf = _info[i];
@@ -419,7 +427,6 @@ bf_prefetch_thread_t::run()
                 new_state(i, pf_end_fix);
             }
         }
-        DO_PTHREAD(pthread_cond_wait(&_activate, &_prefetch_mutex));
     } /* while */
 }
 
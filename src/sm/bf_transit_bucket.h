@@ -126,6 +126,15 @@ public:
         // no longer in-transit-out
     }
 
+    /// True iff this pid is in-transit-out.
+    /// Caller holds the transit bucket mutex.
+    bool is_in_transit_out(const bfpid_t &pid) const {
+        for(int i=0; i < _page_count; i++) {
+            if( _pages[i] == pid ) return true;
+        }
+        return false;
+    }
+
     /// Called by publish_partial.
     /// Signal waiters that this page is no longer in-transit-out.
     /// Removes the page from the bucket if it is in there. (Is only
@@ -89,6 +89,13 @@ rc_t badcc() {
  *
  ********************************************************************/
 
+NORET
+btree_m::~btree_m()
+{
+    btree_impl::_retire_prefetch_threads();
+}
+
+
 smsize_t                        
 btree_m::max_entry_size() {
     return btree_p::max_entry_size;
@@ -905,6 +912,36 @@ btree_m::lookup(
 }
 
 
+/*********************************************************************
+ *
+ *  btree_m::lookup_batch(...)
+ *
+ *  Look up count keys at once. The keys are already scrambled and
+ *  the probes sorted by key, so that the lookups walk the tree
+ *  from left to right and share the leaves they land on.
+ *
+ *********************************************************************/
+rc_t
+btree_m::lookup_batch(
+    const lpid_t&         root,        // I-  root of btree
+    bool                  unique, // I-  true if btree is unique
+    concurrency_t         cc,        // I-  concurrency control
+    int                   count,  // I-  number of probes
+    bt_probe_t            probes[], // IO- the probes, sorted by key
+    const bool            bIgnoreLatches)
+{
+    if(
+        (cc != t_cc_none) && (cc != t_cc_file) &&
+        (cc != t_cc_kvl) && (cc != t_cc_modkvl) &&
+        (cc != t_cc_im) 
+        ) return badcc();
+
+    W_DO( btree_impl::_lookup_batch(root, unique, cc, count, probes,
+                bIgnoreLatches) );
+    return RCOK;
+}
+
+
 /*
  * btree_m::lookup_prev() - find previous entry 
  * 
@@ -1417,6 +1454,7 @@ btree_m::fetch(cursor_t& cursor, const bool bIgnoreLatches)
                         goto again;
                     }
                 } // else got lock 
+                if(xct()) W_DO(xct()->occ_read(kvl, *child));
 
             } 
 
@@ -75,6 +75,16 @@ class btree_p;
 struct btree_stats_t;
 class bt_cursor_t;
 
+/*
+ * One key of a batched lookup (btree_m::lookup_batch).
+ */
+struct bt_probe_t {
+    const cvec_t*       key;    // I-  key we want to find, scrambled
+    void*               el;     // I-  buffer to put el found
+    smsize_t*           elen;   // IO- size of el
+    bool*               found;  // O-  true if key is found
+};
+
 /*--------------------------------------------------------------*
  *  class btree_m                                                *
  *--------------------------------------------------------------*/
@@ -88,7 +98,7 @@ class btree_m : public smlevel_2 {
 
 public:
     NORET                        btree_m()   {};
-    NORET                        ~btree_m()  {};
+    NORET                        ~btree_m();
 
     static smsize_t                max_entry_size(); 
 
@@ -292,6 +302,13 @@ public:
         smsize_t&                     elen,
         bool&                     found,
 	bool                         use_dirbuf = false);
+    static rc_t                        lookup_batch(
+        const lpid_t&                     root, 
+        bool                             unique,
+        concurrency_t                    cc,
+        int                              count,
+        bt_probe_t                       probes[],
+	const bool                       bIgnoreLatches = false);
 
     /* for lid service only */
     static rc_t                        lookup_prev(
@@ -0,0 +1,194 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+   
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+   
+                         All Rights Reserved.
+   
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+   
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+/*<std-header orig-src='shore'>
+
+ $Id$
+
+SHORE -- Scalable Heterogeneous Object REpository
+
+Copyright (c) 1994-99 Computer Sciences Department, University of
+                      Wisconsin -- Madison
+All Rights Reserved.
+
+Permission to use, copy, modify and distribute this software and its
+documentation is hereby granted, provided that both the copyright
+notice and this permission notice appear in all copies of the
+software, derivative works or modified versions, and any portions
+thereof, and that both notices appear in supporting documentation.
+
+THE AUTHORS AND THE COMPUTER SCIENCES DEPARTMENT OF THE UNIVERSITY
+OF WISCONSIN - MADISON ALLOW FREE USE OF THIS SOFTWARE IN ITS
+"AS IS" CONDITION, AND THEY DISCLAIM ANY LIABILITY OF ANY KIND
+FOR ANY DAMAGES WHATSOEVER RESULTING FROM THE USE OF THIS SOFTWARE.
+
+This software was developed with support by the Advanced Research
+Project Agency, ARPA order number 018 (formerly 8230), monitored by
+the U.S. Army Research Laboratory under contract DAAB07-91-C-Q518.
+Further funding for this work was provided by DARPA through
+Rome Research Laboratory Contract No. F30602-97-2-0247.
+
+*/
+
+#include "w_defines.h"
+
+/*  -- do not edit anything above this line --   </std-header>*/
+
+#define SM_SOURCE
+#define BTREE_HASH_INDEX_C
+#include "sm_int_0.h"
+#include "btree_hash_index.h"
+
+btree_hash_index::btree_hash_index()
+    : _nstores(0), _entries(0), _locks(0)
+{
+    for(int i=0; i < max_stores; i++) _stores[i] = 0;
+}
+
+btree_hash_index::~btree_hash_index() 
+{
+    shutdown();
+}
+
+void btree_hash_index::shutdown()
+{
+    CRITICAL_SECTION(cs, _store_lock);
+    for(int i=0; i < max_stores; i++) _stores[i] = 0;
+    _nstores = 0;
+    delete [] _entries;
+    _entries = 0;
+    delete [] _locks;
+    _locks = 0;
+}
+
+/* 
+ * FNV-1a over the store, the key length and the start of the key. 
+ * Keys that share a long prefix may collide; the lookup compares
+ * the whole key on the leaf anyway.
+ */
+w_base_t::uint4_t 
+btree_hash_index::_hash(store_key_t store, const cvec_t& key)
+{
+    unsigned char buf[64];
+    size_t len = key.copy_to(buf, sizeof(buf));
+
+    w_base_t::uint4_t h = 2166136261u;
+    store ^= store_key_t(key.size()) << 48;
+    for(int i=0; i < 8; i++) {
+        h = (h ^ w_base_t::uint4_t(store & 0xff)) * 16777619u;
+        store >>= 8;
+    }
+    for(size_t j=0; j < len; j++) {
+        h = (h ^ buf[j]) * 16777619u;
+    }
+    return h;
+}
+
+rc_t btree_hash_index::enable(const stid_t& stid)
+{
+    store_key_t s = _store_key(stid);
+    CRITICAL_SECTION(cs, _store_lock);
+    int empty = -1;
+    for(int i=0; i < max_stores; i++) {
+        if(_stores[i] == s) return RCOK;
+        if(_stores[i] == 0 && empty < 0) empty = i;
+    }
+    if(empty < 0) return RC(smlevel_0::eHASHINDEXFULL);
+
+    if(!_entries) {
+        _entries = new entry_t[nentries]();
+        _locks = new queue_based_lock_t[nlocks];
+    }
+    // an old entry for this store id might still be in the table,
+    // but the LSN check keeps it from being used
+    _stores[empty] = s;
+    _nstores++;
+    return RCOK;
+}
+
+void btree_hash_index::disable(const stid_t& stid)
+{
+    store_key_t s = _store_key(stid);
+    CRITICAL_SECTION(cs, _store_lock);
+    bool found = false;
+    for(int i=0; i < max_stores; i++) {
+        if(_stores[i] == s) {
+            _stores[i] = 0;
+            _nstores--;
+            found = true;
+        }
+    }
+    if(!found) return;
+
+    for(int i=0; i < nentries; i++) {
+        CRITICAL_SECTION(ecs, _lock_for(i));
+        if(_entries[i].store == s) _entries[i].store = 0;
+    }
+}
+
+bool btree_hash_index::is_enabled(const stid_t& stid) const
+{
+    if(_nstores == 0) return false;
+    store_key_t s = _store_key(stid);
+    for(int i=0; i < max_stores; i++) {
+        if(_stores[i] == s) return true;
+    }
+    return false;
+}
+
+bool btree_hash_index::probe(const stid_t& stid, const cvec_t& key,
+        shpid_t& leaf, slotid_t& slot, lsn_t& lsn)
+{
+    store_key_t s = _store_key(stid);
+    w_base_t::uint4_t h = _hash(s, key);
+    CRITICAL_SECTION(cs, _lock_for(h));
+    entry_t& e = _entry_for(h);
+    if(e.store != s || e.hash != h) return false;
+    leaf = e.leaf;
+    slot = e.slot;
+    lsn = e.lsn;
+    return true;
+}
+
+void btree_hash_index::insert(const stid_t& stid, const cvec_t& key,
+        shpid_t leaf, slotid_t slot, const lsn_t& lsn)
+{
+    store_key_t s = _store_key(stid);
+    w_base_t::uint4_t h = _hash(s, key);
+    CRITICAL_SECTION(cs, _lock_for(h));
+    entry_t& e = _entry_for(h);
+    e.store = s;
+    e.hash = h;
+    e.leaf = leaf;
+    e.slot = slot;
+    e.lsn = lsn;
+}
+
+void btree_hash_index::remove(const stid_t& stid, const cvec_t& key)
+{
+    store_key_t s = _store_key(stid);
+    w_base_t::uint4_t h = _hash(s, key);
+    CRITICAL_SECTION(cs, _lock_for(h));
+    entry_t& e = _entry_for(h);
+    if(e.store == s && e.hash == h) e.store = 0;
+}
@@ -0,0 +1,155 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+   
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+   
+                         All Rights Reserved.
+   
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+   
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+/*<std-header orig-src='shore' incl-file-exclusion='BTREE_HASH_INDEX_H'>
+
+ $Id$
+
+SHORE -- Scalable Heterogeneous Object REpository
+
+Copyright (c) 1994-99 Computer Sciences Department, University of
+                      Wisconsin -- Madison
+All Rights Reserved.
+
+Permission to use, copy, modify and distribute this software and its
+documentation is hereby granted, provided that both the copyright
+notice and this permission notice appear in all copies of the
+software, derivative works or modified versions, and any portions
+thereof, and that both notices appear in supporting documentation.
+
+THE AUTHORS AND THE COMPUTER SCIENCES DEPARTMENT OF THE UNIVERSITY
+OF WISCONSIN - MADISON ALLOW FREE USE OF THIS SOFTWARE IN ITS
+"AS IS" CONDITION, AND THEY DISCLAIM ANY LIABILITY OF ANY KIND
+FOR ANY DAMAGES WHATSOEVER RESULTING FROM THE USE OF THIS SOFTWARE.
+
+This software was developed with support by the Advanced Research
+Project Agency, ARPA order number 018 (formerly 8230), monitored by
+the U.S. Army Research Laboratory under contract DAAB07-91-C-Q518.
+Further funding for this work was provided by DARPA through
+Rome Research Laboratory Contract No. F30602-97-2-0247.
+
+*/
+
+#ifndef BTREE_HASH_INDEX_H
+#define BTREE_HASH_INDEX_H
+
+#include "w_defines.h"
+
+/*  -- do not edit anything above this line --   </std-header>*/
+
+#ifndef BASICS_H
+#include "basics.h"
+#endif
+
+#ifndef SM_S_H
+#include "sm_s.h"
+#endif
+
+#ifndef STHREAD_H
+#include "sthread.h"
+#endif
+
+/**\brief  Adaptive hash index in front of btree point lookups.
+ *
+ * \details
+ *  For the unique btrees on which it has been enabled (see
+ *  ss_m::set_adaptive_hash), remembers the leaf page and slot
+ *  on which a key was last found, along with the LSN of the leaf
+ *  at that time.  btree_impl::_lookup tries it before descending
+ *  from the root.
+ *
+ *  An entry is only a hint: the lookup re-fixes the leaf and uses
+ *  the entry only if the page is still a leaf of the same store
+ *  with the same LSN and the key is still in that slot. Any update
+ *  to the leaf, including a split or a merge, moves its LSN, so
+ *  stale entries simply turn into misses and are dropped.
+ *
+ *  The table is direct-mapped on a hash of the store and key; a
+ *  collision replaces the older entry.  It is allocated the first
+ *  time an index is enabled.
+ */
+class btree_hash_index 
+{
+public:
+    enum { 
+        max_stores = 32,     // indexes that can be enabled at once
+        nentries = 16384,    // must be a power of 2
+        nlocks = 256         // must be a power of 2
+    };
+
+    btree_hash_index();
+    ~btree_hash_index();
+
+    // Start caching lookups on this index.
+    rc_t    enable(const stid_t& stid);
+    // Stop caching lookups on this index and drop its entries.
+    void    disable(const stid_t& stid);
+    bool    is_enabled(const stid_t& stid) const;
+
+    // Find the remembered location of key; false if there is none.
+    bool    probe(const stid_t& stid, const cvec_t& key,
+                shpid_t& leaf, slotid_t& slot, lsn_t& lsn);
+    void    insert(const stid_t& stid, const cvec_t& key,
+                shpid_t leaf, slotid_t slot, const lsn_t& lsn);
+    // Drop the entry for key, e.g. because it turned out to be stale.
+    void    remove(const stid_t& stid, const cvec_t& key);
+
+    // Clean up for shutting down storage manager.
+    void    shutdown();
+
+private:
+    typedef w_base_t::uint8_t store_key_t; // packed stid; 0 is unused
+
+    struct entry_t {
+        store_key_t    store;
+        w_base_t::uint4_t hash;
+        shpid_t        leaf;
+        lsn_t          lsn;
+        slotid_t       slot;
+    };
+
+    static store_key_t _store_key(const stid_t& stid) {
+        return (store_key_t(stid.vol.vol) << 32) | stid.store;
+    }
+    static w_base_t::uint4_t _hash(store_key_t store, const cvec_t& key);
+    queue_based_lock_t& _lock_for(w_base_t::uint4_t h) {
+        return _locks[h & (nlocks-1)];
+    }
+    entry_t& _entry_for(w_base_t::uint4_t h) {
+        return _entries[h & (nentries-1)];
+    }
+
+    // enabled stores; read without the lock, written under it
+    store_key_t volatile _stores[max_stores];
+    int volatile         _nstores;
+    queue_based_lock_t   _store_lock;
+
+    entry_t*             _entries;
+    queue_based_lock_t*  _locks;
+}; 
+
+extern btree_hash_index btree_hash;
+
+/*<std-footer incl-file-exclusion='BTREE_HASH_INDEX_H'>  -- do not edit anything below this line -- */
+
+#endif          /*</std-footer>*/
@@ -88,6 +88,9 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 #include <crash.h>
 #include <store_latch_manager.h>
 #include "btree_latch_manager.h"
+#include "btree_hash_index.h"
+#include <bf_prefetch.h>
+#include <vector>
 // common/store_latch_manager.h defines or undefs the following:
 extern store_latch_manager store_latches; // sm_io.cpp
 extern btree_latch_manager btree_latches; // smindex.cpp
@@ -3782,6 +3785,24 @@ btree_impl::_lookup(
     INC_TSTAT(bt_find_cnt);
     stid_t         stid = root.stid();
 
+    /*
+     *  Point lookups on a unique index may be answered by the
+     *  adaptive hash index without walking down the tree.
+     *  Without logging, page LSNs don't move, so the hash entries
+     *  could not be validated.
+     */
+    bool use_hash = !cursor && unique && !bIgnoreLatches &&
+        elem.size() == 0 && smlevel_0::logging_enabled &&
+        btree_hash.is_enabled(stid);
+    if(use_hash) {
+        bool hit = false;
+        W_DO( _lookup_hashed(stid, cc, key, hit, el, elen) );
+        if(hit) {
+            found = true;
+            return RCOK;
+        }
+    }
+
     {
         tree_latch   tree_root(root, bIgnoreLatches); // for latching the whole tree
         lpid_t       search_start_pid = root;
@@ -4141,6 +4162,7 @@ btree_impl::_lookup(
                     goto again;        // retry
                 }
             } // acquiring locks
+            if(xct()) W_DO(xct()->occ_read(kvl, *child));
         } // if any locking needed
 
         if (found) {
@@ -4156,6 +4178,10 @@ btree_impl::_lookup(
                     elen = rec.elen();
                     rec.elem().copy_to(el, elen);
                 }
+                if(use_hash && child->get_store_flags() == st_regular) {
+                    btree_hash.insert(stid, key, child->pid().page,
+                            slot, child->lsn());
+                }
             }
         } else {
             // rec will be the next record if !found
@@ -4172,6 +4198,384 @@ btree_impl::_lookup(
 }
 
 
+/*********************************************************************
+ *
+ *  btree_impl::_lookup_hashed(...)
+ *
+ *  Try to answer a point lookup on a unique btree from the adaptive
+ *  hash index.  The leaf named by the hash entry is fixed directly;
+ *  the entry is used only if the page is still a leaf of this store,
+ *  its LSN has not moved since the entry was made, and the key is
+ *  still in the remembered slot.  Otherwise the entry is dropped and
+ *  hit is false, and the caller does the full traversal.
+ *
+ *********************************************************************/
+rc_t
+btree_impl::_lookup_hashed(
+    const stid_t&       stid,        // I-  store of unique btree
+    concurrency_t       cc,        // I-  concurrency control
+    const cvec_t&       key,        // I-  key we want to find
+    bool&               hit,        // O-  true if answered from the hash
+    void*               el,        // I/o-  buffer to put el
+    smsize_t&           elen)        // IO- size of el
+{
+    FUNC(btree_impl::_lookup_hashed);
+    hit = false;
+
+    shpid_t     shpid;
+    slotid_t    slot;
+    lsn_t       lsn;
+    if(!btree_hash.probe(stid, key, shpid, slot, lsn)) {
+        INC_TSTAT(bt_ahi_miss_cnt);
+        return RCOK;
+    }
+
+    /*
+     * The page may since have been freed and reused by another
+     * store or as another kind of page, so fix it without
+     * assuming either.
+     */
+    lpid_t          pid(stid, shpid);
+    page_p          page;
+    store_flag_t    store_flags = st_bad;
+    rc_t rc = page.fix(pid, page_p::t_any_p, LATCH_SH, 0, store_flags,
+                        true /*ignore_store_id*/);
+
+    const btree_p&  leaf = *(btree_p*) &page;
+    bool valid = !rc.is_error() &&
+        page.tag() == page_p::t_btree_p &&
+        page.pid() == pid &&
+        page.lsn() == lsn &&
+        page.get_store_flags() == st_regular &&
+        leaf.is_leaf() && slot < leaf.nrecs();
+
+    btrec_t     rec;
+    if(valid) {
+        rec.set(leaf, slot);
+        valid = (rec.key() == key);
+    }
+    if(!valid) {
+        DBGTHRD(<<"stale hash entry for leaf " << pid << " slot " << slot);
+        btree_hash.remove(stid, key);
+        INC_TSTAT(bt_ahi_invalid_cnt);
+        return RCOK;
+    }
+
+    if(cc != t_cc_none) {
+        /*
+         * Same key-value lock _lookup would take.  Don't wait for
+         * it while holding the latch; leave that to the full lookup.
+         */
+        lockid_t    kvl;
+        mk_kvl(cc, kvl, stid, true, rec);
+        if(lm->lock(kvl, SH, t_long, WAIT_IMMEDIATE).is_error()) {
+            return RCOK;
+        }
+        if(xct()) W_DO(xct()->occ_read(kvl, leaf));
+    }
+
+    if (el) {
+        if (elen < rec.elen())  {
+            DBG(<<"RECWONTFIT");
+            return RC(eRECWONTFIT);
+        }
+        elen = rec.elen();
+        rec.elem().copy_to(el, elen);
+    }
+    INC_TSTAT(bt_ahi_hit_cnt);
+    hit = true;
+    return RCOK;
+}
+
+/*********************************************************************
+ *
+ *  btree_impl::_lookup_batch(...)
+ *
+ *  Look up a batch of keys, sorted in ascending order.  Rather than
+ *  descending from the root for every key, keep the leaf the last
+ *  key was found on and answer the following keys from it as long
+ *  as their satisfying keys are there.  When a key is past the end
+ *  of the leaf, try the right sibling (as case 2 of _lookup does)
+ *  before descending again from the root.
+ *
+ *  If the sm_prefetch option is on and the batch is large enough,
+ *  a pooled bf_prefetch_thread_t reads in the right sibling of each leaf
+ *  the batch lands on while the keys on that leaf are processed,
+ *  as scan_file_i does for the pages of a file.
+ *
+ *  Anything out of the ordinary -- an empty leaf or SMO, the end
+ *  of the index, a key-value lock that is not granted at once --
+ *  is left to _lookup for that one key.
+ *
+ *********************************************************************/
+/*
+ *  Prefetch threads idle between batches.  Forking and joining a
+ *  thread for every batch would cost more than the reads it saves,
+ *  so _lookup_batch borrows one from here and returns it when the
+ *  batch is done.  One is forked only when all are in use; at most
+ *  prefetch_pool_max are kept.
+ */
+static pthread_mutex_t                      prefetch_pool_lock
+                                                = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<bf_prefetch_thread_t*>   prefetch_pool;
+static const size_t                         prefetch_pool_max = 8;
+
+static bf_prefetch_thread_t* get_prefetch_thread()
+{
+    {
+        CRITICAL_SECTION(cs, prefetch_pool_lock);
+        if(!prefetch_pool.empty()) {
+            bf_prefetch_thread_t* t = prefetch_pool.back();
+            prefetch_pool.pop_back();
+            return t;
+        }
+    }
+    bf_prefetch_thread_t* t = new bf_prefetch_thread_t;
+    if(t) {
+        W_COERCE(t->fork());
+    }
+    return t;
+}
+
+static void retire_prefetch_thread(bf_prefetch_thread_t* t)
+{
+    t->retire();
+    delete t;
+}
+
+// The thread must have no request outstanding.
+static void put_prefetch_thread(bf_prefetch_thread_t* t)
+{
+    {
+        CRITICAL_SECTION(cs, prefetch_pool_lock);
+        if(prefetch_pool.size() < prefetch_pool_max) {
+            prefetch_pool.push_back(t);
+            return;
+        }
+    }
+    retire_prefetch_thread(t);
+}
+
+void
+btree_impl::_retire_prefetch_threads()
+{
+    std::vector<bf_prefetch_thread_t*> pool;
+    {
+        CRITICAL_SECTION(cs, prefetch_pool_lock);
+        pool.swap(prefetch_pool);
+    }
+    for(size_t i = 0; i < pool.size(); i++) {
+        retire_prefetch_thread(pool[i]);
+    }
+}
+
+rc_t
+btree_impl::_lookup_batch(
+    const lpid_t&       root,        // I-  root of btree
+    bool                unique, // I-  true if btree is unique
+    concurrency_t       cc,        // I-  concurrency control
+    int                 count,  // I-  number of probes
+    bt_probe_t          probes[], // IO- the probes, sorted by key
+    const bool          bIgnoreLatches)
+{
+    FUNC(btree_impl::_lookup_batch);
+
+    // Too few keys to be worth a prefetch thread
+    const int               prefetch_min = 32;
+
+    bf_prefetch_thread_t*   prefetch = 0;
+    if(smlevel_0::do_prefetch && !bIgnoreLatches && count >= prefetch_min) {
+        prefetch = get_prefetch_thread();
+    }
+
+    rc_t rc = _lookup_sorted(root, unique, cc, count, probes,
+                prefetch, bIgnoreLatches);
+
+    if(prefetch) {
+        // After an error a request may still be outstanding (or the
+        // thread failed): don't hand it to the next batch.
+        if(rc.is_error()) {
+            retire_prefetch_thread(prefetch);
+        } else {
+            put_prefetch_thread(prefetch);
+        }
+    }
+    return rc;
+}
+
+rc_t
+btree_impl::_lookup_sorted(
+    const lpid_t&           root,
+    bool                    unique,
+    concurrency_t           cc,
+    int                     count,
+    bt_probe_t              probes[],
+    bf_prefetch_thread_t*   prefetch,
+    const bool              bIgnoreLatches)
+{
+    FUNC(btree_impl::_lookup_sorted);
+    latch_mode_t    mode = bIgnoreLatches ? LATCH_NLS : LATCH_SH;
+    cvec_t          null;
+
+    // The leaf we are on, and a frame to fix its sibling in.
+    btree_p         pages[2];
+    btree_p*        leaf = &pages[0];
+    btree_p*        sibling = &pages[1];
+
+    // The page requested of the prefetch thread, if any
+    lpid_t          requested = lpid_t::null;
+
+    for(int i = 0; i < count; i++) {
+        bt_probe_t& probe = probes[i];
+        bool        answered = false;
+        uint        whatcase = m_not_found_end_of_file;
+
+        INC_TSTAT(bt_batch_probe_cnt);
+
+        if(leaf->is_fixed()) {
+            W_DO(_probe_leaf(*leaf, unique, cc, probe,
+                        answered, whatcase));
+            if(answered) {
+                INC_TSTAT(bt_batch_leaf_reuse);
+                continue;
+            }
+
+            if(whatcase == m_not_found_end_of_non_empty_page) {
+                /*
+                 * Probably on the next leaf: latch-couple to it,
+                 * keeping this leaf until the probe is answered, as
+                 * _lookup does.
+                 */
+                lpid_t pid = root;
+                pid.page = leaf->next();
+                if(requested == pid) {
+                    page_p  page;
+                    W_DO(prefetch->fetch(requested, page));
+                    requested = lpid_t::null;
+                }
+                INC_TSTAT(bt_links);
+                W_DO(sibling->fix(pid, mode));
+                W_DO(_probe_leaf(*sibling, unique, cc, probe,
+                            answered, whatcase));
+                leaf->unfix();
+                btree_p* tmp = leaf;
+                leaf = sibling;
+                sibling = tmp;
+            }
+        }
+
+        if(!answered && whatcase != m_satisfying_key_found_same_page) {
+            /*
+             * Descend from the root.  Traverse doesn't check that
+             * the leaf is right; _probe_leaf's _satisfy does.
+             */
+            leaf->unfix();
+            btree_p     parent;
+            lsn_t       leaf_lsn, parent_lsn;
+            bool        found;
+            W_DO( _traverse(root, root, lsn_t::null, *probe.key, null,
+                        found, mode, *leaf, parent, leaf_lsn, parent_lsn,
+                        bIgnoreLatches) );
+            parent.unfix();
+
+            W_DO(_probe_leaf(*leaf, unique, cc, probe,
+                        answered, whatcase));
+        }
+
+        if(!answered) {
+            INC_TSTAT(bt_batch_fallback);
+            leaf->unfix();
+            W_DO( _lookup(root, unique, cc, *probe.key, null,
+                        *probe.found, 0, probe.el, *probe.elen,
+                        bIgnoreLatches) );
+            continue;
+        }
+
+        /*
+         * A leaf we just landed on.  If there are more keys, start
+         * reading in its sibling, where they are likely to go next.
+         */
+        if(prefetch && i+1 < count && leaf->next()) {
+            lpid_t pid = root;
+            pid.page = leaf->next();
+            if(requested != pid && !bf_m::is_resident(pid)) {
+                if(requested != lpid_t::null) {
+                    page_p  page;
+                    W_DO(prefetch->fetch(requested, page));
+                }
+                requested = pid;
+                W_DO(prefetch->request(requested, mode));
+            }
+        }
+    }
+    if(requested != lpid_t::null) {
+        // Take the page, so the thread is idle for its next batch.
+        page_p  page;
+        W_DO(prefetch->fetch(requested, page));
+    }
+    return RCOK;
+}
+
+/*
+ *  Answer a probe of a batch from the given leaf, if the leaf holds
+ *  the key's satisfying key (the key or the next one) and
+ *  the key-value lock _lookup would take is granted at once.
+ *  If the leaf has the satisfying key but the lock was not granted,
+ *  returns answered false and wcase m_satisfying_key_found_same_page;
+ *  otherwise wcase says why the key is not here.
+ */
+rc_t
+btree_impl::_probe_leaf(
+    const btree_p&      leaf,
+    bool                unique,
+    concurrency_t       cc,
+    bt_probe_t&         probe,
+    bool&               answered,
+    uint&               whatcase)
+{
+    FUNC(btree_impl::_probe_leaf);
+    cvec_t          null;
+    bool            found = false;
+    bool            total_match = false;
+    slotid_t        slot;
+
+    answered = false;
+    W_DO(_satisfy(leaf, *probe.key, null, found, total_match,
+                slot, whatcase));
+    if(whatcase != m_satisfying_key_found_same_page) {
+        return RCOK;
+    }
+    w_assert9(slot < leaf.nrecs());
+
+    btrec_t     rec;
+    rec.set(leaf, slot);
+
+    if( (!found && !total_match) && (cc == t_cc_modkvl) ) {
+        ; /* we don't want to lock next */
+    } else if (cc != t_cc_none)  {
+        lockid_t    kvl;
+        if(cc > t_cc_none) mk_kvl(cc, kvl, leaf.pid().stid(), unique, rec);
+        if(lm->lock(kvl, SH, t_long, WAIT_IMMEDIATE).is_error()) {
+            // let _lookup wait for it
+            return RCOK;
+        }
+        if(xct()) W_DO(xct()->occ_read(kvl, leaf));
+    }
+
+    if (found && probe.el) {
+        if (*probe.elen < rec.elen())  {
+            DBG(<<"RECWONTFIT");
+            return RC(eRECWONTFIT);
+        }
+        *probe.elen = rec.elen();
+        rec.elem().copy_to(probe.el, *probe.elen);
+    }
+    *probe.found = found;
+    INC_TSTAT(bt_find_cnt);
+    answered = true;
+    return RCOK;
+}
+
 /*********************************************************************
  *
  *  btree_impl::_update(...)
@@ -4585,6 +4989,7 @@ btree_impl::_skip_one_slot(
             eof = true;
             return RCOK;
         }
+        bf_m::prefetch(pid);
         p1.unfix();
         DBGTHRD(<<"fixing " << pid);
 	fix_latch = bIgnoreLatches ? LATCH_NLS : LATCH_SH;
@@ -4593,6 +4998,11 @@ btree_impl::_skip_one_slot(
             w_assert9(p2.is_smo()); 
             found = false;
         }
+        // A scan that got here will likely go on to the next
+        // sibling; start its lookup while this page is read.
+        if ((pid.page = backward? p2.prev() : p2.next())) {
+            bf_m::prefetch(pid);
+        }
         child =  &p2;
         slot = backward? p2.nrecs()-1 : 0;
     }
@@ -5782,8 +6192,6 @@ no_change:
             w_assert9( !p[c].is_smo() );
             w_assert9( !p[c].is_delete() );
 
-            p[1-c].unfix(); // if it's valid
-
             DBGTHRD(<<" found " << found 
                 << " total_match " << total_match
                 << " slot=" << slot);
@@ -5793,8 +6201,15 @@ no_change:
              *  If the child is a leaf, we'll want to
              *  fix in the given mode, else fix in LATCH_SH mode.
              *  Slot < 0 means we hit the very beginning of the file.
+             *
+             *  Knowing the child, start loading its buffer pool
+             *  lookup into the CPU cache, and let the grandparent
+             *  go while that is in flight.
              */
             pid[1-c].page = ((slot < 0) ? p[c].pid0() : p[c].child(slot));
+            bf_m::prefetch(pid[1-c]);
+
+            p[1-c].unfix(); // if it's valid
 
 	    fix_latch = bIgnoreLatches ? LATCH_NLS : LATCH_SH;
             latch_mode_t node_mode = p[c].is_leaf_parent() ? mode : fix_latch;
@@ -76,6 +76,7 @@ typedef enum {  m_not_found_end_of_file,
         m_not_found_page_is_empty } m_page_search_cases;
 
 class btsink_t;
+class bf_prefetch_thread_t;
 
 class btree_impl : protected btree_m  {
     friend class btree_m;
@@ -211,6 +212,25 @@ protected:
         smsize_t&                     elen,   // IO- size of el if !cursor
 	const bool bIgnoreLatches = false);
 
+    static rc_t                 _lookup_batch(
+        const lpid_t&                     root,  // I-  root of btree
+        bool                            unique,// I-  true if btree is unique
+        concurrency_t                    cc,           // I-  concurrency control
+        int                              count, // I-  number of probes
+        bt_probe_t                       probes[],// IO- probes, sorted by key
+	const bool bIgnoreLatches = false);
+
+    // joins the prefetch threads kept for _lookup_batch
+    static void                 _retire_prefetch_threads();
+
+    static rc_t                 _lookup_hashed(
+        const stid_t&                     stid,  // I-  store of unique btree
+        concurrency_t                    cc,           // I-  concurrency control
+        const cvec_t&                     key,   // I-  key we want to find
+        bool&                             hit,   // O-  true if answered from the hash
+        void*                             el,           // I/o-  buffer to put el
+        smsize_t&                     elen);  // IO- size of el
+
     static rc_t          _update(
         const lpid_t&       root,        // I-  root of btree
 	bool                unique, // I-  true if btree is unique
@@ -297,6 +317,21 @@ private:
         bool&                            total_match,
         slotid_t&                    slot,
         uint&                             wcase);
+    static rc_t                 _lookup_sorted(
+        const lpid_t&                    root,
+        bool                            unique,
+        concurrency_t                    cc,
+        int                              count,
+        bt_probe_t                       probes[],
+        bf_prefetch_thread_t*            prefetch,
+	const bool bIgnoreLatches);
+    static rc_t                 _probe_leaf(
+        const btree_p&                   leaf,
+        bool                            unique,
+        concurrency_t                    cc,
+        bt_probe_t&                      probe,
+        bool&                            answered,
+        uint&                             wcase);
     static rc_t                 _traverse(
         const lpid_t&                    __root,        // I-  root of tree 
         const lpid_t&                    _start,        // I-  root of search 
@@ -102,7 +102,7 @@ private:
     
 #define USE_OCC_LOCK_HERE 1
 #ifdef USE_OCC_LOCK_HERE
-    typedef occ_rwlock Lock;
+    typedef spin_park_rwlock Lock;
 #else
     typedef queue_based_lock_t Lock;
 #endif
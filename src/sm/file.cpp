@@ -73,6 +73,7 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 
 #include "histo.h"
 #include "crash.h"
+#include "vstore.h"
 
 #ifdef EXPLICIT_TEMPLATE
 /* Used in sort.cpp, btree_bl.cpp */
@@ -740,9 +741,11 @@ file_m::destroy_rec_slot(const rid_t rid, file_mrbt_p& page, const bool bIgnoreL
     w_assert2(page.is_latched_by_me());
     w_assert2(page.is_mine());
 
+    W_DO( version_store_t::before_update(page, rid.slot) );
     W_DO( page.destroy_rec(rid.slot) ); // does a page_mark for the slot
 
-    if (page.rec_count() == 0) {
+    // snapshots may still read the records that were on the page
+    if (page.rec_count() == 0 && !version_store_t::versioning()) {
         DBG(<<"Now free page");
         w_assert2(page.is_fixed());
         W_DO(_free_page(page, bIgnoreLatches));
@@ -793,6 +796,7 @@ file_m::_create_mrbt_rec_in_slot(
     tag.body_len = data.size();
     w_assert2(page.is_fixed() &&
 	      (page.latch_mode() == LATCH_NLX || page.latch_mode() == LATCH_EX));
+    W_DO(version_store_t::before_update(page, rid.slot));
     rc = page.fill_slot(rid.slot, tag, hdr, data, 100);
     if (rc.is_error())  {
 	
@@ -1620,6 +1624,8 @@ file_m::_create_rec_in_slot(
     rectag_t         tag;
     tag.hdr_len = hdr.size();
 
+    W_DO(version_store_t::before_update(page, rid.slot));
+
     switch (rec_impl) {
     case t_small:
         // it is small, so put the data in as well
@@ -1703,6 +1709,7 @@ file_m::destroy_rec(const rid_t& rid, const bool bIgnoreLatches)
 
     W_DO( page.get_rec(rid.slot, rec) );
     DBGTHRD(<<"got rec for rid " << rid);
+    W_DO( version_store_t::before_update(page, rid.slot) );
 
     if (rec->is_small()) {
         // nothing special
@@ -1714,7 +1721,8 @@ file_m::destroy_rec(const rid_t& rid, const bool bIgnoreLatches)
 
     W_DO( page.destroy_rec(rid.slot) ); // does a page_mark for the slot
 
-    if (page.rec_count() == 0) {
+    // snapshots may still read the records that were on the page
+    if (page.rec_count() == 0 && !version_store_t::versioning()) {
         DBG(<<"Now free page");
         w_assert2(page.is_fixed());
 	if(page.tag() == page_p::t_file_p) {
@@ -1759,6 +1767,7 @@ file_m::update_rec(const rid_t& rid, uint4_t start, const vec_t& data, const boo
         return RC(eRECUPDATESIZE);
     }
 
+    W_DO( version_store_t::before_update(page, rid.slot) );
     if (rec->is_small()) {
         W_DO( page.splice_data(rid.slot, u4i(start), data.size(), data) );
     } else {
@@ -1832,6 +1841,8 @@ file_m::append_rec(const rid_t& rid, const vec_t& data, const sdesc_t& sd)
         return RC(eBADAPPEND);
     }
 
+    W_DO( version_store_t::before_update(page, rid.slot) );
+
     // see if record will remain small
     smsize_t space_needed;
     if ( rec->is_small() &&
@@ -1964,6 +1975,8 @@ file_m::append_mrbt_rec(const rid_t& rid, const vec_t& data, const sdesc_t& sd,
         return RC(eBADAPPEND);
     }
 
+    W_DO( version_store_t::before_update(page, rid.slot) );
+
     // see if record will remain small
     smsize_t space_needed;
     if ( rec->is_small() &&
@@ -2061,6 +2074,7 @@ file_m::truncate_rec(const rid_t& rid, uint4_t amount, bool& should_forward)
     uint4_t        orig_size  = rec->body_size();
     uint2_t        orig_flags  = rec->tag.flags;
 
+    W_DO( version_store_t::before_update(page, rid.slot) );
     if (rec->is_small()) {
         W_DO( page.truncate_rec(rid.slot, amount) );
         rec = NULL; // no longer valid;
@@ -2201,6 +2215,7 @@ file_m::truncate_mrbt_rec(const rid_t& rid, uint4_t amount, bool& should_forward
     uint4_t        orig_size  = rec->body_size();
     uint2_t        orig_flags  = rec->tag.flags;
 
+    W_DO( version_store_t::before_update(page, rid.slot) );
     if (rec->is_small()) {
         W_DO( page.truncate_rec(rid.slot, amount) );
         rec = NULL; // no longer valid;
@@ -2365,6 +2380,114 @@ file_m::read_rec(const rid_t& s_rid,
     return RCOK;
 }
 
+/*
+ * Copy "amount" bytes starting at "start" of the body of a large
+ * record out of data page "data", whose first byte is byte
+ * "page_start" of the body.
+ */
+static void
+_copy_lgdata(const char* data, smsize_t data_len, smsize_t page_start,
+             smsize_t start, smsize_t amount, char* buf)
+{
+    smsize_t from = MAX(start, page_start);
+    smsize_t to = MIN(start + amount, page_start + data_len);
+    w_assert1(from < to);
+    memcpy(buf + (from - start), data + (from - page_start), to - from);
+}
+
+/*
+ * Read a range of the body of a large record into buf.  The
+ * caller has the record's page fixed.
+ *
+ * The data pages covering the range are looked up in the record's
+ * chunk list or index a batch at a time.  Pages that are in the buffer
+ * pool are copied out of it.  If the transaction holds a lock (on the
+ * record or on one of its parents) that keeps the data pages from
+ * changing, runs of contiguous pages that are not in the pool are read
+ * straight from the volume with a single request each, without
+ * disturbing the buffer pool.  Without such a lock (t_cc_none, or a
+ * caller that skipped locking) a page found non-resident could be
+ * fixed and updated by another transaction while we read the volume,
+ * so every page is read through the buffer pool instead.
+ */
+rc_t
+file_m::read_large(file_p& page, slotid_t slot,
+                   smsize_t start, smsize_t amount, char* buf)
+{
+    FUNC(file_m::read_large);
+    record_t*  rec;
+    W_DO( page.get_rec(slot, rec) );
+    w_assert1(rec->is_large());
+    w_assert1(start + amount <= rec->body_size());
+    if (amount == 0) return RCOK;
+
+    bool direct = false;
+    if (xct()) {
+        lock_mode_t m = NL;
+        W_DO( lm->query(rid_t(page.pid(), slot), m, xct()->tid(), true) );
+        direct = (m == SH || m == SIX || m == UD || m == EX);
+    }
+
+    const uint4_t  max_pages = 64;        // pids looked up per batch
+    shpid_t        pids[max_pages];
+    page_s*        bufs = new page_s[max_many_pages];
+    if (!bufs)
+        W_FATAL(fcOUTOFMEMORY);
+    w_auto_delete_array_t<page_s> ad_bufs(bufs);
+
+    uint4_t first = start / lgdata_p::data_sz;
+    uint4_t last = (start + amount - 1) / lgdata_p::data_sz;
+    while (first <= last) {
+        uint4_t num_pages = MIN(max_pages, last - first + 1);
+        stid_t  stid;
+        if (rec->tag.flags & t_large_0) {
+            const lg_tag_chunks_h lg_hdl(page, *(lg_tag_chunks_s*)rec->body());
+            W_DO(lg_hdl.pids(first, num_pages, pids));
+            stid = lg_hdl.stid();
+        } else {
+            const lg_tag_indirect_h lg_hdl(page, 
+                    *(lg_tag_indirect_s*)rec->body(), rec->page_count());
+            W_DO(lg_hdl.pids(first, num_pages, pids));
+            stid = lg_hdl.stid();
+        }
+
+        uint4_t i = 0;
+        while (i < num_pages) {
+            smsize_t page_start = smsize_t(first + i) * lgdata_p::data_sz;
+            lpid_t   pid(stid, pids[i]);
+
+            if (!direct || bf->is_resident(pid)) {
+                lgdata_p lgdata;
+                W_DO( lgdata.fix(pid, LATCH_SH) );
+                _copy_lgdata((const char*) lgdata.tuple_addr(0), 
+                        lgdata.tuple_size(0), page_start, start, amount, buf);
+                INC_TSTAT(lg_read_cached_pages);
+                i++;
+                continue;
+            }
+
+            int run = 1;
+            while (i + run < num_pages && run < max_many_pages &&
+                    pids[i + run] == pids[i] + run &&
+                    !bf->is_resident(lpid_t(stid, pids[i + run]))) {
+                run++;
+            }
+            W_DO( io->read_many_pages(pid, bufs, run) );
+            for (int j = 0; j < run; j++) {
+                const page_s& p = bufs[j];
+                w_assert1(p.pid.page == pids[i + j] && p.tag == page_p::t_lgdata_p);
+                _copy_lgdata(p.data() + p.slot(0).offset, p.slot(0).length,
+                        page_start + j * lgdata_p::data_sz, start, amount, buf);
+            }
+            INC_TSTAT(lg_read_direct_cnt);
+            ADD_TSTAT(lg_read_direct_pages, run);
+            i += run;
+        }
+        first += num_pages;
+    }
+    return RCOK;
+}
+
 rc_t
 file_m::splice_hdr(rid_t rid, slot_length_t start, slot_length_t len, 
 		   const vec_t& hdr_data, const bool bIgnoreLatches)
@@ -2380,6 +2503,7 @@ file_m::splice_hdr(rid_t rid, slot_length_t start, slot_length_t len,
     // currently header realignment (rec hdr must always
     // have an alignedlength) is not supported
     w_assert3(len == hdr_data.size());
+    W_DO( version_store_t::before_update(page, rid.slot) );
     W_DO( page.splice_hdr(rid.slot, start, len, hdr_data));
     return RCOK;
 }
@@ -4000,6 +4124,7 @@ file_m::update_rectag(const rid_t& rid, uint4_t len, uint2_t flags)
     
     W_DO(_locate_page(rid, page, LATCH_EX) );
     
+    W_DO( version_store_t::before_update(page, rid.slot) );
     W_DO( page.set_rec_len(rid.slot, len) );
     W_DO( page.set_rec_flags(rid.slot, flags) );
     
@@ -339,6 +339,8 @@ public:
         return read_rec(rid, 0, len, buf, bIgnoreLatches);
     }
     static rc_t read_hdr(const rid_t& rid, int& len, void* buf, const bool bIgnoreLatches = false);
+    static rc_t read_large(file_p& page, slotid_t slot,
+                           smsize_t start, smsize_t amount, char* buf);
 
     // The following functions return the first/next pages in a
     // store.  If "allocated" is NULL then only allocated pages will be
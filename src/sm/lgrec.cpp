@@ -229,6 +229,32 @@ lg_tag_chunks_h::update(uint4_t start_byte, const vec_t& data) const
     return RCOK;
 }
 
+/*
+ * pids() returns the page numbers of "count" consecutive pages
+ * of the record, starting with page number "first".
+ */
+rc_t
+lg_tag_chunks_h::pids(uint4_t first, uint4_t count, shpid_t result[]) const
+{
+    FUNC(lg_tag_chunks_h::pids);
+    uint4_t pid_num = first;
+    uint4_t done = 0;
+    for (int i = 0; i < _cref.chunk_cnt && done < count; i++) {
+        if (_cref.chunks[i].npages <= pid_num) {
+            pid_num -= _cref.chunks[i].npages;
+            continue;
+        }
+        for (; pid_num < _cref.chunks[i].npages && done < count; pid_num++) {
+            result[done++] = _cref.chunks[i].pid(pid_num);
+        }
+        pid_num = 0;
+    }
+    if (done < count) {
+        W_FATAL(smlevel_0::eINTERNAL);
+    }
+    return RCOK;
+}
+
 shpid_t lg_tag_chunks_h::_pid(uint4_t pid_num) const
 {
     FUNC(lg_tag_chunks_h::_pid);
@@ -547,6 +573,48 @@ shpid_t lg_tag_indirect_h::_last_pid() const
     return last_indirect.last_pid();
 }
 
+/*
+ * pids() returns the page numbers of "count" consecutive pages
+ * of the record, starting with page number "first".  Unlike
+ * repeated calls to pid(), each index page is fixed only once.
+ */
+rc_t
+lg_tag_indirect_h::pids(uint4_t first, uint4_t count, shpid_t result[]) const
+{
+    FUNC(lg_tag_indirect_h::pids);
+    w_assert1(first + count <= _page_cnt);
+    if (count == 0) return RCOK;
+
+    lpid_t root_pid(stid(), _iref.indirect_root);
+    lgindex_p root;
+    W_DO( root.fix(root_pid, LATCH_SH) );
+
+    if (indirect_type(_page_cnt) == t_large_1) {
+        for (uint4_t i = 0; i < count; i++) {
+            result[i] = root.pids(first + i);
+        }
+        return RCOK;
+    }
+    w_assert9(indirect_type(_page_cnt) == t_large_2);
+
+    uint4_t done = 0;
+    while (done < count) {
+        uint4_t pid_num = first + done;
+        slotid_t idx = (slotid_t)(pid_num/lgindex_p::max_pids);
+        uint4_t  slot = pid_num % lgindex_p::max_pids;
+        uint4_t  n = MIN(count - done, lgindex_p::max_pids - slot);
+
+        lpid_t indirect_pid(stid(), root.pids(idx));
+        lgindex_p indirect;
+        W_DO( indirect.fix(indirect_pid, LATCH_SH) );
+        for (uint4_t i = 0; i < n; i++) {
+            result[done + i] = indirect.pids(slot + i);
+        }
+        done += n;
+    }
+    return RCOK;
+}
+
 shpid_t lg_tag_indirect_h::_pid(uint4_t pid_num) const
 {
     FUNC(lg_tag_indirect_h::_pid);
@@ -132,6 +132,7 @@ public:
     rc_t     append(uint4_t num_pages, const lpid_t new_pages[]);
     rc_t     truncate(uint4_t num_pages);
     rc_t     update(uint4_t start_byte, const vec_t& data) const ;
+    rc_t     pids(uint4_t first, uint4_t count, shpid_t result[]) const;
 
     stid_t    stid() const {return stid_t(_page.pid().vol(), _cref.store);}
     void     print(ostream &) const;
@@ -162,6 +163,7 @@ public:
     rc_t     append(uint4_t num_pages, const lpid_t new_pages[]);
     rc_t     truncate(uint4_t num_pages);
     rc_t     update(uint4_t start_byte, const vec_t& data) const ;
+    rc_t     pids(uint4_t first, uint4_t count, shpid_t result[]) const;
 
     stid_t    stid() const {return stid_t(_page.pid().vol(), _iref.store);}
 
@@ -265,6 +265,14 @@ rc_t lock_m::query(
 }
 
 
+bool lock_m::held_by_other(const lockid_t& n, lmode_t m)
+{
+    xct_t* xd = xct();
+    lmode_t other = _core->other_mode(n, xd? xd->lock_info() : 0);
+    return !compat[m][other];
+}
+
+
 rc_t lock_m::_query_implicit(
     const lockid_t&     n,
     lmode_t&            m,
@@ -461,6 +469,46 @@ lock_m::_lock(
 
     w_assert9(timeout >= 0 || timeout == WAIT_FOREVER);
 
+    if (xd && xd->is_snapshot() && !n.is_user_lock() &&
+            (m == SH || m == IS || m == UD)) {
+        // Snapshot transactions read old record versions rather than
+        // wait for writers (see version_store_t), so they only lock
+        // what keeps their files and indexes from going away.
+        // Btree keys are not versioned: kvl locks make their reads
+        // read-committed, without holding up the writers after.
+        switch (n.lspace()) {
+        case lockid_t::t_page:
+        case lockid_t::t_record:
+            INC_TSTAT(lock_snapshot_skip_cnt);
+            return RCOK;
+        case lockid_t::t_kvl:
+            duration = t_instant;
+            break;
+        case lockid_t::t_vol:
+        case lockid_t::t_store:
+            m = IS;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (xd && xd->is_occ() && m == SH && duration != t_instant &&
+            (n.lspace() == lockid_t::t_record || 
+             n.lspace() == lockid_t::t_page ||
+             n.lspace() == lockid_t::t_kvl)) {
+        // Optimistic transactions validate these reads at commit
+        // instead (see xct_t::occ_read); lock only the file or index,
+        // to keep it from going away.
+        xd->occ_skip_lock(n);
+        INC_TSTAT(lock_occ_skip_cnt);
+        lockid_t p;
+        while (n.lspace() != lockid_t::t_store && get_parent(n, p)) {
+            n = p;
+        }
+        m = IS;
+    }
+
     if (xd) {
         // The lock info is created with the xct constructor.
         theLockInfo = xd->lock_info();
@@ -136,6 +136,9 @@ public:
         bool                         passOnToDescendants = true);
 
     bool			sli_query(lockid_t const &n);
+
+    // true if another transaction holds n in a mode that conflicts with m
+    bool                        held_by_other(const lockid_t& n, lmode_t m);
     
     rc_t                        query(
         const lockid_t&              n, 
@@ -893,6 +893,27 @@ lock_head_t::granted_mode_other(const lock_request_t* exclude)
     return gmode;
 }
 
+/*********************************************************************
+ *
+ *   lock_core_m::other_mode(n, theLockInfo)
+ *
+ *   Group mode of the requests granted on n to transactions other
+ *   than theLockInfo's, without creating a lock head.
+ *
+ *********************************************************************/
+lock_base_t::lmode_t
+lock_core_m::other_mode(const lockid_t& n, xct_lock_info_t* theLockInfo)
+{
+    lock_head_t* lock = find_lock_head(n, false); // do not create
+    if (!lock) return NL;
+    // lock head mutex was acquired by find_lock_head
+    lock_request_t* req = theLockInfo? lock->find_lock_request(theLockInfo) : 0;
+    if (req && req->status() == lock_m::t_waiting) req = 0;
+    lmode_t m = req? lock->granted_mode_other(req) : lock->granted_mode;
+    MUTEX_RELEASE(lock->head_mutex);
+    return m;
+}
+
 bool
 lock_head_t::invalidate_sli()
 {
@@ -1567,6 +1588,7 @@ lock_core_m::acquire_lock(
                     const char* blockname = "lock";
                     // TODO: non-rc version of smthread_block
                     INC_TSTAT(lock_block_cnt);
+                    xct_wait_timer_t w(xct_wait_lock);
                     rce = me()->smthread_block(DREADLOCKS_INTERVAL_MS, 0, 
                                                                 blockname);
 
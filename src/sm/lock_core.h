@@ -94,6 +94,11 @@ public:
     lock_head_t*    find_lock_head(
                 const lockid_t&            n,
                 bool                create);
+
+    // mode in which transactions other than theLockInfo's hold n
+    lmode_t         other_mode(
+                const lockid_t&            n,
+                xct_lock_info_t*           theLockInfo);
 public:
     typedef     w_list_t<lock_head_t,queue_based_lock_t> chain_list_t;
     typedef     w_list_i<lock_head_t,queue_based_lock_t> chain_list_i;
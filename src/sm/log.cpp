@@ -119,11 +119,12 @@ bool log_i::next(lsn_t& lsn, logrec_t*& r)
  *
  *********************************************************************/
 uint4_t const log_m::_version_major = 4;
-uint4_t const log_m::_version_minor = 0;
+uint4_t const log_m::_version_minor = 2;
 const char log_m::_SLASH = '/';
 const char log_m::_master_prefix[] = "chk."; // same size as _log_prefix
 const char log_m::_log_prefix[] = "log.";
 char       log_m::_logdir[max_devname];
+char       log_m::_logtail[max_devname];
 
 // virtual
 void  log_m::shutdown() 
@@ -242,7 +243,10 @@ log_m::log_m()
       _partition_size(0), 
       _partition_data_size(0), 
       _log_corruption(false),
-      _waiting_for_space(false)
+      _waiting_for_space(false),
+      _archiving(false),
+      _archived(0),
+      _backup_lsn(lsn_t::max)
 {
     pthread_mutex_init(&_space_lock, 0);
     pthread_cond_init(&_space_cond, 0);
@@ -271,12 +275,19 @@ rc_t
 log_m::new_log_m(log_m   *&the_log,
                          const char *path,
                          int wrbufsize,
-                         bool  reformat)
+                         bool  reformat,
+                         const char *tail)
 {
     FUNC(log_m::new_log_m);
 
     w_assert1(strlen(path) < sizeof(_logdir));
     strcpy(_logdir, path);
+    if(tail) {
+        w_assert1(strlen(tail) < sizeof(_logtail));
+        strcpy(_logtail, tail);
+    } else {
+        _logtail[0] = '\0';
+    }
 
     rc_t rc = log_core::new_log_m(the_log, wrbufsize, reformat);
 
@@ -334,6 +345,18 @@ log_m::insert(logrec_t &r, lsn_t* ret)
     return log_core::THE_LOG->insert(r, ret); 
 }
 
+rc_t 
+log_m::insert(const logrec_writer_t &w, logrec_t* scratch, lsn_t* ret)
+{ 
+    if (_log_corruption || do_log_compact) {
+        // build it aside, so the usual insert can corrupt or
+        // compact it
+        w.construct(scratch);
+        return insert(*scratch, ret);
+    }
+    return log_core::THE_LOG->insert(w, scratch, ret); 
+}
+
 rc_t 
 log_m::flush(lsn_t lsn, bool block)
     { return log_core::THE_LOG->flush(lsn, block); }
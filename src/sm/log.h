@@ -65,6 +65,7 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 
 
 class logrec_t;
+class logrec_writer_t;
 class log_buf;
 
 /**\brief Log manager interface class.
@@ -87,6 +88,7 @@ class log_m : public smlevel_0
     static const char    _master_prefix[];
     static const char    _log_prefix[];
     static char          _logdir[max_devname];
+    static char          _logtail[max_devname];
 
 protected: 
     static const char    _SLASH; 
@@ -95,6 +97,9 @@ protected:
     mutable queue_based_block_lock_t _partition_lock;
     lsn_t                   _curr_lsn;
     lsn_t                   _durable_lsn;
+    // What the partition files hold durably; lags _durable_lsn when
+    // the mapped log tail (sm_log_tail) holds the rest.
+    lsn_t                   _synced_lsn;
     lsn_t                   _master_lsn;
     lsn_t                   _min_chkpt_rec_lsn;
     fileoff_t volatile      _space_available; // how many unreserved bytes left
@@ -103,6 +108,12 @@ protected:
     fileoff_t               _partition_data_size;
     bool                    _log_corruption;
     bool                    _waiting_for_space; 
+    // With a log archiver, the partitions after _archived have not 
+    // been copied yet, and must not be recycled.
+    bool                    _archiving;
+    partition_number_t volatile _archived;
+    // An online volume backup needs the log from here on.
+    lsn_t                   _backup_lsn;
     pthread_mutex_t         _space_lock; // tied to _space_cond
     pthread_cond_t          _space_cond; // tied to _space_lock
 
@@ -144,6 +155,38 @@ public:
 
     rc_t                file_was_archived(const char *file);
 
+    /**\brief Hold back the partitions after \a n from recycling.
+     * \details
+     * Used by the log archiver: it calls this when it starts, and
+     * again each time it has copied a partition.
+     */
+    void                set_archived(partition_number_t n) {
+                            _archived = n; 
+                            _archiving = true;
+                        }
+    /**\brief Lowest lsn the log archiver still needs; lsn_t::max
+     * if there is no archiver.
+     */
+    lsn_t               archive_min_lsn() const {
+                            return _archiving ? first_lsn(_archived+1) 
+                                : lsn_t::max;
+                        }
+
+    /**\brief Hold back the partitions from \a lsn on from recycling,
+     * while an online volume backup copies the volume; lsn_t::max
+     * when it is done.
+     */
+    void                set_backup_lsn(const lsn_t& lsn) {
+                            ASSERT_FITS_IN_POINTER(lsn_t);
+                            _backup_lsn = lsn;
+                        }
+    /**\brief Lowest lsn the log archiver or a volume backup still
+     * needs; lsn_t::max if neither does.
+     */
+    lsn_t               retain_min_lsn() const {
+                            return std::min(archive_min_lsn(), _backup_lsn);
+                        }
+
 private:
     /**\brief Helper for _write_master */
     static void         _create_master_chkpt_contents(
@@ -210,6 +253,8 @@ public:
      * @param[in] wrlogbufsize  Size of log buffer, see ss_m run-time options.
      * @param[in] reformat  If true, the manager will blow away the log and start over.
      * This precludes recovery.
+     * @param[in] tail  If set, a file to map the log buffer onto (see
+     * the sm_log_tail option).
      *
      * \todo explain the logbuf size and log size options
      */
@@ -217,7 +262,8 @@ public:
                              log_m        *&the_log,
                              const char   *path,
                              int          wrlogbufsize,
-                             bool         reformat);
+                             bool         reformat,
+                             const char   *tail = 0);
 
     /**\brief log segment size; exported for use by ss_m::options processing 
      * \details
@@ -234,6 +280,11 @@ public:
      */
     static const char * dir_name() { return _logdir; }
 
+    /**\brief Return name of the file the log buffer is mapped onto,
+     * or an empty string.
+     */
+    static const char * tail_name() { return _logtail; }
+
     /**\brief  Return the amount of space left in the log.
      * \details
      * Used by xct_impl for error-reporting. 
@@ -288,6 +339,15 @@ public:
                             // else need to join the insert queue
                             return _durable_lsn;
                         }
+    /**\brief Return the end of what the log partitions hold durably.
+     * \details
+     * Used by the log archiver, which copies closed partitions.  The
+     * same as durable_lsn() but with a mapped log tail.
+     */
+    lsn_t               synced_lsn() const {
+                            ASSERT_FITS_IN_POINTER(lsn_t);
+                            return _synced_lsn;
+                        }
     /**\brief used by restart.recover */
     lsn_t               master_lsn() const {
                             ASSERT_FITS_IN_POINTER(lsn_t);
@@ -298,6 +358,9 @@ public:
     // not called from the implementation:
     rc_t        scavenge(lsn_t min_rec_lsn, lsn_t min_xct_lsn);
     rc_t        insert(logrec_t &r, lsn_t* ret);
+    // build the record in place; "scratch" is for when it can't be
+    rc_t        insert(const logrec_writer_t &w, logrec_t* scratch, 
+                       lsn_t* ret);
     rc_t        compensate(lsn_t orig_lsn, lsn_t undo_lsn);
     // used by log_i and xct_impl
     rc_t        fetch(lsn_t &lsn, logrec_t* &rec, lsn_t* nxt=NULL);
@@ -359,6 +422,8 @@ public:
     bool                         next(lsn_t& lsn, logrec_t*& r);
     /// Get the return code from the last next() call.
     w_rc_t&                      get_last_rc();
+    /// Go on from \a lsn, which must be the lsn of a record.
+    void                         seek(const lsn_t& lsn) { cursor = lsn; }
 private:
     log_m&                       log;
     lsn_t                        cursor;
@@ -0,0 +1,700 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+// -*- mode:c++; c-basic-offset:4 -*-
+
+#define SM_SOURCE
+#define LOG_ARCHIVER_C
+
+#include "sm_int_1.h"
+#include "logtype_gen.h"
+#include "log_archiver.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sys/stat.h>
+
+// The archive index file, in the archive directory
+static const char arch_index_name[] = "arch.index";
+
+// Most we pread or pwrite at once
+static const int arch_xfer_sz = 1024*1024;
+
+static rc_t
+arch_pread(int fd, char* buf, smlevel_0::fileoff_t n, smlevel_0::fileoff_t pos)
+{
+    while(n > 0) {
+        int chunk = int(std::min(n, smlevel_0::fileoff_t(arch_xfer_sz)));
+        W_DO(me()->pread(fd, buf, chunk, pos));
+        buf += chunk;
+        pos += chunk;
+        n -= chunk;
+    }
+    return RCOK;
+}
+
+static rc_t
+arch_pwrite(int fd, const char* buf, smlevel_0::fileoff_t n,
+            smlevel_0::fileoff_t pos)
+{
+    while(n > 0) {
+        int chunk = int(std::min(n, smlevel_0::fileoff_t(arch_xfer_sz)));
+        W_DO(me()->pwrite(fd, buf, chunk, pos));
+        buf += chunk;
+        pos += chunk;
+        n -= chunk;
+    }
+    return RCOK;
+}
+
+// Where a page update is in the buffer of records being archived
+struct arch_rec_t {
+    vid_t               vid;
+    shpid_t             page;
+    lsn_t               lsn;
+    smlevel_0::fileoff_t off;
+
+    bool operator<(const arch_rec_t& o) const {
+        if(vid != o.vid) return vid < o.vid;
+        if(page != o.page) return page < o.page;
+        return lsn < o.lsn;
+    }
+};
+
+// Where the records of a page are, in one of the runs
+struct arch_ref_t {
+    shpid_t             page;
+    size_t              run;
+    size_t              idx;
+
+    // by page, and for a page in partition (hence lsn) order
+    bool operator<(const arch_ref_t& o) const {
+        return page < o.page || (page == o.page && run < o.run);
+    }
+};
+
+
+NORET
+log_archiver_t::log_archiver_t(const char* dir)
+    : smthread_t(t_regular, "log_archiver"),
+      _archived(0),
+      _retire(false),
+      _kicked(false)
+{
+    w_assert1(strlen(dir) < sizeof(_dir));
+    strcpy(_dir, dir);
+    pthread_mutex_init(&_lock, 0);
+    pthread_cond_init(&_wake, 0);
+}
+
+NORET
+log_archiver_t::~log_archiver_t()
+{
+    for(size_t i=0; i < _runs.size(); i++) {
+        delete _runs[i];
+    }
+    pthread_mutex_destroy(&_lock);
+    pthread_cond_destroy(&_wake);
+}
+
+void
+log_archiver_t::_make_name(char* buf, int bufsz,
+                           smlevel_0::partition_number_t num,
+                           const char* suffix) const
+{
+    w_ostrstream s(buf, bufsz);
+    s << _dir << '/' << "arch." << num << suffix << ends;
+}
+
+/*
+ * Read the archive index and the page indexes of the runs it lists.
+ * With an empty archive, start with the oldest partition the log
+ * still has.
+ */
+rc_t
+log_archiver_t::open()
+{
+    char fname[smlevel_0::max_devname];
+    {
+        w_ostrstream s(fname, sizeof(fname));
+        s << _dir << '/' << arch_index_name << ends;
+    }
+
+    struct stat st;
+    if(stat(_dir, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        smlevel_0::errlog->clog << error_prio
+            << "Log archive directory " << _dir << " does not exist"
+            << flushl;
+        return RC(smlevel_0::eBADARCHIVE);
+    }
+
+    int fd;
+    if(!me()->open(fname, smthread_t::OPEN_RDONLY, 0, fd).is_error()) {
+        sthread_t::filestat_t fst;
+        rc_t rc = me()->fstat(fd, fst);
+        smlevel_0::fileoff_t n = fst.st_size / sizeof(arch_run_hdr_t);
+        for(smlevel_0::fileoff_t i=0; !rc.is_error() && i < n; i++) {
+            run_t* run = new run_t;
+            rc = me()->pread(fd, &run->hdr, sizeof(run->hdr),
+                             i * sizeof(run->hdr));
+            // a torn last entry: that run was never finished
+            if(rc.is_error() || !run->hdr.valid()) {
+                delete run;
+                break;
+            }
+            rc = _load_run(*run);
+            if(rc.is_error()) {
+                delete run;
+                break;
+            }
+            _runs.push_back(run);
+            _archived = run->hdr.num;
+        }
+        W_DO(me()->close(fd));
+        W_DO(rc);
+    }
+
+    if(_runs.empty()) {
+        smlevel_0::partition_number_t n = smlevel_0::log->curr_lsn().hi();
+        char lname[smlevel_0::max_devname];
+        while(n > 1) {
+            log_m::make_log_name(n-1, lname, sizeof(lname));
+            if(stat(lname, &st) != 0) break;
+            n--;
+        }
+        _archived = n-1;
+    }
+
+    smlevel_0::log->set_archived(_archived);
+    return RCOK;
+}
+
+rc_t
+log_archiver_t::_load_run(run_t& run)
+{
+    char fname[smlevel_0::max_devname];
+    _make_name(fname, sizeof(fname), run.hdr.num);
+
+    int fd;
+    W_DO(me()->open(fname, smthread_t::OPEN_RDONLY, 0, fd));
+    arch_run_hdr_t hdr;
+    rc_t rc = me()->pread(fd, &hdr, sizeof(hdr), 0);
+    if(!rc.is_error() &&
+        (!hdr.valid() || hdr.num != run.hdr.num
+         || hdr.page_cnt != run.hdr.page_cnt)) {
+        rc = RC(smlevel_0::eBADARCHIVE);
+    }
+    if(!rc.is_error()) {
+        run.pages.resize(hdr.page_cnt);
+        if(hdr.page_cnt > 0) {
+            rc = arch_pread(fd, (char*) &run.pages[0],
+                            hdr.page_cnt * sizeof(arch_page_t),
+                            hdr.index_off);
+        }
+    }
+    W_DO(me()->close(fd));
+    return rc;
+}
+
+void
+log_archiver_t::run()
+{
+    while(true) {
+        {
+            CRITICAL_SECTION(cs, _lock);
+            if(!_kicked && !_retire) {
+                // look now and then even if nobody tells us to
+                struct timespec when;
+                sthread_t::timeout_to_timespec(1000, when);
+                DO_PTHREAD_TIMED(pthread_cond_timedwait(&_wake, &_lock,
+                                                        &when));
+            }
+            _kicked = false;
+            if(_retire)
+                break;
+        }
+
+        // Copy the partitions the log has moved past.
+        while(!_retire &&
+                smlevel_0::log->synced_lsn().hi() > _archived + 1) {
+            rc_t rc = _archive(_archived + 1);
+            if(rc.is_error()) {
+                smlevel_0::errlog->clog << error_prio
+                    << "Log archiver could not copy partition "
+                    << _archived + 1 << ": " << rc << flushl;
+                break; // try again later
+            }
+            // let the log recycle it
+            smlevel_0::log->set_archived(_archived);
+            W_COERCE(smlevel_0::log->scavenge(lsn_t::max, lsn_t::max));
+        }
+    }
+}
+
+void
+log_archiver_t::retire()
+{
+    CRITICAL_SECTION(cs, _lock);
+    _retire = true;
+    DO_PTHREAD(pthread_cond_signal(&_wake));
+}
+
+void
+log_archiver_t::wakeup()
+{
+    CRITICAL_SECTION(cs, _lock);
+    _kicked = true;
+    DO_PTHREAD(pthread_cond_signal(&_wake));
+}
+
+// Writes a file from offset "off" on, arch_xfer_sz bytes at a time
+class arch_writer_t {
+public:
+    arch_writer_t(int fd, smlevel_0::fileoff_t off) : _fd(fd), _off(off) {
+        _buf.reserve(arch_xfer_sz);
+    }
+
+    // where the next byte put goes
+    smlevel_0::fileoff_t off() const { return _off + _buf.size(); }
+
+    rc_t put(const char* p, size_t n) {
+        while(n > 0) {
+            size_t k = std::min(n, size_t(arch_xfer_sz) - _buf.size());
+            _buf.insert(_buf.end(), p, p + k);
+            p += k;
+            n -= k;
+            if(_buf.size() == size_t(arch_xfer_sz)) {
+                W_DO(flush());
+            }
+        }
+        return RCOK;
+    }
+
+    rc_t flush() {
+        if(!_buf.empty()) {
+            W_DO(me()->pwrite(_fd, &_buf[0], _buf.size(), _off));
+            _off += _buf.size();
+            _buf.clear();
+        }
+        return RCOK;
+    }
+
+private:
+    int                     _fd;
+    smlevel_0::fileoff_t    _off;
+    std::vector<char>       _buf;
+};
+
+/*
+ * Copy the page updates of log partition num into a new run, sorted by
+ * page and lsn.  The partition is closed, so the file is read directly
+ * rather than through the log, which may be waiting for us to finish.
+ * It is read, and the run written, arch_xfer_sz bytes at a time; only
+ * the page updates, compacted, are held in memory to be sorted.
+ */
+rc_t
+log_archiver_t::_archive(smlevel_0::partition_number_t num)
+{
+    char fname[smlevel_0::max_devname];
+    log_m::make_log_name(num, fname, sizeof(fname));
+
+    int fd;
+    if(me()->open(fname, smthread_t::OPEN_RDONLY, 0, fd).is_error()) {
+        // recycled before we got to it, e.g. while archiving was off
+        smlevel_0::errlog->clog << warning_prio
+            << "Log partition " << num
+            << " is gone; the log archive skips it" << flushl;
+        _archived = num;
+        return RCOK;
+    }
+    sthread_t::filestat_t fst;
+    rc_t rc = me()->fstat(fd, fst);
+    smlevel_0::fileoff_t size = fst.st_size;
+
+    // Pick out the page updates, and compact them.
+    std::vector<char>       recs;
+    std::vector<arch_rec_t> index;
+    logrec_t* r = new logrec_t;
+    w_auto_delete_t<logrec_t> ad_r(r);
+
+    // buf holds the partition from offset base on; a record that
+    // runs past what has been read is moved to the front, and the
+    // next chunk read in behind it.
+    const long bufsz = arch_xfer_sz + sizeof(logrec_t);
+    char* buf = new char[bufsz];
+    w_auto_delete_array_t<char> ad_buf(buf);
+    smlevel_0::fileoff_t base = 0;
+    long have = 0; // bytes in buf
+    long at = 0;   // where in buf the next record is
+    while(!rc.is_error()) {
+        if(have - at < long(sizeof(logrec_t)) && base + have < size) {
+            memmove(buf, buf + at, have - at);
+            base += at;
+            have -= at;
+            at = 0;
+            smlevel_0::fileoff_t n = std::min(size - (base + have),
+                                        smlevel_0::fileoff_t(bufsz - have));
+            rc = arch_pread(fd, buf + have, n, base + have);
+            if(rc.is_error()) break;
+            have += n;
+        }
+        if(at + long(logrec_t::common_hdr_sz) > have) break;
+
+        const logrec_t* l = (const logrec_t*) (buf + at);
+        smsize_t len = l->length();
+        if(len < l->min_length() || len > sizeof(logrec_t)
+            || at + long(len) > have
+            || l->type() == logrec_t::t_skip
+            || l->get_lsn_ck() != lsn_t(num, base + at)) {
+            break; // end of the partition
+        }
+        memcpy((char*) r, l, len);
+        if(r->is_compact()) r->expand();
+
+        if(r->is_redo() && !r->null_pid()) {
+            arch_rec_t e;
+            e.vid = r->vid();
+            e.page = r->shpid();
+            e.lsn = r->lsn_ck();
+            e.off = recs.size();
+            index.push_back(e);
+
+            char hdr[logrec_t::compact_hdr_max];
+            smsize_t hsz = r->compact(hdr);
+            if(hsz > 0) {
+                recs.insert(recs.end(), hdr, hdr + hsz);
+                recs.insert(recs.end(), r->data(),
+                            r->data() + r->length() - logrec_t::hdr_sz);
+            } else {
+                recs.insert(recs.end(), (const char*) r,
+                            ((const char*) r) + r->length());
+            }
+        }
+        at += len;
+    }
+    W_DO(me()->close(fd));
+    W_DO(rc);
+    smlevel_0::fileoff_t pos = base + at;
+    std::sort(index.begin(), index.end());
+
+    arch_run_hdr_t hdr = arch_run_hdr_t();
+    hdr.magic = arch_run_hdr_t::magic_val;
+    hdr.version = arch_run_hdr_t::version_val;
+    hdr.num = num;
+    hdr.rec_cnt = index.size();
+    hdr.first = log_m::first_lsn(num);
+    hdr.end = lsn_t(num, pos);
+
+    // Write it under a temporary name, so that a run file is either
+    // whole or missing, then enter it in the archive index.  The run
+    // is the header, the records by page, then the page index; the
+    // header is written last, when it knows where the index is.
+    char tmpname[smlevel_0::max_devname];
+    char runname[smlevel_0::max_devname];
+    _make_name(tmpname, sizeof(tmpname), num, ".tmp");
+    _make_name(runname, sizeof(runname), num);
+
+    run_t* run = new run_t;
+    smlevel_0::fileoff_t bytes = 0;
+    rc = me()->open(tmpname, smthread_t::OPEN_WRONLY | smthread_t::OPEN_CREATE
+                    | smthread_t::OPEN_TRUNC, 0644, fd);
+    if(!rc.is_error()) {
+        arch_writer_t w(fd, sizeof(hdr));
+        for(size_t i=0; i < index.size() && !rc.is_error(); i++) {
+            const arch_rec_t& e = index[i];
+            if(i == 0 || e.vid != index[i-1].vid 
+                    || e.page != index[i-1].page) {
+                arch_page_t p = arch_page_t();
+                p.vid = e.vid;
+                p.page = e.page;
+                p.off = w.off();
+                run->pages.push_back(p);
+            }
+            const logrec_t* c = (const logrec_t*) &recs[e.off];
+            rc = w.put((const char*) c, c->length());
+        }
+        hdr.page_cnt = run->pages.size();
+        hdr.index_off = w.off();
+        if(!rc.is_error() && hdr.page_cnt > 0) {
+            rc = w.put((const char*) &run->pages[0],
+                       hdr.page_cnt * sizeof(arch_page_t));
+        }
+        if(!rc.is_error()) rc = w.flush();
+        if(!rc.is_error()) rc = me()->pwrite(fd, &hdr, sizeof(hdr), 0);
+        if(!rc.is_error()) rc = me()->fsync(fd);
+        W_COERCE(me()->close(fd));
+        bytes = w.off();
+    }
+    run->hdr = hdr;
+    if(!rc.is_error() && ::rename(tmpname, runname) != 0) {
+        rc = RC(smlevel_0::eOS);
+    }
+
+    char iname[smlevel_0::max_devname];
+    {
+        w_ostrstream s(iname, sizeof(iname));
+        s << _dir << '/' << arch_index_name << ends;
+    }
+    if(!rc.is_error()) {
+        rc = me()->open(iname, smthread_t::OPEN_RDWR | smthread_t::OPEN_CREATE,
+                        0644, fd);
+    }
+    if(!rc.is_error()) {
+        // overwrites a torn entry, if there is one
+        CRITICAL_SECTION(cs, _lock);
+        rc = me()->pwrite(fd, &hdr, sizeof(hdr),
+                          _runs.size() * sizeof(hdr));
+        if(!rc.is_error()) rc = me()->fsync(fd);
+        W_COERCE(me()->close(fd));
+        if(!rc.is_error()) {
+            _runs.push_back(run);
+            run = 0;
+            _archived = num;
+        }
+    }
+    delete run;
+    W_DO(rc);
+
+    INC_TSTAT(log_arch_runs);
+    ADD_TSTAT(log_arch_records, hdr.rec_cnt);
+    ADD_TSTAT(log_arch_bytes, bytes);
+    return RCOK;
+}
+
+/*
+ * Read the records of page i of a run into buf.
+ */
+rc_t
+log_archiver_t::_read_page(int fd, const run_t& run, size_t i,
+                           std::vector<char>& buf)
+{
+    smlevel_0::fileoff_t off = run.pages[i].off;
+    smlevel_0::fileoff_t end = (i+1 < run.pages.size()) ?
+        run.pages[i+1].off : run.hdr.index_off;
+    buf.resize(end - off);
+    if(end > off) {
+        W_DO(arch_pread(fd, &buf[0], end - off, off));
+    }
+    return RCOK;
+}
+
+/*
+ * Redo r on the page if the page is older.  The caller writes the
+ * page out (bf_m::force_unlogged) before unfixing it.
+ */
+bool
+log_archiver_t::_apply(page_p& page, logrec_t& r)
+{
+    lsn_t lsn = r.lsn_ck();
+    if(page.lsn() >= lsn) return false;
+    r.redo(&page);
+    page.set_lsns(lsn);
+    INC_TSTAT(log_arch_redone);
+    return true;
+}
+
+/*
+ * Write out a page we have redone updates to, and unfix it.
+ */
+rc_t
+log_archiver_t::_finish(page_p& page)
+{
+    W_DO(smlevel_0::bf->force_unlogged(&page.persistent_part()));
+    page.unfix();
+    return RCOK;
+}
+
+/*
+ * Redo the records of one page of a run, in buf, on the page; fix the
+ * page first if it isn't.
+ */
+rc_t
+log_archiver_t::_redo_page(const std::vector<char>& buf, page_p& page,
+                           logrec_t* r, int& applied)
+{
+    size_t pos = 0;
+    while(pos < buf.size()) {
+        const logrec_t* l = (const logrec_t*) &buf[pos];
+        smsize_t len = l->length();
+        if(len < l->min_length() || pos + len > buf.size()) {
+            return RC(smlevel_0::eBADARCHIVE);
+        }
+        memcpy((char*) r, l, len);
+        if(r->is_compact()) r->expand();
+        if(!page.is_fixed()) {
+            smlevel_0::store_flag_t store_flags = smlevel_0::st_bad;
+            W_DO(page.fix(r->construct_pid(), page_p::t_any_p, LATCH_EX,
+                          0, store_flags, true));
+        }
+        if(_apply(page, *r)) applied++;
+        pos += len;
+    }
+    return RCOK;
+}
+
+/*
+ * Redo what the log has, from lsn "from" on, for the page (or, with
+ * no page, the volume).
+ */
+rc_t
+log_archiver_t::redo_log(const lsn_t& from, const vid_t& vid,
+                         page_p* page, int& applied)
+{
+    logrec_t* r = new logrec_t;
+    w_auto_delete_t<logrec_t> ad_r(r);
+
+    lsn_t lsn = from;
+    while(true) {
+        logrec_t* l;
+        lsn_t nxt;
+        rc_t rc = smlevel_0::log->fetch(lsn, l, &nxt);
+        if(!rc.is_error()) memcpy((char*) r, l, l->length());
+        smlevel_0::log->release();
+        if(rc.is_error()) {
+            if(rc.err_num() == smlevel_0::eEOF) break;
+            return rc;
+        }
+        lsn = nxt;
+
+        if(!r->is_redo() || r->null_pid() || r->vid() != vid) continue;
+        if(page) {
+            if(r->shpid() != page->pid().page) continue;
+            if(_apply(*page, *r)) applied++;
+        } else {
+            page_p p;
+            smlevel_0::store_flag_t store_flags = smlevel_0::st_bad;
+            W_DO(p.fix(r->construct_pid(), page_p::t_any_p, LATCH_EX,
+                       0, store_flags, true));
+            if(_apply(p, *r)) applied++;
+            W_DO(_finish(p));
+        }
+    }
+    return RCOK;
+}
+
+rc_t
+log_archiver_t::restore_page(page_p& page, int& applied)
+{
+    applied = 0;
+    std::vector<run_t*> runs;
+    lsn_t tail;
+    {
+        CRITICAL_SECTION(cs, _lock);
+        runs = _runs;
+        tail = log_m::first_lsn(_archived + 1);
+    }
+
+    logrec_t* r = new logrec_t;
+    w_auto_delete_t<logrec_t> ad_r(r);
+    std::vector<char> buf;
+
+    arch_page_t key;
+    key.vid = page.pid().vol();
+    key.page = page.pid().page;
+    for(size_t i=0; i < runs.size(); i++) {
+        const std::vector<arch_page_t>& pages = runs[i]->pages;
+        std::vector<arch_page_t>::const_iterator it
+            = std::lower_bound(pages.begin(), pages.end(), key);
+        if(it == pages.end() || key < *it) continue;
+
+        char fname[smlevel_0::max_devname];
+        _make_name(fname, sizeof(fname), runs[i]->hdr.num);
+        int fd;
+        W_DO(me()->open(fname, smthread_t::OPEN_RDONLY, 0, fd));
+        rc_t rc = _read_page(fd, *runs[i], it - pages.begin(), buf);
+        W_COERCE(me()->close(fd));
+        W_DO(rc);
+        W_DO(_redo_page(buf, page, r, applied));
+    }
+    W_DO(redo_log(tail, key.vid, &page, applied));
+    return smlevel_0::bf->force_unlogged(&page.persistent_part());
+}
+
+rc_t
+log_archiver_t::restore_volume(const vid_t& vid, int& applied)
+{
+    applied = 0;
+    std::vector<run_t*> runs;
+    lsn_t tail;
+    {
+        CRITICAL_SECTION(cs, _lock);
+        runs = _runs;
+        tail = log_m::first_lsn(_archived + 1);
+    }
+
+    // Merge the page indexes of the runs, so that each page is visited
+    // once, with its records from all runs in lsn order.
+    arch_page_t lo, hi;
+    lo.vid = hi.vid = vid;
+    lo.page = 0;
+    hi.page = shpid_t(-1);
+    std::vector<arch_ref_t> refs;
+    for(size_t i=0; i < runs.size(); i++) {
+        const std::vector<arch_page_t>& pages = runs[i]->pages;
+        std::vector<arch_page_t>::const_iterator it
+            = std::lower_bound(pages.begin(), pages.end(), lo);
+        for( ; it != pages.end() && !(hi < *it); ++it) {
+            arch_ref_t ref;
+            ref.page = it->page;
+            ref.run = i;
+            ref.idx = it - pages.begin();
+            refs.push_back(ref);
+        }
+    }
+    std::sort(refs.begin(), refs.end());
+
+    std::vector<int> fds(runs.size(), -1);
+    rc_t rc;
+    {
+        logrec_t* r = new logrec_t;
+        w_auto_delete_t<logrec_t> ad_r(r);
+        std::vector<char> buf;
+        page_p page;
+        for(size_t i=0; !rc.is_error() && i < refs.size(); i++) {
+            if(i > 0 && refs[i].page != refs[i-1].page) {
+                rc = _finish(page);
+                if(rc.is_error()) break;
+            }
+
+            int& fd = fds[refs[i].run];
+            if(fd == -1) {
+                char fname[smlevel_0::max_devname];
+                _make_name(fname, sizeof(fname), runs[refs[i].run]->hdr.num);
+                rc = me()->open(fname, smthread_t::OPEN_RDONLY, 0, fd);
+                if(rc.is_error()) {
+                    fd = -1;
+                    break;
+                }
+            }
+            rc = _read_page(fd, *runs[refs[i].run], refs[i].idx, buf);
+            if(!rc.is_error()) rc = _redo_page(buf, page, r, applied);
+        }
+        if(!rc.is_error() && page.is_fixed()) rc = _finish(page);
+    }
+    for(size_t i=0; i < fds.size(); i++) {
+        if(fds[i] != -1) W_COERCE(me()->close(fds[i]));
+    }
+    W_DO(rc);
+
+    return redo_log(tail, vid, 0, applied);
+}
@@ -0,0 +1,170 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+// -*- mode:c++; c-basic-offset:4 -*-
+
+#ifndef LOG_ARCHIVER_H
+#define LOG_ARCHIVER_H
+
+#include "w_defines.h"
+
+#include <vector>
+
+class page_p;
+class logrec_t;
+
+/**\cond skip */
+/*
+ * Header of an archive run file, which holds the page updates of one
+ * log partition.  The same header, appended to the archive index file,
+ * is the run's entry there.
+ */
+struct arch_run_hdr_t {
+    enum {
+        magic_val = 0x4c415243, // "LARC"
+        version_val = 1
+    };
+    w_base_t::uint4_t   magic;
+    w_base_t::uint4_t   version;
+    w_base_t::uint4_t   num;        // log partition archived
+    w_base_t::uint4_t   page_cnt;   // entries in the page index
+    w_base_t::uint8_t   rec_cnt;    // log records in the run
+    lsn_t               first;      // first lsn of the partition
+    lsn_t               end;        // lsn past its last record
+    smlevel_0::fileoff_t index_off; // where the page index starts
+
+    bool valid() const {
+        return magic == magic_val && version == version_val;
+    }
+};
+
+/*
+ * Page index entry of a run: the records of page (vid, page) start
+ * at off, and go on to the next entry's off.
+ */
+struct arch_page_t {
+    vid_t               vid;
+    w_base_t::uint2_t   pad;
+    shpid_t             page;
+    smlevel_0::fileoff_t off;
+
+    bool operator<(const arch_page_t& o) const {
+        return vid < o.vid || (vid == o.vid && page < o.page);
+    }
+};
+/**\endcond skip */
+
+/**\brief Copies closed log partitions into a log archive.
+ *
+ * \details
+ * With the sm_archdir option, the storage manager keeps a continuous
+ * history of page updates beyond what the log itself keeps: this
+ * thread copies each log partition, once the log has moved on to the
+ * next one, into a run file arch.<partition> in the archive directory,
+ * and the log does not recycle a partition until it has been copied.
+ *
+ * A run holds only the records that redo page updates, sorted by page
+ * id and then lsn, with their headers in the compact encoding (see
+ * logrec_t::compact()), followed by an index of the pages in it.  The
+ * archive index file, arch.index, lists the runs in partition order.
+ *
+ * For media recovery, restore_page() and restore_volume() start from
+ * the pages' images on the volume (e.g. restored from a backup) and
+ * redo the newer updates to them: those in the archive, found through
+ * the page indexes of the runs and merged in lsn order, then those
+ * still in the log.
+ */
+class log_archiver_t : public smthread_t {
+public:
+    NORET               log_archiver_t(const char* dir);
+    NORET               ~log_archiver_t();
+
+    /**\brief Read the archive index, and tell the log which
+     * partitions to keep for us.  Call before fork().
+     */
+    rc_t                open();
+
+    virtual void        run();
+    /// Stop the thread; join() it afterwards.
+    void                retire();
+    /// Look for closed partitions now.
+    void                wakeup();
+
+    /// The last partition copied to the archive.
+    smlevel_0::partition_number_t archived() const { return _archived; }
+
+    /**\brief Redo the archived and logged updates to a page that are
+     * newer than its image.  The caller must have the page fixed EX,
+     * and be in a transaction with logging turned off.
+     */
+    rc_t                restore_page(page_p& page, int& applied);
+
+    /**\brief Redo the archived and logged updates to all pages of a
+     * volume that are newer than their images.  Must be called in a
+     * transaction with logging turned off.
+     */
+    rc_t                restore_volume(const vid_t& vid, int& applied);
+
+    /**\brief Redo the updates in the log from lsn "from" on to the given
+     * page, or with no page, to all pages of the volume, that are newer
+     * than their images.  Must be called in a transaction with logging
+     * turned off.
+     */
+    static rc_t         redo_log(const lsn_t& from, const vid_t& vid,
+                                 page_p* page, int& applied);
+
+private:
+    // A run we know of.
+    struct run_t {
+        arch_run_hdr_t              hdr;
+        std::vector<arch_page_t>    pages;
+    };
+
+    rc_t                _archive(smlevel_0::partition_number_t num);
+    rc_t                _load_run(run_t& run);
+    rc_t                _read_page(int fd, const run_t& run, size_t i,
+                                   std::vector<char>& buf);
+    rc_t                _redo_page(const std::vector<char>& buf,
+                                   page_p& page, logrec_t* r, int& applied);
+    static bool         _apply(page_p& page, logrec_t& r);
+    static rc_t         _finish(page_p& page);
+
+    void                _make_name(char* buf, int bufsz,
+                                   smlevel_0::partition_number_t num,
+                                   const char* suffix = "") const;
+
+    char                _dir[smlevel_0::max_devname];
+    smlevel_0::partition_number_t volatile _archived;
+    std::vector<run_t*> _runs;      // in partition order
+    bool                _retire;
+    bool                _kicked;
+
+    pthread_mutex_t     _lock;      // paired with _wake; protects _runs
+    pthread_cond_t      _wake;      // paired with _lock
+
+    // disabled
+    NORET               log_archiver_t(const log_archiver_t&);
+    log_archiver_t&     operator=(const log_archiver_t&);
+};
+
+#endif
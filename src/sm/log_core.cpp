@@ -69,6 +69,9 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 #endif
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <os_interface.h>
 #include <largefile_aware.h>
 
@@ -80,6 +83,7 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 
 // chkpt.h needed to kick checkpoint thread
 #include "chkpt.h"
+#include "log_archiver.h"
 
 #include <sstream>
 #include <w_strstream.h>
@@ -230,6 +234,8 @@ log_core::scavenge(lsn_t min_rec_lsn, lsn_t min_xct_lsn)
     partition_t        *p;
 
     lsn_t lsn = global_min_lsn(min_rec_lsn,min_xct_lsn);
+    // nor the ones the log archiver or a volume backup still needs
+    lsn = std::min(lsn, retain_min_lsn());
     partition_number_t min_num;
     {
         /* 
@@ -319,6 +325,15 @@ log_core::_flushX(lsn_t start_lsn,
         w_assert3(start_lsn.file() == n+1);
         w_assert3(n != 0);
 
+        // what we wrote to the old one must be durable before we close it
+        _sync_written();
+
+        // and restart can skip it if it has the summary of all of it
+        if(_summary.covers(n) && _summary.end() == lsn_t(n, p->size())) {
+            p->write_summary(_summary);
+            INC_TSTAT(log_summaries_written);
+        }
+
         {
             /* FRJ: before starting into the CS below we have to be
                sure an empty partition waits for us (otherwise we
@@ -329,7 +344,9 @@ log_core::_flushX(lsn_t start_lsn,
         retry:
             bf->activate_background_flushing();
             smlevel_1::chkpt->wakeup_and_take();
-            u_int oldest = log->global_min_lsn().hi();
+            if(smlevel_1::archiver) smlevel_1::archiver->wakeup();
+            u_int oldest = log->global_min_lsn(
+                                    log->retain_min_lsn()).hi();
             if(oldest + PARTITION_COUNT == start_lsn.file()) {
             fprintf(stderr, "Can't open partition %d until partition %d is reclaimed\n",
                 start_lsn.file(), oldest);
@@ -338,7 +355,8 @@ log_core::_flushX(lsn_t start_lsn,
             }
             DO_PTHREAD(pthread_mutex_unlock(&_scavenge_lock));
             
-            // grab the lock -- we're about to mess with partitions
+            // grab the locks -- we're about to mess with partitions
+            CRITICAL_SECTION(scs, _sync_lock);
             CRITICAL_SECTION(cs, _partition_lock);
             p->close();  
             unset_current();
@@ -347,15 +365,22 @@ log_core::_flushX(lsn_t start_lsn,
             p = _open_partition_for_append(n+1, lsn_t::null, false, false);
         }
         
+        // the one we closed can go to the archive
+        if(smlevel_1::archiver) smlevel_1::archiver->wakeup();
+
         // it's a new partition -- size is now 0
         w_assert3(curr_partition()->size()== 0);
         w_assert3(partition_num() != 0);
     }
 
-    // Flush the log buffer
-    p->flush(p->fhdl_app(), start_lsn, _buf, start1, end1, start2, end2);
+    // Write the log buffer; _sync_written() fsyncs
+    p->flush(p->fhdl_app(), start_lsn, _buf, start1, end1, start2, end2,
+             false);
     long written = (end2 - start2) + (end1 - start1);
     p->set_size(start_lsn.lo()+written);
+    _written_bytes += written;
+
+    _summarize(start_lsn, start1, end1, start2, end2);
 
 #if W_DEBUG_LEVEL > 2
     _sanity_check();
@@ -363,6 +388,361 @@ log_core::_flushX(lsn_t start_lsn,
 }
 
 
+/*********************************************************************
+ *
+ *  log_core::_summarize(start_lsn, start1, end1, start2, end2)
+ *
+ *  Add the records _flushX just wrote to the summary of the current
+ *  partition, if it has one from its first record on (sm_log_summary).
+ *  The daemon writes whole records, but one may wrap around from
+ *  the end of _buf[start1,end1) to _buf[start2,end2).
+ *
+ *********************************************************************/
+void
+log_core::_summarize(const lsn_t& start_lsn, long start1, long end1,
+                     long start2, long end2)
+{
+    if(!smlevel_0::do_log_summary) return;
+    if(start_lsn == first_lsn(start_lsn.hi())) _summary.reset(start_lsn);
+    if(!_summary.covers(start_lsn.hi())) return;
+
+    long len1 = end1 - start1;
+    long total = len1 + (end2 - start2);
+    logrec_t& r = _summary.scratch();
+    for(long off = 0; off < total; ) {
+        // the header is all we need, in either encoding
+        long want = std::min(total - off, long(logrec_t::compact_hdr_max));
+        char* to = (char*) &r;
+        if(off < len1) {
+            long n = std::min(want, len1 - off);
+            memcpy(to, _buf + start1 + off, n);
+            memcpy(to + n, _buf + start2, want - n);
+        } else {
+            memcpy(to, _buf + start2 + (off - len1), want);
+        }
+
+        long len = r.length();
+        if(len < long(r.min_length()) || off + len > total) {
+            // e.g. start_log_corruption()
+            _summary.invalidate();
+            return;
+        }
+        if(r.is_compact()) r.expand();
+        lsn_t lsn = start_lsn + off;
+        _summary.add(r, lsn, lsn + len);
+        off += len;
+    }
+}
+
+
+/*********************************************************************
+ *
+ *  log_core::_sync_written()
+ *
+ *  fsync the current partition, making what the flush daemon has
+ *  written so far durable, and wake those waiting for it.
+ *  Called by the syncer, and by the flush daemon itself when it
+ *  runs without a syncer (sm_log_flush_pipeline=no), when it moves
+ *  on to a new partition and when it shuts down.
+ *
+ *********************************************************************/
+void
+log_core::_sync_written()
+{
+    {
+        CRITICAL_SECTION(cs, _sync_lock);
+        lsn_t target = *&_written_lsn;
+        if(target <= *&_synced_lsn) return;
+        long bytes = *&_written_bytes - _synced_bytes;
+
+        partition_t* p = curr_partition();
+        hrtime_t start = gethrtime();
+        p->flush(p->fhdl_app());
+        long us = long((gethrtime() - start) / 1000);
+
+        if(bytes <= 4*1024)             INC_TSTAT(log_sync_4k);
+        else if(bytes <= 32*1024)       INC_TSTAT(log_sync_32k);
+        else if(bytes <= 256*1024)      INC_TSTAT(log_sync_256k);
+        else                            INC_TSTAT(log_sync_big);
+        if(us < 100)                    INC_TSTAT(log_sync_100us);
+        else if(us < 1000)              INC_TSTAT(log_sync_1ms);
+        else if(us < 10000)             INC_TSTAT(log_sync_10ms);
+        else                            INC_TSTAT(log_sync_slow);
+        ADD_TSTAT(log_sync_us, us);
+
+        _synced_bytes += bytes;
+        _synced_lsn = target;
+        if(_tail_map) {
+            // restart need not copy these from the tail any more
+            CRITICAL_SECTION(tcs, _tail_lock);
+            if(_tail_hdr.synced < target) {
+                _tail_hdr.synced = target;
+                _write_tail_hdr();
+            }
+        }
+        _set_durable(target);
+    }
+
+    // wake up anyone waiting on log flush
+    CRITICAL_SECTION(cs, _wait_flush_lock);
+    DO_PTHREAD(pthread_cond_broadcast(&_wait_cond)); 
+}
+
+// Move _durable_lsn up to lsn; the syncer and the committing threads
+// persisting the mapped log tail race to do so.
+void
+log_core::_set_durable(const lsn_t& lsn)
+{
+    ASSERT_FITS_IN_POINTER(lsn_t);
+    lsn_t old = *&_durable_lsn;
+    while(old < lsn) {
+        uint64_t ov = *(uint64_t*)&old;
+        uint64_t cv = atomic_cas_64((uint64_t*)&_durable_lsn, ov,
+                                    *(uint64_t*)&lsn);
+        if(cv == ov) break;
+        old = *(lsn_t*)&cv;
+    }
+}
+
+// Wait until the flush daemon has written the log up to lsn, which
+// can be later than making it durable with a mapped log tail.
+void
+log_core::_wait_written(const lsn_t& lsn)
+{
+    CRITICAL_SECTION(cs, _wait_flush_lock);
+    while(lsn >= *&_written_lsn) {
+        *&_waiting_for_flush = true;
+        DO_PTHREAD(pthread_cond_signal(&_flush_cond));
+        DO_PTHREAD(pthread_cond_wait(&_wait_cond, &_wait_flush_lock));
+    }
+}
+
+/*********************************************************************
+ *
+ *  The mapped log tail (sm_log_tail)
+ *
+ *  The tail file holds two headers, then the log buffer.  A header
+ *  records what the partitions have (synced), what the tail has
+ *  (persisted), and the two epochs, which tell where in the buffer
+ *  the records in between are.  The records between synced and
+ *  persisted are never overwritten, since the flush daemon lets
+ *  inserts reuse buffer space only once it is synced.
+ *
+ *********************************************************************/
+
+w_base_t::uint8_t
+log_core::tail_hdr_t::checksum() const
+{
+    const w_base_t::uint8_t* w = (const w_base_t::uint8_t*) this;
+    long n = ((const char*) &sum - (const char*) this) / sizeof(*w);
+    w_base_t::uint8_t s = magic_val;
+    for(long i=0; i < n; i++) {
+        s = ((s << 7) | (s >> 57)) ^ w[i];
+    }
+    return s;
+}
+
+// Make len bytes at addr in the tail file durable.
+void
+log_core::_persist(const char* addr, long len)
+{
+    if(len <= 0) return;
+#if defined(__x86_64__) || defined(__i386__)
+    if(_tail_dax) {
+        // the mapping is synchronous: out of the cache is on media
+        enum { LINE=64 };
+        for(const char* p = (const char*)(long(addr) & ~long(LINE-1));
+                p < addr+len; p += LINE) {
+            __asm__ __volatile__("clflush %0" : : "m"(*p));
+        }
+        __asm__ __volatile__("sfence" : : : "memory");
+        return;
+    }
+#endif
+    long pg = sysconf(_SC_PAGESIZE);
+    char* start = (char*)(long(addr) & ~(pg-1));
+    if(msync(start, addr+len-start, MS_SYNC) != 0) {
+        W_FATAL_MSG(fcOS, << "cannot msync the log tail " << tail_name());
+    }
+}
+
+// Write _tail_hdr over the older of the two headers.  Caller holds
+// _tail_lock.
+void
+log_core::_write_tail_hdr()
+{
+    _tail_hdr.seq++;
+    _tail_hdr.sum = _tail_hdr.checksum();
+    char* slot = _tail_map + (_tail_hdr.seq % 2) * TAIL_HDR_SLOT;
+    memcpy(slot, &_tail_hdr, sizeof(_tail_hdr));
+    _persist(slot, sizeof(_tail_hdr));
+}
+
+// Map the log buffer onto the tail file.  Called by the constructor.
+void
+log_core::_open_tail()
+{
+    w_assert1(sizeof(tail_hdr_t) <= TAIL_HDR_SLOT);
+    long pg = sysconf(_SC_PAGESIZE);
+    long hdr_sz = _ceil(2*TAIL_HDR_SLOT, pg);
+    _tail_map_sz = hdr_sz + _segsize;
+
+    int fd = ::open(tail_name(), O_RDWR | O_CREAT, 0666);
+    if(fd < 0) {
+        W_FATAL_MSG(fcOS, << "cannot open the log tail " << tail_name());
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (st.st_size < _tail_map_sz
+                && ftruncate(fd, _tail_map_sz) != 0)) {
+        W_FATAL_MSG(fcOS, << "cannot size the log tail " << tail_name());
+    }
+
+    void* m = MAP_FAILED;
+    _tail_dax = false;
+#if defined(MAP_SYNC) && defined(MAP_SHARED_VALIDATE)
+    // only DAX file systems take this
+    m = mmap(0, _tail_map_sz, PROT_READ | PROT_WRITE,
+             MAP_SHARED_VALIDATE | MAP_SYNC, fd, 0);
+    _tail_dax = (m != MAP_FAILED);
+#endif
+    if(m == MAP_FAILED) {
+        m = mmap(0, _tail_map_sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if(m == MAP_FAILED) {
+        W_FATAL_MSG(fcOS, << "cannot map the log tail " << tail_name());
+    }
+    _tail_map = (char*) m;
+
+    // the later valid header is current
+    const tail_hdr_t* h0 = (const tail_hdr_t*) _tail_map;
+    const tail_hdr_t* h1 = (const tail_hdr_t*) (_tail_map + TAIL_HDR_SLOT);
+    const tail_hdr_t* h = 0;
+    if(h0->valid()) h = h0;
+    if(h1->valid() && (!h || h1->seq > h->seq)) h = h1;
+    if(h) {
+        _tail_hdr = *h;
+    } else {
+        _tail_hdr = tail_hdr_t();
+        _tail_hdr.magic = tail_hdr_t::magic_val;
+    }
+
+    delete [] _buf;
+    _buf = _tail_map + hdr_sz;
+}
+
+extern char* block_of_zeros(); // partition.cpp
+
+/*
+ * Write the bytes of the epoch with the given base_lsn and end,
+ * from lsn "from" on, to their partition, followed by a skip record,
+ * as _flushX would have.
+ */
+void
+log_core::_write_tail_range(const lsn_t& from, const lsn_t& base, long end)
+{
+    w_assert1(from.hi() == base.hi() && from >= base);
+    long off = from.lo() - base.lo();
+    long len = end - off;
+    if(len <= 0) return;
+    lsn_t to = from + len;
+
+    char fname[max_devname];
+    make_log_name(from.hi(), fname, sizeof(fname));
+    int fd;
+    W_COERCE(me()->open(fname, smthread_t::OPEN_RDWR | smthread_t::OPEN_CREATE,
+                        0666, fd));
+    W_COERCE(me()->pwrite(fd, _buf + off, len, from.lo()));
+
+    // as at the end of every flush
+    _skip_log->set_lsn_ck(to);
+    long total = ceil2(to.lo() + _skip_log->length(), BLOCK_SIZE) - to.lo();
+    W_COERCE(me()->pwrite(fd, _skip_log, _skip_log->length(), to.lo()));
+    W_COERCE(me()->pwrite(fd, block_of_zeros(), total - _skip_log->length(),
+                          to.lo() + _skip_log->length()));
+    W_COERCE(me()->fsync(fd));
+    W_COERCE(me()->close(fd));
+    ADD_TSTAT(log_tail_recovered, len);
+}
+
+/*
+ * Copy to the partitions what the tail has and they don't.  Called
+ * by the constructor before it looks at the partitions.
+ */
+void
+log_core::_recover_tail()
+{
+    tail_hdr_t& h = _tail_hdr;
+    if(h.persisted <= h.synced) return;
+    if(h.segsize != _segsize) {
+        W_FATAL_MSG(fcINTERNAL, << "log tail " << tail_name()
+                << " is for a log buffer of " << h.segsize
+                << " bytes, not " << _segsize);
+    }
+
+    lsn_t from = h.synced;
+    if(from < h.cur_base) {
+        // starts in the old epoch
+        if(from.hi() == h.old_base.hi() && from >= h.old_base) {
+            _write_tail_range(from, h.old_base, h.old_end);
+        }
+        from = h.cur_base;
+    }
+    _write_tail_range(from, h.cur_base, h.cur_end);
+
+    CRITICAL_SECTION(cs, _tail_lock);
+    h.synced = h.persisted;
+    _write_tail_hdr();
+}
+
+/*
+ * Make everything inserted so far durable in the tail.  Called by
+ * flush() instead of waiting for the flush daemon.
+ */
+void
+log_core::_persist_tail()
+{
+    CRITICAL_SECTION(cs, _tail_lock);
+    epoch o, c;
+    {
+        CRITICAL_SECTION(fcs, _flush_lock);
+        o = _old_epoch;
+        c = _cur_epoch;
+    }
+    lsn_t to = c.base_lsn + c.end;
+    if(to <= _tail_hdr.persisted) return;
+
+    // From the lsn before which everything is in the partitions or
+    // already here.  What's after that is still in the buffer.
+    lsn_t from = std::min(to, std::max(_tail_hdr.persisted, *&_synced_lsn));
+    long bytes = 0;
+    if(from < c.base_lsn) {
+        // starts in the old epoch
+        if(from.hi() == o.base_lsn.hi() && from >= o.base_lsn) {
+            long off = from.lo() - o.base_lsn.lo();
+            _persist(_buf + off, o.end - off);
+            bytes += o.end - off;
+        }
+        from = c.base_lsn;
+    }
+    long off = from.lo() - c.base_lsn.lo();
+    _persist(_buf + off, c.end - off);
+    bytes += c.end - off;
+
+    _tail_hdr.segsize = _segsize;
+    _tail_hdr.synced = std::max(_tail_hdr.synced, *&_synced_lsn);
+    _tail_hdr.persisted = to;
+    _tail_hdr.old_base = o.base_lsn;
+    _tail_hdr.old_end = o.end;
+    _tail_hdr.cur_base = c.base_lsn;
+    _tail_hdr.cur_end = c.end;
+    _write_tail_hdr();
+
+    INC_TSTAT(log_tail_persists);
+    ADD_TSTAT(log_tail_bytes, bytes);
+    _set_durable(to);
+}
+
 // See that the log buffer contains whatever partial log record
 // might have been written to the tail of the file fd.
 // Used when recovery finds a not-full partition file.
@@ -371,7 +751,7 @@ log_core::_prime(int fd, fileoff_t start, lsn_t next)
 {
     w_assert1(_durable_lsn == _curr_lsn); // better be startup/recovery!
     long boffset = prime(_buf, fd, start, next);
-    _durable_lsn = _flush_lsn = _curr_lsn = next;
+    _synced_lsn = _written_lsn = _durable_lsn = _flush_lsn = _curr_lsn = next;
 
     /* FRJ: the new code assumes that the buffer is always aligned
        with some buffer-sized multiple of the partition, so we need to
@@ -543,6 +923,10 @@ log_core::fetch(lsn_t& ll, logrec_t*& rp, lsn_t* nxt)
     // ll is at the *beginning* of what we want
     // to read...
     W_DO(flush(ll+sizeof(logrec_t)));
+    if(_tail_map) {
+        // durable in the tail is not enough to read it
+        _wait_written(std::min(ll+sizeof(logrec_t), (*&_curr_lsn)+ -1));
+    }
 
     // protect against double-acquire
     _acquire(); // caller must release the _partition_lock mutex
@@ -632,6 +1016,11 @@ log_core::fetch(lsn_t& ll, logrec_t*& rp, lsn_t* nxt)
         *nxt = tmp.advance(r.length());
     }
 
+    // hand it out in the full encoding; the read buffer has room
+    if (r.is_compact()) {
+        r.expand();
+    }
+
 #ifdef UNDEF
     int saved = r._checksum;
     r._checksum = 0;
@@ -924,11 +1313,24 @@ public:
     virtual void run() { _log->flush_daemon(); }
 };
 
+class sync_daemon_thread_t : public smthread_t {
+    log_core* _log;
+public:
+    sync_daemon_thread_t(log_core* log) : 
+         smthread_t(t_regular, "log_syncer", WAIT_NOT_USED), _log(log) { }
+
+    virtual void run() { _log->sync_daemon(); }
+};
+
 // Does not get called until after the 
 // log is fully constructed:
 void log_core::start_flush_daemon() 
 {
     _flush_daemon_running = true;
+    if(_pipelined()) {
+        _sync_daemon = new sync_daemon_thread_t(this);
+        W_COERCE(_sync_daemon->fork());
+    }
     _flush_daemon->fork();
 }
 
@@ -955,6 +1357,18 @@ log_core::shutdown()
     _flush_daemon_running = false;
     delete _flush_daemon;
     _flush_daemon=NULL;
+
+    // the daemon synced what it wrote last on its way out
+    {
+        CRITICAL_SECTION(cs, _wait_flush_lock);
+        _sync_retire = true;
+        DO_PTHREAD(pthread_cond_signal(&_sync_cond));
+    }
+    if(_sync_daemon) {
+        _sync_daemon->join();
+        delete _sync_daemon;
+        _sync_daemon=NULL;
+    }
 }
 
 // used to access the _waiting and _dummy nodes together
@@ -1113,6 +1527,13 @@ log_core::log_core(
       _buf(new char[_segsize]),
       _shutting_down(false),
       _flush_daemon_running(false),
+      _written_bytes(0),
+      _synced_bytes(0),
+      _sync_daemon(0),
+      _sync_retire(false),
+      _tail_map(0),
+      _tail_map_sz(0),
+      _tail_dax(false),
       _slot_array(new insert_info_array(SLOT_ARRAY_SIZE)),
       _active_slots(SLOT_ACTIVE_COUNT),
       _slots(new insert_info* volatile[SLOT_ACTIVE_COUNT]),
@@ -1125,8 +1546,15 @@ log_core::log_core(
     DO_PTHREAD(pthread_mutex_init(&_wait_flush_lock, NULL));
     DO_PTHREAD(pthread_cond_init(&_wait_cond, NULL));
     DO_PTHREAD(pthread_cond_init(&_flush_cond, NULL));
+    DO_PTHREAD(pthread_mutex_init(&_sync_lock, NULL));
+    DO_PTHREAD(pthread_cond_init(&_sync_cond, NULL));
+    DO_PTHREAD(pthread_mutex_init(&_tail_lock, NULL));
     DO_PTHREAD(pthread_mutex_init(&_scavenge_lock, NULL));
     DO_PTHREAD(pthread_cond_init(&_scavenge_cond, NULL));
+    lock_profile_t::set_name(&_flush_lock, "log flush");
+    lock_profile_t::set_name(&_comp_lock, "log compensate");
+    lock_profile_t::set_name(&_insert_lock, "log insert");
+    lock_profile_t::set_name(&_expose_lock, "log expose");
     
     for(int i=0; i < _active_slots; i++) 
 	_allocate_slot(i);
@@ -1155,6 +1583,18 @@ log_core::log_core(
     // a legitimate value now.
     _set_size(max_logsz);
 
+    if(tail_name()[0]) {
+        _open_tail();
+        if(reformat) {
+            // nothing in it belongs to the new log
+            CRITICAL_SECTION(cs, _tail_lock);
+            _tail_hdr.synced = _tail_hdr.persisted = lsn_t::null;
+            _write_tail_hdr();
+        } else {
+            _recover_tail();
+        }
+    }
+
 
     // FRJ: we don't actually *need* this (no trx around yet), but we
     // don't want to trip the assertions that watch for it.
@@ -1529,12 +1969,14 @@ log_core::log_core(
     DBG(<<" pos is now " << pos);
 
     if (f)  {
+        // Read just the part of the header that tells the length,
+        // which is where it is in both encodings.
         allocaN<logrec_t::hdr_sz> buf;
 
-        DBGTHRD(<<"fread " << fname << " sz= " << logrec_t::hdr_sz);
+        DBGTHRD(<<"fread " << fname << " sz= " << logrec_t::common_hdr_sz);
         int n;
-        while ((n = fread(buf, 1, logrec_t::hdr_sz, f)) 
-                == logrec_t::hdr_sz)  
+        while ((n = fread(buf, 1, logrec_t::common_hdr_sz, f)) 
+                == logrec_t::common_hdr_sz)  
         {
             DBG(<<" pos is now " << pos);
             logrec_t  *l = (logrec_t*) (void*) buf;
@@ -1547,20 +1989,19 @@ log_core::log_core(
             DBGTHRD(<<"scanned log rec type=" << int(l->type())
                     << " length=" << l->length());
 
-            if(len < logrec_t::hdr_sz) {
+            if(len < l->min_length()) {
                 // Must be garbage and we'll have to truncate this
                 // partition to size 0
                 w_assert1(pos == start_pos);
             } else {
-                w_assert1(len >= logrec_t::hdr_sz);
+                w_assert1(len >= l->min_length());
 
-                DBGTHRD(<<"hdr_sz " << logrec_t::hdr_sz );
                 DBGTHRD(<<"len " << len );
                 // seek to lsn_ck at end of record
-                // Subtract out sizeof(header) because we already
-                // read that (thus we have seeked past it)
+                // Subtract out what we read of the header because 
+                // we already read that (thus we have seeked past it)
                 // Subtract out lsn_t to find beginning of lsn_ck.
-                len -= (logrec_t::hdr_sz + sizeof(lsn_t));
+                len -= (logrec_t::common_hdr_sz + sizeof(lsn_t));
 
                 //NB: this is a RELATIVE seek
                 DBG(<<" pos is now " << pos);
@@ -1737,7 +2178,7 @@ log_core::log_core(
         <<" durable_lsn " << durable_lsn());
 
     lsn_t new_lsn(last_partition, pos);
-    _curr_lsn = _durable_lsn = _flush_lsn = new_lsn;
+    _curr_lsn = _synced_lsn = _written_lsn = _durable_lsn = _flush_lsn = new_lsn;
 
     DBGTHRD( << "partition num = " << partition_num()
             <<" current_lsn " << curr_lsn()
@@ -1919,11 +2360,22 @@ log_core::~log_core()
         delete [] _readbuf;
         delete _skip_log;
         w_assert1(_durable_lsn == _curr_lsn);
-        delete [] _buf;
+        if(_tail_map) {
+            munmap(_tail_map, _tail_map_sz);
+        } else {
+            delete [] _buf;
+        }
 
         DO_PTHREAD(pthread_mutex_destroy(&_wait_flush_lock));
         DO_PTHREAD(pthread_cond_destroy(&_wait_cond));
         DO_PTHREAD(pthread_cond_destroy(&_flush_cond));
+        DO_PTHREAD(pthread_mutex_destroy(&_sync_lock));
+        DO_PTHREAD(pthread_cond_destroy(&_sync_cond));
+        DO_PTHREAD(pthread_mutex_destroy(&_tail_lock));
+        lock_profile_t::clear_name(&_flush_lock);
+        lock_profile_t::clear_name(&_comp_lock);
+        lock_profile_t::clear_name(&_insert_lock);
+        lock_profile_t::clear_name(&_expose_lock);
         THE_LOG = NULL;
 	for(int i=0; i < _active_slots; i++) {
 	    long old_count = atomic_swap_ulong((unsigned long*) &_slots[i]->count, SLOT_UNUSED);
@@ -2249,7 +2701,8 @@ void log_core::_acquire_buffer_space(insert_info* info, long recsize)
     info->error = 0;
 }
 
-lsn_t log_core::_copy_to_buffer(logrec_t &rec, long pos, long recsize, insert_info* info)
+lsn_t log_core::_copy_to_buffer(logrec_t &rec, long pos, long recsize, 
+                                insert_info* info, const char* compact_hdr)
 {
     /*
       do the memcpy (or two)
@@ -2262,11 +2715,31 @@ lsn_t log_core::_copy_to_buffer(logrec_t &rec, long pos, long recsize, insert_in
     if(pos >= _segsize)
 	pos -= _segsize;
     
-    char const* data = (char const*) &rec;
-    long spillsize = pos + recsize - _segsize;
+    if(compact_hdr) {
+        // the compact header, then the rest of the record as it is
+        long rest = rec.length() - logrec_t::hdr_sz;
+        long hsz = recsize - rest;
+        _copy_wrapped(pos, compact_hdr, hsz);
+        pos += hsz;
+        if(pos >= _segsize)
+            pos -= _segsize;
+        _copy_wrapped(pos, rec.data(), rest);
+        INC_TSTAT(log_compact_cnt);
+        ADD_TSTAT(log_compact_bytes_saved, rec.length() - recsize);
+    }
+    else {
+        _copy_wrapped(pos, (char const*) &rec, recsize);
+    }
+
+    return rlsn;
+}
+
+void log_core::_copy_wrapped(long pos, char const* data, long size)
+{
+    long spillsize = pos + size - _segsize;
     if(spillsize <= 0) {
 	// normal insert
-	memcpy(_buf+pos, data, recsize);
+	memcpy(_buf+pos, data, size);
     }
     else {
         // spillsize > 0 so we are wrapping. 
@@ -2281,14 +2754,40 @@ lsn_t log_core::_copy_to_buffer(logrec_t &rec, long pos, long recsize, insert_in
         //
         // spillsize is the portion that wraps around 
         // partsize is the portion that doesn't wrap.
-        long partsize = recsize - spillsize;
+        long partsize = size - spillsize;
 
         // Copy log record to buffer
         // memcpy : areas do not overlap
 	memcpy(_buf+pos, data, partsize);
         memcpy(_buf, data+partsize, spillsize);
     }
+}
+
+/*
+ * Like _copy_to_buffer, but builds the record right where it goes
+ * in the buffer.  A record that would wrap around the end of the
+ * buffer is built in "scratch" and copied in two pieces.
+ */
+lsn_t log_core::_construct_in_buffer(const logrec_writer_t &w, 
+                                     logrec_t &scratch,
+                                     long pos, long recsize, 
+                                     insert_info* info)
+{
+    long bufpos = pos + info->start_pos;
+    if(bufpos >= _segsize)
+	bufpos -= _segsize;
+
+    if(bufpos + recsize > _segsize) {
+	w.construct(&scratch);
+	w_assert1((long) scratch.length() == recsize);
+	return _copy_to_buffer(scratch, pos, recsize, info);
+    }
 
+    logrec_t* rec = w.construct(_buf+bufpos);
+    w_assert1((long) rec->length() == recsize);
+    lsn_t rlsn = info->lsn + pos;
+    rec->set_lsn_ck(rlsn);
+    INC_TSTAT(log_direct_inserts);
     return rlsn;
 }
 
@@ -2477,7 +2976,33 @@ void log_core::_allocate_slot(long idx) {
 
 
 rc_t log_core::insert(logrec_t &rec, lsn_t* rlsn) {
-    long size = rec.length();
+    if(smlevel_0::do_log_compact) {
+        char hdr[logrec_t::compact_hdr_max];
+        smsize_t hsz = rec.compact(hdr);
+        if(hsz > 0) {
+            return _insert(rec.length() - logrec_t::hdr_sz + hsz, &rec, 
+                           NULL, rlsn, hdr);
+        }
+    }
+    return _insert(rec.length(), &rec, NULL, rlsn);
+}
+
+rc_t log_core::insert(const logrec_writer_t &w, logrec_t* scratch, 
+                      lsn_t* rlsn) 
+{
+    return _insert(w.length(), scratch, &w, rlsn);
+}
+
+/*
+ * Inserts a record of the given size: copies "rec" into the log
+ * buffer, or, if there is a writer, has it build the record there
+ * (with "rec" as its scratch space).  With a compact header, what
+ * gets copied is that header in place of the record's own.
+ */
+rc_t log_core::_insert(long size, logrec_t* rec, 
+                       const logrec_writer_t* w, lsn_t* rlsn,
+                       const char* compact_hdr) 
+{
     w_assert1((size_t)size <= sizeof(logrec_t));
 
     /* Copy our data into the buffer and update/create epochs. Note
@@ -2561,8 +3086,12 @@ rc_t log_core::insert(logrec_t &rec, lsn_t* rlsn) {
     }
 
     // insert my value
-    if(!info->error) 
-	rec_lsn = _copy_to_buffer(rec, pos, size, info);
+    if(!info->error) {
+	if(w)
+	    rec_lsn = _construct_in_buffer(*w, *rec, pos, size, info);
+	else
+	    rec_lsn = _copy_to_buffer(*rec, pos, size, info, compact_hdr);
+    }
 
     // last one to leave cleans up
     long end_count = atomic_add_long_nv((unsigned long *)&info->count, size);
@@ -2594,6 +3123,11 @@ rc_t log_core::flush(lsn_t lsn, bool block)
 
     // don't try to flush past end of log -- we might wait forever...
     lsn = std::min(lsn, (*&_curr_lsn)+ -1);
+
+    // with a mapped log tail, we make it durable ourselves
+    if(_tail_map && lsn >= *&_durable_lsn) {
+        _persist_tail();
+    }
     
     // already durable?
     if(lsn >= *&_durable_lsn) {
@@ -2602,12 +3136,17 @@ rc_t log_core::flush(lsn_t lsn, bool block)
             DO_PTHREAD(pthread_cond_signal(&_flush_cond));
         }
         else {
+            xct_wait_timer_t w(xct_wait_log_flush);
 	    CRITICAL_SECTION(cs, _wait_flush_lock);
 	    while(lsn >= *&_durable_lsn) {
-		*&_waiting_for_flush = true;
-		// Use signal since the only thread that should be waiting 
-		// on the _flush_cond is the log flush daemon.
-		DO_PTHREAD(pthread_cond_signal(&_flush_cond));
+		// Once written, the fsync in flight or the next one
+		// makes it durable; the daemon need not do anything.
+		if(lsn >= *&_written_lsn) {
+		    *&_waiting_for_flush = true;
+		    // Use signal since the only thread that should be waiting 
+		    // on the _flush_cond is the log flush daemon.
+		    DO_PTHREAD(pthread_cond_signal(&_flush_cond));
+		}
 		DO_PTHREAD(pthread_cond_wait(&_wait_cond, &_wait_flush_lock));
 	    }
         }
@@ -2673,10 +3212,31 @@ void log_core::flush_daemon()
         (lsn=flush_daemon_work(last_completed_flush_lsn)) != 
                 last_completed_flush_lsn; 
         last_completed_flush_lsn=lsn) ;
+    // ... and durable
+    _sync_written();
+}
+
+/**\brief Log syncer driver.
+ * \details
+ * Waits for the flush daemon to write something, and fsyncs it,
+ * while the daemon goes on writing.
+ */
+void log_core::sync_daemon() 
+{
+    while(1) {
+        {
+            CRITICAL_SECTION(cs, _wait_flush_lock);
+            while(!*&_sync_retire && *&_written_lsn <= *&_synced_lsn) {
+                DO_PTHREAD(pthread_cond_wait(&_sync_cond, &_wait_flush_lock));
+            }
+            if(*&_sync_retire) break;
+        }
+        _sync_written();
+    }
 }
 
 /**\brief Flush unflushed-portion of log buffer.
- * @param[in] old_mark Durable lsn from last flush. Flush records later than this.
+ * @param[in] old_mark Written lsn from last flush. Flush records later than this.
  * \details
  * This is the guts of the log daemon.
  *
@@ -2687,7 +3247,9 @@ void log_core::flush_daemon()
  * Called by the log flush daemon.
  * Protection from duplicate flushing is handled by the fact that we have
  * only one log flush daemon.
- * \return Latest durable lsn resulting from this flush
+ * The records are durable once the syncer's next fsync ends, or on
+ * return without sm_log_flush_pipeline.
+ * \return Latest written lsn resulting from this flush
  *
  */
 lsn_t log_core::flush_daemon_work(lsn_t old_mark) 
@@ -2773,10 +3335,22 @@ lsn_t log_core::flush_daemon_work(lsn_t old_mark)
     // will open a new partition into which to flush.
     // That, in turn, is determined by whether the _old_epoch.base_lsn.file()
     // matches the _cur_epoch.base_lsn.file()
+    if(*&_written_lsn > *&_synced_lsn) INC_TSTAT(log_write_overlap);
     _flushX(start_lsn, start1, end1, start2, end2);
 
-    _durable_lsn = end_lsn;
-    _start = new_start;
+    _written_lsn = end_lsn;
+
+    if(_pipelined()) {
+        _start = new_start;
+        // leave the fsync to the syncer
+        CRITICAL_SECTION(cs, _wait_flush_lock);
+        DO_PTHREAD(pthread_cond_signal(&_sync_cond));
+    } else {
+        // with a mapped tail, inserts must not reuse the space until
+        // the partition has what it held
+        _sync_written();
+        _start = new_start;
+    }
 
     return end_lsn;
 }
@@ -2842,11 +3416,20 @@ cerr
     << "log rec is  " << *s << endl;
         return RC(eBADCOMPENSATION);
     }
-    w_assert1(s->prev() == lsn_t::null || s->prev() >= undo_lsn);
+    w_assert1(s->is_compact() || 
+              s->prev() == lsn_t::null || s->prev() >= undo_lsn);
 
     if(s->is_undoable_clr())
         return RC(eBADCOMPENSATION);
 
+    if(s->is_compact()) {
+        // its _prev is a varint; the new one has to fit
+        if(!s->set_compact_clr(undo_lsn))
+            return RC(eBADCOMPENSATION);
+        DBGTHRD(<<"COMPENSATED COMPACT LOG RECORD " << undo_lsn);
+        return RCOK;
+    }
+
     // success!
     DBGTHRD(<<"COMPENSATING LOG RECORD " << undo_lsn << " : " << *s);
     s->set_clr(undo_lsn);
@@ -2876,6 +3459,8 @@ rc_t log_core::wait_for_space(fileoff_t &amt, timeout_in_ms timeout)
     if(amt > _partition_data_size)
         return RC(eOUTOFLOGSPACE);
 
+    xct_wait_timer_t w(xct_wait_log_space);
+
     // wait for a signal or 100ms, whichever is longer...
     w_assert0(amt > 0);
     struct timespec when;
@@ -76,6 +76,7 @@ typedef    int    partition_index_t;
 class skip_log; // forward
 
 #include <partition.h>
+#include "log_summary.h"
 #include <deque>
 
 class log_core : public log_m 
@@ -187,9 +188,9 @@ private:
 
     lsn_t                _flush_lsn;
 
-    tatas_lock           _flush_lock;
+    spin_park_lock       _flush_lock;
     long _padding2[16];
-    tatas_lock           _comp_lock;
+    spin_park_lock       _comp_lock;
     long _padding3[16];
     queue_based_lock_t   _insert_lock; // synchronize concurrent log inserts
     long _padding4[16];
@@ -205,6 +206,56 @@ private:
     bool volatile        _shutting_down;
     bool volatile        _flush_daemon_running; // for asserts only
 
+    /* The flush daemon writes, and the syncer fsyncs, so that the
+       daemon can write the next epochs while an fsync is in flight.
+       _written_lsn is the end of what the daemon has written;
+       _durable_lsn catches up with it when an fsync ends.  An fsync
+       makes durable everything written before it starts, so the
+       longer fsyncs take, the more commits each one covers.
+     */
+    lsn_t                _written_lsn;
+    long volatile        _written_bytes; // set by the daemon only
+    long                 _synced_bytes;  // protected by _sync_lock
+    pthread_mutex_t      _sync_lock;     // held across fsyncs and across
+                                         // switches to a new partition
+    pthread_cond_t       _sync_cond;     // paired with _wait_flush_lock
+    sthread_t*           _sync_daemon;   // NULL unless _pipelined()
+    bool volatile        _sync_retire;
+
+    /* With sm_log_tail, _buf is mapped from a file, after two headers
+       that tell restart where the bytes in it from _synced_lsn on go.
+       flush() makes records durable by persisting them there; the
+       daemon copies them to the partitions at its own pace, and does
+       not let inserts reuse buffer space until they are synced.
+     */
+    struct tail_hdr_t {
+        enum { magic_val = 0x4c544149 }; // "LTAI"
+        w_base_t::uint4_t   magic;
+        w_base_t::uint4_t   pad;
+        w_base_t::uint8_t   seq;        // the later of the two is current
+        w_base_t::int8_t    segsize;
+        lsn_t               synced;     // the partitions have what's before
+        lsn_t               persisted;  // the tail has what's before
+        lsn_t               old_base;   // base_lsn and end of the epochs
+        w_base_t::int8_t    old_end;    // at the time
+        lsn_t               cur_base;
+        w_base_t::int8_t    cur_end;
+        w_base_t::uint8_t   sum;        // of the above
+
+        w_base_t::uint8_t   checksum() const;
+        bool valid() const { return magic == magic_val && sum == checksum(); }
+    };
+    enum { TAIL_HDR_SLOT=128 };          // two of these, then _buf
+    char*                _tail_map;     // NULL without a mapped tail
+    long                 _tail_map_sz;
+    bool                 _tail_dax;     // MAP_SYNC: a cache flush persists
+    tail_hdr_t           _tail_hdr;     // latest header written
+    pthread_mutex_t      _tail_lock;    // protects _tail_hdr
+
+    // what the partition the flush daemon writes holds, for restart;
+    // only the flush daemon touches it
+    log_summary_t        _summary;
+
     // c-array stuff
     insert_info_array* _slot_array;
     long _active_slots;
@@ -271,6 +322,8 @@ public:
 
     // returns lsn where data were written 
     rc_t            insert(logrec_t &r, lsn_t* l); 
+    rc_t            insert(const logrec_writer_t &w, logrec_t* scratch,
+                           lsn_t* l); 
     rc_t            flush(lsn_t lsn, bool block=true);
     rc_t            compensate(lsn_t orig_lsn, lsn_t undo_lsn);
     void            start_flush_daemon();
@@ -298,9 +351,29 @@ public:
     // for flush_daemon_thread_t
     void            flush_daemon();
     lsn_t           flush_daemon_work(lsn_t old_mark);
+    // for sync_daemon_thread_t
+    void            sync_daemon();
 
 private:
     void            _flushX(lsn_t base_lsn, long start1, long end1, long start2, long end2);
+    void            _sync_written();
+    // whether a syncer fsyncs what the flush daemon writes; with a
+    // mapped tail the daemon syncs before inserts may reuse the space
+    bool            _pipelined() const {
+                        return smlevel_0::do_log_flush_pipeline && !_tail_map;
+                    }
+    void            _summarize(const lsn_t& start_lsn, long start1, long end1,
+                               long start2, long end2);
+    void            _set_durable(const lsn_t& lsn);
+    void            _wait_written(const lsn_t& lsn);
+
+    void            _open_tail();
+    void            _recover_tail();
+    void            _write_tail_range(const lsn_t& from, const lsn_t& base,
+                                      long end);
+    void            _persist_tail();
+    void            _persist(const char* addr, long len);
+    void            _write_tail_hdr();
     void            _set_size(fileoff_t psize);
     fileoff_t       _get_min_size() const {
                         // Return minimum log size as a function of the
@@ -310,7 +383,13 @@ private:
     partition_t *   _partition(partition_index_t i) const;
 
     void _acquire_buffer_space(insert_info* info, long size);
-    lsn_t _copy_to_buffer(logrec_t &rec, long pos, long size, insert_info* info);
+    rc_t _insert(long size, logrec_t* rec, const logrec_writer_t* w,
+                 lsn_t* l, const char* compact_hdr=0);
+    lsn_t _copy_to_buffer(logrec_t &rec, long pos, long size, insert_info* info,
+                          const char* compact_hdr=0);
+    void _copy_wrapped(long pos, char const* data, long size);
+    lsn_t _construct_in_buffer(const logrec_writer_t &w, logrec_t &scratch,
+                               long pos, long size, insert_info* info);
     bool _update_epochs(insert_info* info, bool attempt_abort);
     bool _wait_for_expose(insert_info* info, bool attempt_abort);
     void _spin_on_epoch(long old_end); // sm-no-inline.cpp
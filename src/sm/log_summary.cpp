@@ -0,0 +1,242 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+
+// -*- mode:c++; c-basic-offset:4 -*-
+
+#define SM_SOURCE
+#define LOG_SUMMARY_C
+
+#include "sm_int_1.h"
+#include "logtype_gen.h"
+#include "log_summary.h"
+
+#include <algorithm>
+#include <vector>
+
+// Most we pread or pwrite at once
+static const int summary_xfer_sz = 1024*1024;
+
+static w_base_t::uint8_t
+summary_checksum(const char* p, long n, w_base_t::uint8_t s)
+{
+    for(long i=0; i < n; i++) {
+        s = ((s << 7) | (s >> 57)) ^ u_char(p[i]);
+    }
+    return s;
+}
+
+NORET
+log_summary_t::log_summary_t()
+    : _ok(false), _has_mount(false), _scratch(new logrec_t)
+{
+    if(!_scratch) W_FATAL(smlevel_0::eOUTOFMEMORY);
+}
+
+NORET
+log_summary_t::~log_summary_t()
+{
+    delete _scratch;
+}
+
+void
+log_summary_t::reset(const lsn_t& first)
+{
+    _ok = true;
+    _has_mount = false;
+    _first = _end = first;
+    _xcts.clear();
+    _pages.clear();
+}
+
+/*
+ * Keep what restart_m::analysis_pass would do with the record, once
+ * the master checkpoint is behind it: for its transaction, whether
+ * it is there already or not, and for the page it updates.
+ */
+void
+log_summary_t::add(const logrec_t& r, const lsn_t& lsn, const lsn_t& next)
+{
+    if(!_ok) return;
+    if(lsn != _end) {
+        // a gap: we missed something
+        _ok = false;
+        return;
+    }
+    _end = next;
+
+    log_summary_xct_t* x = 0;
+    if(r.tid() != tid_t::null) {
+        xct_map::iterator it = _xcts.find(r.tid());
+        if(it == _xcts.end()) {
+            log_summary_xct_t e;
+            e.tid = r.tid();
+            e.flags = 0;
+            e.pad = 0;
+            e.first = lsn;
+            e.first_prev = r.prev();
+            it = _xcts.insert(std::make_pair(r.tid(), e)).first;
+        }
+        x = &it->second;
+        x->last = lsn;
+    }
+
+    switch(r.type()) {
+    case logrec_t::t_mount_vol:
+    case logrec_t::t_dismount_vol:
+        _has_mount = true;
+        break;
+
+    case logrec_t::t_xct_freeing_space:
+        if(x) x->flags |= log_summary_xct_t::freeing;
+        break;
+
+    case logrec_t::t_xct_abort:
+    case logrec_t::t_xct_end:
+        if(x) x->flags |= log_summary_xct_t::ended;
+        break;
+
+    default:
+        if(!r.is_page_update() && !r.is_cpsn()) break;
+        if(x) {
+            if(r.is_undo()) {
+                x->undo_nxt = lsn;
+                x->flags |= log_summary_xct_t::undo_set;
+            } else if(r.is_cpsn()) {
+                x->undo_nxt = r.undo_nxt();
+                x->flags |= log_summary_xct_t::undo_set;
+            }
+        }
+        if(r.is_redo()) {
+            // only the first one counts
+            _pages.insert(std::make_pair(r.construct_pid(), lsn));
+        }
+        break;
+    }
+}
+
+rc_t
+log_summary_t::write(int fd, smlevel_0::fileoff_t off) const
+{
+    w_assert1(_ok);
+    log_summary_hdr_t hdr = log_summary_hdr_t();
+    hdr.magic = log_summary_hdr_t::magic_val;
+    hdr.version = log_summary_hdr_t::version_val;
+    hdr.xct_cnt = _xcts.size();
+    hdr.page_cnt = _pages.size();
+    hdr.flags = _has_mount ? log_summary_hdr_t::has_mount : 0;
+    hdr.first = _first;
+    hdr.end = _end;
+    hdr.off = off;
+
+    long body = _xcts.size() * sizeof(log_summary_xct_t)
+        + _pages.size() * sizeof(log_summary_page_t);
+    std::vector<char> buf(body + sizeof(hdr));
+    char* p = &buf[0];
+    for(xct_map::const_iterator it = _xcts.begin(); it != _xcts.end(); ++it) {
+        memcpy(p, &it->second, sizeof(log_summary_xct_t));
+        p += sizeof(log_summary_xct_t);
+    }
+    for(page_map::const_iterator it = _pages.begin(); it != _pages.end(); ++it) {
+        log_summary_page_t e = log_summary_page_t();
+        e.pid = it->first;
+        e.rec_lsn = it->second;
+        memcpy(p, &e, sizeof(e));
+        p += sizeof(e);
+    }
+    hdr.sum = summary_checksum(&buf[0], body, log_summary_hdr_t::magic_val);
+    hdr.sum = summary_checksum((const char*) &hdr,
+                    (const char*) &hdr.sum - (const char*) &hdr, hdr.sum);
+    memcpy(p, &hdr, sizeof(hdr));
+
+    for(long done = 0; done < long(buf.size()); ) {
+        int n = int(std::min(long(buf.size()) - done, long(summary_xfer_sz)));
+        W_DO(me()->pwrite(fd, &buf[done], n, off + done));
+        done += n;
+    }
+    return RCOK;
+}
+
+bool
+log_summary_t::read(smlevel_0::partition_number_t n)
+{
+    _ok = false;
+    _xcts.clear();
+    _pages.clear();
+
+    char fname[smlevel_0::max_devname];
+    log_m::make_log_name(n, fname, sizeof(fname));
+    int fd;
+    if(me()->open(fname, smthread_t::OPEN_RDONLY, 0, fd).is_error()) {
+        return false;
+    }
+
+    bool ok = false;
+    std::vector<char> buf;
+    log_summary_hdr_t hdr;
+    sthread_t::filestat_t st;
+    if(!me()->fstat(fd, st).is_error()
+       && st.st_size >= smlevel_0::fileoff_t(sizeof(hdr))
+       && !me()->pread(fd, &hdr, sizeof(hdr),
+                       st.st_size - sizeof(hdr)).is_error()
+       && hdr.valid() && hdr.first == log_m::first_lsn(n)) {
+        long body = long(hdr.xct_cnt) * sizeof(log_summary_xct_t)
+            + long(hdr.page_cnt) * sizeof(log_summary_page_t);
+        if(hdr.off + body + smlevel_0::fileoff_t(sizeof(hdr)) == st.st_size) {
+            buf.resize(body);
+            ok = true;
+            for(long done = 0; ok && done < body; ) {
+                int k = int(std::min(body - done, long(summary_xfer_sz)));
+                ok = !me()->pread(fd, &buf[done], k, hdr.off + done).is_error();
+                done += k;
+            }
+        }
+    }
+    W_COERCE(me()->close(fd));
+    if(!ok) return false;
+
+    const char* p = buf.empty() ? 0 : &buf[0];
+    w_base_t::uint8_t sum = summary_checksum(p, buf.size(),
+                                    log_summary_hdr_t::magic_val);
+    sum = summary_checksum((const char*) &hdr,
+                    (const char*) &hdr.sum - (const char*) &hdr, sum);
+    if(sum != hdr.sum) return false;
+
+    for(w_base_t::uint4_t i=0; i < hdr.xct_cnt; i++) {
+        log_summary_xct_t e;
+        memcpy((char*) &e, p, sizeof(e));
+        p += sizeof(e);
+        _xcts.insert(std::make_pair(e.tid, e));
+    }
+    for(w_base_t::uint4_t i=0; i < hdr.page_cnt; i++) {
+        log_summary_page_t e;
+        memcpy((char*) &e, p, sizeof(e));
+        p += sizeof(e);
+        _pages.insert(std::make_pair(e.pid, e.rec_lsn));
+    }
+    _has_mount = (hdr.flags & log_summary_hdr_t::has_mount) != 0;
+    _first = hdr.first;
+    _end = hdr.end;
+    _ok = true;
+    return true;
+}
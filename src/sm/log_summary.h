@@ -0,0 +1,157 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+
+// -*- mode:c++; c-basic-offset:4 -*-
+
+#ifndef LOG_SUMMARY_H
+#define LOG_SUMMARY_H
+
+#include "w_defines.h"
+
+#include <map>
+
+class logrec_t;
+
+/**\cond skip */
+/*
+ * Last thing in a closed log partition's file: says what comes before
+ * it, the transaction entries and then the page entries.
+ */
+struct log_summary_hdr_t {
+    enum {
+        magic_val = 0x4c53554d, // "LSUM"
+        version_val = 1
+    };
+    enum {
+        has_mount = 0x1         // the partition (dis)mounts volumes
+    };
+    w_base_t::uint4_t   magic;
+    w_base_t::uint4_t   version;
+    w_base_t::uint4_t   xct_cnt;
+    w_base_t::uint4_t   page_cnt;
+    w_base_t::uint4_t   flags;
+    w_base_t::uint4_t   pad;
+    lsn_t               first;  // first lsn of the partition
+    lsn_t               end;    // lsn past its last record
+    smlevel_0::fileoff_t off;   // where the entries start in the file
+    w_base_t::uint8_t   sum;    // of the entries and the above
+
+    bool valid() const {
+        return magic == magic_val && version == version_val;
+    }
+};
+
+/*
+ * What the records of a transaction in the partition do to its entry
+ * in the transaction table.
+ */
+struct log_summary_xct_t {
+    enum {
+        undo_set = 0x1,         // undo_nxt is to be set
+        freeing = 0x2,          // t_xct_freeing_space
+        ended = 0x4             // t_xct_end or t_xct_abort
+    };
+    tid_t               tid;
+    w_base_t::uint4_t   flags;
+    w_base_t::uint4_t   pad;
+    lsn_t               first;      // its first record here ...
+    lsn_t               first_prev; // ... and that record's prev()
+    lsn_t               last;       // its last record here
+    lsn_t               undo_nxt;
+};
+
+/*
+ * A page that a redoable record in the partition updates, with the
+ * first such record.
+ */
+struct log_summary_page_t {
+    lpid_t              pid;
+    lsn_t               rec_lsn;
+};
+/**\endcond skip */
+
+/**\brief Summary of what a log partition does to the transaction and
+ * dirty page tables, for restart.
+ *
+ * \details
+ * The log flush daemon builds one for the partition it writes, from
+ * the headers of the records as it writes them, and when it moves on
+ * to the next partition it writes it after the data of the one it
+ * closes (sm_log_summary).  A summary is only written for a partition
+ * the daemon has written from its first record on.
+ *
+ * Restart's analysis pass applies the summary of each whole partition
+ * after the master checkpoint, instead of reading its records; it
+ * reads those of partitions without a (valid) summary, the last one,
+ * and ones that mount or dismount volumes.
+ */
+class log_summary_t {
+public:
+    typedef std::map<tid_t, log_summary_xct_t>  xct_map;
+    typedef std::map<lpid_t, lsn_t>             page_map;
+
+    NORET               log_summary_t();
+    NORET               ~log_summary_t();
+
+    /// Start over, for the records from \a first on.
+    void                reset(const lsn_t& first);
+    /// A record was missed: there is no summary to write.
+    void                invalidate() { _ok = false; }
+    /// Does this summarize all of partition \a n up to end()?
+    bool                covers(smlevel_0::partition_number_t n) const {
+                            return _ok && _first == log_m::first_lsn(n);
+                        }
+    const lsn_t&        end() const { return _end; }
+
+    /**\brief Add the record at \a lsn, which must be end(); the next
+     * one is at \a next.  The record's header must be in the full
+     * encoding.
+     */
+    void                add(const logrec_t& r, const lsn_t& lsn,
+                            const lsn_t& next);
+    /// Somewhere to expand a record's header for add().
+    logrec_t&           scratch() { return *_scratch; }
+
+    /// Write at offset \a off of the partition file \a fd.
+    rc_t                write(int fd, smlevel_0::fileoff_t off) const;
+    /**\brief Read the summary of partition \a n, if it has a valid
+     * one.  Returns false if not.
+     */
+    bool                read(smlevel_0::partition_number_t n);
+
+    bool                has_mount() const { return _has_mount; }
+    const xct_map&      xcts() const { return _xcts; }
+    const page_map&     pages() const { return _pages; }
+
+private:
+    bool                _ok;
+    bool                _has_mount;
+    lsn_t               _first;
+    lsn_t               _end;
+    xct_map             _xcts;
+    page_map            _pages;
+    logrec_t*           _scratch;
+};
+
+#endif
@@ -202,8 +202,7 @@ logrec_t::fill(const lpid_t* p, uint2_t tag, smsize_t l)
         // zero out extra space to keep purify happy
         memset(_data+l, 0, align(l)-l);
     }
-    unsigned int tmp = align(l) + hdr_sz + sizeof(lsn_t);
-    tmp = (tmp + 7) & -8; // force 8-byte alignment
+    unsigned int tmp = length_for(l);
     w_assert1(tmp <= max_sz);
     _len = tmp;
     if(type() != t_skip) {
@@ -246,6 +245,190 @@ logrec_t::valid_header(const lsn_t & lsn) const
 }
 
 
+/*********************************************************************
+ *
+ *  Compact encoding of the log record header.
+ *
+ *  The records that make up most of the log volume (slotted page and
+ *  B+-Tree updates) carry small payloads, so the fixed header is a
+ *  large part of them.  With the sm_log_compact option, the log
+ *  writes those records with their header in a compact encoding,
+ *  flagged by t_compact in _cat:
+ *
+ *      _len, _type, _cat          as in the full header
+ *      a byte                     the length of the compact header
+ *      _shpid, _vid, _page_tag,
+ *      _snum, _tid, _prev.hi(),
+ *      _prev.lo()                 as varints: 7 bits per byte, 
+ *                                 least significant first, the high
+ *                                 bit set on all but the last byte
+ *      zero padding to 8 bytes
+ *      data and lsn_ck            as in the full record
+ *
+ *  _len stays first and lsn_ck last, so the log can be scanned and
+ *  checked without knowing about the encoding.  _prev comes last in
+ *  the header, so that compensation can rewrite it in place if the
+ *  new value fits (set_compact_clr()).  The log applies the
+ *  encoding as it copies a record into its buffer (compact()), and
+ *  fetch() expands such records back (expand()), so the rest of
+ *  the SM never sees it.
+ *
+ *********************************************************************/
+static bool
+is_compactable(logrec_t::kind_t type)
+{
+    switch(type) {
+    case logrec_t::t_page_insert:
+    case logrec_t::t_page_remove:
+    case logrec_t::t_page_mark:
+    case logrec_t::t_page_reclaim:
+    case logrec_t::t_page_splice:
+    case logrec_t::t_page_splicez:
+    case logrec_t::t_page_delta:
+    case logrec_t::t_btree_insert:
+    case logrec_t::t_btree_remove:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static inline char*
+put_varint(char* p, w_base_t::uint8_t v)
+{
+    while(v >= 0x80) {
+        *p++ = char(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = char(v);
+    return p;
+}
+
+static inline const char*
+get_varint(const char* p, w_base_t::uint8_t& v)
+{
+    v = 0;
+    int shift = 0;
+    u_char c;
+    do {
+        c = *p++;
+        v |= w_base_t::uint8_t(c & 0x7f) << shift;
+        shift += 7;
+    } while(c & 0x80);
+    return p;
+}
+
+/*
+ * Puts the compact encoding of this record's header in "hdr", which
+ * must have room for compact_hdr_max bytes, and returns its length.
+ * The compact record is that header followed by everything after
+ * this record's header.  Returns 0 if the record is not to be
+ * compacted.
+ */
+smsize_t
+logrec_t::compact(char* hdr) const
+{
+    if(is_compact() || !is_compactable(type())) return 0;
+
+    char* p = hdr + common_hdr_sz + 1;
+    p = put_varint(p, _shpid);
+    p = put_varint(p, _vid.vol);
+    p = put_varint(p, _page_tag);
+    p = put_varint(p, _snum);
+    p = put_varint(p, _tid.get_value());
+    p = put_varint(p, _prev.hi());
+    p = put_varint(p, _prev.lo());
+    smsize_t hsz = p - hdr;
+    smsize_t asz = (hsz + 7) & -8;
+    w_assert1(asz <= compact_hdr_max);
+    if(asz >= hdr_sz) return 0;
+    memset(p, 0, asz - hsz);
+
+    uint2_t len = _len - (hdr_sz - asz);
+    memcpy(hdr, &len, sizeof(len));
+    hdr[sizeof(uint2_t)] = _type;
+    hdr[sizeof(uint2_t) + 1] = _cat | t_compact;
+    hdr[common_hdr_sz] = char(asz);
+    return asz;
+}
+
+/*
+ * Where the varints that encode _prev start in a compact header.
+ */
+static inline const char*
+compact_prev(const char* hdr)
+{
+    w_base_t::uint8_t v;
+    const char* p = hdr + logrec_t::common_hdr_sz + 1;
+    p = get_varint(p, v); // _shpid
+    p = get_varint(p, v); // _vid
+    p = get_varint(p, v); // _page_tag
+    p = get_varint(p, v); // _snum
+    p = get_varint(p, v); // _tid
+    return p;
+}
+
+/*
+ * set_clr() for a record in the compact encoding, as it sits in the
+ * log buffer.  Returns false, leaving the record alone, if the new
+ * _prev does not fit in the header.
+ */
+bool
+logrec_t::set_compact_clr(const lsn_t& c)
+{
+    w_assert1(is_compact());
+    char* hdr = (char*) this;
+    smsize_t asz = u_char(hdr[common_hdr_sz]);
+    smsize_t off = compact_prev(hdr) - hdr;
+
+    char buf[compact_hdr_max];
+    char* e = put_varint(put_varint(buf, c.hi()), c.lo());
+    smsize_t n = e - buf;
+    if(off + n > asz) return false;
+
+    memcpy(hdr + off, buf, n);
+    memset(hdr + off + n, 0, asz - off - n);
+    _cat &= ~t_undo;
+    _cat |= t_cpsn;
+    return true;
+}
+
+/*
+ * Turns a record in the compact encoding back into the full one, in
+ * place.  There must be room for the record to grow to its full
+ * length.
+ */
+void
+logrec_t::expand()
+{
+    w_assert1(is_compact());
+    const char* p = ((const char*) this) + common_hdr_sz;
+    smsize_t asz = u_char(*p++);
+    w_base_t::uint8_t shpid, vol, tag, snum, tid, hi, lo;
+    p = get_varint(p, shpid);
+    p = get_varint(p, vol);
+    p = get_varint(p, tag);
+    p = get_varint(p, snum);
+    p = get_varint(p, tid);
+    p = get_varint(p, hi);
+    p = get_varint(p, lo);
+    w_assert1(smsize_t(p - (const char*) this) <= asz);
+
+    // move the data and lsn_ck up to where they belong
+    smsize_t rest = _len - asz;
+    memmove(_data, ((char*) this) + asz, rest);
+
+    _len = hdr_sz + rest;
+    _cat &= ~t_compact;
+    _shpid = shpid_t(shpid);
+    _vid = vid_t(uint2_t(vol));
+    _page_tag = uint2_t(tag);
+    _snum = snum_t(snum);
+    _tid = tid_t(tid);
+    _prev = lsn_t(uint4_t(hi), sm_diskaddr_t(lo));
+}
+
+
 /*********************************************************************
  *
  *  logrec_t::redo(page)
@@ -877,6 +1060,8 @@ public:
     page_insert_t(int idx, int cnt, const cvec_t* vec);
     cvec_t* unflatten(int cnt, cvec_t vec[]);
     int size();
+    // size() of the page_insert_t made from cnt and vec
+    static int size_for(int cnt, const cvec_t* vec);
     void redo(page_p* page);
     void undo(page_p* page);
 };
@@ -946,6 +1131,15 @@ page_insert_t::size()
     return p - (char*) this;
 }
 
+int
+page_insert_t::size_for(int c, const cvec_t* v)
+{
+    // idx, cnt, then len[cnt] and the data
+    int s = sizeof(int2_t) * (2 + c);
+    for (int i = 0; i < c; i++) s += v[i].size();
+    return s;
+}
+
 
 void 
 page_insert_t::redo(page_p* page)
@@ -987,6 +1181,16 @@ page_insert_log::page_insert_log(
                 (new (_data) page_insert_t(idx, cnt, vec))->size());
 }
 
+smsize_t
+page_insert_log::data_length(
+    const page_p&         , 
+    int                 , 
+    int                 cnt,
+    const cvec_t*         vec)
+{
+    return page_insert_t::size_for(cnt, vec);
+}
+
 
 
 void 
@@ -1512,6 +1716,98 @@ page_splicez_log::undo(page_p* page)
     W_COERCE(page->splice(dp->idx, dp->start, dp->new_len, z));
 }
 
+/*********************************************************************
+ *
+ *  page_delta_log
+ *
+ *  Log an overwrite of part of a record in page, in which the new
+ *  data are the same length as the old.  Only the bytes between
+ *  the first and last byte that changed are saved, as old XOR new,
+ *  so the same image serves for both redo and undo.
+ *
+ *********************************************************************/
+struct page_delta_t {
+    int2_t                 idx;        // slot affected
+    uint2_t                 start;  // offset in the slot of the first changed byte
+    uint2_t                 len;    // # bytes saved in data[]
+    fill2                 _fill;
+    char                 data[logrec_t::data_sz - 4 * sizeof(int2_t)]; // old ^ new
+
+    NORET                page_delta_t(
+        int                     i, 
+        uint                     start, 
+        const void*             tuple,
+        const cvec_t&             v);
+    int                        size()  { 
+        return data + len - (char*) this; 
+    }
+};
+
+page_delta_t::page_delta_t(
+    int                 i,
+    uint                 start_,
+    const void*         tuple,
+    const cvec_t&         v)
+    : idx(i), start(start_), len(v.size())
+{
+    w_assert1((size_t)len <= sizeof(data));
+    v.copy_to(data);
+
+    // trim the bytes that are not changing off both ends, then
+    // fold the old image into what remains
+    const char* old = ((const char*)tuple) + start;
+    uint first = 0;
+    while(first < len && data[first] == old[first]) first++;
+    uint last = len;
+    while(last > first && data[last-1] == old[last-1]) last--;
+
+    for(uint k = first; k < last; k++) {
+        data[k - first] = data[k] ^ old[k];
+    }
+    start += first;
+    len = last - first;
+
+    INC_TSTAT(page_delta_cnt);
+    ADD_TSTAT(page_delta_bytes_saved, 2 * v.size() - len);
+}
+
+page_delta_log::page_delta_log(
+    const page_p&         page,
+    int                 idx,
+    int                 start, 
+    const cvec_t&         v)
+{
+    w_assert9(v.size() <= smlevel_0::page_sz);
+    fill(&page.pid(), page.tag(),
+         (new (_data) page_delta_t(idx, start,
+                                    page.tuple_addr(idx), v))->size());
+}
+
+void 
+page_delta_log::redo(page_p* page)
+{
+    page_delta_t* dp = (page_delta_t*) _data;
+    if(dp->len == 0) return;
+
+    w_assert1(dp->len <= smlevel_0::page_sz);
+    char* buf = new char[dp->len];
+    w_auto_delete_array_t<char> auto_del(buf);
+
+    const char* p = ((const char*) page->tuple_addr(dp->idx)) + dp->start;
+    for(uint k = 0; k < dp->len; k++) {
+        buf[k] = p[k] ^ dp->data[k];
+    }
+    const vec_t vec_tmp(buf, dp->len);
+    W_COERCE(page->splice(dp->idx, dp->start, dp->len, vec_tmp));
+}
+
+void
+page_delta_log::undo(page_p* page)
+{
+    // xor is its own inverse
+    redo(page);
+}
+
 /*********************************************************************
  *
  *  page_set_byte_log
@@ -1675,6 +1971,10 @@ struct btree_insert_t {
     btree_insert_t(const btree_p& page, int idx, const cvec_t& key,
                    const cvec_t& el, bool unique);
     int size()        { return data + klen + elen - (char*) this; }
+    // size() of the btree_insert_t made from key and el
+    static int size_for(const cvec_t& key, const cvec_t& el) {
+        return sizeof(lpid_t) + 4*sizeof(int2_t) + key.size() + el.size();
+    }
 };
 
 btree_insert_t::btree_insert_t(
@@ -1703,6 +2003,17 @@ btree_insert_log::btree_insert_log(
          (new (_data) btree_insert_t(bp, idx, key, el, unique))->size());
 }
 
+smsize_t
+btree_insert_log::data_length(
+    const page_p&         , 
+    int                 , 
+    const cvec_t&         key,
+    const cvec_t&         el,
+    bool                 )
+{
+    return btree_insert_t::size_for(key, el);
+}
+
 void 
 btree_insert_log::undo(page_p* W_IFDEBUG9(page))
 {
@@ -1781,6 +2092,17 @@ btree_remove_log::btree_remove_log(
          (new (_data) btree_remove_t(bp, idx, key, el, unique))->size());
 }
 
+smsize_t
+btree_remove_log::data_length(
+    const page_p&         , 
+    int                 , 
+    const cvec_t&         key,
+    const cvec_t&         el,
+    bool                 )
+{
+    return btree_remove_t::size_for(key, el);
+}
+
 void
 btree_remove_log::undo(page_p* W_IFDEBUG9(page))
 {
@@ -90,6 +90,7 @@ public:
     bool             is_undoable_clr() const;
     bool             is_logical() const;
     bool             valid_header(const lsn_t & lsn_ck) const;
+    bool             is_compact() const;
 
     void             redo(page_p*);
     void             undo(page_p*);
@@ -115,6 +116,15 @@ public:
     enum {
         data_sz = max_sz - (hdr_sz + sizeof(lsn_t))
     };
+    enum {
+        // The part of the header that is the same in both
+        // encodings: _len, _type and _cat.
+        common_hdr_sz = sizeof(uint2_t) + 2 * sizeof(u_char),
+        // Longest header in the compact encoding, and the
+        // shortest record.
+        compact_hdr_max = 48,
+        compact_min_sz = 3 * sizeof(lsn_t)
+    };
     const tid_t&         tid() const;
     const vid_t&         vid() const;
     const shpid_t&       shpid() const;
@@ -129,6 +139,14 @@ public:
     bool                 null_pid() const; // needed in restart.cpp
     uint2_t              tag() const;
     smsize_t             length() const;
+    // length() of a record whose data part is "data_length" bytes
+    static smsize_t      length_for(smsize_t data_length);
+    // shortest length() a record in this record's encoding can have
+    smsize_t             min_length() const;
+    // compact encoding of the header; see logrec.cpp
+    smsize_t             compact(char* hdr) const;
+    bool                 set_compact_clr(const lsn_t& c);
+    void                 expand();
     const lsn_t&         undo_nxt() const;
     const lsn_t&         prev() const;
     void                 set_clr(const lsn_t& c);
@@ -162,8 +180,11 @@ protected:
         // So far this limitation has been fine.
     // old: t_cpsn = 020 | t_redo,
     t_cpsn = 020,
-    t_rollback = 040 // Not a category, but issued in abort/undo --
+    t_rollback = 040, // Not a category, but issued in abort/undo --
         // adding a bit is cheaper than adding a comment log record
+    t_compact = 0100 // Not a category either: the header is in the 
+        // compact encoding.  Only ever seen in the log buffer and on
+        // disk; fetch() hands out records expanded.
     };
     u_char             cat() const;
 
@@ -218,6 +239,25 @@ protected:
     }
 };
 
+/**\cond skip */
+/*
+ * Builds a log record whose length is known before it is built, so
+ * that the log can reserve exactly that much space and have the record
+ * built right there, rather than have it built elsewhere and copied.
+ *
+ * Log record types with the D bit set in logdef.dat have a
+ * <type>_log::writer_t, made from the same arguments as the record.
+ */
+class logrec_writer_t {
+public:
+    virtual NORET      ~logrec_writer_t() {}
+    /// The length() of the record construct() will build.
+    virtual smsize_t   length() const = 0;
+    /// Build the record at "where", which has room for length() bytes.
+    virtual logrec_t*  construct(void* where) const = 0;
+};
+/**\endcond skip */
+
 /* for logging,  recovering and undoing extent alloc/dealloc:  */
 class      ext_log_info_t {
 public:
@@ -485,6 +525,13 @@ logrec_t::length() const
     return _len;
 }
 
+inline smsize_t
+logrec_t::length_for(smsize_t l)
+{
+    smsize_t tmp = align(l) + hdr_sz + sizeof(lsn_t);
+    return (tmp + 7) & -8; // force 8-byte alignment
+}
+
 inline const lsn_t&
 logrec_t::undo_nxt() const
 {
@@ -516,7 +563,19 @@ logrec_t::data() const
 inline u_char
 logrec_t::cat() const 
 {
-    return _cat & ~t_rollback;
+    return _cat & ~(t_rollback | t_compact);
+}
+
+inline bool
+logrec_t::is_compact() const
+{
+    return (_cat & t_compact) != 0;
+}
+
+inline smsize_t
+logrec_t::min_length() const
+{
+    return is_compact() ? smsize_t(compact_min_sz) : smsize_t(hdr_sz);
 }
 
 inline bool             
@@ -847,6 +847,7 @@ page_p::_fix(
 			  (page_flags & t_virgin) != 0,  // no_read
 			  ret_store_flags,
 			  ignore_store_id, store_flags) );
+            _mode = bf->latch_mode(_pp);
 	} else if(condl) {
               bool would_block = false;
               bf->upgrade_latch_if_not_block(_pp, would_block);
@@ -906,7 +907,7 @@ page_p::_fix(
         }
 #endif 
         _mode = bf->latch_mode(_pp);
-        w_assert3(_mode >= m);
+        w_assert3(latch_mode_covers(_mode, m));
     }
 
     _refbit = refbit;
@@ -918,7 +919,7 @@ page_p::_fix(
         // w_assert3((tag() != t_file_p) || (rsvd_mode()));
     // }
     init_bucket_info(ptag, page_flags);
-    w_assert3(_mode >= m);
+    w_assert3(latch_mode_covers(_mode, m));
     store_flags = ret_store_flags;
 
     w_assert2(is_fixed());
@@ -1730,6 +1731,16 @@ page_p::splice(slotid_t idx, slot_length_t start, slot_length_t len, const cvec_
         <<" len=" << len
         <<" vec.size = " << nsave
     ); 
+    /*
+     *  A same-length overwrite of record data is logged as a
+     *  byte delta instead: only the range that actually changed
+     *  is saved, and only once.  Extlink pages are left alone;
+     *  see page_splice_log::undo.
+     */
+    bool delta = (vecsz == len && vecsz > 0 && !vec.is_zvec() &&
+        (tag() == t_file_p || tag() == t_file_mrbt_p || 
+         tag() == t_lgdata_p));
+
     if(vec.is_zvec()) {
         DBG(<<"splice in " << vec.size() << " zeroes");
         nsave = 0; zeroes_found = true;
@@ -1742,7 +1753,7 @@ page_p::splice(slotid_t idx, slot_length_t start, slot_length_t len, const cvec_
     */
 #define FUDGE 0
     // check old
-    if ((size_t)len > FUDGE + (2 * sizeof(int2_t))) {
+    if (!delta && (size_t)len > FUDGE + (2 * sizeof(int2_t))) {
         char        *c;
         int        l;
         for (l = len, c = (char *)tuple_addr(idx)+start;
@@ -1765,7 +1776,11 @@ page_p::splice(slotid_t idx, slot_length_t start, slot_length_t len, const cvec_
      */
     rc_t rc;
 
-    if(zeroes_found) {
+    if(delta) {
+        DBG(<<"log delta idx=" <<  idx << " start=" << start
+              << " len=" << len );
+        rc = log_page_delta(*this, idx, start, vec);
+    } else if(zeroes_found) {
         DBG(<<"Z splice avoid saving old=" 
                 << (len - osave) 
                 << " new= " 
@@ -406,6 +406,7 @@ private:
     friend class page_remove_log;
     friend class page_splice_log;
     friend class page_splicez_log;
+    friend class page_delta_log;
     friend class page_set_byte_log;
     friend class page_set_bit_log;
     friend class page_clr_bit_log;
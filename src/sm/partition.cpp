@@ -181,6 +181,9 @@ partition_t::open_for_append(partition_number_t __num,
     // size() was set in peek()
     w_assert1(size() != partition_t::nosize);
 
+    // we may add records to it
+    _clear_summary(fd);
+
     _set_fhdl_app(fd);
     _set_state(m_flushed);
     _set_state(m_exists);
@@ -190,6 +193,39 @@ partition_t::open_for_append(partition_number_t __num,
     return ;
 }
 
+/*
+ * Write the summary of the records in this partition after the end of
+ * its data, where the log never puts any.  Restart can do without it,
+ * so it need not be durable (see log_summary_t::read()).
+ */
+void
+partition_t::write_summary(const log_summary_t& s)
+{
+    w_rc_t e = s.write(fhdl_app(), _eop);
+    if (e.is_error()) {
+        smlevel_0::errlog->clog << warning_prio
+            << "warning: could not write the summary of log partition "
+            << num() << ":" << endl << e << endl;
+    }
+}
+
+/*
+ * A partition that got a summary when the log moved on from it, and
+ * that restart then made current again, gets more records than the
+ * summary knows of: throw it away, durably, before any.
+ */
+void
+partition_t::_clear_summary(int fd)
+{
+    sthread_base_t::filestat_t statbuf;
+    W_COERCE(me()->fstat(fd, statbuf));
+    if (statbuf.st_size > _eop) {
+        DBGTHRD(<<"partition " << num() << " dropping its summary");
+        W_COERCE(me()->ftruncate(fd, _eop));
+        W_COERCE(me()->fsync(fd));
+    }
+}
+
 void
 partition_t::clear()
 {
@@ -221,6 +257,8 @@ partition_t::init(log_core *owner)
  * start2->end2
  * a skip record 
  * enough zeroes to make the entire write become a multiple of BLOCK_SIZE 
+ * then fsync, unless force is false (the log flush daemon leaves that
+ * to its syncer).
  */
 void 
 partition_t::flush(
@@ -231,7 +269,8 @@ partition_t::flush(
         long start1, 
         long end1, 
         long start2, 
-        long end2)
+        long end2,
+        bool force)
 {
     long size = (end2 - start2) + (end1 - start1);
     long write_size = size;
@@ -346,7 +385,7 @@ partition_t::flush(
         }
     } // end copy skip record
 
-    this->flush(fd); // fsync
+    if(force) this->flush(fd); // fsync
 }
 
 /*
@@ -440,7 +479,7 @@ again:
             << " l->length " << l->length() 
             << " l->type " << int(l->type()));
 
-        w_assert1(l->length() >= logrec_t::hdr_sz);
+        w_assert1(l->length() >= l->min_length());
         {
             // check lsn
             lsn_ck = l->get_lsn_ck();
@@ -450,7 +489,7 @@ again:
                 <<" l.length=" << l->length() );
 
 
-            if( ( l->length() < logrec_t::hdr_sz )
+            if( ( l->length() < l->min_length() )
                 ||
                 ( l->length() > sizeof(logrec_t) )
                 ||
@@ -715,7 +754,7 @@ partition_t::read(logrec_t *&rp, lsn_t &ll, int fd)
         //
         if (first_time) {
             if( rp->length() > sizeof(logrec_t) || 
-            rp->length() < logrec_t::hdr_sz ) {
+            rp->length() < rp->min_length() ) {
                 w_assert1(ll.hi() == 0); // in peek()
                 return RC(smlevel_0::eEOF);
             }
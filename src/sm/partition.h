@@ -65,6 +65,7 @@ typedef enum    {  /* partition_t::_mask values */
 } partition_mask_values;
 
 class log_core; // forward
+class log_summary_t; // forward
 class partition_t {
 public:
     typedef smlevel_0::fileoff_t fileoff_t;
@@ -107,10 +108,11 @@ private:
     /* store end lsn at the beginning of each partition; updated
     * when partition closed 
     */
-    void             flush(int fd);
     lsn_t            first_lsn(uint4_t pnum) const { return lsn_t( pnum, 0); }
 
 public:
+    // fsync
+    void             flush(int fd);
     // exported for unix_log
     void               init(log_core *owner);
     void               init_index(partition_index_t i) { _index=i; }
@@ -142,8 +144,11 @@ public:
                             long start1, 
                             long end1, 
                             long start2, 
-                            long end2);
+                            long end2,
+                            bool force = true);
     const lsn_t&       last_skip_lsn() const { return _last_skip_lsn; }
+    // for restart, after the data; see log_summary_t
+    void               write_summary(const log_summary_t& s);
 #if W_DEBUG_LEVEL > 2
     void               check_fhdl_rd() const ;
     void               check_fhdl_app() const ;
@@ -171,6 +176,9 @@ public:
     void               close() { this->close(false);  }
     void               destroy();
     void               sanity_check() const;
+private:
+    void               _clear_summary(int fd);
+public:
 
 private:
     char *             _readbuf();
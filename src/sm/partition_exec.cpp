@@ -0,0 +1,630 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+// -*- mode:c++; c-basic-offset:4 -*-
+
+#define SM_SOURCE
+#define PARTITION_EXEC_C
+
+#include "sm_int_4.h"
+#include "sm.h"
+#include "key_ranges_map.h"
+#include "partition_exec.h"
+#include "atomic_templates.h"
+
+#include <deque>
+#include <string>
+
+/*
+ * The thread bound to one partition.  Everything below the queue is
+ * touched by this thread only.
+ */
+class partition_worker_t : public smthread_t {
+public:
+    NORET           partition_worker_t(partition_exec_t* exec, int id);
+    NORET           ~partition_worker_t();
+
+    virtual void    run();
+
+    /// Put a message in our queue. Any thread.
+    void            send(pexec_msg_t* m);
+
+private:
+    // A transaction's lock on a key.
+    struct holder_t {
+        tid_t       tid;
+        lock_mode_t mode;
+    };
+    struct key_lock_t {
+        std::vector<holder_t>               holders;
+        std::deque<partition_action_t*>     waiters;
+    };
+    typedef std::map<std::string, key_lock_t>   lock_table_t;
+    // the keys each transaction holds locks on
+    typedef std::map<tid_t, std::vector<lock_table_t::iterator> > held_table_t;
+
+    enum grant_t { g_granted, g_wait, g_die };
+
+    pexec_msg_t*    _take();
+    void            _sleep();
+    void            _action(partition_action_t* a);
+    grant_t         _lock(partition_action_t* a);
+    void            _grant(lock_table_t::iterator it, const tid_t& tid,
+                           lock_mode_t mode);
+    void            _wake_waiters(lock_table_t::iterator it);
+    void            _run(partition_action_t* a);
+    void            _release(const tid_t& tid);
+    void            _pause(partition_xct_t* px);
+
+    static bool     _compatible(lock_mode_t a, lock_mode_t b) {
+        return a == NL || b == NL || (a == SH && b == SH);
+    }
+
+    partition_exec_t*       _exec;
+    int                     _id;
+
+    // Multiple producers push on _head; we take the whole list at once,
+    // so there is no ABA problem.
+    pexec_msg_t* volatile   _head;
+    unsigned volatile       _sleeping;
+    pthread_mutex_t         _wake_lock; // paired with _wake
+    pthread_cond_t          _wake;      // paired with _wake_lock
+
+    lock_table_t            _locks;
+    held_table_t            _held;
+};
+
+partition_worker_t::partition_worker_t(partition_exec_t* exec, int id)
+    : smthread_t(t_regular, "partition_worker"),
+      _exec(exec), _id(id), _head(0), _sleeping(0)
+{
+    DO_PTHREAD(pthread_mutex_init(&_wake_lock, NULL));
+    DO_PTHREAD(pthread_cond_init(&_wake, NULL));
+}
+
+partition_worker_t::~partition_worker_t()
+{
+    w_assert1(_head == 0);
+    w_assert1(_held.empty());
+    DO_PTHREAD(pthread_cond_destroy(&_wake));
+    DO_PTHREAD(pthread_mutex_destroy(&_wake_lock));
+}
+
+void
+partition_worker_t::send(pexec_msg_t* m)
+{
+    pexec_msg_t* old = *&_head;
+    while(1) {
+        m->next = old;
+        membar_producer();
+        pexec_msg_t* cur = (pexec_msg_t*) atomic_cas_ptr(&_head, old, m);
+        if(cur == old)
+            break;
+        old = cur;
+    }
+    // The cas is a full barrier, so either the worker sees our
+    // message before it sleeps or we see it sleeping.
+    if(*&_sleeping) {
+        CRITICAL_SECTION(cs, _wake_lock);
+        DO_PTHREAD(pthread_cond_signal(&_wake));
+    }
+}
+
+/*
+ * Take all the messages sent so far, oldest first.
+ */
+pexec_msg_t*
+partition_worker_t::_take()
+{
+    pexec_msg_t* list = (pexec_msg_t*) atomic_swap_ptr(&_head, NULL);
+    membar_consumer();
+    pexec_msg_t* fifo = 0;
+    while(list) {
+        pexec_msg_t* m = list;
+        list = m->next;
+        m->next = fifo;
+        fifo = m;
+    }
+    return fifo;
+}
+
+void
+partition_worker_t::_sleep()
+{
+    CRITICAL_SECTION(cs, _wake_lock);
+    atomic_swap_32(&_sleeping, 1);
+    while(!*&_head) {
+        DO_PTHREAD(pthread_cond_wait(&_wake, &_wake_lock));
+    }
+    _sleeping = 0;
+}
+
+void
+partition_worker_t::run()
+{
+    bool stop = false;
+    while(!stop) {
+        pexec_msg_t* m = _take();
+        if(!m) {
+            _sleep();
+            continue;
+        }
+        while(m) {
+            pexec_msg_t* next = m->next;
+            switch(m->kind) {
+            case pexec_msg_t::m_action:
+                _action(m->action);
+                break;
+            case pexec_msg_t::m_release:
+                _release(m->tid);
+                delete m;
+                break;
+            case pexec_msg_t::m_pause:
+                _pause(m->px);
+                delete m;
+                break;
+            case pexec_msg_t::m_stop:
+                // the last message: stop() sends nothing after it
+                w_assert1(next == 0);
+                stop = true;
+                delete m;
+                break;
+            }
+            m = next;
+        }
+    }
+}
+
+void
+partition_worker_t::_action(partition_action_t* a)
+{
+    switch(_lock(a)) {
+    case g_granted:
+        _run(a);
+        break;
+    case g_wait:
+        INC_TSTAT(pexec_lock_wait_cnt);
+        break;
+    case g_die:
+        INC_TSTAT(pexec_lock_die_cnt);
+        _exec->_done(a->_msg.px, RC(smlevel_0::eDEADLOCK));
+        break;
+    }
+}
+
+/*
+ * Lock the action's key for its transaction, wait-die: the action
+ * waits only behind younger transactions (larger tids).  New requests
+ * queue behind the waiters, so the waiters count as blockers, too.
+ */
+partition_worker_t::grant_t
+partition_worker_t::_lock(partition_action_t* a)
+{
+    if(a->_mode == NL) {
+        return g_granted;
+    }
+    const tid_t& tid = a->_msg.px->_tid;
+
+    std::string k(a->_key.size(), '\0');
+    if(k.size() > 0) {
+        a->_key.copy_to(&k[0], k.size());
+    }
+    lock_table_t::iterator it = _locks.find(k);
+    if(it == _locks.end()) {
+        it = _locks.insert(lock_table_t::value_type(k, key_lock_t())).first;
+    }
+    key_lock_t& l = it->second;
+
+    bool blocked = false;
+    bool holds = false;
+    for(size_t i = 0; i < l.holders.size(); i++) {
+        const holder_t& h = l.holders[i];
+        if(h.tid == tid) {
+            holds = true;
+            continue;
+        }
+        if(_compatible(h.mode, a->_mode)) continue;
+        if(h.tid < tid) return g_die;
+        blocked = true;
+    }
+    if(holds) {
+        // An upgrade waits for the other holders only, ahead of the
+        // waiters, which are waiting for us anyway.
+        if(blocked) {
+            l.waiters.push_front(a);
+            return g_wait;
+        }
+    } else {
+        for(size_t i = 0; i < l.waiters.size(); i++) {
+            const tid_t& wtid = l.waiters[i]->_msg.px->_tid;
+            if(wtid != tid && wtid < tid) return g_die;
+            blocked = true;
+        }
+        if(blocked) {
+            l.waiters.push_back(a);
+            return g_wait;
+        }
+    }
+    _grant(it, tid, a->_mode);
+    return g_granted;
+}
+
+void
+partition_worker_t::_grant(lock_table_t::iterator it, const tid_t& tid,
+        lock_mode_t mode)
+{
+    std::vector<holder_t>& holders = it->second.holders;
+    for(size_t i = 0; i < holders.size(); i++) {
+        if(holders[i].tid == tid) {
+            if(mode == EX) holders[i].mode = EX;
+            return;
+        }
+    }
+    holder_t h;
+    h.tid = tid;
+    h.mode = mode;
+    holders.push_back(h);
+    _held[tid].push_back(it);
+}
+
+/*
+ * Grant the lock to the waiters at the head of the queue that no
+ * longer conflict, and run their actions.
+ */
+void
+partition_worker_t::_wake_waiters(lock_table_t::iterator it)
+{
+    key_lock_t& l = it->second;
+    while(!l.waiters.empty()) {
+        partition_action_t* a = l.waiters.front();
+        const tid_t& tid = a->_msg.px->_tid;
+        bool blocked = false;
+        for(size_t i = 0; i < l.holders.size() && !blocked; i++) {
+            blocked = l.holders[i].tid != tid &&
+                      !_compatible(l.holders[i].mode, a->_mode);
+        }
+        if(blocked) break;
+        l.waiters.pop_front();
+        _grant(it, tid, a->_mode);
+        _run(a);
+    }
+}
+
+void
+partition_worker_t::_run(partition_action_t* a)
+{
+    partition_xct_t* px = a->_msg.px;
+    attach_xct(px->_xd);
+    rc_t rc = a->run();
+    INC_TSTAT(pexec_action_cnt);
+    detach_xct(px->_xd);
+    _exec->_done(px, rc);
+}
+
+void
+partition_worker_t::_release(const tid_t& tid)
+{
+    held_table_t::iterator h = _held.find(tid);
+    if(h == _held.end()) return;
+    std::vector<lock_table_t::iterator>& keys = h->second;
+    for(size_t i = 0; i < keys.size(); i++) {
+        lock_table_t::iterator it = keys[i];
+        std::vector<holder_t>& holders = it->second.holders;
+        for(size_t j = 0; j < holders.size(); j++) {
+            if(holders[j].tid == tid) {
+                holders.erase(holders.begin() + j);
+                break;
+            }
+        }
+        _wake_waiters(it);
+        if(it->second.holders.empty()) {
+            // nobody waits for a lock nobody holds
+            w_assert1(it->second.waiters.empty());
+            _locks.erase(it);
+        }
+    }
+    _held.erase(h);
+}
+
+/*
+ * Stay off our sub-tree while px rolls back, which latches the pages
+ * our actions don't.
+ */
+void
+partition_worker_t::_pause(partition_xct_t* px)
+{
+    CRITICAL_SECTION(cs, px->_lock);
+    px->_paused++;
+    DO_PTHREAD(pthread_cond_broadcast(&px->_done));
+    while(px->_hold) {
+        DO_PTHREAD(pthread_cond_wait(&px->_done, &px->_lock));
+    }
+    px->_paused--;
+    DO_PTHREAD(pthread_cond_broadcast(&px->_done));
+}
+
+
+partition_action_t::partition_action_t(const cvec_t& key, lock_mode_t mode)
+    : _msg(pexec_msg_t::m_action),
+      _key(key, 0, key.size()),
+      _mode(mode),
+      _exec(0)
+{
+    _msg.action = this;
+}
+
+partition_action_t::~partition_action_t()
+{
+}
+
+const stid_t&
+partition_action_t::stid() const
+{
+    return _exec->stid();
+}
+
+bool
+partition_action_t::ignore_latches() const
+{
+    return _exec->ignore_latches();
+}
+
+
+partition_xct_t::partition_xct_t()
+    : _xd(0), _pending(0), _paused(0), _hold(false)
+{
+    DO_PTHREAD(pthread_mutex_init(&_lock, NULL));
+    DO_PTHREAD(pthread_cond_init(&_done, NULL));
+}
+
+partition_xct_t::~partition_xct_t()
+{
+    w_assert1(_pending == 0);
+    DO_PTHREAD(pthread_cond_destroy(&_done));
+    DO_PTHREAD(pthread_mutex_destroy(&_lock));
+}
+
+
+partition_exec_t::partition_exec_t(const stid_t& stid, bool bIgnoreLatches)
+    : _stid(stid),
+      _bIgnoreLatches(bIgnoreLatches),
+      _ranges(0),
+      _sinfo(0),
+      _workers(0),
+      _nworkers(0)
+{
+}
+
+partition_exec_t::~partition_exec_t()
+{
+    stop();
+}
+
+rc_t
+partition_exec_t::start()
+{
+    w_assert1(!_workers);
+    if(!xct()) return RC(eNOTRANS);
+
+    key_ranges_map* ranges = 0;
+    sinfo_s sinfo;
+    W_DO(ss_m::get_range_map(_stid, ranges));
+    W_DO(ss_m::get_store_info(_stid, sinfo));
+
+    // Keep copies: the index's map lives in the store descriptor cache.
+    _ranges = new key_ranges_map;
+    _sinfo = new sinfo_s(sinfo);
+    if(!_ranges || !_sinfo) W_FATAL(eOUTOFMEMORY);
+    *_ranges = *ranges;
+
+    std::vector<lpid_t> roots;
+    W_DO(_ranges->getAllPartitions(roots));
+    _workers = new partition_worker_t*[roots.size()];
+    if(!_workers) W_FATAL(eOUTOFMEMORY);
+
+    rc_t rc;
+    _nworkers = 0;
+    for(size_t i = 0; i < roots.size(); i++) {
+        partition_worker_t* w = new partition_worker_t(this, i);
+        if(!w) W_FATAL(eOUTOFMEMORY);
+        rc = w->fork();
+        if(rc.is_error()) {
+            delete w;
+            break;
+        }
+        _workers[_nworkers++] = w;
+        _index[roots[i]] = i;
+    }
+    if(rc.is_error()) {
+        stop();
+        return rc;
+    }
+    return RCOK;
+}
+
+void
+partition_exec_t::stop()
+{
+    if(!_workers) return;
+    for(int i = 0; i < _nworkers; i++) {
+        pexec_msg_t* m = new pexec_msg_t(pexec_msg_t::m_stop);
+        if(!m) W_FATAL(eOUTOFMEMORY);
+        _workers[i]->send(m);
+    }
+    for(int i = 0; i < _nworkers; i++) {
+        W_COERCE(_workers[i]->join());
+        delete _workers[i];
+    }
+    delete[] _workers;
+    _workers = 0;
+    _nworkers = 0;
+    _index.clear();
+    delete _ranges;
+    _ranges = 0;
+    delete _sinfo;
+    _sinfo = 0;
+}
+
+rc_t
+partition_exec_t::submit(partition_xct_t& px, partition_action_t& action)
+{
+    xct_t* xd = xct();
+    if(!xd) return RC(eNOTRANS);
+    if(!_workers) return RC(eBADARGUMENT);
+    if(action._mode != NL && action._mode != SH && action._mode != EX) {
+        return RC(eBADLOCKMODE);
+    }
+    if(px._xd != xd) {
+        // px belongs to another transaction that has not ended
+        if(px._xd) return RC(eBADARGUMENT);
+        w_assert1(px._pending == 0);
+        px._xd = xd;
+        px._tid = xd->tid();
+        px._rc = RCOK;
+        px._touched.assign(_nworkers, false);
+    }
+
+    lpid_t root;
+    W_DO(_ranges->getPartitionByUnscrambledKey(*_sinfo, action._key, root));
+    std::map<lpid_t, int>::const_iterator it = _index.find(root);
+    w_assert1(it != _index.end());
+    int w = it->second;
+
+    action._exec = this;
+    action._root = root;
+    action._msg.px = &px;
+    px._touched[w] = true;
+    atomic_inc(px._pending);
+    _workers[w]->send(&action._msg);
+    return RCOK;
+}
+
+rc_t
+partition_exec_t::wait(partition_xct_t& px)
+{
+    if(!px._xd) return RCOK;
+    CRITICAL_SECTION(cs, px._lock);
+    while(*&px._pending > 0) {
+        DO_PTHREAD(pthread_cond_wait(&px._done, &px._lock));
+    }
+    return px._rc;
+}
+
+void
+partition_exec_t::_done(partition_xct_t* px, const rc_t& rc)
+{
+    CRITICAL_SECTION(cs, px->_lock);
+    // let the first error found prevail
+    if(rc.is_error() && !px->_rc.is_error()) {
+        px->_rc = rc;
+    }
+    if(atomic_dec_nv(px->_pending) == 0) {
+        DO_PTHREAD(pthread_cond_broadcast(&px->_done));
+    }
+}
+
+rc_t
+partition_exec_t::commit(partition_xct_t& px, bool lazy)
+{
+    rc_t rc = wait(px);
+    if(rc.is_error()) {
+        W_DO(abort(px));
+        return rc;
+    }
+    int parts = 0;
+    for(size_t i = 0; i < px._touched.size(); i++) {
+        if(px._touched[i]) parts++;
+    }
+    if(parts > 1) {
+        INC_TSTAT(pexec_multi_xct_cnt);
+    }
+    W_DO(ss_m::commit_xct(lazy));
+    _release(px);
+    return RCOK;
+}
+
+rc_t
+partition_exec_t::abort(partition_xct_t& px)
+{
+    rc_t rc = wait(px);
+    // the actions failed or not, we are rolling them back
+    if(rc.is_error()) rc = RCOK;
+
+    bool pause = _bIgnoreLatches && px._xd;
+    if(pause) _pause(px);
+    rc = ss_m::abort_xct();
+    if(pause) _resume(px);
+    W_DO(rc);
+    _release(px);
+    return RCOK;
+}
+
+void
+partition_exec_t::_pause(partition_xct_t& px)
+{
+    int n = 0;
+    px._hold = true;
+    for(int i = 0; i < _nworkers; i++) {
+        if(!px._touched[i]) continue;
+        pexec_msg_t* m = new pexec_msg_t(pexec_msg_t::m_pause);
+        if(!m) W_FATAL(eOUTOFMEMORY);
+        m->px = &px;
+        _workers[i]->send(m);
+        n++;
+    }
+    CRITICAL_SECTION(cs, px._lock);
+    while(px._paused < n) {
+        DO_PTHREAD(pthread_cond_wait(&px._done, &px._lock));
+    }
+}
+
+void
+partition_exec_t::_resume(partition_xct_t& px)
+{
+    CRITICAL_SECTION(cs, px._lock);
+    px._hold = false;
+    DO_PTHREAD(pthread_cond_broadcast(&px._done));
+    // px may go away once we return
+    while(px._paused > 0) {
+        DO_PTHREAD(pthread_cond_wait(&px._done, &px._lock));
+    }
+}
+
+/*
+ * The transaction has ended: tell the workers it used to drop its
+ * key locks.  They do so when they get to it; we don't wait.
+ */
+void
+partition_exec_t::_release(partition_xct_t& px)
+{
+    for(int i = 0; i < _nworkers && i < int(px._touched.size()); i++) {
+        if(!px._touched[i]) continue;
+        pexec_msg_t* m = new pexec_msg_t(pexec_msg_t::m_release);
+        if(!m) W_FATAL(eOUTOFMEMORY);
+        m->tid = px._tid;
+        _workers[i]->send(m);
+    }
+    px._xd = 0;
+    px._touched.clear();
+    px._rc = RCOK;
+}
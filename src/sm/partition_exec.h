@@ -0,0 +1,268 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+// -*- mode:c++; c-basic-offset:4 -*-
+
+#ifndef PARTITION_EXEC_H
+#define PARTITION_EXEC_H
+
+#include "w_defines.h"
+
+#include <map>
+#include <vector>
+
+class partition_action_t;
+class partition_exec_t;
+class partition_xct_t;
+class partition_worker_t;
+
+/**\cond skip */
+// A request in a worker's queue.
+struct pexec_msg_t {
+    enum kind_t {
+        m_action,   // run an action
+        m_release,  // the transaction ended; release its key locks
+        m_pause,    // stop until the transaction has rolled back
+        m_stop      // exit
+    };
+    pexec_msg_t*        next;
+    kind_t              kind;
+    partition_action_t* action;
+    partition_xct_t*    px;
+    tid_t               tid;
+
+    pexec_msg_t(kind_t k) : next(0), kind(k), action(0), px(0) {}
+};
+/**\endcond skip */
+
+/**\brief A piece of a transaction that works on one partition of a
+ * multi-rooted B+-Tree.
+ * \ingroup SSMBTREE
+ *
+ * \details
+ * Derive from this class and implement run() with the calls to the
+ * ss_m::*_mr_assoc methods the action needs, passing them
+ * bIgnoreLocks=true, ignore_latches() and root().  The executor runs
+ * the action on the worker that owns the partition of key(), once the
+ * worker has granted the action's transaction a \e mode lock on key()
+ * in its own lock table.
+ *
+ * The action, and the memory its key refers to, must stay valid until
+ * partition_exec_t::wait() returns for its transaction.
+ */
+class partition_action_t {
+public:
+    /**\brief
+     * @param[in] key  Key of the entry the action works on; it
+     *            decides the partition.
+     * @param[in] mode  NL, SH or EX: how to lock the key.
+     */
+    NORET               partition_action_t(const cvec_t& key,
+                                           lock_mode_t mode);
+    virtual NORET       ~partition_action_t();
+
+    /// Do the work. Runs on a worker thread, in the transaction.
+    virtual rc_t        run() = 0;
+
+    const cvec_t&       key() const { return _key; }
+    lock_mode_t         mode() const { return _mode; }
+
+protected:
+    /// The index.
+    const stid_t&       stid() const;
+    /// Root of the sub-tree of the partition the action runs on.
+    const lpid_t&       root() const { return _root; }
+    /// True if the action must not latch pages of the sub-tree.
+    bool                ignore_latches() const;
+
+private:
+    friend class partition_exec_t;
+    friend class partition_worker_t;
+
+    pexec_msg_t         _msg;
+    cvec_t              _key;
+    lock_mode_t         _mode;
+    partition_exec_t*   _exec;
+    lpid_t              _root;
+
+    // disabled
+    NORET               partition_action_t(const partition_action_t&);
+    partition_action_t& operator=(const partition_action_t&);
+};
+
+/**\brief The rendezvous point of a transaction's actions.
+ * \ingroup SSMBTREE
+ *
+ * \details
+ * Tracks the actions a transaction has handed to a partition_exec_t,
+ * the first error they returned, and the workers holding key locks
+ * for it.  One per running transaction; it can be reused once the
+ * transaction has ended.
+ */
+class partition_xct_t {
+public:
+    NORET               partition_xct_t();
+    NORET               ~partition_xct_t();
+
+private:
+    friend class partition_exec_t;
+    friend class partition_worker_t;
+
+    xct_t*              _xd;
+    tid_t               _tid;
+    int volatile        _pending;   // actions not done yet
+    int                 _paused;    // workers stopped for rollback
+    bool                _hold;      // keep them stopped
+    rc_t                _rc;        // first error of an action
+    std::vector<bool>   _touched;   // workers with our key locks
+
+    pthread_mutex_t     _lock;      // paired with _done
+    pthread_cond_t      _done;      // paired with _lock
+
+    // disabled
+    NORET               partition_xct_t(const partition_xct_t&);
+    partition_xct_t&    operator=(const partition_xct_t&);
+};
+
+/**\brief Runs the actions on a multi-rooted B+-Tree with one thread
+ * per partition.
+ * \ingroup SSMBTREE
+ *
+ * \details
+ * Data-oriented execution: instead of each transaction's thread
+ * working on any part of the index, and the lock manager keeping the
+ * threads apart, the transaction hands out actions, and each action
+ * runs on the worker thread bound to the partition (sub-tree) its key
+ * falls in.  A worker is the only thread that touches its sub-tree,
+ * so:
+ * - each worker keeps the key locks of its partition in a lock table
+ *   of its own, which it alone reads and writes, and the actions
+ *   skip the lock manager (bIgnoreLocks);
+ * - if the executor was made with \e bIgnoreLatches, the actions skip
+ *   the page latches of the sub-tree, too.
+ *
+ * Actions reach their worker through a lock-free queue; an idle
+ * worker sleeps until an action arrives.
+ *
+ * The key locks are held until the transaction ends, and are waited
+ * for in wait-die order: an action of an older transaction waits for
+ * a younger one to end, but an action that would wait for an older
+ * transaction fails with eDEADLOCK, so transactions whose actions span
+ * partitions cannot deadlock.  The caller then aborts and retries.
+ *
+ * A transaction uses the executor like this:
+ * \code
+ * W_DO(ss_m::begin_xct());
+ * partition_xct_t px;
+ * W_DO(exec.submit(px, action1));  // may run on another worker
+ * W_DO(exec.submit(px, action2));  //  than action1
+ * W_DO(exec.commit(px));           // rendezvous, commit, unlock
+ * \endcode
+ * The actions run in the caller's transaction, attached to the worker
+ * threads.  The caller must not commit or abort the transaction by
+ * itself: commit() and abort() wait for the transaction's actions
+ * (the rendezvous) before they end it, and release its key locks
+ * afterwards.  If the latches are skipped, abort() also stops the
+ * workers the transaction used while it rolls back, since rollback
+ * latches the pages.
+ *
+ * The partitions are those of the index when start() is called; the
+ * index must not be repartitioned while the executor runs, and all
+ * changes to the index must go through the executor.
+ */
+class partition_exec_t : public smlevel_0 {
+public:
+    /**\brief
+     * @param[in] stid  The multi-rooted B+-Tree.
+     * @param[in] bIgnoreLatches  Actions skip page latches.
+     */
+    NORET               partition_exec_t(const stid_t& stid,
+                                         bool bIgnoreLatches = false);
+    /// Stops the workers if they are still running.
+    NORET               ~partition_exec_t();
+
+    /**\brief Read the partitions of the index and start one worker
+     * for each.
+     * \details
+     * Must be called in a transaction.
+     */
+    rc_t                start();
+    /**\brief Stop the workers.
+     * \details
+     * No transaction may be using the executor.
+     */
+    void                stop();
+
+    /// The number of partitions (and workers).
+    int                 num_partitions() const { return _nworkers; }
+    const stid_t&       stid() const { return _stid; }
+    bool                ignore_latches() const { return _bIgnoreLatches; }
+
+    /**\brief Send an action of the attached transaction to its
+     * partition's worker.
+     * \details
+     * Returns at once; the action's result is returned by wait().
+     */
+    rc_t                submit(partition_xct_t& px,
+                               partition_action_t& action);
+
+    /**\brief Wait until all the actions submitted for \e px are done.
+     * \details
+     * Returns the first error an action returned.  The transaction
+     * keeps its key locks.
+     */
+    rc_t                wait(partition_xct_t& px);
+
+    /**\brief Wait for the transaction's actions, then commit it, or
+     * abort it if an action failed, and release its key locks.
+     * \details
+     * Returns the error of the failed action, if any.
+     */
+    rc_t                commit(partition_xct_t& px, bool lazy = false);
+
+    /// Wait for the transaction's actions, abort it, and release its
+    /// key locks.
+    rc_t                abort(partition_xct_t& px);
+
+private:
+    friend class partition_worker_t;
+
+    void                _done(partition_xct_t* px, const rc_t& rc);
+    void                _pause(partition_xct_t& px);
+    void                _resume(partition_xct_t& px);
+    void                _release(partition_xct_t& px);
+
+    stid_t              _stid;
+    bool                _bIgnoreLatches;
+    key_ranges_map*     _ranges;    // our copy of the index's
+    sinfo_s*            _sinfo;     // the index's key types
+    std::map<lpid_t, int> _index;   // sub-tree root -> its worker
+    partition_worker_t** _workers;
+    int                 _nworkers;
+
+    // disabled
+    NORET               partition_exec_t(const partition_exec_t&);
+    partition_exec_t&   operator=(const partition_exec_t&);
+};
+
+#endif
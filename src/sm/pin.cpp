@@ -65,6 +65,7 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 #include <pin.h>
 #include <lgrec.h>
 #include <sm.h>
+#include "vstore.h"
 
 #include <new>
 
@@ -130,6 +131,7 @@ void pin_i::unpin()
             _data_page().unfix();  
         }
         _hdr_page().unfix();  
+        _free_snapshot_copy();
         _flags = pin_empty;
         _rec = NULL;
 
@@ -219,6 +221,28 @@ rc_t pin_i::next_bytes(bool& eof)
     return RCOK;
 }
 
+rc_t pin_i::read_bytes(smsize_t start, smsize_t len, char* buf)
+{
+    SM_PROLOGUE_RC(pin_i::read_bytes, in_xct, read_only,  0);
+    _check_lsn();
+
+    if (!pinned()) {
+        return RC(eBADARGUMENT);
+    }
+    if (start > _rec->body_size()) {
+        return RC(eBADSTART);
+    }
+    if (len > _rec->body_size() - start) {
+        return RC(eBADLENGTH);
+    }
+
+    if (_rec->is_small()) {
+        memcpy(buf, _rec->body() + start, len);
+        return RCOK;
+    }
+    return fi->read_large(_hdr_page(), _rid.slot, start, len, buf);
+}
+
 rc_t pin_i::update_rec(smsize_t start, const vec_t& data,
                        const bool bIgnoreLocks)
 {
@@ -250,6 +274,7 @@ rc_t pin_i::update_rec(smsize_t start, const vec_t& data,
         if (data.size() > (rec()->body_size()-start)) {
             return RC(eRECUPDATESIZE);
         }
+        W_DO_GOTO(rc, version_store_t::before_update(_hdr_page(), _rid.slot));
         W_DO_GOTO(rc, _hdr_page().splice_data(_rid.slot, u4i(start), data.size(), data));
 
     } else {
@@ -337,6 +362,7 @@ rc_t pin_i::update_mrbt_rec(smsize_t start, const vec_t& data,
         if (data.size() > (rec()->body_size()-start)) {
             return RC(eRECUPDATESIZE);
         }
+        W_DO_GOTO(rc, version_store_t::before_update(_hdr_page(), _rid.slot));
         W_DO_GOTO(rc, _hdr_page().splice_data(_rid.slot, u4i(start), data.size(), data));
 
     } else {
@@ -408,6 +434,7 @@ rc_t pin_i::update_rec_hdr(smsize_t start, const vec_t& hdr,
     lock_mode_t repin_lock_mode = EX;
     if (bIgnoreLocks) repin_lock_mode = SH;
     W_DO_GOTO(rc, _repin(repin_lock_mode));
+    W_DO_GOTO(rc, version_store_t::before_update(_hdr_page(), _rid.slot));
     W_DO_GOTO(rc, _hdr_page().splice_hdr(_rid.slot, u4i(start), hdr.size(), hdr));
 
 // success
@@ -633,6 +660,45 @@ const char* pin_i::_body_large()
     return (char*) _data_page().tuple_addr(0);
 }
 
+/*
+ * Point _rec at the record in the fixed header page, or, in a snapshot
+ * transaction, at the version the snapshot sees.  Record number zero
+ * is the page header and has no versions.
+ */
+rc_t pin_i::_get_rec(const rid_t& rid)
+{
+    xct_t* xd = xct();
+    if (rid.slot != 0 && xd && xd->is_snapshot()) {
+        record_t* copy;
+        switch (version_store_t::lookup(xd, rid, &copy)) {
+        case version_store_t::vs_current:
+            break;
+        case version_store_t::vs_old:
+            _rec = copy;
+            _flags |= pin_snapshot_copy;
+            return RCOK;
+        case version_store_t::vs_absent:
+            _rec = NULL;
+            return RC(eBADSLOTNUMBER);
+        }
+    }
+    W_DO(_hdr_page().get_rec(rid.slot, _rec));
+    if (xd && xd->is_occ() && rid.slot != 0) {
+        // the page lsn does not cover a large record's data pages
+        W_DO(xd->occ_read(lockid_t(rid), _hdr_page(), _rec->is_large()));
+    }
+    return RCOK;
+}
+
+void pin_i::_free_snapshot_copy()
+{
+    if (_flags & pin_snapshot_copy) {
+        delete [] (char*) _rec;
+        _rec = NULL;
+        _flags &= ~pin_snapshot_copy;
+    }
+}
+
 rc_t pin_i::_pin(const rid_t& rid, 
                  smsize_t start, 
                  lock_mode_t lock_mode,
@@ -659,6 +725,7 @@ rc_t pin_i::_pin(const rid_t& rid, smsize_t start,
             w_assert3(_flags & pin_separate_data && _data_page().is_fixed());  
             _data_page().unfix();  
         }
+        _free_snapshot_copy();
    
         /*
          * If the page for the new record is not the same as the
@@ -701,14 +768,15 @@ rc_t pin_i::_pin(const rid_t& rid, smsize_t start,
 
     }
 
-    W_DO_GOTO(rc, _hdr_page().get_rec(rid.slot, _rec));
+    _flags = pin_empty;
+    W_DO_GOTO(rc, _get_rec(rid));
     if (_rec == NULL) goto failure;
     if (start > 0 && start >= _rec->body_size()) {
         rc = RC(eBADSTART);
         goto failure;
     }
 
-    _flags = pin_rec_pinned;
+    _flags |= pin_rec_pinned;
     _rid = rid;
 
     /*
@@ -736,6 +804,7 @@ failure:
         INC_TSTAT(rec_unpin_cnt);
 
     }
+    _free_snapshot_copy();
     _flags = pin_empty;
     return rc;
 }
@@ -835,13 +904,14 @@ rc_t pin_i::_repin(lock_mode_t lmode,
         DBGTHRD(<<"repin");
         W_DO_GOTO(rc, fi->locate_page(_rid, _hdr_page(),
 				      lock_to_latch(_lmode, bIgnoreLatches)));
-        W_DO_GOTO(rc, _hdr_page().get_rec(_rid.slot, _rec) );
+        _flags = pin_empty;
+        W_DO_GOTO(rc, _get_rec(_rid));
         w_assert3(_rec);
         if (_start > 0 && _start >= _rec->body_size()) {
             rc = RC(eBADSTART);
             goto failure;
         }
-        _flags = pin_rec_pinned;
+        _flags |= pin_rec_pinned;
 
         /*
          * See if the record is small or large.  Record number zero
@@ -866,6 +936,7 @@ rc_t pin_i::_repin(lock_mode_t lmode,
     return RCOK;
   
 failure:
+    _free_snapshot_copy();
     _flags = pin_empty;
     return rc;
 }
@@ -190,7 +190,8 @@ public:
         pin_rec_pinned                = 0x01,
         pin_hdr_only                = 0x02, 
         pin_separate_data        = 0x04,
-        pin_lg_data_pinned        = 0x08  // large data page is pinned
+        pin_lg_data_pinned        = 0x08, // large data page is pinned
+        pin_snapshot_copy        = 0x10  // _rec is a copy of an old version
     };
     /**\endcond skip */
     
@@ -274,6 +275,24 @@ public:
      */
     rc_t       next_bytes(bool& eof); 
 
+    /**\brief Copy a range of the pinned record's body into a buffer.
+     * \details
+     * @param[in] start  Offset of the first byte of interest.
+     * @param[in] len  Number of bytes to copy.
+     * @param[out] buf  Buffer of at least \a len bytes.
+     *
+     * The range must lie within the body.  What is pinned does not
+     * change.
+     *
+     * Use this rather than next_bytes() to stream a large record:
+     * the data pages of the range are looked up in the record's
+     * index once, and those not already in the buffer pool are read
+     * from the volume several contiguous pages at a time, straight
+     * into a private buffer, so a big object does not flush the
+     * buffer pool as it goes by.
+     */
+    rc_t       read_bytes(smsize_t start, smsize_t len, char* buf);
+
     /**\brief True if something currently pinned. */
     bool       pinned() const     { return _flags & pin_rec_pinned; }
 
@@ -411,6 +430,9 @@ private:
     rc_t         _pin_data();
 
     const char* _body_large();
+
+    rc_t        _get_rec(const rid_t &rid);
+    void        _free_snapshot_copy();
     
     rc_t        _pin(const rid_t &rid, smsize_t start, lock_mode_t m, 
                     latch_mode_t l);
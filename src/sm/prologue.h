@@ -267,6 +267,14 @@ prologue_rc_t::prologue_rc_t(
         }
     }
 
+    // Snapshot transactions read old versions; they cannot update.
+    if(_the_xct && _constraint == read_write && _xct_state == in_xct &&
+            _the_xct->is_snapshot()) {
+        _rc = rc_t(__FILE__, __LINE__, smlevel_0::eSNAPSHOTUPDATE);
+        _constraint = read_only; // nothing for the destructor to undo
+        return;
+    }
+
     // Now make sure we don't have multiple threads attached if
     // this is an update-method. 
     if(_the_xct && (_constraint == read_write))  {
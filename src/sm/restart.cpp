@@ -68,6 +68,7 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 #include "w_heap.h"
 // include crash.h for definition of LOGTRACE1
 #include "crash.h"
+#include "log_summary.h"
 
 
 #ifdef EXPLICIT_TEMPLATE
@@ -380,6 +381,8 @@ restart_m::analysis_pass(
      */
     int num_chkpt_end_handled = 0;
 
+    log_summary_t summary;
+
     while (scan.next(lsn, log_rec_buf)) {
         logrec_t&        r = *log_rec_buf;
 
@@ -395,6 +398,23 @@ restart_m::analysis_pass(
                << "Analyzing log segment " << cur_segment << flushl;
         }
 
+        /*
+         *  Past the master checkpoint, a whole partition with a
+         *  summary need not be read: apply what its records would
+         *  do, and go on with the next one.  Not the last partition,
+         *  which may have more records than its summary (if any),
+         *  nor ones that mount or dismount volumes.
+         */
+        if (lsn == log_m::first_lsn(lsn.hi()) && num_chkpt_end_handled > 0
+            && lsn.hi() < log->curr_lsn().hi()
+            && summary.read(lsn.hi()) && !summary.has_mount())  {
+            DBG(<<"analysis: applying the summary of partition " << lsn.hi());
+            _apply_summary(summary, dptab);
+            INC_TSTAT(log_summaries_used);
+            scan.seek(log_m::first_lsn(lsn.hi()+1));
+            continue;
+        }
+
         xct_t* xd = 0;
 
         /*
@@ -470,6 +490,8 @@ restart_m::analysis_pass(
                  *         If the xct is not in xct tab, insert it.
                  */
                 const chkpt_xct_tab_t* dp = (chkpt_xct_tab_t*) r.data();
+                // new transactions must not reuse tids from before the crash
+                xct_t::note_tid(dp->youngest);
                 for (uint i = 0; i < dp->count; i++)  {
                     xct_t* xd = xct_t::look_up(dp->xrec[i].tid);
                     if (!xd) {
@@ -594,21 +616,7 @@ restart_m::analysis_pass(
             /*
              *  Remove xct from xct tab
              */
-            if (xd->state() == xct_t::xct_prepared || xd->state() == xct_t::xct_freeing_space) 
-            {
-                /*
-                 * was prepared in the master
-                 * checkpoint, so the locks
-                 * were acquired.  have to free them
-                 */
-                me()->attach_xct(xd);        
-                // release all locks (1st true) and don't 
-                // free extents which hold locks (2nd true)
-                W_COERCE( lm->unlock_duration(t_long, true, true) );
-                me()->detach_xct(xd);        
-            }
-            xd->change_state(xct_t::xct_ended);
-	    xct_t::destroy_xct(xd);
+            _end_xct(xd);
             break;
 
         default: {
@@ -761,6 +769,87 @@ restart_m::analysis_pass(
 
 
 
+/*********************************************************************
+ *
+ *  restart_m::_end_xct(xd)
+ *
+ *  Analysis found the end (or abort) record of xd: remove it from
+ *  the xct table.
+ *
+ *********************************************************************/
+void
+restart_m::_end_xct(xct_t* xd)
+{
+    if (xd->state() == xct_t::xct_prepared || xd->state() == xct_t::xct_freeing_space) 
+    {
+        /*
+         * was prepared in the master
+         * checkpoint, so the locks
+         * were acquired.  have to free them
+         */
+        me()->attach_xct(xd);        
+        // release all locks (1st true) and don't 
+        // free extents which hold locks (2nd true)
+        W_COERCE( lm->unlock_duration(t_long, true, true) );
+        me()->detach_xct(xd);        
+    }
+    xd->change_state(xct_t::xct_ended);
+    xct_t::destroy_xct(xd);
+}
+
+
+/*********************************************************************
+ *
+ *  restart_m::_apply_summary(summary, dptab)
+ *
+ *  Do to the xct table and dptab what analysis_pass would do with
+ *  the records of a partition after the master checkpoint, from the
+ *  partition's summary.
+ *
+ *********************************************************************/
+void
+restart_m::_apply_summary(const log_summary_t& summary,
+                          dirty_pages_tab_t& dptab)
+{
+    typedef log_summary_t::xct_map::const_iterator xct_iter;
+    for (xct_iter it = summary.xcts().begin(); 
+         it != summary.xcts().end(); ++it)  {
+        const log_summary_xct_t& e = it->second;
+        xct_t* xd = xct_t::look_up(e.tid);
+        if (!xd) {
+            if (e.flags & log_summary_xct_t::ended)  {
+                // began and ended in the partition
+                xct_t::note_tid(e.tid);
+                continue;
+            }
+            DBG(<<"analysis: inserting tx " << e.tid << " active ");
+            xd = xct_t::new_xct(e.tid, xct_t::xct_active, 
+                                e.first, e.first_prev);
+            w_assert1(xd);
+        }
+        xd->set_last_lsn(e.last);
+        if (e.flags & log_summary_xct_t::undo_set)  {
+            xd->set_undo_nxt(e.undo_nxt);
+        }
+        if (e.flags & log_summary_xct_t::freeing)  {
+            xd->change_state(xct_t::xct_freeing_space);
+        }
+        if (e.flags & log_summary_xct_t::ended)  {
+            _end_xct(xd);
+        }
+    }
+
+    typedef log_summary_t::page_map::const_iterator page_iter;
+    for (page_iter it = summary.pages().begin(); 
+         it != summary.pages().end(); ++it)  {
+        if (!dptab.look_up(it->first))  {
+            DBG(<<"dptab.insert dirty pg " << it->first << " " << it->second);
+            dptab.insert(it->first, it->second);
+        }
+    }
+}
+
+
 /*********************************************************************
  * 
  *  restart_m::redo_pass(redo_lsn, highest_lsn, dptab)
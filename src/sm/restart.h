@@ -48,6 +48,8 @@ class dirty_pages_tab_t;
 #include <restart_s.h>
 #endif
 
+class log_summary_t;
+
 class restart_m : public smlevel_1 {
 public:
     NORET                        restart_m()        {};
@@ -71,6 +73,11 @@ private:
 
     static void                 undo_pass();
 
+    static void                 _apply_summary(
+        const log_summary_t&              summary,
+        dirty_pages_tab_t&                ptab);
+    static void                 _end_xct(xct_t* xd);
+
 private:
     // keep track of tid from log record that we're redoing
     // for a horrid space-recovery handling hack
@@ -67,6 +67,9 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 #include <bf_prefetch.h>
 #include <btcursor.h>
 #include <rtree_p.h>
+#include "vstore.h"
+
+#include <map>
 
 #if W_DEBUG_LEVEL > 1
 inline void         pin_i::_set_lsn_for_scan() {
@@ -96,6 +99,27 @@ inline void         pin_i::_set_lsn_for_scan() {
     } while(0)
 
 
+/*
+ * While a scan fixes pages, those it reads into the buffer pool go to
+ * its ring, if it has one: see bf_ring_t.
+ */
+class scan_ring_guard_t {
+    bf_ring_t*  _saved;
+public:
+    scan_ring_guard_t(bf_ring_t* r) : _saved(me()->scan_ring()) {
+        me()->set_scan_ring(r);
+    }
+    ~scan_ring_guard_t() { me()->set_scan_ring(_saved); }
+};
+
+static bf_ring_t* new_scan_ring()
+{
+    if(smlevel_0::scan_ring_frames == 0) return 0;
+    return new bf_ring_t(smlevel_0::scan_ring_frames, 
+                         smlevel_0::scan_ring_threshold);
+}
+
+
 // Can no longer inline this in scan.h without requiring
 // client (vas) to include def's for file_p and lgdata_p.
 file_p&   append_file_i::_page() 
@@ -132,7 +156,8 @@ scan_index_i::scan_index_i(
   _btcursor(0),
   _skip_nulls( ! include_nulls ),
   _cc(cc),
-  _bIgnoreLatches(bIgnoreLatches)
+  _bIgnoreLatches(bIgnoreLatches),
+  _ring(new_scan_ring())
 {
     INIT_SCAN_PROLOGUE_RC(scan_index_i::scan_index_i, prologue_rc_t::read_only, 1);
 
@@ -144,6 +169,18 @@ scan_index_i::scan_index_i(
 scan_index_i::~scan_index_i()
 {
     finish();
+    delete _ring;
+}
+
+void
+scan_index_i::use_ring(bool on)
+{
+    if(!on) {
+        delete _ring;
+        _ring = 0;
+    } else if(!_ring) {
+        _ring = new_scan_ring();
+    }
 }
 
 
@@ -451,6 +488,7 @@ scan_index_i::_fetch(
     }
 
     SM_PROLOGUE_RC(scan_index_i::_fetch, in_xct, read_only, 0);
+    scan_ring_guard_t ring(_ring);
 
     /*
      *  Check if scan is terminated.
@@ -662,6 +700,25 @@ scan_rt_i::xct_state_changed(
 }
 
 
+/*
+ * The shared scans of a file (sm_scan_share): how many there are, and
+ * the page the last of them to move on is on.  A new one joins them
+ * there.  Nothing keeps that page in the file until the new scan has
+ * locked it: the scan that is on it may hold no lock on it, or commit
+ * first, and another transaction free it.  So the new scan checks it
+ * once its own locks are in place (see scan_file_i::_init).
+ */
+struct scan_share_t {
+    int                 scans;
+    lpid_t              pos;
+    const scan_file_i*  owner;  // of pos
+
+    scan_share_t() : scans(0), owner(0) {}
+};
+typedef std::map<stid_t, scan_share_t> scan_share_map;
+static scan_share_map   scan_shares;
+static pthread_mutex_t  scan_share_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 scan_file_i::scan_file_i(
         const stid_t& stid_, const rid_t& start,
         concurrency_t cc, bool pre, 
@@ -674,7 +731,10 @@ scan_file_i::scan_file_i(
   _cc(cc), 
   _bIgnoreLatches(bIgnoreLatches),
   _do_prefetch(pre),
-  _prefetch(0)
+  _prefetch(0),
+  _share(0),
+  _share_wrapped(false),
+  _ring(cc == t_cc_append ? 0 : new_scan_ring())
 {
     INIT_SCAN_PROLOGUE_RC(scan_file_i::scan_file_i,
             cc == t_cc_append ? prologue_rc_t::read_write : prologue_rc_t::read_only,
@@ -699,7 +759,10 @@ scan_file_i::scan_file_i(const stid_t& stid_, concurrency_t cc,
   _cc(cc),
   _bIgnoreLatches(bIgnoreLatches),
   _do_prefetch(pre),
-  _prefetch(0)
+  _prefetch(0),
+  _share(0),
+  _share_wrapped(false),
+  _ring(cc == t_cc_append ? 0 : new_scan_ring())
 {
     INIT_SCAN_PROLOGUE_RC(scan_file_i::scan_file_i,
         cc == t_cc_append?prologue_rc_t::read_write:prologue_rc_t::read_only,  0);
@@ -720,13 +783,24 @@ scan_file_i::~scan_file_i()
     // consistency check
 #endif
     finish();
+    delete _ring;
 }
 
-
+void
+scan_file_i::use_ring(bool on)
+{
+    if(!on) {
+        delete _ring;
+        _ring = 0;
+    } else if(!_ring && _cc != t_cc_append) {
+        _ring = new_scan_ring();
+    }
+}
 
 
 rc_t scan_file_i::_init(bool for_append) 
 {
+    scan_ring_guard_t ring(_ring);
     // Can't nest these prologues
     // SCAN_METHOD_PROLOGUE(scan_file_i::_init, read_only, 1);
     this->_prefetch = 0;
@@ -817,6 +891,11 @@ rc_t scan_file_i::_init(bool for_append)
         }
         curr_rid.slot = 0;  // get the header object
 
+        if (!for_append && smlevel_0::do_scan_share) {
+            _share_first = curr_rid.pid;
+            _share_attach();
+        }
+
     } else {
         // subtract 1 slot from curr_rid so that next will advance
         // properly.  Also pin the previous slot it.
@@ -832,6 +911,22 @@ rc_t scan_file_i::_init(bool for_append)
         }
     }
 
+    // Our page or file lock now keeps the page we joined at in the
+    // file, if it still is: it may have been freed since the others
+    // were on it.  Then start at the first page after all.
+    if (_share && _share_start != _share_first
+        && !io->is_valid_page_of(_share_start, stid.store)) {
+        DBGTHRD(<<" page " << _share_start << " left the file");
+        curr_rid.pid = _share_start = _share_first;
+        if (_page_lock_mode != NL) {
+            _error_occurred = lm->lock(curr_rid.pid, _page_lock_mode, 
+                                      t_long, WAIT_SPECIFIED_BY_XCT);
+            if (_error_occurred.is_error())  {
+                return w_rc_t(_error_occurred);
+            }
+        }
+    }
+
     // remember the next pid
     _next_pid = curr_rid.pid;
     _error_occurred = fi->next_page(_next_pid, eof, NULL/*alloc only*/);
@@ -843,6 +938,9 @@ rc_t scan_file_i::_init(bool for_append)
     if (eof) {
         _next_pid = lpid_t::null;
     } 
+    if (_share) {
+        _share_next(_next_pid);
+    }
 
     if(smlevel_0::do_prefetch && this->_do_prefetch && !for_append) {
         // prefetch first page
@@ -863,6 +961,140 @@ rc_t scan_file_i::_init(bool for_append)
     return RCOK;
 }
 
+/*
+ * Fix the current page, which must have been requested of the
+ * prefetch thread, and request the page after it.
+ */
+rc_t
+scan_file_i::_fetch_prefetched(file_p& page)
+{
+    w_assert3(this->_prefetch);
+    DBGTHRD(<<" fetching page: " << curr_rid.pid);
+    W_DO(this->_prefetch->fetch(curr_rid.pid, page));
+
+    if(_next_pid != lpid_t::null) {
+        // Must lock before latch...
+        if (_page_lock_mode != NL) {
+            DBGTHRD(<<" locking " << _next_pid);
+            w_assert3(_next_pid.page != 0);
+            W_DO(lm->lock(_next_pid, _page_lock_mode,
+                          t_long, WAIT_SPECIFIED_BY_XCT));
+        }
+        DBGTHRD(<<" requesting next page: " << _next_pid);
+        W_COERCE(this->_prefetch->request(_next_pid, 
+                 pin_i::lock_to_latch(_page_lock_mode, _bIgnoreLatches)));
+    }
+    return RCOK;
+}
+
+/*
+ * The current page is exhausted: make the next page current,
+ * lock it if necessary and locate the page after it.
+ * Sets _eof if there is no next page.
+ */
+rc_t
+scan_file_i::_advance_page()
+{
+    curr_rid.pid = _next_pid;
+    curr_rid.slot = 0;
+    if (_next_pid == lpid_t::null) {
+        _eof = true;
+        return RCOK;
+    }
+
+    if(this->_prefetch == 0) {
+        if (_page_lock_mode != NL) {
+            DBGTHRD(<<" locking " << curr_rid.pid);
+            W_DO(lm->lock(curr_rid.pid, _page_lock_mode,
+                          t_long, WAIT_SPECIFIED_BY_XCT));
+        }
+    } else {
+        // prefetch case: we already locked & requested the next pid
+        // we'll fetch it when we get there.
+        // 
+        // All we have to do in this case is locate the
+        // page after that.
+    }
+
+    if (curr_rid.pid == _last_pid) {
+        // end of the page range of a scan_file_range_i
+        _next_pid = lpid_t::null;
+        return RCOK;
+    }
+
+    DBGTHRD(<<" locating page after " << _next_pid);
+    bool tmp_eof;
+    W_DO(fi->next_page(_next_pid, tmp_eof, NULL/*alloc only*/));
+    if (tmp_eof) {
+        _next_pid = lpid_t::null;
+    } 
+    if (_share) {
+        _share_next(_next_pid);
+    }
+    DBGTHRD(<<" next page is " << _next_pid);
+    return RCOK;
+}
+
+/*
+ * Join the other shared scans of the file, if any, at the page they
+ * are on, instead of at the first page.  A t_cc_none scan takes no
+ * locks to keep that page in the file, so it only lets others join it.
+ */
+void
+scan_file_i::_share_attach()
+{
+    CRITICAL_SECTION(cs, scan_share_mutex);
+    scan_share_t& s = scan_shares[stid];
+    if (_cc != t_cc_none && s.scans > 0 && s.pos != lpid_t::null) {
+        DBGTHRD(<<" joining the scans of " << stid << " at " << s.pos);
+        curr_rid.pid = s.pos;
+        INC_TSTAT(fscan_share_joined);
+    }
+    s.scans++;
+    _share = &s;
+    _share_start = curr_rid.pid;
+    _share_wrapped = false;
+}
+
+void
+scan_file_i::_share_detach()
+{
+    if (!_share) return;
+    CRITICAL_SECTION(cs, scan_share_mutex);
+    if (_share->owner == this) {
+        // no one is on it any more
+        _share->pos = lpid_t::null;
+        _share->owner = 0;
+    }
+    if (--_share->scans == 0) {
+        scan_shares.erase(stid);
+    }
+    _share = 0;
+}
+
+/*
+ * We are on curr_rid.pid, and next_pid comes after it in the file:
+ * tell the others where we are, and go on past the end of the file
+ * to the first page, until we get back to where we joined.
+ */
+void
+scan_file_i::_share_next(lpid_t& next_pid)
+{
+    {
+        CRITICAL_SECTION(cs, scan_share_mutex);
+        _share->pos = curr_rid.pid;
+        _share->owner = this;
+    }
+    if (next_pid == lpid_t::null && !_share_wrapped 
+        && _share_start != _share_first) {
+        _share_wrapped = true;
+        next_pid = _share_first;
+    }
+    if (_share_wrapped && next_pid == _share_start) {
+        next_pid = lpid_t::null;
+    }
+}
+
 rc_t
 scan_file_i::next(pin_i*& pin_ptr, smsize_t start, bool& eof)
 {
@@ -878,6 +1110,7 @@ rc_t
 scan_file_i::_next(pin_i*& pin_ptr, smsize_t start, bool& eof)
 {
     SCAN_METHOD_PROLOGUE1;
+    scan_ring_guard_t ring(_ring);
     file_p*        curr;
 
     w_assert1(xct()->tid() == tid); // (ip) ???
@@ -894,28 +1127,9 @@ scan_file_i::_next(pin_i*& pin_ptr, smsize_t start, bool& eof)
             temp_rid.slot = 0; 
             if(this->_prefetch) {
                 // It should have been prefetched
-                DBGTHRD(<<" fetching page: " << temp_rid.pid);
-                _error_occurred = this->_prefetch->fetch(temp_rid.pid, 
-                                _cursor._hdr_page());
-                if(!_error_occurred.is_error()) {
-                    if(_next_pid != lpid_t::null) {
-                        // Must lock before latch...
-                        if (_page_lock_mode != NL) {
-                            DBGTHRD(<<" locking " << _next_pid);
-                            w_assert3(_next_pid.page != 0);
-                            _error_occurred = lm->lock(_next_pid,
-                                              _page_lock_mode,
-                                              t_long,
-                                              WAIT_SPECIFIED_BY_XCT);
-                            if (_error_occurred.is_error())  {
-                                return w_rc_t(_error_occurred);
-                            }
-                        }
-                        DBGTHRD(<<" requesting next page: " << _next_pid);
-                        W_COERCE(this->_prefetch->request(_next_pid, 
-			         pin_i::lock_to_latch(_page_lock_mode,
-						      _bIgnoreLatches)));
-                    }
+                _error_occurred = _fetch_prefetched(_cursor._hdr_page());
+                if (_error_occurred.is_error())  {
+                    return w_rc_t(_error_occurred);
                 }
             } 
             _error_occurred = _cursor._pin(temp_rid, start,
@@ -938,7 +1152,12 @@ scan_file_i::_next(pin_i*& pin_ptr, smsize_t start, bool& eof)
             slotid_t        slot;
             // next_slot returns the slot we are wanting to lock,
             // but that's not what we're locking here:
-            slot = curr->next_slot(curr_rid.slot);
+            if(xct()->is_snapshot()) {
+                slot = version_store_t::next_slot(xct(), *curr, 
+                                                  curr_rid.slot);
+            } else {
+                slot = curr->next_slot(curr_rid.slot);
+            }
             curr_rid.slot = slot;
             if(_rec_lock_mode != NL) {
                 w_assert3(curr_rid.pid.page != 0);
@@ -974,39 +1193,9 @@ scan_file_i::_next(pin_i*& pin_ptr, smsize_t start, bool& eof)
             // consistency check
 #endif
             _cursor.unpin();
-            curr_rid.pid = _next_pid;
-            if (_next_pid == lpid_t::null) {
-                _eof = true;
-            } else {
-                if(this->_prefetch == 0) {
-                    if (_page_lock_mode != NL) {
-                        DBGTHRD(<<" locking " << curr_rid.pid);
-                        _error_occurred = lm->lock(curr_rid.pid, 
-                                                  _page_lock_mode,
-                                                  t_long,
-                                                  WAIT_SPECIFIED_BY_XCT);
-                        if (_error_occurred.is_error())  {
-                            return w_rc_t(_error_occurred);
-                        }
-                    }
-                } else {
-                    // prefetch case: we already locked & requested the next pid
-                    // we'll fetch it at the top of this loop
-                    // 
-                    // All we have to do in this case is locate the
-                    // page after that.
-                }
-
-                DBGTHRD(<<" locating page after " << _next_pid);
-                bool tmp_eof;
-                _error_occurred = fi->next_page(_next_pid, tmp_eof, NULL/*alloc only*/);
-                if (_error_occurred.is_error())  {
-                    return w_rc_t(_error_occurred);
-                }
-                if (tmp_eof) {
-                    _next_pid = lpid_t::null;
-                } 
-                DBGTHRD(<<" next page is " << _next_pid);
+            _error_occurred = _advance_page();
+            if (_error_occurred.is_error())  {
+                return w_rc_t(_error_occurred);
             }
 #if W_DEBUG_LEVEL > 1
         (void) _cursor.is_mine(); // Not an assert - just a 
@@ -1061,6 +1250,100 @@ scan_file_i::next_page(pin_i*& pin_ptr, smsize_t start, bool& eof)
     return _next(pin_ptr, start, eof);
 }
 
+rc_t
+scan_file_i::next_batch(record_batch& batch, bool& eof)
+{
+    SCAN_METHOD_PROLOGUE1;
+    SCAN_METHOD_PROLOGUE(scan_file_i::next_batch, read_only, 
+                         batch.max_pages());
+    scan_ring_guard_t ring(_ring);
+
+    w_assert1(xct()->tid() == tid);
+
+    batch.release();
+
+    if (_rec_lock_mode != NL) {
+        // we would have to lock records while holding page latches
+        return RC(eBADLOCKMODE);
+    }
+
+    latch_mode_t latch = pin_i::lock_to_latch(_rec_lock_mode, _bIgnoreLatches);
+
+    while (!_eof && batch._npages < batch._max_pages) {
+        file_p& page = batch._page(batch._npages);
+
+        if (_cursor.pinned()) {
+            // next() left off in the middle of this page; take over
+            // its fix and continue after the current slot
+            page = _cursor._hdr_page(); // refixes
+            _cursor.unpin();
+        } else if(this->_prefetch) {
+            _error_occurred = _fetch_prefetched(page);
+        } else {
+            rid_t temp_rid = curr_rid;
+            temp_rid.slot = 0; 
+            _error_occurred = fi->locate_page(temp_rid, page, latch);
+        }
+        if (_error_occurred.is_error())  {
+            return w_rc_t(_error_occurred);
+        }
+
+        int before = batch._count;
+        slotid_t slot = curr_rid.slot;
+        xct_t* xd = xct();
+        if (xd->is_snapshot()) {
+            while ((slot = version_store_t::next_slot(xd, page, slot)) != 0) {
+                rid_t rid(curr_rid.pid, slot);
+                record_t* rec;
+                if (version_store_t::lookup(xd, rid, &rec) == 
+                        version_store_t::vs_old) {
+                    batch._keep(rec);
+                } else {
+                    _error_occurred = page.get_rec(slot, rec);
+                    if (_error_occurred.is_error())  {
+                        return w_rc_t(_error_occurred);
+                    }
+                }
+                batch._append(rid, rec);
+            }
+        } else {
+            bool large = false;
+            while ((slot = page.next_slot(slot)) != 0) {
+                record_t* rec;
+                _error_occurred = page.get_rec(slot, rec);
+                if (_error_occurred.is_error())  {
+                    return w_rc_t(_error_occurred);
+                }
+                large = large || rec->is_large();
+                batch._append(rid_t(curr_rid.pid, slot), rec);
+            }
+            _error_occurred = xd->occ_read(lockid_t(curr_rid.pid), page, 
+                                           large);
+            if (_error_occurred.is_error())  {
+                return w_rc_t(_error_occurred);
+            }
+        }
+
+        if (batch._count == before) {
+            // nothing on this page; don't hang onto it
+            page.unfix();
+        } else {
+            batch._npages++;
+        }
+
+        _error_occurred = _advance_page();
+        if (_error_occurred.is_error())  {
+            return w_rc_t(_error_occurred);
+        }
+    }
+
+    INC_TSTAT(rec_batch_cnt);
+    ADD_TSTAT(rec_batch_rec_cnt, batch._count);
+
+    eof = _eof && batch._count == 0;
+    return RCOK;
+}
+
 void scan_file_i::finish()
 {
     // must finish regardless of error
@@ -1084,6 +1367,319 @@ void scan_file_i::finish()
         delete this->_prefetch;
         this->_prefetch = 0;
     }
+    _share_detach();
+}
+
+record_batch::record_batch(int max_pages)
+: _max_pages(max_pages > 0 ? max_pages : 1),
+  _npages(0),
+  _count(0),
+  _capacity(0),
+  _entries(0),
+  _ncopies(0),
+  _copies_capacity(0),
+  _copies(0),
+  _page_alias(0)
+{
+    _page_alias = new char[_max_pages * PAGE_ALIAS_FILE];
+    if(!_page_alias) W_FATAL(eOUTOFMEMORY);
+    for(int i = 0; i < _max_pages; i++) {
+        w_assert3(PAGE_ALIAS_FILE >= sizeof(file_p) + __alignof__(file_p));
+        new (&_page(i)) file_p();
+    }
+}
+
+record_batch::~record_batch()
+{
+    release();
+    for(int i = 0; i < _max_pages; i++) {
+        _page(i).destructor();
+    }
+    delete[] _page_alias;
+    delete[] _entries;
+    delete[] _copies;
+}
+
+file_p&
+record_batch::_page(int i) const
+{
+    w_assert3(i >= 0 && i < _max_pages);
+    return *aligned_cast<file_p>(_page_alias + i * PAGE_ALIAS_FILE);
+}
+
+void
+record_batch::release()
+{
+    for(int i = 0; i < _npages; i++) {
+        _page(i).unfix();
+    }
+    for(int i = 0; i < _ncopies; i++) {
+        delete[] (char*) _copies[i];
+    }
+    _npages = 0;
+    _count = 0;
+    _ncopies = 0;
+}
+
+void
+record_batch::_keep(record_t* copy)
+{
+    if(_ncopies == _copies_capacity) {
+        int cap = _copies_capacity ? 2 * _copies_capacity : 16;
+        record_t** copies = new record_t*[cap];
+        if(!copies) W_FATAL(eOUTOFMEMORY);
+        for(int i = 0; i < _ncopies; i++) copies[i] = _copies[i];
+        delete[] _copies;
+        _copies = copies;
+        _copies_capacity = cap;
+    }
+    _copies[_ncopies++] = copy;
+}
+
+void
+record_batch::_append(const rid_t& rid, const record_t* rec)
+{
+    if(_count == _capacity) {
+        // grow; the entries are reused from batch to batch so
+        // this settles down quickly
+        int cap = _capacity ? 2 * _capacity : 64 * _max_pages;
+        entry_t* entries = new entry_t[cap];
+        if(!entries) W_FATAL(eOUTOFMEMORY);
+        for(int i = 0; i < _count; i++) entries[i] = _entries[i];
+        delete[] _entries;
+        _entries = entries;
+        _capacity = cap;
+    }
+    entry_t& e = _entries[_count++];
+    e.rid = rid;
+    e.hdr = rec->hdr();
+    e.hdr_size = rec->hdr_size();
+    e.body = rec->is_small() ? rec->body() : 0;
+    e.body_size = rec->body_size();
+}
+
+scan_file_range_i::scan_file_range_i(
+        const stid_t& stid_, const scan_morsel_t& morsel,
+        concurrency_t cc, bool pre, const bool bIgnoreLatches)
+: scan_file_i(stid_, rid_t(morsel.first_pid, 0), cc, pre, SH, bIgnoreLatches)
+{
+    w_assert1(morsel.first_pid.stid() == stid_);
+    _last_pid = morsel.last_pid;
+    // _init located the page after the first without knowing
+    // where we stop
+    if (curr_rid.pid == _last_pid) {
+        _next_pid = lpid_t::null;
+    }
+}
+
+/*
+ * A worker of a parallel_scan_file_i.  It runs on behalf of the
+ * transaction of the thread that called run().
+ */
+class scan_file_worker_t : public smthread_t {
+public:
+    NORET            scan_file_worker_t(parallel_scan_file_i* owner,
+                                        int id, xct_t* x)
+                     : smthread_t(t_regular, "scan_file_worker"),
+                       _owner(owner), _id(id), _xct(x) {}
+    NORET            ~scan_file_worker_t() {}
+
+    virtual void     run();
+    rc_t             rc() { return _rc; }
+
+private:
+    parallel_scan_file_i*   _owner;
+    int                     _id;
+    xct_t*                  _xct;
+    rc_t                    _rc;
+};
+
+void
+scan_file_worker_t::run()
+{
+    attach_xct(_xct);
+    _rc = _owner->_work(_id);
+    if(_rc.is_error()) {
+        _owner->_fail();
+    }
+    detach_xct(_xct);
+}
+
+parallel_scan_file_i::parallel_scan_file_i(
+        const stid_t& stid_, int num_workers, concurrency_t cc,
+        int morsel_exts, const bool bIgnoreLatches)
+: _stid(stid_),
+  _num_workers(num_workers > 0 ? num_workers : 1),
+  _cc(cc),
+  _morsel_exts(morsel_exts > 0 ? morsel_exts : 1),
+  _bIgnoreLatches(bIgnoreLatches),
+  _visitor(0),
+  _morsels(0),
+  _num_morsels(0),
+  _max_morsels(0),
+  _next_morsel(0),
+  _stop(false)
+{
+}
+
+parallel_scan_file_i::~parallel_scan_file_i()
+{
+    delete[] _morsels;
+}
+
+rc_t
+parallel_scan_file_i::run(scan_file_visitor_t& visitor)
+{
+    SM_PROLOGUE_RC(parallel_scan_file_i::run, in_xct, read_only, 0);
+
+    lock_mode_t mode = IS;
+    switch(_cc) {
+    case t_cc_none:
+    case t_cc_record:
+    case t_cc_page:
+        break;
+    case t_cc_file:
+        mode = SH;
+        break;
+    default:
+        return RC(eBADLOCKMODE);
+    }
+
+    // Lock the file before looking at its extents.  The workers'
+    // scans will find the lock already granted to the xct.
+    sdesc_t* sd = 0;
+    W_DO(dir->access(_stid, sd, mode));
+    W_DO(_cut_morsels());
+    _next_morsel = 0;
+    _stop = false;
+    _visitor = &visitor;
+
+    scan_file_worker_t** workers = new scan_file_worker_t*[_num_workers];
+    if(!workers) W_FATAL(eOUTOFMEMORY);
+    w_auto_delete_array_t<scan_file_worker_t*> auto_del(workers);
+
+    rc_t rc;
+    int forked = 0;
+    for(int i = 0; i < _num_workers; i++) {
+        workers[i] = new scan_file_worker_t(this, i, xct());
+        if(!workers[i]) W_FATAL(eOUTOFMEMORY);
+        rc = workers[i]->fork();
+        if(rc.is_error()) {
+            delete workers[i];
+            _fail();
+            break;
+        }
+        forked++;
+    }
+    for(int i = 0; i < forked; i++) {
+        W_COERCE(workers[i]->join());
+        rc_t wrc = workers[i]->rc();
+        // let the first error found prevail
+        if(wrc.is_error() && !rc.is_error()) {
+            rc = wrc;
+        }
+        delete workers[i];
+    }
+    _visitor = 0;
+    return rc;
+}
+
+void
+parallel_scan_file_i::_fail()
+{
+    CRITICAL_SECTION(cs, _morsel_lock);
+    _stop = true;
+}
+
+/*
+ * Cut the extent list of the file into morsels of _morsel_exts
+ * extents.  Extents without allocated pages are skipped, so a
+ * morsel always has at least one page.
+ */
+rc_t
+parallel_scan_file_i::_cut_morsels()
+{
+    _num_morsels = 0;
+    extnum_t ext;
+    W_DO(io->first_ext(_stid, ext));
+    while(ext != 0) {
+        lpid_t first = lpid_t::null;
+        lpid_t last;
+        for(int i = 0; i < _morsel_exts && ext != 0; i++) {
+            lpid_t f, l;
+            rc_t rc = io->page_range_in_ext(_stid, ext, f, l);
+            if(rc.is_error()) {
+                if(rc.err_num() != eEOF) return rc;
+            } else {
+                if(first == lpid_t::null) {
+                    first = f;
+                }
+                last = l;
+            }
+            W_DO(io->next_ext(_stid, ext, ext));
+        }
+        if(first != lpid_t::null) {
+            _add_morsel(first, last);
+        }
+    }
+    ADD_TSTAT(fscan_morsel_cnt, _num_morsels);
+    return RCOK;
+}
+
+void
+parallel_scan_file_i::_add_morsel(const lpid_t& first, const lpid_t& last)
+{
+    if(_num_morsels == _max_morsels) {
+        int n = _max_morsels ? 2 * _max_morsels : 16;
+        scan_morsel_t* m = new scan_morsel_t[n];
+        if(!m) W_FATAL(eOUTOFMEMORY);
+        for(int i = 0; i < _num_morsels; i++) m[i] = _morsels[i];
+        delete[] _morsels;
+        _morsels = m;
+        _max_morsels = n;
+    }
+    _morsels[_num_morsels].first_pid = first;
+    _morsels[_num_morsels].last_pid = last;
+    _num_morsels++;
+}
+
+/*
+ * Hand out the next morsel.  Returns false when there are none
+ * left or a worker has failed.
+ */
+bool
+parallel_scan_file_i::_claim(scan_morsel_t& morsel)
+{
+    CRITICAL_SECTION(cs, _morsel_lock);
+    if(_stop || _next_morsel == _num_morsels) {
+        return false;
+    }
+    morsel = _morsels[_next_morsel++];
+    return true;
+}
+
+rc_t
+parallel_scan_file_i::_work(int worker)
+{
+    record_batch batch;
+    while(true) {
+        scan_morsel_t morsel;
+        if(!_claim(morsel)) break;
+
+        bool eof;
+        scan_file_range_i scan(_stid, morsel, _cc, false, _bIgnoreLatches);
+        if(scan.error_code().is_error()) {
+            return RC(scan.error_code().err_num());
+        }
+        do {
+            W_DO(scan.next_batch(batch, eof));
+            if(!eof) {
+                W_DO(_visitor->visit(worker, batch));
+            }
+        } while(!eof);
+        batch.release();
+    }
+    return RCOK;
 }
 
 /*********************************************************************
@@ -157,6 +157,8 @@ class bt_cursor_t;
  * \endcode
  *
  */
+class bf_ring_t;
+
 class scan_index_i : public smlevel_top, public xct_dependent_t {
 public:
     /**\brief Construct an iterator.
@@ -263,6 +265,16 @@ t_cc_file  | error     | error       | error     | error     | SH/none
     /// Free the resources used by this iterator. Called by desctructor if
     /// necessary.
     void             finish();
+
+    /**\brief Confine the pages this scan reads to a ring of frames.
+     * \details
+     * Once it has read -sm_scan_ring_threshold pages into the buffer
+     * pool, a scan with a ring reuses a ring of -sm_scan_ring frames
+     * for the rest, so that it does not displace the pages others
+     * use.  Scans have one unless -sm_scan_ring is 0; pass false for
+     * a scan whose pages should stay in the pool.
+     */
+    void             use_ring(bool on);
     
     /// If false, curr() may be called.
     bool             eof()    { return _eof; }
@@ -286,6 +298,7 @@ private:
     concurrency_t        _cc;
     lock_mode_t          _mode;
     bool                 _bIgnoreLatches;
+    bf_ring_t*           _ring;
 
     rc_t            _fetch(
         vec_t*                key, 
@@ -404,6 +417,95 @@ private:
 };
 
 class bf_prefetch_thread_t;
+class file_p;
+class record_t;
+
+/**\brief A batch of records handed out by scan_file_i::next_batch.
+ * \ingroup SSMSCANF
+ * \details
+ * A record_batch keeps up to max_pages() file pages fixed in the
+ * buffer pool and holds one entry for every record found on them.
+ * The header and body pointers in an entry point directly into the
+ * fixed frames; they remain valid until the batch is released,
+ * refilled by the next call to next_batch, or destroyed.
+ *
+ * Only the header of a large record lives on the slotted page, so for
+ * such records body is NULL and body_size is the length of the whole
+ * record.  Use a pin_i on the entry's rid to get at the data.
+ *
+ * The rules for pin_i apply here as well: the pages are latched, so
+ * do not hold a batch while the thread blocks, and never hand a batch
+ * to another thread.
+ *
+ * \code
+ * scan_file_i   scan(fid, ss_m::t_cc_file);
+ * record_batch  batch(4);
+ * bool          eof(false);
+ * do {
+ *    W_DO(scan.next_batch(batch, eof));
+ *    for(int i = 0; i < batch.count(); i++) {
+ *        const record_batch::entry_t &e = batch[i];
+ *        // handle e.hdr, e.body
+ *        ...
+ *    }
+ * } while (!eof);
+ * \endcode
+ */
+class record_batch : public smlevel_top {
+    friend class scan_file_i;
+public:
+    /// One record of the batch.
+    struct entry_t {
+        rid_t          rid;
+        const char*    hdr;
+        const char*    body;  // NULL for large records
+        smsize_t       hdr_size;
+        smsize_t       body_size;
+    };
+
+    /**\brief Construct an empty batch.
+     * @param[in] max_pages  Maximum number of pages a single call to
+     *                       scan_file_i::next_batch will keep fixed.
+     */
+    NORET            record_batch(int max_pages = 1);
+    NORET            ~record_batch();
+
+    /// Number of records in the batch.
+    int              count() const { return _count; }
+    /// Number of pages currently fixed by the batch.
+    int              pages() const { return _npages; }
+    /// Maximum number of pages the batch will hold.
+    int              max_pages() const { return _max_pages; }
+
+    const entry_t&   operator[](int i) const {
+                        w_assert1(i >= 0 && i < _count);
+                        return _entries[i];
+                     }
+
+    /// Unfix all pages and empty the batch.
+    void             release();
+
+private:
+    int              _max_pages;
+    int              _npages;
+    int              _count;
+    int              _capacity;
+    entry_t*         _entries;
+    // old versions read by a snapshot transaction; freed by release()
+    int              _ncopies;
+    int              _copies_capacity;
+    record_t**       _copies;
+    /* see comments in pin.h for the reason for the aliases */
+    char*            _page_alias;
+
+    file_p&          _page(int i) const;
+    void             _append(const rid_t& rid, const record_t* rec);
+    void             _keep(record_t* copy);
+
+    // disabled
+    NORET            record_batch(const record_batch&);
+    record_batch&    operator=(const record_batch&);
+};
 
 
 /** \brief Iterator over a file of records. 
@@ -437,6 +539,8 @@ class bf_prefetch_thread_t;
  * } while (1);
  * \endcode
  */
+struct scan_share_t;
+
 class scan_file_i : public smlevel_top, public xct_dependent_t {
 public:
     stid_t                stid;
@@ -487,6 +591,15 @@ public:
      * with phantoms if another transaction is altering the file while
      * this scan is going on.  Thus, if you try to use record-level
      * locking, you will get page-level locking instead.
+     *
+     * With the server option sm_scan_share, a scan constructed while
+     * others of the same file are under way joins them: it starts
+     * at the page they are on, goes on to the end of the file with
+     * them, finding their pages in the buffer pool, then wraps around
+     * to the first page and ends where it started.  It returns every
+     * record once, but not in the order of the file.  A t_cc_none
+     * scan has no locks to keep their page in the file, so it starts
+     * at the first page, though others may join it.
      */
     NORET            scan_file_i(
         const stid_t&            stid,
@@ -543,10 +656,31 @@ public:
         smsize_t               start_offset, 
         bool&                  eof);
 
+    /**\brief Return all remaining records on the next page(s) of the file.
+     *
+     * @param[in,out] batch  Released, then refilled with the records
+     * of up to batch.max_pages() pages, which stay fixed until the
+     * batch is released or refilled.
+     * @param[out] eof  True if no records were returned because the end
+     * of the file was reached.
+     *
+     * If next() was called before, the batch begins with the record
+     * after the one the cursor points to, and the cursor is unpinned.
+     * Record-level locks are never acquired here, so this cannot be
+     * used with t_cc_append.
+     */
+    rc_t            next_batch(
+        record_batch&          batch,
+        bool&                  eof);
+
     /**\brief Free resources acquired by this iterator. Useful if
      * you are finished with the scan but not ready to delete it.
      */
     void            finish();
+    /**\brief Confine the pages this scan reads to a ring of frames.
+     * \details See scan_index_i::use_ring.  Append scans have none.
+     */
+    void            use_ring(bool on);
     /**\brief End of file was reached. Cursor is not usable.*/
     bool            eof()        { return _eof; }
     /**\brief Error code returned from last method call. */
@@ -567,7 +701,15 @@ protected:
     bool             _bIgnoreLatches;
 
 
+    lpid_t           _last_pid; // last page of a range scan
+
     rc_t             _init(bool for_append=false);
+    void             _share_attach();
+    void             _share_detach();
+    void             _share_next(lpid_t& next_pid);
+
+    rc_t             _fetch_prefetched(file_p& page);
+    rc_t             _advance_page();
 
     rc_t            _next(
         pin_i*&                pin_ptr,
@@ -582,11 +724,164 @@ private:
     bool              _do_prefetch;
     bf_prefetch_thread_t*    _prefetch;
 
+    // sm_scan_share: NULL if this scan does not share
+    scan_share_t*     _share;
+    lpid_t            _share_first;   // first page of the file
+    lpid_t            _share_start;   // the page this scan joined at
+    bool              _share_wrapped; // past the end of the file
+    bf_ring_t*        _ring;
+
     // disabled
     NORET            scan_file_i(const scan_file_i&);
     scan_file_i&        operator=(const scan_file_i&);
 };
 
+/**\brief A contiguous piece of a file's extent list.
+ * \ingroup SSMSCANF
+ * \details
+ * Handed out by parallel_scan_file_i to its workers and scanned
+ * with a scan_file_range_i.  The pages are those of the file from
+ * first_pid through last_pid, in the order of the extent list.
+ */
+struct scan_morsel_t {
+    lpid_t            first_pid;
+    lpid_t            last_pid;
+};
+
+/**\brief Iterator over a range of pages of a file.
+ * \ingroup SSMSCANF
+ * \details
+ * Behaves just like scan_file_i, with the same concurrency control
+ * options, but reaches eof after the last page of the given morsel
+ * rather than at the end of the file.
+ */
+class scan_file_range_i : public scan_file_i {
+public:
+    /**\brief Construct an iterator over part of the given file.
+     *
+     * @param[in] stid  ID of the file over which to iterate.
+     * @param[in] morsel  The pages of interest.
+     * @param[in] cc   Locking granularity to be used.  See scan_file_i.
+     * @param[in] prefetch   See scan_file_i.
+     */
+    NORET            scan_file_range_i(
+        const stid_t&            stid,
+        const scan_morsel_t&     morsel,
+        concurrency_t            cc = t_cc_file,
+        bool                     prefetch=false,
+        const bool               bIgnoreLatches = false);
+
+    NORET            ~scan_file_range_i() {}
+
+private:
+    // disabled
+    NORET            scan_file_range_i(const scan_file_range_i&);
+    scan_file_range_i&    operator=(const scan_file_range_i&);
+};
+
+/**\brief Callback used by parallel_scan_file_i.
+ * \ingroup SSMSCANF
+ * \details
+ * Derive your per-record processing from this.  visit() is called
+ * concurrently by all the workers of the scan; \a worker tells which
+ * one is calling, so per-worker state can be kept without
+ * synchronization.  Returning an error stops the scan.
+ */
+class scan_file_visitor_t {
+public:
+    virtual NORET    ~scan_file_visitor_t() {}
+    virtual rc_t     visit(int worker, const record_batch& batch) = 0;
+};
+
+class scan_file_worker_t;
+
+/**\brief Scan a file with several threads.
+ * \ingroup SSMSCANF
+ * \details
+ * run() cuts the extent list of the file into morsels of a few
+ * extents each, then forks a number of worker threads, attaches them
+ * to the caller's transaction, and lets them claim morsels one at a
+ * time until the whole file has been handed out.  The morsels are
+ * cut up front so that the workers need not read the extent map,
+ * whose pages are latched exclusively, while they compete for work.  Each worker scans
+ * its morsels with a scan_file_range_i, with the given concurrency
+ * control, and passes the records to the visitor one page at a time.
+ *
+ * Records are visited in no particular order.  As with scan_file_i,
+ * do not update the file in the same transaction while it is being
+ * scanned.
+ *
+ * \code
+ * class counter_t : public scan_file_visitor_t {
+ * public:
+ *     int count[4];
+ *     rc_t visit(int worker, const record_batch& batch) {
+ *         count[worker] += batch.count();
+ *         return RCOK;
+ *     }
+ * } counter;
+ * parallel_scan_file_i scan(fid, 4);
+ * W_DO(scan.run(counter));
+ * \endcode
+ */
+class parallel_scan_file_i : public smlevel_top {
+    friend class scan_file_worker_t;
+public:
+    /**\brief Construct a parallel scan of the given store (file).
+     *
+     * @param[in] stid  ID of the file over which to iterate.
+     * @param[in] num_workers  Number of threads to scan with.
+     * @param[in] cc   Locking granularity to be used by each worker;
+     *                 see scan_file_i.  t_cc_append is not permitted.
+     * @param[in] morsel_exts  Number of extents per morsel.
+     */
+    NORET            parallel_scan_file_i(
+        const stid_t&            stid,
+        int                      num_workers,
+        concurrency_t            cc = t_cc_file,
+        int                      morsel_exts = 8,
+        const bool               bIgnoreLatches = false);
+
+    NORET            ~parallel_scan_file_i();
+
+    /**\brief Scan the whole file, handing every record to \a visitor.
+     * \details
+     * Must be called by a thread attached to a transaction.  Returns
+     * when all workers are done, with the first error any of them ran
+     * into.
+     */
+    rc_t             run(scan_file_visitor_t& visitor);
+
+    int              num_workers() const { return _num_workers; }
+    /// Number of morsels the last run() cut the file into.
+    int              num_morsels() const { return _num_morsels; }
+
+private:
+    stid_t                  _stid;
+    int                     _num_workers;
+    concurrency_t           _cc;
+    int                     _morsel_exts;
+    bool                    _bIgnoreLatches;
+
+    scan_file_visitor_t*    _visitor;
+    scan_morsel_t*          _morsels;
+    int                     _num_morsels;
+    int                     _max_morsels;
+    queue_based_block_lock_t _morsel_lock; // protects the following
+    int                     _next_morsel;
+    bool                    _stop;         // a worker failed
+
+    rc_t             _cut_morsels();
+    void             _add_morsel(const lpid_t& first, const lpid_t& last);
+    bool             _claim(scan_morsel_t& morsel);
+    rc_t             _work(int worker);
+    void             _fail();
+
+    // disabled
+    NORET            parallel_scan_file_i(const parallel_scan_file_i&);
+    parallel_scan_file_i&    operator=(const parallel_scan_file_i&);
+};
+
 #include <cstring>
 #ifndef SDESC_H
 #include "sdesc.h"
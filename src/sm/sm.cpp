@@ -78,6 +78,10 @@ class prologue_rc_t;
 #include "crash.h"
 #include "restart.h"
 #include "histo.h"        /* just for dump */
+#include "btree_hash_index.h"
+#include "vstore.h"
+#include "log_archiver.h"
+#include "backup.h"
 
 #include "app_support.h"
 
@@ -100,6 +104,13 @@ smlevel_0::operating_mode_t
             //controlled by AutoTurnOffLogging:
 bool        smlevel_0::logging_enabled = true;
 bool        smlevel_0::do_prefetch = false;
+bool        smlevel_0::do_scan_share = false;
+int         smlevel_0::scan_ring_frames = 0;
+int         smlevel_0::scan_ring_threshold = 0;
+bool        smlevel_0::do_cache_prefetch = true;
+bool        smlevel_0::do_log_compact = false;
+bool        smlevel_0::do_log_flush_pipeline = true;
+bool        smlevel_0::do_log_summary = true;
 
 #ifndef SM_LOG_WARN_EXCEED_PERCENT
 #define SM_LOG_WARN_EXCEED_PERCENT 40
@@ -214,6 +225,7 @@ ErrLog*            smlevel_0::errlog;
 char smlevel_0::zero_page[page_sz];
 
 chkpt_m* smlevel_1::chkpt = 0;
+log_archiver_t* smlevel_1::archiver = 0;
 
 btree_m* smlevel_2::bt = 0;
 file_m* smlevel_2::fi = 0;
@@ -240,9 +252,18 @@ option_group_t* ss_m::_options = NULL;
 option_t* ss_m::_hugetlbfs_path = NULL;
 option_t* ss_m::_reformat_log = NULL;
 option_t* ss_m::_prefetch = NULL;
+option_t* ss_m::_scan_share = NULL;
+option_t* ss_m::_scan_ring = NULL;
+option_t* ss_m::_scan_ring_threshold = NULL;
+option_t* ss_m::_cache_prefetch = NULL;
+option_t* ss_m::_log_compact = NULL;
+option_t* ss_m::_log_flush_pipeline = NULL;
+option_t* ss_m::_log_tail = NULL;
+option_t* ss_m::_log_summary = NULL;
 option_t* ss_m::_bufpoolsize = NULL;
 option_t* ss_m::_locktablesize = NULL;
 option_t* ss_m::_logdir = NULL;
+option_t* ss_m::_archdir = NULL;
 option_t* smlevel_0::_backgroundflush = NULL;
 option_t* ss_m::_logsize = NULL;
 option_t* ss_m::_logbufsize = NULL;
@@ -353,6 +374,39 @@ rc_t ss_m::setup_options(option_group_t* options)
             "no disables page prefetching on scans",
             false, option_t::set_value_bool, _prefetch));
 
+    W_DO(options->add_option("sm_scan_share", "yes/no", "no",
+            "yes lets a file scan join the scans of the same file under way",
+            false, option_t::set_value_bool, _scan_share));
+
+    W_DO(options->add_option("sm_scan_ring", ">=0", "32",
+            "frames a large scan reuses for its pages; 0 lets it use any",
+            false, option_t::set_value_long, _scan_ring));
+
+    W_DO(options->add_option("sm_scan_ring_threshold", ">=0", "0",
+            "pages a scan reads before it keeps to its ring; "
+            "0 means a quarter of the buffer pool",
+            false, option_t::set_value_long, _scan_ring_threshold));
+
+    W_DO(options->add_option("sm_cache_prefetch", "yes/no", "yes",
+            "no disables CPU cache prefetches of buffer pool lookups",
+            false, option_t::set_value_bool, _cache_prefetch));
+
+    W_DO(options->add_option("sm_log_compact", "yes/no", "no",
+            "yes writes page and B+-Tree updates with compact log headers",
+            false, option_t::set_value_bool, _log_compact));
+
+    W_DO(options->add_option("sm_log_flush_pipeline", "yes/no", "yes",
+            "yes lets the log flush daemon write while a log fsync is in flight",
+            false, option_t::set_value_bool, _log_flush_pipeline));
+
+    W_DO(options->add_option("sm_log_tail", "file name", NULL,
+            "file (on persistent memory) to map the log buffer onto; commits are durable once there",
+            false, option_t::set_value_charstr, _log_tail));
+
+    W_DO(options->add_option("sm_log_summary", "yes/no", "yes",
+            "yes closes each log partition with a summary that lets restart skip reading it",
+            false, option_t::set_value_bool, _log_summary));
+
     W_DO(options->add_option("sm_bufpoolsize", "#>=8192", NULL,
             "size of buffer pool in Kbytes",
             true, option_t::set_value_long, _bufpoolsize));
@@ -372,6 +426,10 @@ rc_t ss_m::setup_options(option_group_t* options)
             "directory for log files",
             true, option_t::set_value_charstr, _logdir));
 
+    W_DO(options->add_option("sm_archdir", "directory name", NULL,
+            "directory for the log archive; not set means no log archive",
+            false, option_t::set_value_charstr, _archdir));
+
     W_DO(options->add_option("sm_backgroundflush", "yes/no", "yes",
             "yes indicates background buffer pool flushing thread is enabled",
             false, option_t::set_value_bool, _backgroundflush));
@@ -818,11 +876,19 @@ ss_m::_construct_once(
             "WARNING: Log buffer is bigger than 1/8 partition (probably safe to make it smaller)."
                    << flushl;
         }
+        do_log_flush_pipeline = 
+            option_t::str_to_bool(_log_flush_pipeline->value(), badVal);
+        w_assert3(!badVal);
+        do_log_summary = 
+            option_t::str_to_bool(_log_summary->value(), badVal);
+        w_assert3(!badVal);
+
         rc_t    e;
         e = log_m::new_log_m(log, 
                      _logdir->value(), 
                      logbufsize, 
-                     reformat_log);
+                     reformat_log,
+                     _log_tail->is_set() ? _log_tail->value() : 0);
         W_COERCE(e);
 
         int percent=0;
@@ -1013,9 +1079,40 @@ ss_m::_construct_once(
 
     chkpt->spawn_chkpt_thread();
 
+    if(log && _archdir->is_set()) {
+        archiver = new log_archiver_t(_archdir->value());
+        if (! archiver)
+            W_FATAL(eOUTOFMEMORY);
+        W_COERCE(archiver->open());
+        W_COERCE(archiver->fork());
+    }
+
     do_prefetch = 
         option_t::str_to_bool(_prefetch->value(), badVal);
     w_assert3(!badVal);
+
+    do_scan_share = 
+        option_t::str_to_bool(_scan_share->value(), badVal);
+    w_assert3(!badVal);
+
+    // a ring bigger than a quarter of the pool would not spare it much
+    scan_ring_frames = strtol(_scan_ring->value(), NULL, 0);
+    if(scan_ring_frames > bf_m::npages()/4) {
+        scan_ring_frames = bf_m::npages()/4;
+    }
+    if(scan_ring_frames < 0) scan_ring_frames = 0;
+    scan_ring_threshold = strtol(_scan_ring_threshold->value(), NULL, 0);
+    if(scan_ring_threshold <= 0) {
+        scan_ring_threshold = bf_m::npages()/4;
+    }
+
+    do_cache_prefetch = 
+        option_t::str_to_bool(_cache_prefetch->value(), badVal);
+    w_assert3(!badVal);
+
+    do_log_compact = 
+        option_t::str_to_bool(_log_compact->value(), badVal);
+    w_assert3(!badVal);
     DBG(<<"constructor done");
 }
 
@@ -1138,6 +1235,8 @@ ss_m::_destruct_once()
     delete rt; rt = 0; // rtree manager
     delete fi; fi = 0; // file manager : log is still running
     delete bt; bt = 0; // btree manager
+    btree_hash.shutdown(); // adaptive hash index over btrees
+    version_store_t::shutdown(); // old record versions
 
     /*
      *  Level 1
@@ -1149,6 +1248,12 @@ ss_m::_destruct_once()
 
     delete bf; bf = 0; // buffer manager
 
+    if(archiver) {
+        archiver->retire();
+        W_COERCE(archiver->join());
+        delete archiver; archiver = 0;
+    }
+
     if(log) {
         log->shutdown(); // log joins any subsidiary threads
         // We do not delete the log now; shutdown takes care of that. delete log;
@@ -1219,6 +1324,33 @@ ss_m::begin_xct(tid_t& tid, timeout_in_ms timeout)
     return RCOK;
 }
 
+rc_t
+ss_m::begin_xct(xct_cc_t cc, timeout_in_ms timeout)
+{
+    SM_PROLOGUE_RC(ss_m::begin_xct, not_in_xct, read_only, 0);
+    tid_t tid;
+    W_DO(_begin_xct(0, tid, timeout));
+    if(cc == t_xct_optimistic) xct()->begin_optimistic();
+    return RCOK;
+}
+
+/*--------------------------------------------------------------*
+ *  ss_m::begin_snapshot_xct()                                  *
+ *--------------------------------------------------------------*/
+rc_t
+ss_m::begin_snapshot_xct(timeout_in_ms timeout)
+{
+    SM_PROLOGUE_RC(ss_m::begin_snapshot_xct, not_in_xct, read_only, 0);
+    tid_t tid;
+    W_DO(_begin_xct(0, tid, timeout));
+    rc_t rc = version_store_t::begin_snapshot(xct());
+    if(rc.is_error()) {
+        sm_stats_info_t* stats = 0;
+        W_COERCE(_abort_xct(stats));
+    }
+    return rc;
+}
+
 /*--------------------------------------------------------------*
  *  ss_m::commit_xct()                                *
  *--------------------------------------------------------------*/
@@ -3539,6 +3671,71 @@ ss_m::log_file_was_archived(const char * logfile)
     return RCOK;
 }
 
+rc_t
+ss_m::restore_page(const lpid_t& pid, int& applied)
+{
+    SM_PROLOGUE_RC(ss_m::restore_page, in_xct, read_write, 0);
+    if(!archiver) return RC(eNOARCHIVE);
+
+    // the page image is out of date: don't log what we redo to it
+    xct_log_switch_t toggle(OFF);
+    page_p page;
+    store_flag_t store_flags = st_bad;
+    W_DO(page.fix(pid, page_p::t_any_p, LATCH_EX, 0, store_flags, true));
+    return archiver->restore_page(page, applied);
+}
+
+rc_t
+ss_m::restore_volume(const vid_t& vid, int& applied)
+{
+    SM_PROLOGUE_RC(ss_m::restore_volume, in_xct, read_write, 0);
+    if(!archiver) return RC(eNOARCHIVE);
+
+    xct_log_switch_t toggle(OFF);
+    return archiver->restore_volume(vid, applied);
+}
+
+rc_t
+ss_m::backup_volume(const vid_t& vid, const char* dest, int mb_per_sec)
+{
+    SM_PROLOGUE_RC(ss_m::backup_volume, not_in_xct, read_only, 0);
+    backup_info_t info;
+    return backup_m::backup_volume(vid, dest, mb_per_sec, info);
+}
+
+rc_t
+ss_m::restore_backup(const char* backup, const char* device, int& applied)
+{
+    SM_PROLOGUE_RC(ss_m::restore_backup, not_in_xct, read_only, 0);
+    backup_info_t info;
+    W_DO(backup_m::read_info(backup, info));
+    if(io->get_vid(info.lvid) != vid_t::null) return RC(eALREADYMOUNTED);
+
+    W_DO(backup_m::copy_back(backup, device));
+    {
+        CRITICAL_SECTION(cs, SM_VOL_WLOCK(_begin_xct_mutex));
+        u_int vol_cnt;
+        // under the vid the log records have
+        W_DO(_mount_dev(device, vol_cnt, info.vid));
+    }
+
+    tid_t tid;
+    W_DO(_begin_xct(0, tid, WAIT_SPECIFIED_BY_THREAD));
+    rc_t rc;
+    {
+        xct_log_switch_t toggle(OFF);
+        rc = backup_m::redo(info, applied);
+    }
+    sm_stats_info_t* stats = 0;
+    if(rc.is_error()) {
+        W_COERCE(_abort_xct(stats));
+    } else {
+        rc = _commit_xct(stats, false, 0);
+    }
+    delete stats;
+    return rc;
+}
+
 
 extern "C" {
 /* Debugger-callable functions to dump various SM tables. */
@@ -290,6 +290,31 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
  *      - default: no
  *      - required?: no
  *
+ * -sm_scan_share
+ *      - type: Boolean
+ *      - description: Lets a file scan join the scans of the same file
+ *      under way, so that they read each page once between them.
+ *      See scan_file_i.
+ *      - default: no
+ *      - required?: no
+ *
+ * -sm_scan_ring
+ *      - type: number >= 0
+ *      - description: The number of buffer pool frames a large scan
+ *      reuses for the pages it reads, so that it does not displace
+ *      the pages others use.  0 lets scans use any frame. At most a
+ *      quarter of the buffer pool.  See scan_index_i::use_ring.
+ *      - default: 32
+ *      - required?: no
+ *
+ * -sm_scan_ring_threshold
+ *      - type: number >= 0
+ *      - description: The number of pages a scan reads into the 
+ *      buffer pool before it keeps to its ring (-sm_scan_ring).
+ *      0 means a quarter of the buffer pool.
+ *      - default: 0
+ *      - required?: no
+ *
  * \sa  \ref SSMVAS
  */
 
@@ -562,6 +587,25 @@ private:
 
 };
 
+/**\brief One key of a batched index lookup.
+ * \ingroup SSMBTREE
+ * \details
+ * See ss_m::find_assoc_batch.
+ */
+struct sm_assoc_probe_t {
+    /// Key to look for.
+    const vec_t*    key;
+    /// Buffer into which the element found is copied; may be null.
+    void*           el;
+    /// Length of \e el; if the key is found, the length of the element.
+    smsize_t        elen;
+    /// True if an entry with the key is found.
+    bool            found;
+
+    NORET           sm_assoc_probe_t() : key(0), el(0), elen(0),
+                                         found(false) {}
+};
+
 class sm_store_info_t;
 class log_entry;
 class coordinator;
@@ -585,6 +629,7 @@ public:
     typedef smlevel_0::LOG_ARCHIVED_CALLBACK_FUNC LOG_ARCHIVED_CALLBACK_FUNC;
     typedef smlevel_0::ndx_t ndx_t;
     typedef smlevel_0::concurrency_t concurrency_t;
+    typedef smlevel_0::xct_cc_t xct_cc_t;
     typedef smlevel_1::xct_state_t xct_state_t;
 
     typedef smlevel_0::RELOCATE_RECORD_CALLBACK_FUNC RELOCATE_RECORD_CALLBACK_FUNC;
@@ -724,6 +769,64 @@ public:
      */
     static rc_t         log_file_was_archived(const char * logfile);
 
+    /**\brief Bring a page up to date from the log archive.
+     *
+     * @param[in] pid      Page to recover.
+     * @param[out] applied Number of updates redone to it.
+     *
+     * Redoes the updates in the log archive and the log that are newer
+     * than the page's image on the volume, e.g. after the page was
+     * restored from a backup.  Needs the sm_archdir option, and must
+     * be called in a transaction.
+     */
+    static rc_t         restore_page(const lpid_t& pid, int& applied);
+
+    /**\brief Bring all pages of a volume up to date from the log archive.
+     *
+     * @param[in] vid      Volume to recover.
+     * @param[out] applied Number of updates redone to its pages.
+     *
+     * As restore_page(), for each page of the volume that the archive
+     * or the log has updates for, reading each run once.
+     */
+    static rc_t         restore_volume(const vid_t& vid, int& applied);
+
+    /**\brief Back up a mounted volume while transactions use it.
+     *
+     * @param[in] vid      Volume to back up.
+     * @param[in] dest     File to copy its device to; the log range
+     *                     that makes the copy consistent goes to
+     *                     dest.info.
+     * @param[in] mb_per_sec Copy at most this many MB a second, to leave
+     *                     disk bandwidth to transactions; 0 means no
+     *                     limit.
+     *
+     * The copy reads the device directly, not through the buffer pool.
+     * See backup_m for how it is made consistent.  Must not be called
+     * in a transaction.
+     */
+    static rc_t         backup_volume(
+        const vid_t&          vid,
+        const char*           dest,
+        int                   mb_per_sec = 0);
+
+    /**\brief Restore a volume from a backup_volume() backup.
+     *
+     * @param[in] backup   The backup file.
+     * @param[in] device   Device to restore it to, which must not be
+     *                     mounted; it is mounted on return.
+     * @param[out] applied Number of updates redone to bring it up to date.
+     *
+     * Copies the backup over the device, mounts it, and redoes the
+     * updates since the backup, from the log or, if the log has
+     * recycled them, from the log archive.  Must not be called in a
+     * transaction.
+     */
+    static rc_t         restore_backup(
+        const char*           backup,
+        const char*           device,
+        int&                  applied);
+
 private:
     void                _construct_once(LOG_WARN_CALLBACK_FUNC x=NULL,
                                            LOG_ARCHIVED_CALLBACK_FUNC y=NULL);
@@ -802,6 +905,68 @@ public:
         tid_t&                   tid,
         timeout_in_ms            timeout = WAIT_SPECIFIED_BY_THREAD);
 
+    /**\brief Begin a transaction that locks or validates its reads.
+     *\ingroup SSMXCT
+     * @param[in] cc        t_xct_locking or t_xct_optimistic.
+     * @param[in] timeout   Optional, controls blocking behavior.
+     * \details
+     *
+     * With t_xct_locking this is begin_xct(timeout).
+     *
+     * An optimistic transaction takes no share locks on the records
+     * and btree keys it reads (it still locks files and indexes
+     * in IS mode, and locks what it updates as usual).  Instead it
+     * remembers each record or key it read along with the log sequence
+     * number of its page, and commit_xct checks that none of them
+     * changed and that no other transaction is changing them.
+     * If the check fails, commit_xct returns eOCCCONFLICT and the
+     * transaction stays active; the caller should abort it and retry.
+     * A read of a record or key that another transaction is updating
+     * fails with eOCCCONFLICT right away.
+     *
+     * This is meant for short transactions, for which the
+     * lock manager is most of the cost: the transaction remembers
+     * every read until it ends.  Only one thread may be attached
+     * to an optimistic transaction.
+     *
+     * After several failures in a row, the thread's optimistic
+     * transactions run with two-phase locking until one commits.
+     *
+     * \sa timeout_in_ms
+     */
+    static rc_t           begin_xct(
+        xct_cc_t                 cc,
+        timeout_in_ms            timeout = WAIT_SPECIFIED_BY_THREAD);
+
+    /**\brief Begin a read-only snapshot transaction.
+     *\ingroup SSMXCT
+     * @param[in] timeout   Optional, controls blocking behavior.
+     * \details
+     *
+     * Start a new transaction and "attach" it to this thread, like
+     * begin_xct.  The transaction reads the records of files as they
+     * were when it began, regardless of what other transactions
+     * change or commit in the meantime, and takes no record or page
+     * locks, so it neither waits for writers nor makes them wait.
+     * Old versions of records are kept in memory for as long as a
+     * snapshot transaction may read them.
+     *
+     * A snapshot transaction cannot update anything; update methods
+     * fail with eSNAPSHOTUPDATE.
+     * Btree entries are not versioned: a lookup or index scan reads
+     * the latest committed entries, waiting only for the writers
+     * that hold them.
+     *
+     * If no other snapshot transaction is running, this waits for
+     * the transactions that have updated records to end, since their
+     * updates were not versioned, and fails with eLOCKTIMEOUT if they
+     * do not end within the timeout.
+     *
+     * \sa timeout_in_ms
+     */
+    static rc_t           begin_snapshot_xct(
+        timeout_in_ms            timeout = WAIT_SPECIFIED_BY_THREAD);
+
 #undef FORK_LOG_STREAM
 #if FORK_LOG_STREAM
     /**\brief Fork the designated transaction's log stream and attach
@@ -1416,6 +1581,32 @@ public:
      */
     static rc_t            xct_collect(vtable_t&v, bool names_too=true);
 
+    /**\brief Collect transaction latency histograms in a virtual table.
+     * \ingroup SSMVTABLE
+     * \details
+     * @param[out] v  The virtual table to populate.
+     * @param[in] names_too  If true, make the 
+     *            first row of the table a list of the attribute names.
+     * @param[in] reset  If true, clear the histograms after collecting them.
+     *
+     * There is one row for the latency of whole transactions (begin
+     * to end of commit or abort) and one for each kind of wait a
+     * transaction can be charged with: lock waits, page latch waits,
+     * page reads, log flushes and log space.
+     * A wait row covers only the transactions that waited for that 
+     * kind of thing at all.  Each row gives the count, total and
+     * maximum, estimated p50 and p99, and the histogram buckets.
+     *
+     * All attribute values will be strings.
+     * The virtual table v can be printed with its output operator
+     * operator\<\< for ostreams.
+	 *
+	 * \attention Not atomic. Can yield stale data. 
+     */
+    static rc_t            xct_latency_collect(vtable_t&v, 
+                                bool names_too=true,
+                                bool reset=false);
+
     /**\brief Collect buffer pool information in a virtual table.
      * \ingroup SSMVTABLE
      * \details
@@ -1464,6 +1655,46 @@ public:
      */
     static rc_t            thread_collect(vtable_t&v, bool names_too=true);
 
+    /**\brief Start timing waits on the storage manager's locks and latches.
+     * \ingroup SSMVTABLE
+     * \details
+     * @param[in] reset  If true, throw away the waits recorded so far.
+     *
+     * Only acquires that have to wait are timed; see lock_profile_collect.
+     */
+    static rc_t            enable_lock_profile(bool reset=true);
+
+    /**\brief Stop timing lock waits. What was recorded is kept.
+     * \ingroup SSMVTABLE
+     */
+    static rc_t            disable_lock_profile();
+
+    /**\brief Collect the hottest locks and latches in a virtual table.
+     * \ingroup SSMVTABLE
+     * \details
+     * @param[out] v  The virtual table to populate.
+     * @param[in] names_too  If true, make the 
+     *            first row of the table a list of the attribute names.
+     * @param[in] top_n  Report only the top_n rows; 0 means all of them.
+     * @param[in] by_site  If true, each row is one lock and call site,
+     *            otherwise one lock.
+     *
+     * Rows are sorted by total wait time, and give the number of waits,
+     * total and maximum wait, and a histogram of the wait times 
+     * recorded since enable_lock_profile.
+     * Lock profiling must be enabled for anything to be recorded.
+     *
+     * All attribute values will be strings.
+     * The virtual table v can be printed with its output operator
+     * operator<< for ostreams.
+	 *
+	 * \attention Not atomic. Can yield stale data. 
+     */
+    static rc_t            lock_profile_collect(vtable_t&v, 
+                                bool names_too=true, 
+                                int top_n=0,
+                                bool by_site=true);
+
     /**\brief Write all existing log entries to disk
      */
     static rc_t		   flushlog();
@@ -2428,6 +2659,56 @@ public:
         bool&                   found,
         const bool              bIgnoreLocks = false);
 
+    /**\brief Find the entries associated with many keys in a B+-Tree
+     * or Multi-rooted B+-Tree index.
+     * \ingroup SSMBTREE
+     *
+     * @param[in] stid  ID of the index. 
+     * @param[in] count  Number of keys.
+     * @param[in,out] probes  The keys, and where to put what is found
+     *                 for each; see sm_assoc_probe_t.
+     * @param[in] bIgnoreLocks  As for find_assoc.
+     *
+     * Same as calling find_assoc (or find_mr_assoc) for each key, but
+     * the keys are looked up in key order, and each lookup starts
+     * from the leaf the previous key was found on, or from its right
+     * sibling, rather than from the root, whenever the key is there.
+     * For batches of keys that fall on the same leaves, e.g. the keys
+     * of a join, that saves most of the descents.  With the sm_prefetch
+     * option on, the next leaf is read in while the keys on the current
+     * one are looked up.
+     *
+     * If an element does not fit in its buffer, eRECWONTFIT is
+     * returned and the probes after it in key order are not done.
+     */
+    static rc_t            find_assoc_batch(
+        stid_t                  stid, 
+        int                     count,
+        sm_assoc_probe_t        probes[],
+        const bool              bIgnoreLocks = false);
+
+    /**\brief Turn the adaptive hash index on or off for a B+-Tree index. 
+     * \ingroup SSMBTREE
+     *
+     * @param[in] stid  ID of the index. 
+     * @param[in] enable  True to start remembering where keys were found,
+     *                 false to stop and forget what was remembered.
+     *
+     * While it is on, find_assoc remembers the leaf page and slot on
+     * which each key was found, and later lookups of the same key go
+     * straight to that leaf if it has not changed since, rather than
+     * down from the root.  The setting is not persistent: it lasts
+     * until the index is destroyed or the storage manager shuts down.
+     *
+     * Only unique indexes with the t_regular property are supported:
+     * the leaf's LSN is what tells whether a remembered location is
+     * still good.  At most 32 indexes can have it on at once; beyond
+     * that, eHASHINDEXFULL is returned.
+     */
+    static rc_t            set_adaptive_hash(
+        const stid_t&           stid, 
+        bool                    enable);
+
 
     // TODO: pin: add explaination for MRBT (SSMMRBTREE :)
 
@@ -2583,6 +2864,29 @@ public:
 				      const bool             bIgnoreLatches = false,
 				      const lpid_t&           root = lpid_t::null);
 
+    /**\brief Find the entries associated with many keys in a
+     * Multi-rooted B+-Tree index.
+     * \ingroup SSMBTREE
+     *
+     * @param[in] stid  ID of the index. 
+     * @param[in] count  Number of keys.
+     * @param[in,out] probes  The keys and their results.
+     * @param[in] bIgnoreLocks  As for find_mr_assoc.
+     * @param[in] bIgnoreLatches  As for find_mr_assoc.
+     * @param[in] root  If not null, all the keys are looked up in the
+     *                 sub-tree with this root.
+     *
+     * See find_assoc_batch.  The keys are grouped by the sub-tree
+     * they fall in, and each group is looked up as one batch.
+     */
+    static rc_t            find_mr_assoc_batch(
+				      stid_t                  stid, 
+				      int                     count,
+				      sm_assoc_probe_t        probes[],
+				      const bool             bIgnoreLocks = false,
+				      const bool             bIgnoreLatches = false,
+				      const lpid_t&           root = lpid_t::null);
+
     /**\brief Update an entry associated with a key.
      * Currently used for updating secondary indexes after record relocation
      * due to the primary index being MRBT-PART or MRBT-LEAF 
@@ -3494,9 +3798,18 @@ private:
     static option_t* _hugetlbfs_path;
     static option_t* _reformat_log;
     static option_t* _prefetch;
+    static option_t* _scan_share;
+    static option_t* _scan_ring;
+    static option_t* _scan_ring_threshold;
+    static option_t* _cache_prefetch;
+    static option_t* _log_compact;
+    static option_t* _log_flush_pipeline;
+    static option_t* _log_tail;
+    static option_t* _log_summary;
     static option_t* _bufpoolsize;
     static option_t* _locktablesize;
     static option_t* _logdir;
+    static option_t* _archdir;
     static option_t* _logsize;
     static option_t* _logbufsize;
     static option_t* _error_log;
@@ -3642,6 +3955,13 @@ private:
         smsize_t&            elen, 
         bool&                found,
         const bool           bIgnoreLocks = false);
+    static rc_t            _find_assoc_batch(
+        const stid_t&        stid, 
+        int                  count,
+        sm_assoc_probe_t     probes[],
+        const bool           bIgnoreLocks,
+        const bool           bIgnoreLatches,
+        const lpid_t&        root);
 
 
     static rc_t            _create_mr_index(
@@ -395,6 +395,18 @@ public:
         t_cc_append                 // append-only with scan_file_i
     };
 
+    /**\enum xct_cc_t
+     * \brief How a transaction protects what it reads
+     * \details
+     * - t_xct_locking Two-phase locking
+     * - t_xct_optimistic Reads of records and keys take no locks and are
+     *   validated at commit.  See ss_m::begin_xct(xct_cc_t, timeout_in_ms).
+     */
+    enum xct_cc_t {
+        t_xct_locking,
+        t_xct_optimistic
+    };
+
 /**\cond skip */
 
     /* 
@@ -443,6 +455,13 @@ public:
     static bool        shutting_down;
     static bool        logging_enabled;
     static bool        do_prefetch;
+    static bool        do_scan_share;
+    static int         scan_ring_frames;
+    static int         scan_ring_threshold;
+    static bool        do_cache_prefetch;
+    static bool        do_log_compact;
+    static bool        do_log_flush_pipeline;
+    static bool        do_log_summary;
 
     static operating_mode_t operating_mode;
     static bool in_recovery() { 
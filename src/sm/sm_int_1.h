@@ -44,6 +44,7 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 
 
 class chkpt_m;
+class log_archiver_t;
 
 /* xct_freeing_space implies that the xct is completed, but not yet freed stores and
    extents.  xct_ended implies completed and freeing space completed */
@@ -64,6 +65,7 @@ public:
                         xct_ended = 0x7
     };
     static chkpt_m*    chkpt;
+    static log_archiver_t* archiver;
 };
 
 #if (SM_LEVEL >= 1)
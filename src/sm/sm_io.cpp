@@ -887,6 +887,40 @@ io_m::read_page(const lpid_t& pid, page_s& buf)
 
 
 
+/*********************************************************************
+ *
+ *  io_m::read_many_pages(first, bufs, cnt)
+ * 
+ *  Read the "cnt" pages starting at "first" on disk into "bufs",
+ *  bypassing the buffer pool.  The caller must know that none of
+ *  them is in the buffer pool (see bf_m::is_resident) and that
+ *  they cannot be updated while they are read.
+ *
+ *********************************************************************/
+rc_t
+io_m::read_many_pages(const lpid_t& first, page_s* bufs, int cnt)
+{
+    FUNC(io_m::read_many_pages);
+
+    // NEVER acquire mutex to read page
+
+    if (_msec_disk_delay > 0)
+            me()->sleep(_msec_disk_delay, "io_m::read_many_pages");
+
+    int i = _find(first.vol());
+    if (i < 0) {
+        return RC(eBADVOL);
+    }
+    DBG( << "reading " << cnt << " pages from " << first );
+
+    W_DO( vol[i]->read_many_pages(first.page, bufs, cnt) );
+
+    for (int j = 0; j < cnt; j++) {
+        bufs[j].pid._stid.vol = first.vol();
+    }
+    return RCOK;
+}
+
 /*********************************************************************
  *
  *  io_m::write_many_pages(bufs, cnt)
@@ -2605,6 +2639,65 @@ rc_t io_m::next_page_with_space(
     return RCOK;
 }
 
+/*********************************************************************
+ * 
+ *  io_m::first_ext(stid, ext)
+ *  io_m::next_ext(stid, ext, next)
+ *
+ *  Walk the extent list of store "stid".  An extent number of 0
+ *  means there are no (more) extents.
+ *
+ *********************************************************************/
+rc_t io_m::first_ext(
+    const stid_t&        stid, 
+    extnum_t&            ext)
+{
+    auto_leave_t enter;
+    FUNC(io_m::first_ext);
+    vid_t volid = stid.vol;
+    GRAB_R;
+
+    W_DO( v->first_ext(stid.store, ext) );
+    return RCOK;
+}
+
+rc_t io_m::next_ext(
+    const stid_t&        stid, 
+    extnum_t             ext,
+    extnum_t&            next)
+{
+    auto_leave_t enter;
+    FUNC(io_m::next_ext);
+    vid_t volid = stid.vol;
+    GRAB_R;
+
+    W_DO( v->next_ext(ext, next) );
+    return RCOK;
+}
+
+/*********************************************************************
+ * 
+ *  io_m::page_range_in_ext(stid, ext, first, last)
+ *
+ *  Return the first and last allocated pages of store "stid" in 
+ *  extent "ext".  Returns eEOF if none of its pages is allocated.
+ *
+ *********************************************************************/
+rc_t io_m::page_range_in_ext(
+    const stid_t&        stid, 
+    extnum_t             ext,
+    lpid_t&              first,
+    lpid_t&              last)
+{
+    auto_leave_t enter;
+    FUNC(io_m::page_range_in_ext);
+    vid_t volid = stid.vol;
+    GRAB_R;
+
+    W_DO( v->page_range_in_ext(stid.store, ext, first, last) );
+    return RCOK;
+}
+
 rc_t                 
 io_m::check_store_pages(const stid_t &stid, page_p::tag_t tag)
 {
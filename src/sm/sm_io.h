@@ -288,6 +288,10 @@ public:
     static rc_t                 read_page(
         const lpid_t&                 pid,
         page_s&                       buf);
+    static rc_t                 read_many_pages(
+        const lpid_t&                 first,
+        page_s*                       bufs,
+        int                           cnt);
     static void                 write_many_pages(const page_s* bufs, int cnt);
     
     static rc_t                 mount(
@@ -443,6 +447,21 @@ public:
         space_bucket_t                   needed,
         lock_mode_t                      lock = NL);
 
+    // The following functions walk the extent list of a store.
+    // A next extent of 0 means the end of the list.
+    static rc_t                 first_ext(
+        const stid_t&                    stid,
+        extnum_t&                        ext);
+    static rc_t                 next_ext(
+        const stid_t&                    stid,
+        extnum_t                         ext,
+        extnum_t&                        next);
+    static rc_t                 page_range_in_ext(
+        const stid_t&                    stid,
+        extnum_t                         ext,
+        lpid_t&                          first,
+        lpid_t&                          last);
+
     // this reports du statistics
     static rc_t                 get_du_statistics( // DU DF
         vid_t                            vid,
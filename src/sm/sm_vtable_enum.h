@@ -53,10 +53,32 @@ enum {
     xct_state_attr,
     xct_coordinator_attr,
     xct_forced_readonly_attr,
+    xct_age_us_attr,
+    /* time waited, one per xct_wait_t */
+    xct_lock_wait_us_attr,
+    xct_latch_wait_us_attr,
+    xct_io_wait_us_attr,
+    xct_log_flush_wait_us_attr,
+    xct_log_space_wait_us_attr,
 
     /* last number! */
     xct_last
 };
+
+enum {
+    /* for xct latency histograms */
+    xct_latency_kind_attr,
+    xct_latency_count_attr,
+    xct_latency_total_us_attr,
+    xct_latency_max_us_attr,
+    xct_latency_p50_us_attr,
+    xct_latency_p99_us_attr,
+    /* xct_latency_hist_t::buckets of them */
+    xct_latency_bucket_attr,
+
+    /* last number! */
+    xct_latency_last = xct_latency_bucket_attr + 11
+};
  
 enum {
         /* global per-sm stats */
@@ -65,6 +65,7 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 #include "device.h"
 #include "app_support.h"
 #include "sm.h"
+#include "btree_hash_index.h"
 
 
 #if W_DEBUG_LEVEL > 0
@@ -749,6 +750,11 @@ ss_m::_set_store_property(
     sdesc_t* sd;
     W_DO( dir->access(stid, sd, EX) );  // also locks the store in EX
 
+    if (newflags != st_regular)  {
+        // page LSNs no longer tell whether a leaf changed
+        btree_hash.disable(stid);
+    }
+
     if (newflags == st_regular)  {
         /*
          *  Set the io store flags for both stores and discard
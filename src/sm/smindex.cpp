@@ -62,12 +62,15 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 
 #include "ranges_p.h"
 #include "btree_latch_manager.h"
+#include "btree_hash_index.h"
+#include <algorithm>
 #ifdef SM_HISTOGRAM
 #include "data_access_histogram.h"
 #endif
 
 // NOTE : this is shared with btree layer
 btree_latch_manager btree_latches;
+btree_hash_index btree_hash;
 
 #ifdef SM_HISTOGRAM
 // to keep data access statistics for load balancing
@@ -305,6 +308,44 @@ ss_m::find_assoc(stid_t stid, const vec_t& key,
     return RCOK;
 }
 
+/*--------------------------------------------------------------*
+ *  ss_m::find_assoc_batch()                                         *
+ *--------------------------------------------------------------*/
+rc_t
+ss_m::find_assoc_batch(stid_t stid, int count, sm_assoc_probe_t probes[],
+                       const bool bIgnoreLocks)
+{
+    SM_PROLOGUE_RC(ss_m::find_assoc_batch, in_xct, read_only, 0);
+    W_DO(_find_assoc_batch(stid, count, probes, bIgnoreLocks, false,
+                lpid_t::null));
+    return RCOK;
+}
+
+/*--------------------------------------------------------------*
+ *  ss_m::set_adaptive_hash()                                        *
+ *--------------------------------------------------------------*/
+rc_t
+ss_m::set_adaptive_hash(const stid_t& stid, bool enable)
+{
+    SM_PROLOGUE_RC(ss_m::set_adaptive_hash, in_xct, read_only, 0);
+    if(!enable) {
+        btree_hash.disable(stid);
+        return RCOK;
+    }
+
+    sdesc_t* sd;
+    W_DO( dir->access(stid, sd, IS) );
+    if (sd->sinfo().stype != t_index)   return RC(eBADSTORETYPE);
+    if (sd->sinfo().ntype != t_uni_btree)   return RC(eBADNDXTYPE);
+
+    store_flag_t st;
+    W_DO( io->get_store_flags(stid, st) );
+    if (st != st_regular)   return RC(eBADSTOREFLAGS);
+
+    W_DO( btree_hash.enable(stid) );
+    return RCOK;
+}
+
 /*--------------------------------------------------------------*
  *  ss_m::create_md_assoc()                                        *
  *--------------------------------------------------------------*/
@@ -495,6 +536,19 @@ rc_t ss_m::find_mr_assoc(stid_t stid, const vec_t& key,
     return RCOK;
 }
 
+/*--------------------------------------------------------------*
+ *  ss_m::find_mr_assoc_batch()                                 *
+ *--------------------------------------------------------------*/
+rc_t ss_m::find_mr_assoc_batch(stid_t stid, int count,
+			       sm_assoc_probe_t probes[],
+			       const bool bIgnoreLocks, const bool bIgnoreLatches,
+			       const lpid_t& root)
+{
+    SM_PROLOGUE_RC(ss_m::find_mr_assoc_batch, in_xct, read_only, 0);
+    W_DO(_find_assoc_batch(stid, count, probes, bIgnoreLocks, bIgnoreLatches, root));
+    return RCOK;
+}
+
 /*--------------------------------------------------------------*
  *  ss_m::update_mr_assoc()                                     *
  *--------------------------------------------------------------*/
@@ -1876,6 +1930,7 @@ ss_m::_destroy_index(const stid_t& iid)
     case t_btree:
     case t_uni_btree:
         W_DO( io->destroy_store(iid) );
+        btree_hash.disable(iid);
         break;
     default:
         return RC(eBADNDXTYPE);
@@ -2338,6 +2393,141 @@ ss_m::_find_assoc(
 }
 
 
+// Orders the probes of a batch by their (scrambled) keys
+struct bt_probe_less {
+    bool operator()(const bt_probe_t& a, const bt_probe_t& b) const {
+        return a.key->cmp(*b.key) < 0;
+    }
+};
+
+/*--------------------------------------------------------------*
+ *  ss_m::_find_assoc_batch()                                   *
+ *--------------------------------------------------------------*/
+rc_t
+ss_m::_find_assoc_batch(
+    const stid_t&         stid, 
+    int                   count,
+    sm_assoc_probe_t      probes[],
+    const bool            bIgnoreLocks,
+    const bool            bIgnoreLatches,
+    const lpid_t&         root)
+{
+    concurrency_t cc = t_cc_bad;
+    lock_mode_t                index_mode = NL;// lock mode needed on index
+
+    // same as _find_assoc
+    if (bIgnoreLocks) {
+	cc = t_cc_none;
+	index_mode = NL;
+    } else {
+	xct_t* xd = xct();
+	if (xd)  {
+	    lock_mode_t lock_mode;
+	    W_DO( lm->query(stid, lock_mode, xd->tid(), true, true) );
+	    if (lock_mode >= SH) {
+		cc = t_cc_none;
+	    } else if (lock_mode >= IS) {
+		// no changes needed
+	    } else {
+		index_mode = IS;
+	    }
+	}
+    }
+    
+    sdesc_t* sd;
+    W_DO( dir->access(stid, sd, index_mode) );
+    if (sd->sinfo().stype != t_index)   return RC(eBADSTORETYPE);
+    if (cc == t_cc_bad ) cc = (concurrency_t)sd->sinfo().cc;
+
+    bool unique = false;
+    bool multi_rooted = false;
+    switch (sd->sinfo().ntype) {
+    case t_bad_ndx_t:
+        return RC(eBADNDXTYPE);
+    case t_uni_btree:
+        unique = true;
+        // fall through
+    case t_btree:
+        break;
+    case t_uni_mrbtree:
+    case t_uni_mrbtree_l:
+    case t_uni_mrbtree_p:
+        unique = true;
+        // fall through
+    case t_mrbtree:
+    case t_mrbtree_l:
+    case t_mrbtree_p:
+        multi_rooted = true;
+        break;
+    case t_rtree:
+        // batches are sorted by key, which rtrees don't have
+        return RC(eNOTIMPLEMENTED);
+    default:
+        W_FATAL_MSG(eINTERNAL, << "bad index type " << sd->sinfo().ntype );
+    }
+    if(!multi_rooted && (bIgnoreLatches || root != lpid_t::null)) {
+        return RC(eBADNDXTYPE);
+    }
+    if(count <= 0) return RCOK;
+
+    /*
+     * Scramble the keys into a buffer of our own (_scramble_key
+     * reuses a per-thread one) and sort the probes by them.
+     */
+    smsize_t total = 0;
+    for(int i = 0; i < count; i++) {
+        total += probes[i].key->size();
+    }
+    char* keybuf = new char[total ? total : 1];
+    w_auto_delete_array_t<char> auto_del_keybuf(keybuf);
+    cvec_t* keys = new cvec_t[count];
+    w_auto_delete_array_t<cvec_t> auto_del_keys(keys);
+    bt_probe_t* sorted = new bt_probe_t[count];
+    w_auto_delete_array_t<bt_probe_t> auto_del_sorted(sorted);
+
+    char* next = keybuf;
+    for(int i = 0; i < count; i++) {
+        cvec_t* real_key;
+        W_DO(bt->_scramble_key(real_key, *probes[i].key,
+                    sd->sinfo().nkc, sd->sinfo().kc));
+        smsize_t len = real_key->size();
+        w_assert1(len == probes[i].key->size());
+        real_key->copy_to(next, len);
+        keys[i].put(next, len);
+        next += len;
+
+        probes[i].found = false;
+        sorted[i].key = &keys[i];
+        sorted[i].el = probes[i].el;
+        sorted[i].elen = &probes[i].elen;
+        sorted[i].found = &probes[i].found;
+    }
+    std::sort(sorted, sorted + count, bt_probe_less());
+
+    if(!multi_rooted) {
+        W_DO( bt->lookup_batch(sd->root(), unique, cc, count, sorted) );
+    } else if(root != lpid_t::null) {
+        W_DO( bt->lookup_batch(root, unique, cc, count, sorted,
+                    bIgnoreLatches) );
+    } else {
+        // one batch per sub-tree; its keys are next to each other
+        int    first = 0;
+        lpid_t subroot = sd->root(*sorted[0].key);
+        for(int i = 1; i <= count; i++) {
+            lpid_t r;
+            if(i < count) {
+                r = sd->root(*sorted[i].key);
+                if(r == subroot) continue;
+            }
+            W_DO( bt->lookup_batch(subroot, unique, cc, i - first,
+                        sorted + first, bIgnoreLatches) );
+            first = i;
+            subroot = r;
+        }
+    }
+    return RCOK;
+}
+
 
 /*--------------------------------------------------------------*
  *  ss_m::destroy_md_assoc()                                    *
@@ -95,6 +95,7 @@ class xct_t;
 class xct_log_t;
 class sdesc_cache_t;
 class lockid_t;
+class bf_ring_t;
 
 #ifdef __GNUG__
 #pragma interface
@@ -235,6 +236,7 @@ class smthread_t : public sthread_t {
         lockid_t          *_lock_hierarchy;
         xct_log_t*        _xct_log;
         sm_stats_info_t*  _TL_stats; // thread-local stats
+        bf_ring_t*        _scan_ring; // frames of the scan we are in
 
         // for lock_head_t::my_lock::get_me
         queue_based_lock_t::ext_qnode _me1;
@@ -310,6 +312,7 @@ class smthread_t : public sthread_t {
             _lock_hierarchy(0), 
             _xct_log(0), 
             _TL_stats(0),
+            _scan_ring(0),
             __ordinal(0),
             __metarecs(0),
             __metarecs_in(0)
@@ -573,6 +576,13 @@ public:
     inline
     sdesc_cache_t *  sdesc_cache() { return tcb()._sdesc_cache; }
 
+    /// Frames the pages read in for the scan this thread is in go
+    /// to; NULL when it is in none, or the scan has no ring.
+    inline
+    bf_ring_t*       scan_ring() const { return tcb()._scan_ring; }
+    inline
+    void             set_scan_ring(bf_ring_t* r) { tcb()._scan_ring = r; }
+
     void	     alloc_sdesc_cache();
     void	     free_sdesc_cache();
 
@@ -685,6 +695,42 @@ xct()
     return me()->xct(); 
 }
 
+/**\endcond skip */
+
+/**\brief What a transaction can spend its time waiting for.
+ * \details
+ * Each transaction adds up the elapsed time its threads spend in
+ * each kind of wait (see xct_wait_timer_t).  When it ends, the
+ * totals go into the transaction latency histograms
+ * (see xct_t::latency_collect) and into the sm stats (xct_*_us).
+ */
+enum xct_wait_t {
+    xct_wait_lock,      // blocked in the lock manager
+    xct_wait_latch,     // waiting for a page latch in bf_m::fix
+    xct_wait_io,        // synchronous page reads
+    xct_wait_log_flush, // waiting for the log to be flushed
+    xct_wait_log_space, // waiting for log space
+    xct_wait_kinds
+};
+
+/**\brief Charges the time until the end of its scope to the 
+ * given kind of wait of the thread's transaction.
+ * \details
+ * Does not read the clock if the thread has no transaction.
+ */
+class xct_wait_timer_t {
+public:
+    xct_wait_timer_t(xct_wait_t w)
+        : _xd(xct()), _kind(w), _start(_xd? gethrtime() : 0) {}
+    ~xct_wait_timer_t() { if(_xd) _charge(); }
+private:
+    void            _charge(); // xct.cpp
+    xct_t*          _xd;
+    xct_wait_t      _kind;
+    hrtime_t        _start;
+};
+
+/**\cond skip */
 
 inline void 
 smthread_t::mark_pin_count()
@@ -0,0 +1,359 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+#include "w_defines.h"
+
+/*  -- do not edit anything above this line --   </std-header>*/
+
+/*
+ * Microbenchmark of B+-Tree descents.
+ *
+ * Creates an index of num_rec integer keys, then times random
+ * lookups of keys in it and reports the time per descent.
+ * Run it with different -sm_bufpoolsize values to see how the
+ * descent cost grows with the buffer pool, and with
+ * -sm_cache_prefetch no to see what the cache prefetches of the
+ * buffer pool lookups buy.  For example:
+ *
+ *     bt_descent -num_rec 200000 -l 1000000 -sm_bufpoolsize 65536
+ */
+
+#include <w_stream.h>
+#include <sys/types.h>
+#include <cassert>
+#include "sm_vas.h"
+#include "w_getopt.h"
+ss_m* ssm = 0;
+
+// shorten error code type name
+typedef w_rc_t rc_t;
+
+// this is implemented in options.cpp
+w_rc_t init_config_options(option_group_t& options,
+                        const char* prog_type,
+                        int& argc, char** argv);
+
+
+void
+usage(option_group_t& options)
+{
+    cerr << "Usage: bt_descent [-h] [-l lookups] [options]" << endl;
+    cerr << "       -l number of timed lookups (default 100000)" << endl;
+    cerr << "Valid options are: " << endl;
+    options.print_usage(true, cerr);
+}
+
+/* create an smthread based class for all sm-related work */
+class smthread_user_t : public smthread_t {
+        int        _argc;
+        char        **_argv;
+
+        const char *_device_name;
+        smsize_t    _quota;
+        int         _num_rec;
+        int         _num_lookups;
+        lvid_t      _lvid;
+        stid_t      _index_id;
+        option_group_t* _options;
+        vid_t       _vid;
+public:
+        int         retval;
+
+        smthread_user_t(int ac, char **av)
+                : smthread_t(t_regular, "smthread_user_t"),
+                _argc(ac), _argv(av),
+                _device_name(NULL),
+                _quota(0),
+                _num_rec(0),
+                _num_lookups(100000),
+                _options(NULL),
+                _vid(1),
+                retval(0) { }
+
+        ~smthread_user_t()  { if(_options) delete _options; }
+
+        void run();
+
+        // helpers for run()
+        w_rc_t handle_options();
+        w_rc_t do_init();
+        w_rc_t load_index();
+        w_rc_t lookup(int count, bool check);
+        w_rc_t do_work();
+};
+
+rc_t
+smthread_user_t::do_init()
+{
+    devid_t        devid;
+    cout << "Formatting device: " << _device_name
+         << " with a " << _quota << "KB quota ..." << endl;
+    W_DO(ssm->format_dev(_device_name, _quota, true));
+
+    u_int        vol_cnt;
+    W_DO(ssm->mount_dev(_device_name, vol_cnt, devid));
+    W_DO(ssm->generate_new_lvid(_lvid));
+    W_DO(ssm->create_vol(_device_name, _lvid, _quota, false, _vid));
+    cout << "Created volume " << _lvid
+         << " with local handle(phys volid) " << _vid << endl;
+    return RCOK;
+}
+
+/*
+ * Creates the index and inserts keys 0 .. _num_rec-1; each key's
+ * element is the key itself.
+ */
+rc_t
+smthread_user_t::load_index()
+{
+    cout << "Creating an index with " << _num_rec << " keys" << endl;
+    W_DO(ssm->begin_xct());
+    W_DO(ssm->create_index(_vid, smlevel_0::t_btree, smlevel_3::t_regular,
+                           "i4", smlevel_0::t_cc_kvl, _index_id));
+    W_DO(ssm->commit_xct());
+
+    const int per_xct = 1000;
+    for(int i=0; i < _num_rec; ) {
+        W_DO(ssm->begin_xct());
+        for(int j=0; j < per_xct && i < _num_rec; j++, i++) {
+            vec_t key(&i, sizeof(i));
+            vec_t el(&i, sizeof(i));
+            W_DO(ssm->create_assoc(_index_id, key, el));
+        }
+        W_DO(ssm->commit_xct());
+    }
+    return RCOK;
+}
+
+/*
+ * Looks up "count" random keys.  Locks are skipped, so that what is
+ * measured is the descent of the tree.
+ */
+rc_t
+smthread_user_t::lookup(int count, bool check)
+{
+    W_DO(ssm->begin_xct());
+    for(int i=0; i < count; i++) {
+        int k = randn(_num_rec);
+        int el = -1;
+        smsize_t elen = sizeof(el);
+        bool found = false;
+        vec_t key(&k, sizeof(k));
+        W_DO(ssm->find_assoc(_index_id, key, &el, elen, found, true));
+        if(check && (!found || el != k)) {
+            cerr << "Key " << k << " not found, or wrong element "
+                 << el << endl;
+            W_DO(ssm->abort_xct());
+            return RC(fcASSERT);
+        }
+    }
+    W_DO(ssm->commit_xct());
+    return RCOK;
+}
+
+rc_t
+smthread_user_t::do_work()
+{
+    W_DO(do_init());
+    W_DO(load_index());
+
+    // Warm up the buffer pool (as far as it holds the index),
+    // and check the answers while at it.
+    W_DO(lookup(_num_rec < _num_lookups ? _num_rec : _num_lookups, true));
+
+    sm_stats_info_t before;
+    W_DO(ss_m::gather_stats(before));
+
+    hrtime_t start = gethrtime();
+    W_DO(lookup(_num_lookups, false));
+    hrtime_t elapsed = gethrtime() - start;
+
+    sm_stats_info_t after;
+    W_DO(ss_m::gather_stats(after));
+
+    double looks = double(after.sm.bf_look_cnt - before.sm.bf_look_cnt);
+    double hits = double(after.sm.bf_hit_cnt - before.sm.bf_hit_cnt);
+    double fixes = double(after.sm.page_fix_cnt - before.sm.page_fix_cnt)
+        + double(after.sm.page_refix_cnt - before.sm.page_refix_cnt);
+
+    cout << "cache prefetch " << (smlevel_0::do_cache_prefetch? "on":"off")
+         << endl
+         << "lookups " << _num_lookups << endl
+         << "elapsed ns " << elapsed << endl
+         << "ns per descent " << double(elapsed)/_num_lookups << endl
+         << "page fixes per descent " << fixes/_num_lookups << endl
+         << "buffer pool hit ratio "
+         << (looks > 0 ? hits/looks : 1.0) << endl;
+    return RCOK;
+}
+
+w_rc_t smthread_user_t::handle_options()
+{
+    option_t* opt_device_name = 0;
+    option_t* opt_device_quota = 0;
+    option_t* opt_num_rec = 0;
+
+    cout << "Processing configuration options ..." << endl;
+
+    const int option_level_cnt = 3;
+
+    _options = new option_group_t (option_level_cnt);
+    if(!_options) {
+        cerr << "Out of memory: could not allocate from heap." <<
+            endl;
+        retval = 1;
+        return RC(fcINTERNAL);
+    }
+    option_group_t &options(*_options);
+
+    W_COERCE(options.add_option("device_name", "device/file name",
+                         NULL, "device containg volume holding the index",
+                         true, option_t::set_value_charstr,
+                         opt_device_name));
+
+    W_COERCE(options.add_option("device_quota", "# > 1000",
+                         "2000", "quota for device",
+                         false, option_t::set_value_long,
+                         opt_device_quota));
+
+    W_COERCE(options.add_option("num_rec", "# > 0",
+                         "1", "number of keys in the index",
+                         true, option_t::set_value_long,
+                         opt_num_rec));
+
+    // Have the SSM add its options to my group.
+    W_COERCE(ss_m::setup_options(&options));
+
+    w_rc_t rc = init_config_options(options, "server", _argc, _argv);
+    if (rc.is_error()) {
+        usage(options);
+        retval = 1;
+        return rc;
+    }
+
+    int option;
+    while ((option = getopt(_argc, _argv, "hl:")) != -1) {
+        switch (option) {
+        case 'l' :
+            _num_lookups = atoi(optarg);
+            break;
+
+        case 'h' :
+            usage(options);
+            break;
+
+        default:
+            usage(options);
+            retval = 1;
+            return RC(fcNOTIMPLEMENTED);
+            break;
+        }
+    }
+    {
+        cout << "Checking for required options...";
+        /* check that all required options have been set */
+        w_ostrstream      err_stream;
+        w_rc_t rc = options.check_required(&err_stream);
+        if (rc.is_error()) {
+            cerr << "These required options are not set:" << endl;
+            cerr << err_stream.c_str() << endl;
+            return rc;
+        }
+        cout << "Options OK; values are: { " << endl;
+        options.print_values(false, cout);
+        cout << "} end list of options values. " << endl;
+    }
+
+    _device_name = opt_device_name->value();
+    _quota = strtol(opt_device_quota->value(), 0, 0);
+    _num_rec = strtol(opt_num_rec->value(), 0, 0);
+    if(_num_rec <= 0 || _num_lookups <= 0) {
+        usage(options);
+        retval = 1;
+        return RC(fcASSERT);
+    }
+
+    return RCOK;
+}
+
+void smthread_user_t::run()
+{
+    w_rc_t rc = handle_options();
+    if(rc.is_error()) {
+        retval = 1;
+        return;
+    }
+
+    cout << "Starting SSM and performing recovery ..." << endl;
+    ssm = new ss_m();
+    if (!ssm) {
+        cerr << "Error: Out of memory for ss_m" << endl;
+        retval = 1;
+        return;
+    }
+
+    rc = do_work();
+
+    if (rc.is_error()) {
+        cerr << "Benchmark failed: " << endl;
+        cerr << rc << endl;
+        delete ssm;
+        rc = RCOK;   // force deletion of w_error_t info hanging off rc
+                     // otherwise a leak for w_error_t will be reported
+        retval = 1;
+        if(rc.is_error())
+            W_COERCE(rc); // avoid error not checked.
+        return;
+    }
+
+    cout << "\nShutting down SSM ..." << endl;
+    delete ssm;
+
+    cout << "Finished!" << endl;
+
+    return;
+}
+
+int
+main(int argc, char* argv[])
+{
+    smthread_user_t *smtu = new smthread_user_t(argc, argv);
+    if (!smtu)
+            W_FATAL(fcOUTOFMEMORY);
+
+    w_rc_t e = smtu->fork();
+    if(e.is_error()) {
+        cerr << "error forking thread: " << e <<endl;
+        return 1;
+    }
+    e = smtu->join();
+    if(e.is_error()) {
+        cerr << "error forking thread: " << e <<endl;
+        return 1;
+    }
+
+    int        rv = smtu->retval;
+    delete smtu;
+
+    return rv;
+}
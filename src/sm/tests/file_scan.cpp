@@ -43,14 +43,19 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 #include "sm_vas.h"
 
 #include "w_getopt.h"
+#include "stopwatch.h"
 int cmdline_num_rec(-1); // trumps config options if set
 int num_rec(0); // set by config options
 
 ss_m* ssm = 0;
+const char* device_name = 0;
 
 // shorten error code type name
 typedef w_rc_t rc_t;
 
+// byte k of every record body
+static inline char rec_byte(smsize_t k) { return char('a' + k % 26); }
+
 // this is implemented in options.cpp
 w_rc_t init_config_options(option_group_t& options,
             const char* prog_type,
@@ -169,9 +174,9 @@ setup_device_and_volume(const char* device_name, bool init_device,
         rid_t rid;
 
     /// each record will have its ordinal number in the header
-    /// and zeros for data 
+    /// and a known pattern (see rec_byte) for data 
         char* dummy = new char[rec_size];
-        memset(dummy, '\0', rec_size);
+        for (smsize_t k = 0; k < rec_size; k++) dummy[k] = rec_byte(k);
         vec_t data(dummy, rec_size);
 
         for (int i = 0; i < num_rec; i++) {
@@ -251,6 +256,17 @@ usage(option_group_t& options)
     cerr << "Usage: server [-h] [-i] -l r|f [options]" << endl;
     cerr << "       -i initialize device/volume and create file with nrec records" << endl;
     cerr << "       -l lock granularity r(record) or f(ile)" << endl;
+    cerr << "       -s scan type s(can_file_i::next), b(atch), p(arallel)" << endl;
+    cerr << "          or l(arge records: read bodies with pin_i::read_bytes)" << endl;
+    cerr << "          or u(pdate part of each record, roll back, update again)" << endl;
+    cerr << "          or h(ashed index lookups of every record)" << endl;
+    cerr << "          or v (snapshot scan while others update)" << endl;
+    cerr << "          or o(ptimistic transactions racing with others)" << endl;
+    cerr << "          or r(estore the volume from the log archive, after -s u)" << endl;
+    cerr << "          or k (back up the volume while updating, and restore it)" << endl;
+    cerr << "          or g (check that a scan keeps to its ring of frames)" << endl;
+    cerr << "       -p pages per batch for -s b" << endl;
+    cerr << "       -w number of workers for -s p" << endl;
     cerr << "Valid options are: " << endl;
     options.print_usage(true, cerr);
 }
@@ -288,6 +304,829 @@ void scan_i_scan(const stid_t& fid, int num_rec,
     cout << "scan_i scan complete" << endl;
 }
 
+void scan_i_batch_scan(const stid_t& fid, int num_rec,
+        ss_m::concurrency_t cc, int batch_pages)
+{
+    cout << "starting batch scan of " << num_rec << " records"
+        << " (" << batch_pages << " page(s) per batch)" << endl;
+    scan_file_i scan(fid, cc);
+    record_batch batch(batch_pages);
+    bool    eof = false;
+    int     i = 0;
+    int     nbatches = 0;
+    do {
+        W_COERCE(scan.next_batch(batch, eof));
+        if(eof) break;
+        nbatches++;
+
+        for(int j = 0; j < batch.count(); j++) {
+            const record_batch::entry_t &e = batch[j];
+            int refi;
+            memcpy(&refi, e.hdr, sizeof(refi));
+            w_assert1(e.hdr_size == sizeof(refi));
+            w_assert1(refi == i);
+            i++;
+        }
+    } while (1) ;
+    assert(i == num_rec);
+    cout << "batch scan complete: " << nbatches << " batches" << endl;
+}
+
+/// Counts the records seen by each worker and checks that every
+/// record is seen exactly once.
+class check_visitor_t : public scan_file_visitor_t {
+public:
+    int     num_rec;
+    char*   seen;
+    int*    count;
+
+    check_visitor_t(int n, int nworkers) : num_rec(n) {
+        seen = new char[n];
+        memset(seen, '\0', n);
+        count = new int[nworkers];
+        memset(count, '\0', nworkers * sizeof(int));
+    }
+    ~check_visitor_t() { delete[] seen; delete[] count; }
+
+    rc_t visit(int worker, const record_batch& batch) {
+        for(int j = 0; j < batch.count(); j++) {
+            int refi;
+            memcpy(&refi, batch[j].hdr, sizeof(refi));
+            w_assert1(refi >= 0 && refi < num_rec);
+            // each record goes to exactly one worker, so no need to
+            // synchronize
+            w_assert1(seen[refi] == 0);
+            seen[refi] = 1;
+        }
+        count[worker] += batch.count();
+        return RCOK;
+    }
+};
+
+void scan_i_parallel_scan(const stid_t& fid, int num_rec,
+        ss_m::concurrency_t cc, int nworkers)
+{
+    cout << "starting parallel scan of " << num_rec << " records"
+        << " with " << nworkers << " workers" << endl;
+    check_visitor_t visitor(num_rec, nworkers);
+    parallel_scan_file_i scan(fid, nworkers, cc);
+    W_COERCE(scan.run(visitor));
+
+    int i = 0;
+    for(int w = 0; w < nworkers; w++) i += visitor.count[w];
+    assert(i == num_rec);
+    for(int r = 0; r < num_rec; r++) assert(visitor.seen[r]);
+    cout << "parallel scan complete" << endl;
+}
+
+/// Scans the whole file, with or without a ring, and returns the
+/// number of pages that read from the volume.
+static unsigned long ring_scan(const stid_t& fid, int num_rec,
+        ss_m::concurrency_t cc, bool ring, rid_t* first, int nfirst)
+{
+    sm_stats_info_t* stats = new sm_stats_info_t;
+    w_auto_delete_t<sm_stats_info_t>     autodel(stats);
+    W_COERCE(ss_m::gather_stats(*stats));
+    unsigned long reads = stats->sm.vol_reads;
+
+    scan_file_i scan(fid, cc);
+    scan.use_ring(ring);
+    pin_i*  handle;
+    bool    eof = false;
+    int     i = 0;
+    do {
+        W_COERCE(scan.next(handle, 0, eof));
+        if(eof) break;
+        if(i < nfirst) first[i] = handle->rid();
+        i++;
+    } while (1) ;
+    assert(i == num_rec);
+
+    W_COERCE(ss_m::gather_stats(*stats));
+    return stats->sm.vol_reads - reads;
+}
+
+/// Pins the records and returns the number of pages that read from
+/// the volume.
+static unsigned long pin_hot(const rid_t* rids, int n)
+{
+    sm_stats_info_t* stats = new sm_stats_info_t;
+    w_auto_delete_t<sm_stats_info_t>     autodel(stats);
+    W_COERCE(ss_m::gather_stats(*stats));
+    unsigned long reads = stats->sm.vol_reads;
+    for(int i = 0; i < n; i++) {
+        pin_i handle;
+        W_COERCE(handle.pin(rids[i], 0));
+    }
+    W_COERCE(ss_m::gather_stats(*stats));
+    return stats->sm.vol_reads - reads;
+}
+
+/// Checks that a scan of a file bigger than the buffer pool leaves
+/// the pages others use in it when it keeps to its ring, and does
+/// not when it does not.
+void scan_i_ring(const stid_t& fid, int num_rec,
+        ss_m::concurrency_t cc)
+{
+    cout << "starting ring scans of " << num_rec << " records" << endl;
+    const int nhot = 8;
+    rid_t hot[nhot];
+    // the first pages of the file are gone from the pool by the end 
+    // of a scan, unless it keeps to its ring
+    ring_scan(fid, num_rec, cc, false, hot, nhot);
+    unsigned long cold = pin_hot(hot, nhot);
+    unsigned long warm = pin_hot(hot, nhot);
+    assert(cold > 0);
+    assert(warm == 0);
+
+    unsigned long with = ring_scan(fid, num_rec, cc, true, 0, 0);
+    unsigned long with_hot = pin_hot(hot, nhot);
+    unsigned long without = ring_scan(fid, num_rec, cc, false, 0, 0);
+    unsigned long without_hot = pin_hot(hot, nhot);
+    cout << "with a ring: " << with << " reads, then " 
+        << with_hot << " for the hot pages" << endl;
+    cout << "without: " << without << " reads, then " 
+        << without_hot << " for the hot pages" << endl;
+    assert(with_hot == 0);
+    assert(without_hot > 0);
+    cout << "ring scans complete" << endl;
+}
+
+/// Reads every record with pin_i::read_bytes and returns the number
+/// of data pages that were read around the buffer pool.
+static unsigned long large_read(const stid_t& fid, int num_rec,
+        ss_m::concurrency_t cc)
+{
+    sm_stats_info_t* stats = new sm_stats_info_t;
+    w_auto_delete_t<sm_stats_info_t>     autodel(stats);
+    W_COERCE(ss_m::gather_stats(*stats));
+    unsigned long direct = stats->sm.lg_read_direct_pages;
+
+    // not a multiple of the page size, so reads straddle pages
+    const smsize_t chunk = 20000;
+    scan_file_i scan(fid, cc);
+    pin_i*     handle;
+    bool    eof = false;
+    int     i = 0;
+    smsize_t total = 0;
+    char*   buf = new char[chunk];
+    do {
+        W_COERCE(scan.next(handle, 0, eof));
+        if(eof) break;
+
+        // body() fixes the first data page in the buffer pool, so
+        // read_bytes copies some pages from there and reads the
+        // rest from the volume
+        assert(handle->body()[0] == rec_byte(0));
+
+        smsize_t size = handle->body_size();
+        for(smsize_t start = 0; start < size; start += chunk) {
+            smsize_t len = size - start < chunk ? size - start : chunk;
+            W_COERCE(handle->read_bytes(start, len, buf));
+            for(smsize_t k = 0; k < len; k++) {
+                assert(buf[k] == rec_byte(start + k));
+            }
+        }
+        total += size;
+        i++;
+    } while (1) ;
+    delete [] buf;
+    assert(i == num_rec);
+
+    W_COERCE(ss_m::gather_stats(*stats));
+    direct = stats->sm.lg_read_direct_pages - direct;
+    cout << "read " << total << " bytes, " << direct 
+        << " pages around the buffer pool" << endl;
+    return direct;
+}
+
+/// Checks that read_bytes reads around the buffer pool only when
+/// the scan's locks keep the data pages from changing.
+void scan_i_large_read(const stid_t& fid, int num_rec,
+        ss_m::concurrency_t cc)
+{
+    cout << "starting read_bytes of " << num_rec << " records" << endl;
+    // without locks first: the locked scan's locks last until commit
+    unsigned long unlocked = large_read(fid, num_rec, ss_m::t_cc_none);
+    W_COERCE(ss_m::force_buffers(true));
+    unsigned long locked = large_read(fid, num_rec, cc);
+    assert(locked > 0);
+    assert(unlocked == 0);
+    cout << "read_bytes scan complete" << endl;
+}
+
+// check that bytes [start, start+len) of rid read back as expected:
+// upper case in [ustart, uend), rec_byte() everywhere else
+static void check_update(const rid_t& rid, smsize_t start, smsize_t len,
+        smsize_t ustart, smsize_t uend, char* buf)
+{
+    pin_i handle;
+    W_COERCE(handle.pin(rid, 0));
+    W_COERCE(handle.read_bytes(start, len, buf));
+    for(smsize_t k = start; k < start + len; k++) {
+        char c = rec_byte(k);
+        if(k >= ustart && k < uend) c = char(c - 'a' + 'A');
+        assert(buf[k - start] == c);
+    }
+}
+
+// overwrite a range in the middle of each record, of which
+// only the middle third actually changes, so the update is
+// logged as a small byte delta
+static void update_range(smsize_t size, smsize_t& start, smsize_t& len,
+        smsize_t& ustart, smsize_t& uend)
+{
+    len = size < 3000 ? size : 3000;
+    start = (size - len) / 2;
+    ustart = start + len/3;
+    uend = start + 2*len/3;
+}
+
+void scan_i_update(const stid_t& fid, int num_rec,
+        ss_m::concurrency_t cc)
+{
+    cout << "starting update/rollback of " << num_rec << " records" << endl;
+    rid_t*  rids = new rid_t[num_rec];
+    smsize_t size = 0;
+    {
+        scan_file_i scan(fid, cc);
+        pin_i*     handle;
+        bool    eof = false;
+        int     i = 0;
+        do {
+            W_COERCE(scan.next(handle, 0, eof));
+            if(eof) break;
+            assert(i < num_rec);
+            rids[i++] = handle->rid();
+            size = handle->body_size();
+        } while (1) ;
+        assert(i == num_rec);
+    }
+
+    smsize_t start, len, ustart, uend;
+    update_range(size, start, len, ustart, uend);
+    char*   buf = new char[len];
+    char*   data = new char[len];
+    for(smsize_t k = start; k < start + len; k++) {
+        char c = rec_byte(k);
+        if(k >= ustart && k < uend) c = char(c - 'a' + 'A');
+        data[k - start] = c;
+    }
+    vec_t   data_vec(data, len);
+
+    sm_save_point_t sp;
+    W_COERCE(ssm->save_work(sp));
+    for(int i = 0; i < num_rec; i++) {
+        W_COERCE(ssm->update_rec(rids[i], start, data_vec));
+        check_update(rids[i], start, len, ustart, uend, buf);
+    }
+
+    // undo applies the same deltas again
+    W_COERCE(ssm->rollback_work(sp));
+    for(int i = 0; i < num_rec; i++) {
+        check_update(rids[i], start, len, 0, 0, buf);
+    }
+
+    // and put it back, so that the updates are committed
+    for(int i = 0; i < num_rec; i++) {
+        W_COERCE(ssm->update_rec(rids[i], start, data_vec));
+    }
+    delete [] data;
+    delete [] buf;
+    delete [] rids;
+    cout << "update/rollback complete" << endl;
+}
+
+// the volume was put back to a copy from before "-s u"; redo that
+// run's updates from the log archive and check that they are there
+void scan_i_restore(const stid_t& fid, int num_rec,
+        ss_m::concurrency_t cc)
+{
+    cout << "starting media recovery of " << num_rec << " records" << endl;
+    int applied = 0;
+    W_COERCE(ssm->restore_volume(fid.vol, applied));
+    cout << "redid " << applied << " updates" << endl;
+    assert(applied >= num_rec);
+
+    scan_file_i scan(fid, cc);
+    pin_i*     handle;
+    bool    eof = false;
+    int     i = 0;
+    char*   buf = 0;
+    smsize_t start = 0, len = 0, ustart = 0, uend = 0;
+    do {
+        W_COERCE(scan.next(handle, 0, eof));
+        if(eof) break;
+        if(!buf) {
+            update_range(handle->body_size(), start, len, ustart, uend);
+            buf = new char[len];
+        }
+        check_update(handle->rid(), start, len, ustart, uend, buf);
+        i++;
+    } while (1) ;
+    assert(i == num_rec);
+    delete [] buf;
+    cout << "media recovery complete" << endl;
+}
+
+// back up the volume between two halves of an update, with the pages
+// of the first half still dirty in the buffer pool; then put the backup
+// back and check that restoring it redoes the updates it missed
+void scan_i_backup(const stid_t& fid, int num_rec,
+        ss_m::concurrency_t cc)
+{
+    cout << "starting backup/restore of " << num_rec << " records" << endl;
+    rid_t*  rids = new rid_t[num_rec];
+    smsize_t size = 0;
+    {
+        scan_file_i scan(fid, cc);
+        pin_i*     handle;
+        bool    eof = false;
+        int     i = 0;
+        do {
+            W_COERCE(scan.next(handle, 0, eof));
+            if(eof) break;
+            rids[i++] = handle->rid();
+            size = handle->body_size();
+        } while (1) ;
+        assert(i == num_rec);
+    }
+
+    smsize_t start, len, ustart, uend;
+    update_range(size, start, len, ustart, uend);
+    char*   buf = new char[len];
+    char*   data = new char[len];
+    for(smsize_t k = start; k < start + len; k++) {
+        char c = rec_byte(k);
+        if(k >= ustart && k < uend) c = char(c - 'a' + 'A');
+        data[k - start] = c;
+    }
+    vec_t   data_vec(data, len);
+
+    for(int i = 0; i < num_rec/2; i++) {
+        W_COERCE(ssm->update_rec(rids[i], start, data_vec));
+    }
+    W_COERCE(ssm->commit_xct());
+
+    char backup[ss_m::max_devname];
+    {
+        w_ostrstream s(backup, sizeof(backup));
+        s << device_name << ".bak" << ends;
+    }
+    // at a rate that makes it sleep now and then
+    W_COERCE(ssm->backup_volume(fid.vol, backup, 64));
+
+    W_COERCE(ssm->begin_xct());
+    for(int i = num_rec/2; i < num_rec; i++) {
+        W_COERCE(ssm->update_rec(rids[i], start, data_vec));
+    }
+    W_COERCE(ssm->commit_xct());
+
+    W_COERCE(ssm->dismount_dev(device_name));
+    int applied = 0;
+    W_COERCE(ssm->restore_backup(backup, device_name, applied));
+    cout << "redid " << applied << " updates" << endl;
+    assert(applied >= num_rec - num_rec/2);
+
+    W_COERCE(ssm->begin_xct());
+    for(int i = 0; i < num_rec; i++) {
+        check_update(rids[i], start, len, ustart, uend, buf);
+    }
+    delete [] data;
+    delete [] buf;
+    delete [] rids;
+    // run() commits the transaction it began
+    cout << "backup/restore complete" << endl;
+}
+
+// look up every record number in the index and check that the
+// rid found has that number in its header
+static void check_lookups(const stid_t& iid, int num_rec)
+{
+    for(int i = 0; i < num_rec; i++) {
+        const vec_t key(&i, sizeof(i));
+        rid_t       rid;
+        smsize_t    len = sizeof(rid);
+        bool        found = false;
+        W_COERCE(ssm->find_assoc(iid, key, &rid, len, found));
+        assert(found && len == sizeof(rid));
+
+        pin_i handle;
+        W_COERCE(handle.pin(rid, 0));
+        assert(*(const int*)handle.hdr() == i);
+    }
+}
+
+void scan_i_hash_lookup(const stid_t& fid, int num_rec,
+        ss_m::concurrency_t cc)
+{
+    cout << "starting hashed lookups of " << num_rec << " records" << endl;
+    stid_t  iid;
+    W_COERCE(ssm->create_index(fid.vol, ss_m::t_uni_btree,
+                ss_m::t_regular, "i4", ss_m::t_cc_kvl, iid));
+    {
+        scan_file_i scan(fid, cc);
+        pin_i*     handle;
+        bool    eof = false;
+        do {
+            W_COERCE(scan.next(handle, 0, eof));
+            if(eof) break;
+            const vec_t key(handle->hdr(), sizeof(int));
+            const vec_t el(&handle->rid(), sizeof(rid_t));
+            W_COERCE(ssm->create_assoc(iid, key, el));
+        } while (1) ;
+    }
+    W_COERCE(ssm->set_adaptive_hash(iid, true));
+
+    // the first pass fills the hash index and the second hits it
+    check_lookups(iid, num_rec);
+    check_lookups(iid, num_rec);
+
+    // moving some entries changes their leaves, so the third
+    // pass finds those hash entries stale
+    for(int i = 0; i < num_rec; i += 10) {
+        const vec_t key(&i, sizeof(i));
+        rid_t       rid;
+        smsize_t    len = sizeof(rid);
+        bool        found = false;
+        W_COERCE(ssm->find_assoc(iid, key, &rid, len, found));
+        const vec_t el(&rid, sizeof(rid));
+        W_COERCE(ssm->destroy_assoc(iid, key, el));
+        W_COERCE(ssm->create_assoc(iid, key, el));
+    }
+    check_lookups(iid, num_rec);
+
+    sm_stats_info_t* stats = new sm_stats_info_t;
+    w_auto_delete_t<sm_stats_info_t>     autodel(stats);
+    W_COERCE(ssm->gather_stats(*stats));
+    cout << "hash hits " << stats->sm.bt_ahi_hit_cnt
+        << " misses " << stats->sm.bt_ahi_miss_cnt
+        << " stale " << stats->sm.bt_ahi_invalid_cnt << endl;
+    assert(stats->sm.bt_ahi_hit_cnt >= (unsigned) num_rec);
+    assert(num_rec < 10 || stats->sm.bt_ahi_invalid_cnt > 0);
+
+    W_COERCE(ssm->destroy_index(iid));
+    cout << "hashed lookups complete" << endl;
+}
+
+// a snapshot must see the file as of its start: no writes committed
+// after it began, no uncommitted writes, and the records deleted since
+static void check_snapshot(const stid_t& fid, int num_rec,
+        ss_m::concurrency_t cc)
+{
+    scan_file_i scan(fid, cc);
+    pin_i*     handle;
+    bool    eof = false;
+    int     i = 0;
+    do {
+        W_COERCE(scan.next(handle, 0, eof));
+        if(eof) break;
+        assert(*(const int*)handle->hdr() == i);
+        assert(handle->body_size() == 0 || handle->body()[0] == rec_byte(0));
+        i++;
+    } while (1) ;
+    assert(i == num_rec);
+}
+
+// commit an update of rid in a transaction of its own
+static void update_committed(const rid_t& rid, char c)
+{
+    const vec_t c_vec(&c, 1);
+    W_COERCE(ssm->begin_xct());
+    W_COERCE(ssm->update_rec(rid, 0, c_vec));
+    W_COERCE(ssm->commit_xct());
+}
+
+// Versions that no running snapshot can see any more must be freed
+// as snapshots end, even after a snapshot that began before any
+// versioned writer committed.
+static void check_snapshot_prune(const rid_t& rid)
+{
+    // no versioned writer has committed yet in this process
+    W_COERCE(ssm->begin_snapshot_xct());
+    W_COERCE(ssm->commit_xct());
+
+    W_COERCE(ssm->begin_snapshot_xct());
+    xct_t*  older = xct();
+    ss_m::detach_xct();
+    update_committed(rid, 'X');
+    W_COERCE(ssm->begin_snapshot_xct());
+    xct_t*  newer = xct();
+    ss_m::detach_xct();
+    update_committed(rid, 'Y');
+
+    sm_stats_info_t* stats = new sm_stats_info_t;
+    w_auto_delete_t<sm_stats_info_t>     autodel(stats);
+    W_COERCE(ssm->gather_stats(*stats));
+    unsigned long pruned = stats->sm.vs_versions_pruned;
+    // only the newer snapshot is left, and it sees the first update
+    // on, so the version from before it goes
+    ss_m::attach_xct(older);
+    W_COERCE(ssm->commit_xct());
+    W_COERCE(ssm->gather_stats(*stats));
+    pruned = stats->sm.vs_versions_pruned - pruned;
+    cout << "versions pruned when the older snapshot ended " 
+        << pruned << endl;
+    assert(pruned > 0);
+
+    ss_m::attach_xct(newer);
+    W_COERCE(ssm->commit_xct());
+    update_committed(rid, rec_byte(0));
+}
+
+void scan_i_snapshot(const stid_t& fid, int num_rec,
+        ss_m::concurrency_t cc)
+{
+    cout << "starting snapshot scan of " << num_rec << " records" << endl;
+    assert(num_rec >= 4);
+    rid_t*  rids = new rid_t[num_rec];
+    {
+        scan_file_i scan(fid, cc);
+        pin_i*     handle;
+        bool    eof = false;
+        int     i = 0;
+        do {
+            W_COERCE(scan.next(handle, 0, eof));
+            if(eof) break;
+            rids[i++] = handle->rid();
+        } while (1) ;
+        assert(i == num_rec);
+    }
+    // the writers below need the file lock this transaction holds
+    W_COERCE(ssm->commit_xct());
+
+    check_snapshot_prune(rids[num_rec-1]);
+
+    const char  z = 'Z';
+    const vec_t z_vec(&z, 1);
+
+    // the first snapshot waits for writers that began before it
+    W_COERCE(ssm->begin_xct());
+    W_COERCE(ssm->update_rec(rids[0], 0, z_vec));
+    xct_t*  early = xct();
+    ss_m::detach_xct();
+    w_rc_t rc = ssm->begin_snapshot_xct(0);
+    assert(rc.is_error() && rc.err_num() == ss_m::eLOCKTIMEOUT);
+    ss_m::attach_xct(early);
+    W_COERCE(ssm->abort_xct());
+
+    W_COERCE(ssm->begin_snapshot_xct());
+    xct_t*  snap = xct();
+    ss_m::detach_xct();
+
+    // a committed writer: update, delete and insert
+    W_COERCE(ssm->begin_xct());
+    for(int i = 0; i < num_rec; i += 2) {
+        W_COERCE(ssm->update_rec(rids[i], 0, z_vec));
+    }
+    W_COERCE(ssm->destroy_rec(rids[1]));
+    {
+        const vec_t hdr(&num_rec, sizeof(num_rec));
+        rid_t       rid;
+        W_COERCE(ssm->create_rec(fid, hdr, 1, z_vec, rid));
+    }
+    W_COERCE(ssm->commit_xct());
+
+    // and one that is still running
+    W_COERCE(ssm->begin_xct());
+    W_COERCE(ssm->update_rec(rids[3], 0, z_vec));
+    xct_t*  pending = xct();
+    ss_m::detach_xct();
+
+    ss_m::attach_xct(snap);
+    check_snapshot(fid, num_rec, cc);
+    {
+        pin_i handle;
+        W_COERCE(handle.pin(rids[1], 0));
+        assert(*(const int*)handle.hdr() == 1);
+    }
+    rc = ssm->update_rec(rids[2], 0, z_vec);
+    assert(rc.is_error() && rc.err_num() == ss_m::eSNAPSHOTUPDATE);
+    W_COERCE(ssm->commit_xct());
+
+    ss_m::attach_xct(pending);
+    W_COERCE(ssm->abort_xct());
+
+    sm_stats_info_t* stats = new sm_stats_info_t;
+    w_auto_delete_t<sm_stats_info_t>     autodel(stats);
+    W_COERCE(ssm->gather_stats(*stats));
+    cout << "versions saved " << stats->sm.vs_versions_saved
+        << " read " << stats->sm.vs_versions_read
+        << " pruned " << stats->sm.vs_versions_pruned << endl;
+    assert(stats->sm.vs_versions_read > 0);
+
+    delete [] rids;
+    // run() commits the transaction it began
+    W_COERCE(ssm->begin_xct());
+    cout << "snapshot scan complete" << endl;
+}
+
+static void pin_header(const rid_t& rid, int i)
+{
+    pin_i handle;
+    W_COERCE(handle.pin(rid, 0));
+    assert(*(const int*)handle.hdr() == i);
+}
+
+// an optimistic transaction that read rid fails at commit once
+// another transaction has changed the record
+static void occ_lose_race(const rid_t& rid, int i, const vec_t& data)
+{
+    W_COERCE(ssm->begin_xct(ss_m::t_xct_optimistic));
+    pin_header(rid, i);
+    xct_t*  reader = xct();
+    ss_m::detach_xct();
+    W_COERCE(ssm->begin_xct());
+    W_COERCE(ssm->update_rec(rid, 0, data));
+    W_COERCE(ssm->commit_xct());
+    ss_m::attach_xct(reader);
+    w_rc_t rc = ssm->commit_xct();
+    assert(rc.is_error() && rc.err_num() == ss_m::eOCCCONFLICT);
+    W_COERCE(ssm->abort_xct());
+}
+
+// an optimistic transaction that looked up key i fails at commit
+// once another transaction has changed the key's leaf
+static void occ_lose_key_race(const stid_t& iid, const rid_t* rids, int i)
+{
+    const vec_t key(&i, sizeof(i));
+    W_COERCE(ssm->begin_xct(ss_m::t_xct_optimistic));
+    {
+        rid_t       rid;
+        smsize_t    len = sizeof(rid);
+        bool        found = false;
+        W_COERCE(ssm->find_assoc(iid, key, &rid, len, found));
+        assert(found);
+    }
+    xct_t*  reader = xct();
+    ss_m::detach_xct();
+    W_COERCE(ssm->begin_xct());
+    {
+        const vec_t el(&rids[i], sizeof(rid_t));
+        W_COERCE(ssm->destroy_assoc(iid, key, el));
+        W_COERCE(ssm->create_assoc(iid, key, el));
+    }
+    W_COERCE(ssm->commit_xct());
+    ss_m::attach_xct(reader);
+    w_rc_t rc = ssm->commit_xct();
+    assert(rc.is_error() && rc.err_num() == ss_m::eOCCCONFLICT);
+    W_COERCE(ssm->abort_xct());
+}
+
+void scan_i_optimistic(const stid_t& fid, int num_rec,
+        ss_m::concurrency_t cc)
+{
+    cout << "starting optimistic transactions on " << num_rec 
+        << " records" << endl;
+    assert(num_rec >= 4);
+    rid_t*  rids = new rid_t[num_rec];
+    {
+        scan_file_i scan(fid, cc);
+        pin_i*     handle;
+        bool    eof = false;
+        int     i = 0;
+        do {
+            W_COERCE(scan.next(handle, 0, eof));
+            if(eof) break;
+            rids[i++] = handle->rid();
+        } while (1) ;
+        assert(i == num_rec);
+    }
+    stid_t  iid;
+    W_COERCE(ssm->create_index(fid.vol, ss_m::t_uni_btree,
+                ss_m::t_regular, "i4", ss_m::t_cc_kvl, iid));
+    for(int i = 0; i < num_rec; i++) {
+        const vec_t key(&i, sizeof(i));
+        const vec_t el(&rids[i], sizeof(rid_t));
+        W_COERCE(ssm->create_assoc(iid, key, el));
+    }
+    W_COERCE(ssm->commit_xct());
+
+    const char  z = 'Z';
+    const vec_t z_vec(&z, 1);
+
+    // read, look up and update; our own update of a page we read
+    // does not fail validation
+    W_COERCE(ssm->begin_xct(ss_m::t_xct_optimistic));
+    pin_header(rids[0], 0);
+    pin_header(rids[1], 1);
+    {
+        int         i = 1;
+        const vec_t key(&i, sizeof(i));
+        rid_t       rid;
+        smsize_t    len = sizeof(rid);
+        bool        found = false;
+        W_COERCE(ssm->find_assoc(iid, key, &rid, len, found));
+        assert(found && rid == rids[1]);
+    }
+    W_COERCE(ssm->update_rec(rids[1], 0, z_vec));
+    W_COERCE(ssm->commit_xct());
+
+    // a record changed after it was read
+    occ_lose_race(rids[2], 2, z_vec);
+
+    // a key changed after it was looked up
+    occ_lose_key_race(iid, rids, 2);
+
+    // a record that another transaction is updating can't be read
+    W_COERCE(ssm->begin_xct());
+    W_COERCE(ssm->update_rec(rids[3], 0, z_vec));
+    xct_t*  writer = xct();
+    ss_m::detach_xct();
+    W_COERCE(ssm->begin_xct(ss_m::t_xct_optimistic));
+    {
+        pin_i handle;
+        w_rc_t rc = handle.pin(rids[3], 0);
+        assert(rc.is_error() && rc.err_num() == ss_m::eOCCCONFLICT);
+    }
+    W_COERCE(ssm->abort_xct());
+    ss_m::attach_xct(writer);
+    W_COERCE(ssm->abort_xct());
+
+    // after three failures in a row, the next one runs with locks
+    sm_stats_info_t* stats = new sm_stats_info_t;
+    w_auto_delete_t<sm_stats_info_t>     autodel(stats);
+    W_COERCE(ssm->gather_stats(*stats));
+    assert(stats->sm.occ_fallback_cnt == 0);
+    W_COERCE(ssm->begin_xct(ss_m::t_xct_optimistic));
+    pin_header(rids[0], 0);
+    W_COERCE(ssm->commit_xct());
+    W_COERCE(ssm->gather_stats(*stats));
+    cout << "optimistic " << stats->sm.occ_xct_cnt
+        << " fallback " << stats->sm.occ_fallback_cnt
+        << " read conflicts " << stats->sm.occ_read_conflict_cnt
+        << " failed validation " << stats->sm.occ_validate_fail_cnt
+        << " locks skipped " << stats->sm.lock_occ_skip_cnt << endl;
+    assert(stats->sm.occ_fallback_cnt == 1);
+    assert(stats->sm.occ_validate_fail_cnt == 2);
+    assert(stats->sm.occ_read_conflict_cnt == 1);
+
+    // and since that one committed, the next one is optimistic again
+    occ_lose_race(rids[0], 0, z_vec);
+
+    // a lookup answered by the adaptive hash index is validated like
+    // one that walked the tree
+    W_COERCE(ssm->begin_xct());
+    W_COERCE(ssm->set_adaptive_hash(iid, true));
+    {
+        // fill in the hash entry
+        int         i = 3;
+        const vec_t key(&i, sizeof(i));
+        rid_t       rid;
+        smsize_t    len = sizeof(rid);
+        bool        found = false;
+        W_COERCE(ssm->find_assoc(iid, key, &rid, len, found));
+    }
+    W_COERCE(ssm->commit_xct());
+    occ_lose_key_race(iid, rids, 3);
+    W_COERCE(ssm->gather_stats(*stats));
+    cout << "adaptive hash hits " << stats->sm.bt_ahi_hit_cnt << endl;
+    assert(stats->sm.bt_ahi_hit_cnt > 0);
+
+    W_COERCE(ssm->begin_xct());
+    W_COERCE(ssm->destroy_index(iid));
+    delete [] rids;
+    // run() commits the transaction it began
+    cout << "optimistic transactions complete" << endl;
+}
+
+void scan_timed(const stid_t& fid, int num_rec,
+        ss_m::concurrency_t cc, char scan_type, int batch_pages,
+        int nworkers)
+{
+    stopwatch_t timer;
+    if(scan_type == 'b') {
+        scan_i_batch_scan(fid, num_rec, cc, batch_pages);
+    } else if(scan_type == 'p') {
+        scan_i_parallel_scan(fid, num_rec, cc, nworkers);
+    } else if(scan_type == 'l') {
+        scan_i_large_read(fid, num_rec, cc);
+    } else if(scan_type == 'u') {
+        scan_i_update(fid, num_rec, cc);
+    } else if(scan_type == 'r') {
+        scan_i_restore(fid, num_rec, cc);
+    } else if(scan_type == 'k') {
+        scan_i_backup(fid, num_rec, cc);
+    } else if(scan_type == 'h') {
+        scan_i_hash_lookup(fid, num_rec, cc);
+    } else if(scan_type == 'v') {
+        scan_i_snapshot(fid, num_rec, cc);
+    } else if(scan_type == 'o') {
+        scan_i_optimistic(fid, num_rec, cc);
+    } else if(scan_type == 'g') {
+        scan_i_ring(fid, num_rec, cc);
+    } else {
+        scan_i_scan(fid, num_rec, cc);
+    }
+    double secs = timer.time();
+    double rate = secs > 0 ? num_rec/secs : 0;
+    cout << "scanned " << num_rec << " records in " << secs << " sec: "
+        << rate << " records/sec" << endl;
+    if(scan_type == 'p') {
+        cout << rate/nworkers << " records/sec per worker" << endl;
+    }
+}
+
 
 /* create an smthread based class for all sm-related work */
 class smthread_user_t : public smthread_t {
@@ -354,8 +1193,39 @@ void smthread_user_t::run()
     int option;
     char* scan_type = 0;
     const char* lock_gran = "f";  // lock granularity (file by default)
-    while ((option = getopt(argc, argv, "n:hil:")) != -1) {
+    int batch_pages = 1;
+    int nworkers = 4;
+    while ((option = getopt(argc, argv, "n:hil:s:p:w:")) != -1) {
     switch (option) {
+    case 's' :
+        scan_type = optarg;
+        if (scan_type[0] != 's' && scan_type[0] != 'b' &&
+            scan_type[0] != 'p' && scan_type[0] != 'l' &&
+            scan_type[0] != 'u' && scan_type[0] != 'h' &&
+            scan_type[0] != 'v' && scan_type[0] != 'o' &&
+            scan_type[0] != 'r' && scan_type[0] != 'k' &&
+            scan_type[0] != 'g') {
+        cerr << "scan type option (-s) must be one of s,b,p,l,u,h,v,o,r,k,g" << endl;
+        retval = 1;
+        return;
+        }
+        break;
+    case 'w' :
+        nworkers = strtol(optarg, 0, 0);
+        if (nworkers < 1) {
+        cerr << "number of workers (-w) must be > 0" << endl;
+        retval = 1;
+        return;
+        }
+        break;
+    case 'p' :
+        batch_pages = strtol(optarg, 0, 0);
+        if (batch_pages < 1) {
+        cerr << "pages per batch (-p) must be > 0" << endl;
+        retval = 1;
+        return;
+        }
+        break;
     case 'n' :
             cmdline_num_rec = strtol(optarg, 0, 0);
             break;
@@ -417,7 +1287,8 @@ void smthread_user_t::run()
 
     cout << "NUM RECORDS " << num_rec << endl;
 
-    rc = setup_device_and_volume(opt_device_name->value(), 
+    device_name = opt_device_name->value();
+    rc = setup_device_and_volume(device_name, 
 				init_device, quota, lvid, num_rec, rec_size, fid, start_rid);
 
 	if (rc.is_error()) {
@@ -436,12 +1307,23 @@ void smthread_user_t::run()
         cout << "lock granularity = " << lock_gran << endl;
         W_COERCE(ssm->begin_xct());
         switch (scan_type[0]) {
-        case 's': {
+        case 's': 
+        case 'b': 
+        case 'p': 
+        case 'l':
+        case 'u':
+        case 'r':
+        case 'k':
+        case 'h':
+        case 'v':
+        case 'o':
+        case 'g': {
             ss_m::concurrency_t cc = ss_m::t_cc_file;
             if (lock_gran[0] == 'r') {
             cc = ss_m::t_cc_record;
             }
-            scan_i_scan(fid, num_rec, cc);
+            scan_timed(fid, num_rec, cc, scan_type[0], batch_pages,
+                    nworkers);
             break;
         }
             break;
@@ -0,0 +1,794 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+#include "w_defines.h"
+
+/*  -- do not edit anything above this line --   </std-header>*/
+
+/*
+ * Tests of the log's optional features, each of which checks the
+ * feature's own statistics, and that restart after a crash finds
+ * what was committed and nothing else.
+ *
+ * A test runs twice.  With -i -c it formats the volume, creates a
+ * file and an index, does its work, and kills itself (SIGKILL)
+ * instead of shutting down, leaving a transaction in flight.
+ * Without -i it restarts from what the first run left behind and
+ * checks the data.  For example:
+ *
+ *     log_test -i -c -t c -sm_log_compact yes
+ *     log_test -t c -sm_log_compact yes
+ *
+ * Tests:
+ *     c   compact log headers (-sm_log_compact yes)
+ *     p   log flush pipelining (-sm_log_flush_pipeline yes or no):
+ *         concurrent commits, and whether log writes overlap fsyncs
+ *     t   mapped log tail (-sm_log_tail file): commits made durable
+ *         in the tail only, and copied to the log by restart
+ *     s   log partition summaries (-sm_log_summary yes or no, with a
+ *         small -sm_logsize): a loser that spans closed partitions
+ */
+
+#include <w_stream.h>
+#include <sys/types.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cstring>
+#include <vector>
+#include "sm_vas.h"
+#include "chkpt.h"
+#include "w_getopt.h"
+ss_m* ssm = 0;
+
+// shorten error code type name
+typedef w_rc_t rc_t;
+
+// this is implemented in options.cpp
+w_rc_t init_config_options(option_group_t& options,
+                        const char* prog_type,
+                        int& argc, char** argv);
+
+// what the first run leaves in the root index for the second
+struct test_info_t {
+    static const char* key;
+    stid_t      fid;
+    stid_t      iid;
+    int         num_rec;
+    int         rec_size;
+};
+const char* test_info_t::key = "LOGTEST";
+
+// the first bytes of every record say which update it has
+const smsize_t version_len = 8;
+
+// test_summary() does this many rounds of inserting keys in the loser
+// and updating every record this many times, each in a transaction
+const int summary_rounds = 4;
+const int summary_keys = 100;
+const int summary_updates = 12;
+
+// overwrites the first bytes of the record with v
+static rc_t update_version(const rid_t& rid, char v)
+{
+    char buf[version_len];
+    memset(buf, v, version_len);
+    const vec_t data(buf, version_len);
+    return ssm->update_rec(rid, 0, data);
+}
+
+/*
+ * Updates every nthreads-th record of rids, from the first on, to
+ * version v, each in a transaction of its own.
+ */
+class commit_thread_t : public smthread_t {
+        const std::vector<rid_t>& _rids;
+        int         _first;
+        int         _nthreads;
+        char        _v;
+public:
+        w_rc_t      rc;
+
+        commit_thread_t(const std::vector<rid_t>& rids, int first,
+                        int nthreads, char v)
+                : smthread_t(t_regular, "commit_thread_t"),
+                _rids(rids), _first(first), _nthreads(nthreads), _v(v) { }
+
+        void run() { rc = do_work(); }
+        w_rc_t do_work() {
+            for(size_t i = _first; i < _rids.size(); i += _nthreads) {
+                W_DO(ssm->begin_xct());
+                W_DO(update_version(_rids[i], _v));
+                W_DO(ssm->commit_xct());
+            }
+            return RCOK;
+        }
+};
+
+void
+usage(option_group_t& options)
+{
+    cerr << "Usage: log_test [-h] [-i [-c]] -t c [options]" << endl;
+    cerr << "       -i initialize device/volume, file and index" << endl;
+    cerr << "       -c crash at the end instead of shutting down" << endl;
+    cerr << "       -t test: c(ompact log headers)" << endl;
+    cerr << "                p(ipelined log flushes)" << endl;
+    cerr << "                t(mapped log tail)" << endl;
+    cerr << "                s(ummaries of log partitions)" << endl;
+    cerr << "Valid options are: " << endl;
+    options.print_usage(true, cerr);
+}
+
+/* create an smthread based class for all sm-related work */
+class smthread_user_t : public smthread_t {
+        int        _argc;
+        char        **_argv;
+
+        const char *_device_name;
+        smsize_t    _quota;
+        int         _num_rec;
+        int         _rec_size;
+        bool        _init;
+        bool        _crash;
+        char        _test;
+        option_group_t* _options;
+        vid_t       _vid;
+        test_info_t _info;
+        std::vector<rid_t> _rids;
+public:
+        int         retval;
+
+        smthread_user_t(int ac, char **av)
+                : smthread_t(t_regular, "smthread_user_t"),
+                _argc(ac), _argv(av),
+                _device_name(NULL),
+                _quota(0),
+                _num_rec(0),
+                _rec_size(100),
+                _init(false),
+                _crash(false),
+                _test(0),
+                _options(NULL),
+                _vid(1),
+                retval(0) { }
+
+        ~smthread_user_t()  { if(_options) delete _options; }
+
+        void run();
+
+        // helpers for run()
+        w_rc_t handle_options();
+        w_rc_t do_init();
+        w_rc_t find_info();
+        w_rc_t find_rids();
+        w_rc_t set_version(char v);
+        w_rc_t check_version(char v) {
+            return check_version(v, 0, _rids.size());
+        }
+        w_rc_t check_version(char v, size_t from, size_t to);
+        w_rc_t insert_keys(int from, int to);
+        w_rc_t check_keys(int count);
+        void   crash();
+
+        // the tests
+        w_rc_t test_compact();
+        w_rc_t test_pipeline();
+        w_rc_t test_tail();
+        w_rc_t test_summary();
+        w_rc_t run_commit_threads(int nthreads, char v);
+};
+
+/*
+ * Formats the device, and creates the volume, a file of _num_rec
+ * records of version '0' and an empty index.
+ */
+rc_t
+smthread_user_t::do_init()
+{
+    devid_t        devid;
+    u_int          vol_cnt;
+    lvid_t         lvid;
+    cout << "Formatting device: " << _device_name
+         << " with a " << _quota << "KB quota ..." << endl;
+    W_DO(ssm->format_dev(_device_name, _quota, true));
+    W_DO(ssm->mount_dev(_device_name, vol_cnt, devid));
+    W_DO(ssm->generate_new_lvid(lvid));
+    W_DO(ssm->create_vol(_device_name, lvid, _quota, false, _vid));
+
+    cout << "Creating a file with " << _num_rec
+         << " records of size " << _rec_size << endl;
+    W_DO(ssm->begin_xct());
+    W_DO(ssm->create_file(_vid, _info.fid, smlevel_3::t_regular));
+    W_DO(ssm->create_index(_vid, smlevel_0::t_btree, smlevel_3::t_regular,
+                           "i4", smlevel_0::t_cc_kvl, _info.iid));
+    char* body = new char[_rec_size];
+    memset(body, '0', _rec_size);
+    vec_t data(body, _rec_size);
+    for(int i = 0; i < _num_rec; i++) {
+        rid_t rid;
+        const vec_t hdr(&i, sizeof(i));
+        W_DO(ssm->create_rec(_info.fid, hdr, _rec_size, data, rid));
+    }
+    delete [] body;
+    _info.num_rec = _num_rec;
+    _info.rec_size = _rec_size;
+
+    stid_t root_iid;
+    W_DO(ss_m::vol_root_index(_vid, root_iid));
+    const vec_t key(test_info_t::key, strlen(test_info_t::key));
+    const vec_t info(&_info, sizeof(_info));
+    W_DO(ss_m::create_assoc(root_iid, key, info));
+    W_DO(ssm->commit_xct());
+    return RCOK;
+}
+
+// mounts the device and finds what do_init left in the root index
+rc_t
+smthread_user_t::find_info()
+{
+    devid_t        devid;
+    u_int          vol_cnt;
+    W_DO(ssm->mount_dev(_device_name, vol_cnt, devid));
+
+    W_DO(ssm->begin_xct());
+    stid_t root_iid;
+    W_DO(ss_m::vol_root_index(_vid, root_iid));
+    const vec_t key(test_info_t::key, strlen(test_info_t::key));
+    smsize_t len = sizeof(_info);
+    bool found = false;
+    W_DO(ss_m::find_assoc(root_iid, key, &_info, len, found));
+    W_DO(ssm->commit_xct());
+    if(!found) {
+        cerr << "No test information found; run with -i first" << endl;
+        return RC(fcASSERT);
+    }
+    return RCOK;
+}
+
+// collects the ids of the file's records
+rc_t
+smthread_user_t::find_rids()
+{
+    _rids.clear();
+    W_DO(ssm->begin_xct());
+    {
+        scan_file_i scan(_info.fid, ss_m::t_cc_file);
+        pin_i*  handle;
+        bool    eof = false;
+        while(true) {
+            W_DO(scan.next(handle, 0, eof));
+            if(eof) break;
+            _rids.push_back(handle->rid());
+        }
+    }
+    W_DO(ssm->commit_xct());
+    if(int(_rids.size()) != _info.num_rec) {
+        cerr << "Found " << _rids.size() << " records, not "
+             << _info.num_rec << endl;
+        return RC(fcASSERT);
+    }
+    return RCOK;
+}
+
+// overwrites the first bytes of every record with v
+rc_t
+smthread_user_t::set_version(char v)
+{
+    for(size_t i = 0; i < _rids.size(); i++) {
+        W_DO(update_version(_rids[i], v));
+    }
+    return RCOK;
+}
+
+// checks that records from .. to-1 are of version v
+rc_t
+smthread_user_t::check_version(char v, size_t from, size_t to)
+{
+    pin_i   handle;
+    for(size_t i = from; i < to; i++) {
+        W_DO(handle.pin(_rids[i], 0));
+        const char* body = handle.body();
+        for(smsize_t k = 0; k < version_len; k++) {
+            if(body[k] != v) {
+                cerr << "Record " << _rids[i] << " has version "
+                     << body[k] << ", not " << v << endl;
+                return RC(fcASSERT);
+            }
+        }
+        handle.unpin();
+    }
+    return RCOK;
+}
+
+// inserts keys from .. to-1 into the index, each with itself
+rc_t
+smthread_user_t::insert_keys(int from, int to)
+{
+    for(int i = from; i < to; i++) {
+        vec_t key(&i, sizeof(i));
+        vec_t el(&i, sizeof(i));
+        W_DO(ssm->create_assoc(_info.iid, key, el));
+    }
+    return RCOK;
+}
+
+// checks that the index holds exactly keys 0 .. count-1
+rc_t
+smthread_user_t::check_keys(int count)
+{
+    for(int i = 0; i <= count; i++) {
+        int el = -1;
+        smsize_t elen = sizeof(el);
+        bool found = false;
+        vec_t key(&i, sizeof(i));
+        W_DO(ssm->find_assoc(_info.iid, key, &el, elen, found));
+        if(found != (i < count) || (found && el != i)) {
+            cerr << "Key " << i << " found " << found
+                 << " element " << el << endl;
+            return RC(fcASSERT);
+        }
+    }
+    return RCOK;
+}
+
+// dies as a crash would: no shutdown, no flushing of anything
+void
+smthread_user_t::crash()
+{
+    cout << "Crashing" << endl;
+    kill(getpid(), SIGKILL);
+}
+
+/*
+ * Compact log headers: commit updates of records and index inserts,
+ * roll some updates back to a savepoint (which compensates compact
+ * records), and crash in the middle of more.  Restart has to redo
+ * and undo the compact records.
+ */
+rc_t
+smthread_user_t::test_compact()
+{
+    if(!smlevel_0::do_log_compact) {
+        cerr << "Run with -sm_log_compact yes" << endl;
+        return RC(fcASSERT);
+    }
+    int n = _info.num_rec;
+    if(!_init) {
+        W_DO(ssm->begin_xct());
+        W_DO(check_version('2'));
+        W_DO(check_keys(n));
+        W_DO(ssm->commit_xct());
+        cout << "Restart recovered the compact records" << endl;
+        return RCOK;
+    }
+
+    sm_stats_info_t before;
+    W_DO(ss_m::gather_stats(before));
+
+    W_DO(ssm->begin_xct());
+    W_DO(set_version('1'));
+    W_DO(insert_keys(0, n));
+    sm_save_point_t sp;
+    W_DO(ssm->save_work(sp));
+    W_DO(set_version('x'));
+    W_DO(ssm->rollback_work(sp));
+    W_DO(check_version('1'));
+    W_DO(set_version('2'));
+    W_DO(ssm->commit_xct());
+
+    sm_stats_info_t after;
+    W_DO(ss_m::gather_stats(after));
+    u_long cnt = after.sm.log_compact_cnt - before.sm.log_compact_cnt;
+    u_long saved = after.sm.log_compact_bytes_saved
+        - before.sm.log_compact_bytes_saved;
+    cout << "log_compact_cnt " << cnt << endl
+         << "log_compact_bytes_saved " << saved << endl;
+    if(cnt < u_long(3*n) || saved == 0) {
+        cerr << "Too few records were written with compact headers" << endl;
+        return RC(fcASSERT);
+    }
+
+    if(_crash) {
+        // a loser for restart to undo
+        W_DO(ssm->begin_xct());
+        W_DO(set_version('3'));
+        W_DO(insert_keys(n, 2*n));
+        W_DO(ss_m::flushlog());
+        crash();
+    }
+    return RCOK;
+}
+
+/*
+ * Log flush pipelining: threads commit small transactions at once,
+ * so that the flush daemon has the next commits to write while an
+ * fsync is in flight.  Those writes are counted in log_write_overlap,
+ * which stays 0 without pipelining.  Then crash with a transaction in
+ * flight; restart has to find every commit.
+ */
+rc_t
+smthread_user_t::test_pipeline()
+{
+    if(!_init) {
+        W_DO(ssm->begin_xct());
+        W_DO(check_version('1'));
+        W_DO(ssm->commit_xct());
+        cout << "Restart recovered every commit" << endl;
+        return RCOK;
+    }
+
+    sm_stats_info_t before;
+    W_DO(ss_m::gather_stats(before));
+
+    W_DO(run_commit_threads(8, '1'));
+
+    sm_stats_info_t after;
+    W_DO(ss_m::gather_stats(after));
+    u_long overlap = after.sm.log_write_overlap
+        - before.sm.log_write_overlap;
+    cout << "log flush pipelining "
+         << (smlevel_0::do_log_flush_pipeline ? "on" : "off") << endl
+         << "log_write_overlap " << overlap << endl;
+    if(smlevel_0::do_log_flush_pipeline ? overlap == 0 : overlap != 0) {
+        cerr << "Unexpected overlap of log writes and fsyncs" << endl;
+        return RC(fcASSERT);
+    }
+
+    if(_crash) {
+        W_DO(ssm->begin_xct());
+        W_DO(set_version('2'));
+        W_DO(ss_m::flushlog());
+        crash();
+    }
+    return RCOK;
+}
+
+/*
+ * Mapped log tail: threads commit small transactions, which are
+ * durable once they are in the tail.  Only a full log buffer wakes
+ * the flush daemon to write them to the log, so once it is done with
+ * those, one more commit is in the tail only.  Crash right after it;
+ * restart has to copy it to the log and find every commit.
+ */
+rc_t
+smthread_user_t::test_tail()
+{
+    if(!_init) {
+        sm_stats_info_t stats;
+        W_DO(ss_m::gather_stats(stats));
+        u_long recovered = stats.sm.log_tail_recovered;
+        cout << "log_tail_recovered " << recovered << endl;
+        if(recovered == 0) {
+            cerr << "Restart copied nothing from the log tail" << endl;
+            return RC(fcASSERT);
+        }
+        W_DO(ssm->begin_xct());
+        W_DO(check_version('2', 0, 1));
+        W_DO(check_version('1', 1, _rids.size()));
+        W_DO(ssm->commit_xct());
+        cout << "Restart recovered every commit" << endl;
+        return RCOK;
+    }
+
+    sm_stats_info_t before;
+    W_DO(ss_m::gather_stats(before));
+
+    W_DO(run_commit_threads(8, '1'));
+
+    sm_stats_info_t after;
+    W_DO(ss_m::gather_stats(after));
+    u_long persists = after.sm.log_tail_persists
+        - before.sm.log_tail_persists;
+    u_long bytes = after.sm.log_tail_bytes - before.sm.log_tail_bytes;
+    cout << "log_tail_persists " << persists << endl
+         << "log_tail_bytes " << bytes << endl;
+    if(persists == 0 || bytes == 0) {
+        cerr << "The commits did not go through the log tail;"
+             << " run with -sm_log_tail <file>" << endl;
+        return RC(fcASSERT);
+    }
+
+    if(_crash) {
+        // let the flush daemon finish writing what it was woken for
+        me()->sleep(500);
+        W_DO(ssm->begin_xct());
+        W_DO(update_version(_rids[0], '2'));
+        W_DO(ssm->commit_xct());
+        crash();
+    }
+    return RCOK;
+}
+
+/*
+ * Log partition summaries: with the checkpoint thread stopped, so that
+ * the master checkpoint stays in the first partition, a loser inserts
+ * keys between transactions that update every record, until the flush
+ * daemon has closed a few partitions (with summaries unless they are
+ * turned off).  Crash with the loser in flight.  Restart analysis
+ * applies the summaries of the closed partitions instead of reading
+ * them, and has to end up with the same state as without them: the
+ * last updates, and none of the loser's keys.
+ */
+rc_t
+smthread_user_t::test_summary()
+{
+    const char last = 'a' + summary_rounds - 1;
+    if(!_init) {
+        sm_stats_info_t stats;
+        W_DO(ss_m::gather_stats(stats));
+        u_long used = stats.sm.log_summaries_used;
+        cout << "log summaries "
+             << (smlevel_0::do_log_summary ? "on" : "off") << endl
+             << "log_summaries_used " << used << endl;
+        if(smlevel_0::do_log_summary ? used == 0 : used != 0) {
+            cerr << "Unexpected number of summaries used" << endl;
+            return RC(fcASSERT);
+        }
+        W_DO(ssm->begin_xct());
+        W_DO(check_version(last));
+        W_DO(check_keys(0));
+        W_DO(ssm->commit_xct());
+        cout << "Restart recovered every commit and undid the loser" << endl;
+        return RCOK;
+    }
+
+    sm_stats_info_t before;
+    W_DO(ss_m::gather_stats(before));
+    smlevel_1::chkpt->retire_chkpt_thread();
+
+    W_DO(ssm->begin_xct());
+    xct_t* loser = me()->xct();
+    ss_m::detach_xct();
+    for(int i = 0; i < summary_rounds; i++) {
+        ss_m::attach_xct(loser);
+        W_DO(insert_keys(i * summary_keys, (i+1) * summary_keys));
+        ss_m::detach_xct();
+
+        for(int k = 0; k < summary_updates; k++) {
+            W_DO(ssm->begin_xct());
+            W_DO(set_version('a' + i));
+            W_DO(ssm->commit_xct());
+        }
+    }
+    ss_m::attach_xct(loser);
+
+    sm_stats_info_t after;
+    W_DO(ss_m::gather_stats(after));
+    u_long written = after.sm.log_summaries_written
+        - before.sm.log_summaries_written;
+    cout << "log_summaries_written " << written << endl;
+    if(smlevel_0::do_log_summary ? written == 0 : written != 0) {
+        cerr << "Unexpected number of summaries written;"
+             << " run with a small -sm_logsize" << endl;
+        return RC(fcASSERT);
+    }
+
+    if(_crash) {
+        W_DO(ss_m::flushlog());
+        crash();
+    }
+    W_DO(ssm->abort_xct());
+    smlevel_1::chkpt->spawn_chkpt_thread();
+    return RCOK;
+}
+
+// updates every record to version v from nthreads threads at once
+rc_t
+smthread_user_t::run_commit_threads(int nthreads, char v)
+{
+    std::vector<commit_thread_t*> threads(nthreads);
+    for(int t = 0; t < nthreads; t++) {
+        threads[t] = new commit_thread_t(_rids, t, nthreads, v);
+        W_DO(threads[t]->fork());
+    }
+    rc_t rc;
+    for(int t = 0; t < nthreads; t++) {
+        W_DO(threads[t]->join());
+        if(threads[t]->rc.is_error() && !rc.is_error()) {
+            rc = threads[t]->rc;
+        }
+        delete threads[t];
+    }
+    return rc;
+}
+
+w_rc_t smthread_user_t::handle_options()
+{
+    option_t* opt_device_name = 0;
+    option_t* opt_device_quota = 0;
+    option_t* opt_num_rec = 0;
+
+    cout << "Processing configuration options ..." << endl;
+
+    const int option_level_cnt = 3;
+
+    _options = new option_group_t (option_level_cnt);
+    if(!_options) {
+        cerr << "Out of memory: could not allocate from heap." <<
+            endl;
+        retval = 1;
+        return RC(fcINTERNAL);
+    }
+    option_group_t &options(*_options);
+
+    W_COERCE(options.add_option("device_name", "device/file name",
+                         NULL, "device containg volume holding the file",
+                         true, option_t::set_value_charstr,
+                         opt_device_name));
+
+    W_COERCE(options.add_option("device_quota", "# > 1000",
+                         "2000", "quota for device",
+                         false, option_t::set_value_long,
+                         opt_device_quota));
+
+    W_COERCE(options.add_option("num_rec", "# > 0",
+                         "1000", "number of records in the file",
+                         false, option_t::set_value_long,
+                         opt_num_rec));
+
+    // Have the SSM add its options to my group.
+    W_COERCE(ss_m::setup_options(&options));
+
+    w_rc_t rc = init_config_options(options, "server", _argc, _argv);
+    if (rc.is_error()) {
+        usage(options);
+        retval = 1;
+        return rc;
+    }
+
+    int option;
+    while ((option = getopt(_argc, _argv, "hict:")) != -1) {
+        switch (option) {
+        case 'i' :
+            _init = true;
+            break;
+
+        case 'c' :
+            _crash = true;
+            break;
+
+        case 't' :
+            _test = optarg[0];
+            break;
+
+        case 'h' :
+            usage(options);
+            break;
+
+        default:
+            usage(options);
+            retval = 1;
+            return RC(fcNOTIMPLEMENTED);
+            break;
+        }
+    }
+    {
+        cout << "Checking for required options...";
+        /* check that all required options have been set */
+        w_ostrstream      err_stream;
+        w_rc_t rc = options.check_required(&err_stream);
+        if (rc.is_error()) {
+            cerr << "These required options are not set:" << endl;
+            cerr << err_stream.c_str() << endl;
+            return rc;
+        }
+        cout << "Options OK; values are: { " << endl;
+        options.print_values(false, cout);
+        cout << "} end list of options values. " << endl;
+    }
+
+    _device_name = opt_device_name->value();
+    _quota = strtol(opt_device_quota->value(), 0, 0);
+    _num_rec = strtol(opt_num_rec->value(), 0, 0);
+    if(_num_rec <= 0 || _test == 0 || (_crash && !_init)) {
+        usage(options);
+        retval = 1;
+        return RC(fcASSERT);
+    }
+
+    return RCOK;
+}
+
+void smthread_user_t::run()
+{
+    w_rc_t rc = handle_options();
+    if(rc.is_error()) {
+        retval = 1;
+        return;
+    }
+
+    cout << "Starting SSM and performing recovery ..." << endl;
+    ssm = new ss_m();
+    if (!ssm) {
+        cerr << "Error: Out of memory for ss_m" << endl;
+        retval = 1;
+        return;
+    }
+
+    rc = _init ? do_init() : find_info();
+    if(!rc.is_error()) {
+        rc = find_rids();
+    }
+    if(!rc.is_error()) {
+        switch(_test) {
+        case 'c':
+            rc = test_compact();
+            break;
+        case 'p':
+            rc = test_pipeline();
+            break;
+        case 't':
+            rc = test_tail();
+            break;
+        case 's':
+            rc = test_summary();
+            break;
+        default:
+            cerr << "Unknown test " << _test << endl;
+            rc = RC(fcNOTIMPLEMENTED);
+            break;
+        }
+    }
+
+    if (rc.is_error()) {
+        cerr << "Test failed: " << endl;
+        cerr << rc << endl;
+        delete ssm;
+        rc = RCOK;   // force deletion of w_error_t info hanging off rc
+                     // otherwise a leak for w_error_t will be reported
+        retval = 1;
+        if(rc.is_error())
+            W_COERCE(rc); // avoid error not checked.
+        return;
+    }
+
+    cout << "\nShutting down SSM ..." << endl;
+    delete ssm;
+
+    cout << "Finished!" << endl;
+
+    return;
+}
+
+int
+main(int argc, char* argv[])
+{
+    smthread_user_t *smtu = new smthread_user_t(argc, argv);
+    if (!smtu)
+            W_FATAL(fcOUTOFMEMORY);
+
+    w_rc_t e = smtu->fork();
+    if(e.is_error()) {
+        cerr << "error forking thread: " << e <<endl;
+        return 1;
+    }
+    e = smtu->join();
+    if(e.is_error()) {
+        cerr << "error forking thread: " << e <<endl;
+        return 1;
+    }
+
+    int        rv = smtu->retval;
+    delete smtu;
+
+    return rv;
+}
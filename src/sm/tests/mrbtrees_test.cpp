@@ -103,6 +103,7 @@ void usage(option_group_t& options)
   cerr << "        \t4) Merge partitions when root1.level > root2.level in MRBtree." << endl;
   cerr << "        \t5) Merge partitions when root1.level < root2.level in MRBtree." << endl;
   cerr << "        \t6) Make equal initial partitions. Then insert the records." << endl;
+  cerr << "        \t8) Run transactions through the partition executor." << endl;
   
   cerr << "Valid options are: " << endl;
   options.print_usage(true, cerr);
@@ -206,6 +207,9 @@ public:
   w_rc_t mr_index_test5();
   w_rc_t mr_index_test6();
   w_rc_t mr_index_test7();
+  w_rc_t mr_index_test8();
+  w_rc_t mr_index_test9();
+  w_rc_t check_batch(int nkeys);
 
   w_rc_t print_the_index();
   w_rc_t static print_updated_rids(vector<rid_t>& old_rids, vector<rid_t>& new_rids);
@@ -982,6 +986,311 @@ rc_t smthread_main_t::mr_index_test7()
     return RCOK;
 }
 
+// partition executor actions on an index of the 1st design
+class pexec_insert_t : public partition_action_t {
+public:
+  int _k;
+  int _v;
+  pexec_insert_t(int k, int v)
+    : partition_action_t(cvec_t(&_k, sizeof(_k)), EX), _k(k), _v(v) {}
+  rc_t run() {
+    el_filler eg;
+    eg._el.put(&_v, sizeof(_v));
+    vec_t key(&_k, sizeof(_k));
+    return ss_m::create_mr_assoc(stid(), key, eg, true, ignore_latches(),
+				 NULL, root());
+  }
+};
+
+class pexec_remove_t : public partition_action_t {
+public:
+  int _k;
+  int _v;
+  pexec_remove_t(int k, int v)
+    : partition_action_t(cvec_t(&_k, sizeof(_k)), EX), _k(k), _v(v) {}
+  rc_t run() {
+    vec_t key(&_k, sizeof(_k));
+    vec_t el(&_v, sizeof(_v));
+    return ss_m::destroy_mr_assoc(stid(), key, el, true, ignore_latches(),
+				  root());
+  }
+};
+
+class pexec_find_t : public partition_action_t {
+public:
+  int _k;
+  int _v;
+  bool _found;
+  pexec_find_t(int k, lock_mode_t mode = SH)
+    : partition_action_t(cvec_t(&_k, sizeof(_k)), mode), _k(k), _v(-1),
+      _found(false) {}
+  rc_t run() {
+    vec_t key(&_k, sizeof(_k));
+    smsize_t len = sizeof(_v);
+    return ss_m::find_mr_assoc(stid(), key, &_v, len, _found, true,
+			       ignore_latches(), root());
+  }
+};
+
+rc_t smthread_main_t::mr_index_test8()
+{
+    cout << endl;
+    cout << " ------- TEST8 -------" << endl;
+    cout << "Test the partition executor!" << endl;
+    cout << endl;
+
+    const int nkeys = 400;
+
+    _design_no = 1;
+    W_DO(ssm->begin_xct());
+    W_DO(create_the_index());
+    W_DO(ssm->commit_xct());
+    for(int i = _num_parts-1; i > 0; i--) {
+      int key = i * nkeys / _num_parts;
+      vec_t key_vec(&key, sizeof(key));
+      W_DO(ssm->begin_xct());
+      W_DO(ssm->add_partition_init(_index_id, key_vec, false));
+      W_DO(ssm->commit_xct());
+    }
+
+    partition_exec_t exec(_index_id, _bIgnoreLatches);
+    W_DO(ssm->begin_xct());
+    W_DO(exec.start());
+    W_DO(ssm->commit_xct());
+    cout << "Started " << exec.num_partitions() << " partition workers" << endl;
+
+    // one transaction inserts into all the partitions
+    {
+      vector<pexec_insert_t*> inserts;
+      partition_xct_t px;
+      W_DO(ssm->begin_xct());
+      for(int k = 0; k < nkeys; k++) {
+	inserts.push_back(new pexec_insert_t(k, 2*k));
+	W_DO(exec.submit(px, *inserts.back()));
+      }
+      W_DO(exec.commit(px));
+      for(size_t i = 0; i < inserts.size(); i++) delete inserts[i];
+    }
+
+    // and finds them all
+    {
+      vector<pexec_find_t*> finds;
+      partition_xct_t px;
+      W_DO(ssm->begin_xct());
+      for(int k = 0; k < nkeys; k++) {
+	finds.push_back(new pexec_find_t(k));
+	W_DO(exec.submit(px, *finds.back()));
+      }
+      W_DO(exec.wait(px));
+      for(int k = 0; k < nkeys; k++) {
+	if(!finds[k]->_found || finds[k]->_v != 2*k) {
+	  cerr << "Key " << k << " found " << finds[k]->_found
+	       << " value " << finds[k]->_v << endl;
+	  return RC(fcASSERT);
+	}
+      }
+      W_DO(exec.commit(px));
+      for(size_t i = 0; i < finds.size(); i++) delete finds[i];
+    }
+
+    // a removal that is rolled back
+    {
+      partition_xct_t px;
+      pexec_remove_t remove(5, 10);
+      W_DO(ssm->begin_xct());
+      W_DO(exec.submit(px, remove));
+      W_DO(exec.wait(px));
+      W_DO(exec.abort(px));
+
+      pexec_find_t find(5);
+      W_DO(ssm->begin_xct());
+      W_DO(exec.submit(px, find));
+      W_DO(exec.commit(px));
+      if(!find._found) {
+	cerr << "Key 5 is gone after the abort" << endl;
+	return RC(fcASSERT);
+      }
+    }
+
+    // wait-die on the workers' key locks
+    {
+      partition_xct_t pold, pyoung, pyounger;
+      W_DO(ssm->begin_xct());
+      xct_t* old_xct = xct();
+      ss_m::detach_xct();
+      W_DO(ssm->begin_xct());
+      xct_t* young_xct = xct();
+
+      pexec_find_t young_find(10, EX);
+      W_DO(exec.submit(pyoung, young_find));
+      W_DO(exec.wait(pyoung));
+      ss_m::detach_xct();
+
+      // the older transaction waits for the younger one
+      ss_m::attach_xct(old_xct);
+      pexec_find_t old_find(10, EX);
+      W_DO(exec.submit(pold, old_find));
+      ss_m::detach_xct();
+
+      ss_m::attach_xct(young_xct);
+      W_DO(exec.commit(pyoung));
+
+      ss_m::attach_xct(old_xct);
+      W_DO(exec.wait(pold));
+      if(!old_find._found || old_find._v != 20) {
+	cerr << "The waiting find did not run" << endl;
+	return RC(fcASSERT);
+      }
+      ss_m::detach_xct();
+
+      // a younger transaction does not wait for an older one
+      W_DO(ssm->begin_xct());
+      pexec_find_t younger_find(10, SH);
+      W_DO(exec.submit(pyounger, younger_find));
+      rc_t rc = exec.commit(pyounger);
+      if(rc.err_num() != ss_m::eDEADLOCK) {
+	cerr << "Expected eDEADLOCK, got " << rc << endl;
+	return RC(fcASSERT);
+      }
+
+      ss_m::attach_xct(old_xct);
+      W_DO(exec.commit(pold));
+    }
+
+    exec.stop();
+
+    sm_stats_info_t stats;
+    W_DO(ss_m::gather_stats(stats));
+    cout << "pexec_action_cnt " << stats.sm.pexec_action_cnt << endl
+	 << "pexec_lock_wait_cnt " << stats.sm.pexec_lock_wait_cnt << endl
+	 << "pexec_lock_die_cnt " << stats.sm.pexec_lock_die_cnt << endl
+	 << "pexec_multi_xct_cnt " << stats.sm.pexec_multi_xct_cnt << endl;
+    if(stats.sm.pexec_lock_wait_cnt < 1 || stats.sm.pexec_lock_die_cnt < 1
+       || (exec.num_partitions() > 1 && stats.sm.pexec_multi_xct_cnt < 1)) {
+      cerr << "Unexpected partition executor statistics" << endl;
+      return RC(fcASSERT);
+    }
+
+    return RCOK;
+}
+
+// looks up keys 0..2*nkeys-1 of _index_id, which holds the even keys
+// k with value 3*k, in one batch, in a scrambled order
+rc_t smthread_main_t::check_batch(int nkeys)
+{
+    const int nprobes = 2*nkeys;
+    vector<int> keys(nprobes);
+    vector<int> values(nprobes, -1);
+    vec_t* key_vecs = new vec_t[nprobes];
+    w_auto_delete_array_t<vec_t> auto_del_key_vecs(key_vecs);
+    vector<sm_assoc_probe_t> probes(nprobes);
+    for(int i = 0; i < nprobes; i++) {
+      keys[i] = (i * 7919) % nprobes; // 7919 is prime
+      key_vecs[i].put(&keys[i], sizeof(int));
+      probes[i].key = &key_vecs[i];
+      probes[i].el = &values[i];
+      probes[i].elen = sizeof(int);
+    }
+
+    W_DO(ssm->begin_xct());
+    if(_design_no == 0) {
+      W_DO(ssm->find_assoc_batch(_index_id, nprobes, &probes[0]));
+    } else {
+      W_DO(ssm->find_mr_assoc_batch(_index_id, nprobes, &probes[0]));
+    }
+    W_DO(ssm->commit_xct());
+
+    for(int i = 0; i < nprobes; i++) {
+      int k = keys[i];
+      bool expected = (k % 2 == 0);
+      if(probes[i].found != expected || (expected && values[i] != 3*k)) {
+	cerr << "Key " << k << " found " << probes[i].found
+	     << " value " << values[i] << endl;
+	return RC(fcASSERT);
+      }
+    }
+    return RCOK;
+}
+
+rc_t smthread_main_t::mr_index_test9()
+{
+    cout << endl;
+    cout << " ------- TEST9 -------" << endl;
+    cout << "Test batched lookups!" << endl;
+    cout << endl;
+
+    const int nkeys = 2000;
+
+    // a conventional btree
+    _design_no = 0;
+    W_DO(ssm->begin_xct());
+    W_DO(create_the_index());
+    for(int k = 0; k < 2*nkeys; k += 2) {
+      int v = 3*k;
+      vec_t key(&k, sizeof(k));
+      vec_t el(&v, sizeof(v));
+      W_DO(ssm->create_assoc(_index_id, key, el));
+    }
+    W_DO(ssm->commit_xct());
+    W_DO(check_batch(nkeys));
+
+    // and a multi-rooted one
+    _design_no = 1;
+    W_DO(ssm->begin_xct());
+    W_DO(create_the_index());
+    W_DO(ssm->commit_xct());
+    for(int i = _num_parts-1; i > 0; i--) {
+      int key = i * 2*nkeys / _num_parts;
+      vec_t key_vec(&key, sizeof(key));
+      W_DO(ssm->begin_xct());
+      W_DO(ssm->add_partition_init(_index_id, key_vec, false));
+      W_DO(ssm->commit_xct());
+    }
+    W_DO(ssm->begin_xct());
+    for(int k = 0; k < 2*nkeys; k += 2) {
+      int v = 3*k;
+      el_filler eg;
+      eg._el.put(&v, sizeof(v));
+      vec_t key(&k, sizeof(k));
+      W_DO(ssm->create_mr_assoc(_index_id, key, eg));
+    }
+    W_DO(ssm->commit_xct());
+    W_DO(check_batch(nkeys));
+
+    sm_stats_info_t stats;
+    W_DO(ss_m::gather_stats(stats));
+    cout << "bt_batch_probe_cnt " << stats.sm.bt_batch_probe_cnt << endl
+	 << "bt_batch_leaf_reuse " << stats.sm.bt_batch_leaf_reuse << endl
+	 << "bt_batch_fallback " << stats.sm.bt_batch_fallback << endl;
+    if(stats.sm.bt_batch_probe_cnt != 4*nkeys
+       || stats.sm.bt_batch_leaf_reuse < nkeys) {
+      cerr << "Unexpected batched lookup statistics" << endl;
+      return RC(fcASSERT);
+    }
+
+    // again from disk, with the prefetch thread reading ahead;
+    // the second batch gets the thread the first one left behind
+    bool prefetch = smlevel_0::do_prefetch;
+    smlevel_0::do_prefetch = true;
+    for(int i = 0; i < 2; i++) {
+      W_DO(ss_m::force_buffers(true));
+      W_DO(check_batch(nkeys));
+    }
+    smlevel_0::do_prefetch = prefetch;
+
+    sm_stats_info_t after;
+    W_DO(ss_m::gather_stats(after));
+    cout << "bf_prefetch_requests "
+	 << after.sm.bf_prefetch_requests - stats.sm.bf_prefetch_requests
+	 << endl;
+    if(after.sm.bf_prefetch_requests == stats.sm.bf_prefetch_requests) {
+      cerr << "Batched lookups did not prefetch" << endl;
+      return RC(fcASSERT);
+    }
+
+    return RCOK;
+}
+
 // prints the btree
 rc_t smthread_main_t::print_the_index() 
 {
@@ -1168,6 +1477,12 @@ rc_t smthread_main_t::no_init()
     case 7:
       W_DO(mr_index_test7()); //
       break;
+    case 8:
+      W_DO(mr_index_test8()); //
+      break;
+    case 9:
+      W_DO(mr_index_test9()); //
+      break;
     }
 
     // scan the file if given in the input
@@ -0,0 +1,625 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+#include "w_defines.h"
+
+/*  -- do not edit anything above this line --   </std-header>*/
+
+/*
+ * Tests of the file scan's optional features, each of which checks
+ * the feature's own statistics, and that every scan returns what it
+ * has to.  Each run formats the volume and creates a file of
+ * -num_rec records of -rec_size bytes, whose headers number them.
+ * For example:
+ *
+ *     scan_test -t j -sm_scan_share yes
+ *
+ * Tests:
+ *     j   shared scans (-sm_scan_share yes): scans of every
+ *         concurrency mode joining each other, then while another
+ *         transaction deletes records and frees their pages
+ */
+
+#include <w_stream.h>
+#include <sys/types.h>
+#include <cstring>
+#include <vector>
+#include "sm_vas.h"
+#include "w_getopt.h"
+ss_m* ssm = 0;
+
+// shorten error code type name
+typedef w_rc_t rc_t;
+
+// this is implemented in options.cpp
+w_rc_t init_config_options(option_group_t& options,
+                        const char* prog_type,
+                        int& argc, char** argv);
+
+// the concurrency modes of the scans in test_share()
+const ss_m::concurrency_t share_cc[] = {
+    ss_m::t_cc_none, ss_m::t_cc_record, ss_m::t_cc_page, ss_m::t_cc_file
+};
+const int share_ncc = sizeof(share_cc) / sizeof(share_cc[0]);
+
+// test_share() scans this many times at least while records go
+const int share_rounds = 2;
+
+// the number in the header of the record on the handle
+static int rec_num(const pin_i* handle)
+{
+    int i;
+    memcpy(&i, handle->hdr(), sizeof(i));
+    return i;
+}
+
+// true if rc is a lock conflict the transaction should be retried for
+static bool must_retry(const rc_t& rc)
+{
+    return rc.err_num() == ss_m::eDEADLOCK
+        || rc.err_num() == ss_m::eLOCKTIMEOUT;
+}
+
+/*
+ * Records which records a scan returns, and checks that none of them
+ * is returned twice, and that it does not miss any of those that
+ * stay in the file.
+ */
+class seen_t {
+        std::vector<char> _seen;
+        int         _keep_from;
+        int         _keep_to;
+public:
+        int         count;
+        int         first;
+
+        seen_t(int num_rec, int keep_from, int keep_to)
+                : _seen(num_rec), _keep_from(keep_from), _keep_to(keep_to),
+                count(0), first(-1) { }
+
+        rc_t add(const pin_i* handle) {
+            int i = rec_num(handle);
+            if(i < 0 || i >= int(_seen.size()) || _seen[i]) {
+                cerr << "Record " << i << " returned twice" << endl;
+                return RC(fcASSERT);
+            }
+            _seen[i] = 1;
+            if(first < 0) first = i;
+            count++;
+            return RCOK;
+        }
+        rc_t check() const {
+            for(int i = 0; i < int(_seen.size()); i++) {
+                if(!_seen[i] && (i < _keep_from || i >= _keep_to)) {
+                    cerr << "Record " << i << " not returned" << endl;
+                    return RC(fcASSERT);
+                }
+            }
+            return RCOK;
+        }
+};
+
+// returns the rest of the scan's records to seen
+static rc_t scan_rest(scan_file_i& scan, seen_t& seen)
+{
+    pin_i*  handle;
+    bool    eof = false;
+    while(true) {
+        W_DO(scan.next(handle, 0, eof));
+        if(eof) break;
+        W_DO(seen.add(handle));
+    }
+    return RCOK;
+}
+
+/*
+ * Scans the file in mode cc, in transactions of its own, over and
+ * over until *done, and at least share_rounds times.  Records from
+ * keep_from to keep_to-1 may go while it does.
+ */
+class share_scan_thread_t : public smthread_t {
+        stid_t      _fid;
+        ss_m::concurrency_t _cc;
+        int         _num_rec;
+        int         _keep_from;
+        int         _keep_to;
+        const bool* _done;
+public:
+        w_rc_t      rc;
+        int         rounds;
+
+        share_scan_thread_t(const stid_t& fid, ss_m::concurrency_t cc,
+                        int num_rec, int keep_from, int keep_to,
+                        const bool* done)
+                : smthread_t(t_regular, "share_scan_thread_t"),
+                _fid(fid), _cc(cc), _num_rec(num_rec),
+                _keep_from(keep_from), _keep_to(keep_to), _done(done),
+                rounds(0) { }
+
+        void run() { rc = do_work(); }
+        w_rc_t do_work() {
+            while(rounds < share_rounds || !*_done) {
+                W_DO(ssm->begin_xct());
+                seen_t  seen(_num_rec, _keep_from, _keep_to);
+                rc_t    e;
+                {
+                    scan_file_i scan(_fid, _cc);
+                    e = scan_rest(scan, seen);
+                }
+                if(must_retry(e)) {
+                    W_DO(ssm->abort_xct());
+                    continue;
+                }
+                W_DO(e);
+                W_DO(seen.check());
+                W_DO(ssm->commit_xct());
+                rounds++;
+            }
+            return RCOK;
+        }
+};
+
+/*
+ * Destroys the records, a page of them in each transaction, so that
+ * their pages are freed once no scan has them locked, and sets *done.
+ */
+class delete_thread_t : public smthread_t {
+        const std::vector<rid_t>& _rids;
+        bool*       _done;
+public:
+        w_rc_t      rc;
+
+        delete_thread_t(const std::vector<rid_t>& rids, bool* done)
+                : smthread_t(t_regular, "delete_thread_t"),
+                _rids(rids), _done(done) { }
+
+        void run() { rc = do_work(); *_done = true; }
+        w_rc_t do_work() {
+            size_t i = 0;
+            while(i < _rids.size()) {
+                size_t end = i;
+                while(end < _rids.size() && _rids[end].pid == _rids[i].pid) {
+                    end++;
+                }
+                W_DO(ssm->begin_xct(1000));
+                rc_t e;
+                for(size_t k = i; k < end && !e.is_error(); k++) {
+                    e = ssm->destroy_rec(_rids[k]);
+                }
+                if(must_retry(e)) {
+                    W_DO(ssm->abort_xct());
+                    me()->sleep(10);
+                    continue;
+                }
+                W_DO(e);
+                W_DO(ssm->commit_xct());
+                i = end;
+            }
+            return RCOK;
+        }
+};
+
+void
+usage(option_group_t& options)
+{
+    cerr << "Usage: scan_test [-h] -t j [options]" << endl;
+    cerr << "       -t test: j(oined scans)" << endl;
+    cerr << "Valid options are: " << endl;
+    options.print_usage(true, cerr);
+}
+
+/* create an smthread based class for all sm-related work */
+class smthread_user_t : public smthread_t {
+        int        _argc;
+        char        **_argv;
+
+        const char *_device_name;
+        smsize_t    _quota;
+        int         _num_rec;
+        int         _rec_size;
+        char        _test;
+        option_group_t* _options;
+        vid_t       _vid;
+        stid_t      _fid;
+        std::vector<rid_t> _rids;
+public:
+        int         retval;
+
+        smthread_user_t(int ac, char **av)
+                : smthread_t(t_regular, "smthread_user_t"),
+                _argc(ac), _argv(av),
+                _device_name(NULL),
+                _quota(0),
+                _num_rec(0),
+                _rec_size(0),
+                _test(0),
+                _options(NULL),
+                _vid(1),
+                retval(0) { }
+
+        ~smthread_user_t()  { if(_options) delete _options; }
+
+        void run();
+
+        // helpers for run()
+        w_rc_t handle_options();
+        w_rc_t do_init();
+
+        // the tests
+        w_rc_t test_share();
+        w_rc_t share_pair(ss_m::concurrency_t cc_a,
+                        ss_m::concurrency_t cc_b);
+        w_rc_t share_deletes();
+};
+
+/*
+ * Formats the device, and creates the volume and a file of _num_rec
+ * records, numbered from 0 in their headers, in _rids in file order.
+ */
+rc_t
+smthread_user_t::do_init()
+{
+    devid_t        devid;
+    u_int          vol_cnt;
+    lvid_t         lvid;
+    cout << "Formatting device: " << _device_name
+         << " with a " << _quota << "KB quota ..." << endl;
+    W_DO(ssm->format_dev(_device_name, _quota, true));
+    W_DO(ssm->mount_dev(_device_name, vol_cnt, devid));
+    W_DO(ssm->generate_new_lvid(lvid));
+    W_DO(ssm->create_vol(_device_name, lvid, _quota, false, _vid));
+
+    cout << "Creating a file with " << _num_rec
+         << " records of size " << _rec_size << endl;
+    W_DO(ssm->begin_xct());
+    W_DO(ssm->create_file(_vid, _fid, smlevel_3::t_regular));
+    char* body = new char[_rec_size];
+    memset(body, 'a', _rec_size);
+    vec_t data(body, _rec_size);
+    for(int i = 0; i < _num_rec; i++) {
+        rid_t rid;
+        const vec_t hdr(&i, sizeof(i));
+        W_DO(ssm->create_rec(_fid, hdr, _rec_size, data, rid));
+    }
+    delete [] body;
+
+    {
+        scan_file_i scan(_fid, ss_m::t_cc_file);
+        pin_i*  handle;
+        bool    eof = false;
+        while(true) {
+            W_DO(scan.next(handle, 0, eof));
+            if(eof) break;
+            if(rec_num(handle) != int(_rids.size())) {
+                cerr << "Record " << rec_num(handle)
+                     << " is out of order" << endl;
+                return RC(fcASSERT);
+            }
+            _rids.push_back(handle->rid());
+        }
+    }
+    W_DO(ssm->commit_xct());
+    return RCOK;
+}
+
+/*
+ * Shared scans: a scan in each concurrency mode starts while one in
+ * each mode is halfway through the file.  It joins that one, unless
+ * it takes no locks, and both return every record once.  Then scans
+ * in every mode but t_cc_none go on joining each other while another
+ * transaction deletes the middle half of the file, freeing pages
+ * they may be about to join at.  (Without locks, a scan can be left
+ * on a freed page whether it shares or not.)
+ */
+rc_t
+smthread_user_t::test_share()
+{
+    if(!smlevel_0::do_scan_share) {
+        cerr << "Run with -sm_scan_share yes" << endl;
+        return RC(fcASSERT);
+    }
+    for(int a = 0; a < share_ncc; a++) {
+        for(int b = 0; b < share_ncc; b++) {
+            W_DO(share_pair(share_cc[a], share_cc[b]));
+        }
+    }
+    cout << "Every pair of scans returned every record once" << endl;
+    return share_deletes();
+}
+
+// scans in modes cc_a and cc_b, with the second joining the first
+rc_t
+smthread_user_t::share_pair(ss_m::concurrency_t cc_a,
+                            ss_m::concurrency_t cc_b)
+{
+    sm_stats_info_t before;
+    W_DO(ss_m::gather_stats(before));
+
+    W_DO(ssm->begin_xct());
+    seen_t  seen_a(_num_rec, 0, _num_rec);
+    seen_t  seen_b(_num_rec, 0, _num_rec);
+    {
+        scan_file_i scan_a(_fid, cc_a);
+        pin_i*  handle;
+        bool    eof = false;
+        while(seen_a.count < _num_rec/2) {
+            W_DO(scan_a.next(handle, 0, eof));
+            if(eof) break;
+            W_DO(seen_a.add(handle));
+        }
+        {
+            scan_file_i scan_b(_fid, cc_b);
+            W_DO(scan_rest(scan_b, seen_b));
+        }
+        W_DO(scan_rest(scan_a, seen_a));
+    }
+    W_DO(seen_a.check());
+    W_DO(seen_b.check());
+    W_DO(ssm->commit_xct());
+
+    sm_stats_info_t after;
+    W_DO(ss_m::gather_stats(after));
+    u_long joined = after.sm.fscan_share_joined
+        - before.sm.fscan_share_joined;
+    cout << "modes " << int(cc_a) << " and " << int(cc_b)
+         << ": fscan_share_joined " << joined
+         << ", second scan started at record " << seen_b.first << endl;
+    bool join = cc_b != ss_m::t_cc_none;
+    if(joined != (join ? 1u : 0u) || (seen_b.first != 0) != join) {
+        cerr << "Unexpected join" << endl;
+        return RC(fcASSERT);
+    }
+    return RCOK;
+}
+
+// scans in every locking mode at once, while the middle half goes
+rc_t
+smthread_user_t::share_deletes()
+{
+    sm_stats_info_t before;
+    W_DO(ss_m::gather_stats(before));
+
+    const int keep_from = _num_rec/4;
+    const int keep_to = 3*_num_rec/4;
+    const std::vector<rid_t> victims(_rids.begin() + keep_from,
+                                     _rids.begin() + keep_to);
+    bool done = false;
+    std::vector<share_scan_thread_t*> scans;
+    for(int c = 0; c < share_ncc; c++) {
+        if(share_cc[c] == ss_m::t_cc_none) continue;
+        scans.push_back(new share_scan_thread_t(_fid, share_cc[c],
+                        _num_rec, keep_from, keep_to, &done));
+        W_DO(scans.back()->fork());
+    }
+    delete_thread_t deleter(victims, &done);
+    W_DO(deleter.fork());
+
+    W_DO(deleter.join());
+    rc_t rc = deleter.rc;
+    int rounds = 0;
+    for(size_t t = 0; t < scans.size(); t++) {
+        W_DO(scans[t]->join());
+        if(scans[t]->rc.is_error() && !rc.is_error()) {
+            rc = scans[t]->rc;
+        }
+        rounds += scans[t]->rounds;
+        delete scans[t];
+    }
+    W_DO(rc);
+
+    W_DO(ssm->begin_xct());
+    seen_t  seen(_num_rec, keep_from, keep_to);
+    {
+        scan_file_i scan(_fid, ss_m::t_cc_file);
+        W_DO(scan_rest(scan, seen));
+    }
+    W_DO(seen.check());
+    W_DO(ssm->commit_xct());
+
+    sm_stats_info_t after;
+    W_DO(ss_m::gather_stats(after));
+    u_long joined = after.sm.fscan_share_joined
+        - before.sm.fscan_share_joined;
+    cout << rounds << " scans while records were deleted"
+         << ": fscan_share_joined " << joined << endl;
+    if(joined == 0) {
+        cerr << "No scan joined another" << endl;
+        return RC(fcASSERT);
+    }
+    if(seen.count != _num_rec - int(victims.size())) {
+        cerr << seen.count << " records left, not "
+             << _num_rec - victims.size() << endl;
+        return RC(fcASSERT);
+    }
+    cout << "Every scan returned every record that stayed once" << endl;
+    return RCOK;
+}
+
+w_rc_t smthread_user_t::handle_options()
+{
+    option_t* opt_device_name = 0;
+    option_t* opt_device_quota = 0;
+    option_t* opt_num_rec = 0;
+    option_t* opt_rec_size = 0;
+
+    cout << "Processing configuration options ..." << endl;
+
+    const int option_level_cnt = 3;
+
+    _options = new option_group_t (option_level_cnt);
+    if(!_options) {
+        cerr << "Out of memory: could not allocate from heap." <<
+            endl;
+        retval = 1;
+        return RC(fcINTERNAL);
+    }
+    option_group_t &options(*_options);
+
+    W_COERCE(options.add_option("device_name", "device/file name",
+                         NULL, "device containg volume holding the file",
+                         true, option_t::set_value_charstr,
+                         opt_device_name));
+
+    W_COERCE(options.add_option("device_quota", "# > 1000",
+                         "2000", "quota for device",
+                         false, option_t::set_value_long,
+                         opt_device_quota));
+
+    W_COERCE(options.add_option("num_rec", "# > 0",
+                         "1000", "number of records in the file",
+                         false, option_t::set_value_long,
+                         opt_num_rec));
+
+    W_COERCE(options.add_option("rec_size", "# > 0",
+                         "1000", "size for records",
+                         false, option_t::set_value_long,
+                         opt_rec_size));
+
+    // Have the SSM add its options to my group.
+    W_COERCE(ss_m::setup_options(&options));
+
+    w_rc_t rc = init_config_options(options, "server", _argc, _argv);
+    if (rc.is_error()) {
+        usage(options);
+        retval = 1;
+        return rc;
+    }
+
+    int option;
+    while ((option = getopt(_argc, _argv, "ht:")) != -1) {
+        switch (option) {
+        case 't' :
+            _test = optarg[0];
+            break;
+
+        case 'h' :
+            usage(options);
+            break;
+
+        default:
+            usage(options);
+            retval = 1;
+            return RC(fcNOTIMPLEMENTED);
+            break;
+        }
+    }
+    {
+        cout << "Checking for required options...";
+        /* check that all required options have been set */
+        w_ostrstream      err_stream;
+        w_rc_t rc = options.check_required(&err_stream);
+        if (rc.is_error()) {
+            cerr << "These required options are not set:" << endl;
+            cerr << err_stream.c_str() << endl;
+            return rc;
+        }
+        cout << "Options OK; values are: { " << endl;
+        options.print_values(false, cout);
+        cout << "} end list of options values. " << endl;
+    }
+
+    _device_name = opt_device_name->value();
+    _quota = strtol(opt_device_quota->value(), 0, 0);
+    _num_rec = strtol(opt_num_rec->value(), 0, 0);
+    _rec_size = strtol(opt_rec_size->value(), 0, 0);
+    if(_num_rec <= 0 || _rec_size <= 0 || _test == 0) {
+        usage(options);
+        retval = 1;
+        return RC(fcASSERT);
+    }
+
+    return RCOK;
+}
+
+void smthread_user_t::run()
+{
+    w_rc_t rc = handle_options();
+    if(rc.is_error()) {
+        retval = 1;
+        return;
+    }
+
+    cout << "Starting SSM and performing recovery ..." << endl;
+    ssm = new ss_m();
+    if (!ssm) {
+        cerr << "Error: Out of memory for ss_m" << endl;
+        retval = 1;
+        return;
+    }
+
+    rc = do_init();
+    if(!rc.is_error()) {
+        switch(_test) {
+        case 'j':
+            rc = test_share();
+            break;
+        default:
+            cerr << "Unknown test " << _test << endl;
+            rc = RC(fcNOTIMPLEMENTED);
+            break;
+        }
+    }
+
+    if (rc.is_error()) {
+        cerr << "Test failed: " << endl;
+        cerr << rc << endl;
+        delete ssm;
+        rc = RCOK;   // force deletion of w_error_t info hanging off rc
+                     // otherwise a leak for w_error_t will be reported
+        retval = 1;
+        if(rc.is_error())
+            W_COERCE(rc); // avoid error not checked.
+        return;
+    }
+
+    cout << "\nShutting down SSM ..." << endl;
+    delete ssm;
+
+    cout << "Finished!" << endl;
+
+    return;
+}
+
+int
+main(int argc, char* argv[])
+{
+    smthread_user_t *smtu = new smthread_user_t(argc, argv);
+    if (!smtu)
+            W_FATAL(fcOUTOFMEMORY);
+
+    w_rc_t e = smtu->fork();
+    if(e.is_error()) {
+        cerr << "error forking thread: " << e <<endl;
+        return 1;
+    }
+    e = smtu->join();
+    if(e.is_error()) {
+        cerr << "error forking thread: " << e <<endl;
+        return 1;
+    }
+
+    int        rv = smtu->retval;
+    delete smtu;
+
+    return rv;
+}
@@ -132,6 +132,8 @@ public:
         w_rc_t vtable_locks();
         w_rc_t vtable_threads();
         w_rc_t vtable_xcts();
+        w_rc_t vtable_lock_profile();
+        w_rc_t vtable_xct_latency();
 
 };
 
@@ -323,8 +325,10 @@ smthread_user_t::scan_the_file()
     W_DO(vtable_locks());
     W_DO(vtable_xcts());
     W_DO(vtable_threads());
+    W_DO(vtable_lock_profile());
 
     W_DO(ssm->commit_xct());
+    W_DO(vtable_xct_latency());
     return RCOK;
 }
 
@@ -527,6 +531,9 @@ void smthread_user_t::run()
         return;
     }
 
+    // time waits on locks and latches from here on
+    W_COERCE(ss_m::enable_lock_profile());
+
     cout << "Getting SSM config info for record size ..." << endl;
 
     sm_config_info_t config_info;
@@ -592,6 +599,28 @@ smthread_user_t::vtable_threads()
     return RCOK;
 }
 
+w_rc_t
+smthread_user_t::vtable_lock_profile() 
+{
+    vtable_t vt;
+    // the 10 locks waited on longest
+    W_DO(ss_m::lock_profile_collect(vt, true, 10));
+    w_ostrstream o;
+    vt.operator<<(o);
+    fprintf(stderr, "Lock waits %s\n", o.c_str());
+    return RCOK;
+}
+
+w_rc_t
+smthread_user_t::vtable_xct_latency() 
+{
+    vtable_t vt;
+    W_DO(ss_m::xct_latency_collect(vt));
+    w_ostrstream o;
+    vt.operator<<(o);
+    fprintf(stderr, "Transaction latency %s\n", o.c_str());
+    return RCOK;
+}
 
 // This was copied from file_scan so it has lots of extra junk
 int
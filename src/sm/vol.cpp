@@ -3465,6 +3465,43 @@ vol_t::first_page(snum_t snum, lpid_t& pid, bool* allocated)
     return RC(eEOF);
 }
 
+/*********************************************************************
+ *
+ *  vol_t::page_range_in_ext(snum, ext, first, last)
+ *
+ *  Return the first and last allocated pids of "snum" in extent "ext".
+ *  If no page of the extent is allocated, return eEOF.
+ *
+ *********************************************************************/
+rc_t
+vol_t::page_range_in_ext(snum_t snum, extnum_t ext, 
+        lpid_t& first, lpid_t& last)
+{
+    first = last = lpid_t::null;
+    if (!_is_valid_ext(ext)) {
+        return RC(eBADPID);
+    }
+
+    extlink_i ei(_epid);
+    const extlink_t* link;
+    W_DO(ei.get(ext, link));
+    if (link->owner != snum) {
+        return RC(eBADSTID);
+    }
+
+    int f = link->first_set(0);
+    if (f < 0) {
+        return RC(eEOF);
+    }
+    int l = link->last_set(ext_sz - 1);
+    w_assert1(l >= f);
+
+    first._stid = last._stid = stid_t(_vid, snum);
+    first.page = ext * ext_sz + f;
+    last.page = ext * ext_sz + l;
+    return RCOK;
+}
+
 /*********************************************************************
  *
  *  vol_t::last_allocated_page(snum, pid)
@@ -4076,6 +4113,7 @@ vol_t::read_page(shpid_t pnum, page_s& page)
      */
     memset(&page, '\0', sizeof(page));
 #endif
+    xct_wait_timer_t w(xct_wait_io); // including any fake latency
     long start = gethrtime();
         /* XXX return errors to caller */
     w_rc_t err = t->pread(_unix_fd, (char *) &page, sizeof(page), offset);
@@ -4108,6 +4146,47 @@ vol_t::read_page(shpid_t pnum, page_s& page)
 }
 
 
+/*********************************************************************
+ *
+ *  vol_t::read_many_pages(pnum, pages, cnt)
+ *
+ *  Read "cnt" pages starting at "pnum" of the volume into the
+ *  buffers "pages" with a single request.
+ *
+ *********************************************************************/
+rc_t
+vol_t::read_many_pages(shpid_t pnum, page_s* const pages, int cnt)
+{
+    w_assert1(pnum > 0 && pnum + cnt <= (shpid_t)(_num_exts * ext_sz));
+    w_assert1(cnt > 0 && cnt <= max_many_pages);
+    fileoff_t offset = fileoff_t(pnum) * sizeof(page_s);
+
+    smthread_t* t = me();
+
+    long start = gethrtime();
+
+    w_rc_t err;
+    {
+        // not around the read_page()s below, which time themselves
+        xct_wait_timer_t w(xct_wait_io);
+        err = t->pread(_unix_fd, (char *) pages, sizeof(page_s)*cnt, offset);
+    }
+    if(err.err_num() == sthread_t::stSHORTIO && err.sys_err_num() == 0) {
+        // read past end of OS file: let read_page sort out
+        // which of the pages are there
+        for (int i = 0; i < cnt; i++) {
+            W_DO(read_page(pnum + i, pages[i]));
+        }
+        return RCOK;
+    }
+    W_COERCE_MSG(err, << "volume id=" << vid());
+
+    fake_disk_latency(start);
+    INC_TSTAT(vol_reads);
+
+    return RCOK;
+}
+
 
 
 /*********************************************************************
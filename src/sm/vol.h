@@ -192,6 +192,11 @@ public:
         shpid_t             page,
         page_s&             buf);
 
+    rc_t                read_many_pages(
+        shpid_t             first_page,
+        page_s*             buf, 
+        int                 cnt);
+
     rc_t            alloc_pages_in_ext(
 		alloc_page_filter_t *filter,
         bool                append_only,
@@ -325,6 +330,12 @@ public:
     lpid_t&                   pid,
     bool*                     allocated = NULL);
 
+    rc_t            page_range_in_ext(
+    snum_t                    fnum,
+    extnum_t                  ext,
+    lpid_t&                   first,
+    lpid_t&                   last);
+
     rc_t            last_allocated_page(
         snum_t                fnum,
         lpid_t&               pid
@@ -0,0 +1,437 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+// -*- mode:c++; c-basic-offset:4 -*-
+
+#define SM_SOURCE
+#define VSTORE_C
+
+#include "sm_int_2.h"
+#include "vstore.h"
+
+#include <cstring>
+#include <map>
+#include <set>
+#include <vector>
+
+/*
+ * A transaction that saved versions.  It outlives the transaction
+ * until the last of its versions is pruned.
+ */
+struct vs_writer_t {
+    w_base_t::uint8_t volatile  stamp;   // commit stamp; 0 until committed
+    bool volatile               aborted; // ended and rolled back
+    int volatile                refs;    // versions, plus the xct's own
+
+    vs_writer_t() : stamp(0), aborted(false), refs(1) {}
+};
+
+/*
+ * The image of a record before writer changed it.
+ */
+struct vs_version_t {
+    vs_version_t*   older;
+    vs_writer_t*    writer;
+    record_t*       image;  // small-record format; 0 if absent
+    smsize_t        size;
+};
+
+/*
+ * Page numbers are unique within a volume, so the store is left out.
+ */
+struct vs_key_t {
+    vid_t           vol;
+    shpid_t         page;
+    slotid_t        slot;
+
+    vs_key_t(const lpid_t& pid, slotid_t s)
+        : vol(pid.vol()), page(pid.page), slot(s) {}
+    bool operator<(const vs_key_t& k) const {
+        if(vol != k.vol) return vol < k.vol;
+        if(page != k.page) return page < k.page;
+        return slot < k.slot;
+    }
+};
+
+typedef std::map<vs_key_t, vs_version_t*> vs_chain_map;
+
+/*
+ * The chains, newest version first, of the records on some pages.
+ * All the slots of a page are in the same shard.
+ */
+struct vs_shard_t {
+    tatas_lock      lock;
+    vs_chain_map    chains;
+} __attribute__((aligned(64)));
+
+enum { vs_shards = 64 };
+static vs_shard_t vs_shard[vs_shards];
+
+static vs_shard_t& vs_shard_for(const lpid_t& pid)
+{
+    w_base_t::uint4_t h = (pid.page * 0x9e3779b1u) ^ pid.vol().vol;
+    return vs_shard[(h >> 16) % vs_shards];
+}
+
+bool volatile version_store_t::_versioning(false);
+
+// guards everything below
+static pthread_mutex_t vs_lock = PTHREAD_MUTEX_INITIALIZER;
+// last commit stamp handed out; starts above 0 so that every
+// snapshot's stamp is non-zero and 0 means "not registered"
+static w_base_t::uint8_t vs_stamp(1);
+static std::multiset<w_base_t::uint8_t> vs_snapshots; // their stamps
+static int vs_nsnapshots(0); // including those still starting
+static bool vs_ready(false); // every update since is versioned
+// oldest running snapshot stamp, or uint8_max; read without the lock
+static w_base_t::uint8_t volatile vs_horizon(w_base_t::uint8_max);
+
+static void vs_release(vs_writer_t* w)
+{
+    if(atomic_dec_nv(w->refs) == 0) delete w;
+}
+
+static void vs_free(vs_version_t* v)
+{
+    vs_release(v->writer);
+    delete [] (char*) v->image;
+    delete v;
+}
+
+static bool vs_visible(const vs_writer_t* w, w_base_t::uint8_t stamp)
+{
+    w_base_t::uint8_t s = w->stamp;
+    return s != 0 && s <= stamp;
+}
+
+/*
+ * Drop the versions no snapshot can see: those of writers that
+ * rolled back, and those from the newest one whose writer every
+ * snapshot sees on.  Returns the new head of the chain.
+ */
+static vs_version_t* vs_prune(vs_version_t* head)
+{
+    vs_version_t** p = &head;
+    while(vs_version_t* v = *p) {
+        w_base_t::uint8_t s = v->writer->stamp;
+        // a snapshot that began before this stamp was handed out
+        // is in the horizon by now
+        membar_consumer();
+        if(s != 0 && s <= vs_horizon) {
+            *p = 0;
+            while(v) {
+                vs_version_t* older = v->older;
+                vs_free(v);
+                INC_TSTAT(vs_versions_pruned);
+                v = older;
+            }
+            break;
+        }
+        if(v->writer->aborted) {
+            *p = v->older;
+            vs_free(v);
+            INC_TSTAT(vs_versions_pruned);
+            continue;
+        }
+        p = &v->older;
+    }
+    return head;
+}
+
+static void vs_sweep(bool all)
+{
+    for(int i=0; i < vs_shards; i++) {
+        vs_shard_t& sh = vs_shard[i];
+        CRITICAL_SECTION(cs, sh.lock);
+        vs_chain_map::iterator it = sh.chains.begin();
+        while(it != sh.chains.end()) {
+            vs_version_t* head = it->second;
+            if(all) {
+                while(head) {
+                    vs_version_t* older = head->older;
+                    vs_free(head);
+                    head = older;
+                }
+            } else {
+                head = vs_prune(head);
+            }
+            if(head) {
+                it->second = head;
+                ++it;
+            } else {
+                sh.chains.erase(it++);
+            }
+        }
+    }
+}
+
+/*
+ * Copy the record in the slot out in the small-record format;
+ * 0 if the slot holds no record.
+ */
+static rc_t vs_copy(file_p& page, slotid_t slot, record_t*& image,
+        smsize_t& size)
+{
+    image = 0;
+    size = 0;
+    record_t* rec;
+    if(page.get_rec(slot, rec).is_error()) return RCOK;
+
+    smsize_t hdr_size = rec->hdr_size();
+    smsize_t body_size = rec->body_size();
+    size = w_offsetof(record_t, info) + align(hdr_size) + body_size;
+    if(size < sizeof(record_t)) size = sizeof(record_t);
+    char* buf = new char[size];
+    if(!buf) W_FATAL(smlevel_0::eOUTOFMEMORY);
+
+    record_t* copy = (record_t*) buf;
+    copy->tag = rec->tag;
+    copy->tag.flags = t_small;
+    memcpy(copy->info, rec->hdr(), hdr_size);
+    char* body = buf + copy->body_offset();
+    if(rec->is_small()) {
+        memcpy(body, rec->body(), body_size);
+    } else {
+        rc_t rc = file_m::read_large(page, slot, 0, body_size, body);
+        if(rc.is_error()) {
+            delete [] buf;
+            return rc;
+        }
+    }
+    image = copy;
+    return RCOK;
+}
+
+rc_t version_store_t::before_update(file_p& page, slotid_t slot)
+{
+    xct_t* xd = xct();
+    if(!xd) return RCOK;
+    w_assert1(!xd->is_snapshot());
+
+    if(!xd->_vs_wrote) {
+        // a snapshot that starts from now on either waits for us or
+        // makes us save versions; see begin_snapshot
+        xd->_vs_wrote = true;
+        membar_enter();
+    }
+    if(!versioning()) return RCOK;
+
+    vs_writer_t* w = xd->_vs_writer;
+    if(!w) w = xd->_vs_writer = new vs_writer_t;
+
+    vs_key_t key(page.pid(), slot);
+    vs_shard_t& sh = vs_shard_for(page.pid());
+    {
+        CRITICAL_SECTION(cs, sh.lock);
+        vs_chain_map::const_iterator it = sh.chains.find(key);
+        if(it != sh.chains.end() && it->second->writer == w) {
+            // we saved the image from before our first change
+            return RCOK;
+        }
+    }
+
+    // Only the holder of the EX latch adds to the chain of a slot on
+    // the page, so the head can't have changed when we push.
+    vs_version_t* v = new vs_version_t;
+    if(!v) W_FATAL(smlevel_0::eOUTOFMEMORY);
+    rc_t rc = vs_copy(page, slot, v->image, v->size);
+    if(rc.is_error()) {
+        delete v;
+        return rc;
+    }
+    v->writer = w;
+    atomic_inc(w->refs);
+
+    {
+        CRITICAL_SECTION(cs, sh.lock);
+        vs_version_t*& head = sh.chains[key];
+        v->older = head ? vs_prune(head) : 0;
+        head = v;
+    }
+    INC_TSTAT(vs_versions_saved);
+    return RCOK;
+}
+
+/*
+ * Walk the chain past the writers the snapshot can't see.
+ */
+static const vs_version_t* vs_find(vs_shard_t& sh, const vs_key_t& key,
+        w_base_t::uint8_t stamp)
+{
+    vs_chain_map::const_iterator it = sh.chains.find(key);
+    if(it == sh.chains.end()) return 0;
+    const vs_version_t* use = 0;
+    for(const vs_version_t* v = it->second; v; v = v->older) {
+        if(vs_visible(v->writer, stamp)) break;
+        use = v;
+    }
+    return use;
+}
+
+version_store_t::lookup_t
+version_store_t::lookup(xct_t* xd, const rid_t& rid, record_t** copy)
+{
+    w_assert1(xd->is_snapshot());
+    if(copy) *copy = 0;
+
+    vs_shard_t& sh = vs_shard_for(rid.pid);
+    CRITICAL_SECTION(cs, sh.lock);
+    const vs_version_t* v = vs_find(sh, vs_key_t(rid.pid, rid.slot),
+            xd->snapshot_stamp());
+    if(!v) return vs_current;
+    if(!v->image) return vs_absent;
+    if(copy) {
+        char* buf = new char[v->size];
+        if(!buf) W_FATAL(smlevel_0::eOUTOFMEMORY);
+        memcpy(buf, v->image, v->size);
+        *copy = (record_t*) buf;
+    }
+    INC_TSTAT(vs_versions_read);
+    return vs_old;
+}
+
+slotid_t version_store_t::next_slot(xct_t* xd, file_p& page, slotid_t curr)
+{
+    w_assert1(xd->is_snapshot());
+    lpid_t pid = page.pid();
+    vs_shard_t& sh = vs_shard_for(pid);
+    CRITICAL_SECTION(cs, sh.lock);
+    // deleted records leave their slots behind, so nslots covers them
+    for(slotid_t s = curr+1; s < page.num_slots(); s++) {
+        const vs_version_t* v = vs_find(sh, vs_key_t(pid, s),
+                xd->snapshot_stamp());
+        if(v ? v->image != 0 : page.is_tuple_valid(s)) return s;
+    }
+    return 0;
+}
+
+/*
+ * Wait for the transactions that may have updated records without
+ * saving versions.
+ */
+rc_t version_store_t::_quiesce(xct_t* self)
+{
+    std::vector<tid_t> busy;
+    {
+        // no transaction ends while we look
+        xct_i iter;
+        while(xct_t* xd = iter.next()) {
+            if(xd != self && xd->_vs_wrote) busy.push_back(xd->tid());
+        }
+    }
+    if(busy.empty()) return RCOK;
+
+    INC_TSTAT(vs_quiesce_waits);
+    timeout_in_ms timeout = self->timeout_c();
+    hrtime_t start = gethrtime();
+    for(size_t i=0; i < busy.size(); i++) {
+        while(xct_t::look_up(busy[i])) {
+            if(timeout != WAIT_FOREVER &&
+                    gethrtime() - start >= hrtime_t(timeout) * 1000000) {
+                return RC(eLOCKTIMEOUT);
+            }
+            me()->sleep(1, "vs_quiesce");
+        }
+    }
+    return RCOK;
+}
+
+rc_t version_store_t::begin_snapshot(xct_t* xd)
+{
+    w_assert1(!xd->_snapshot && !xd->_vs_wrote);
+    xd->force_readonly();
+    xd->_snapshot = true;
+    bool ready;
+    {
+        CRITICAL_SECTION(cs, vs_lock);
+        vs_nsnapshots++;
+        _versioning = true;
+        ready = vs_ready;
+    }
+    // pairs with the barrier in before_update
+    membar_enter();
+    if(!ready) {
+        W_DO(_quiesce(xd));
+        CRITICAL_SECTION(cs, vs_lock);
+        vs_ready = true;
+    }
+
+    CRITICAL_SECTION(cs, vs_lock);
+    xd->_snapshot_stamp = vs_stamp;
+    vs_snapshots.insert(vs_stamp);
+    vs_horizon = *vs_snapshots.begin();
+    INC_TSTAT(snapshot_xct_cnt);
+    return RCOK;
+}
+
+void version_store_t::end_writer(xct_t* xd, bool committed)
+{
+    vs_writer_t* w = xd->_vs_writer;
+    xd->_vs_writer = 0;
+    if(committed) {
+        // stamps must be handed out in the order that snapshots
+        // see them
+        CRITICAL_SECTION(cs, vs_lock);
+        w->stamp = ++vs_stamp;
+    } else {
+        w->aborted = true;
+    }
+    vs_release(w);
+}
+
+void version_store_t::end_snapshot(xct_t* xd)
+{
+    w_assert1(xd->_snapshot);
+    bool last, advanced = false;
+    {
+        CRITICAL_SECTION(cs, vs_lock);
+        // no stamp if begin_snapshot failed before registering one
+        if(xd->_snapshot_stamp) {
+            std::multiset<w_base_t::uint8_t>::iterator it =
+                vs_snapshots.find(xd->_snapshot_stamp);
+            w_assert1(it != vs_snapshots.end());
+            vs_snapshots.erase(it);
+            w_base_t::uint8_t h = vs_snapshots.empty()?
+                w_base_t::uint8_max : *vs_snapshots.begin();
+            advanced = (h != vs_horizon);
+            vs_horizon = h;
+        }
+        last = (--vs_nsnapshots == 0);
+        if(last) {
+            _versioning = false;
+            vs_ready = false;
+        }
+    }
+    xd->_snapshot = false;
+    xd->_snapshot_stamp = 0;
+
+    // Writers that saw the flag before it went down may still add a
+    // version or two after the purge; those are pruned like any other
+    // once versioning is back on.
+    if(last || advanced) vs_sweep(last);
+}
+
+void version_store_t::shutdown()
+{
+    vs_sweep(true);
+}
@@ -0,0 +1,116 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+// -*- mode:c++; c-basic-offset:4 -*-
+
+#ifndef VSTORE_H
+#define VSTORE_H
+
+#include "w_defines.h"
+
+class file_p;
+class record_t;
+class xct_t;
+struct vs_writer_t;
+
+/**\brief In-memory store of old record versions, for snapshot
+ * transactions.
+ *
+ * \details
+ * A snapshot transaction (ss_m::begin_snapshot_xct) reads the
+ * records of files as of the moment it began, without taking record
+ * or page locks, so it neither waits for writers nor makes them wait.
+ *
+ * While at least one snapshot transaction is running, file_m saves
+ * the image of a record in this store before a transaction changes
+ * it for the first time (before_update).  Each record has a chain
+ * of such images, newest first, each tagged with the writer that
+ * replaced it.  A writer gets a commit stamp when it commits; a
+ * snapshot gets the latest stamp when it begins, and sees the
+ * changes of the writers whose stamps are no later than its own.
+ * To read a record, a snapshot walks the chain past the writers it
+ * cannot see and takes the image the oldest of them replaced.  An
+ * image of a record that did not exist yet is saved as "absent".
+ *
+ * Images are copied out in the small-record format, so a snapshot
+ * never follows a large record's data pages once they have changed.
+ *
+ * Versions are pruned as soon as no running snapshot can see them,
+ * and all of them are thrown away when the last snapshot ends.
+ * When there are no snapshots, before_update costs one test of a
+ * global flag.  Pages are not freed while versions are kept, so that
+ * a snapshot can still find the records that were deleted.
+ */
+class version_store_t : public smlevel_0 {
+public:
+    /// What a snapshot sees in a slot.
+    enum lookup_t {
+        vs_current,  // the record on the page
+        vs_old,      // an older image
+        vs_absent    // no record
+    };
+
+    /// True while versions are being saved.
+    static bool     versioning() { return *&_versioning; }
+
+    /**\brief Save the current image of a record that the running
+     * transaction is about to change.
+     * \details
+     * The page must be fixed EX.  A slot that holds no record is
+     * saved as absent, i.e. call this before creating a record, too.
+     */
+    static rc_t     before_update(file_p& page, slotid_t slot);
+
+    /**\brief Find the version of a record that a snapshot sees.
+     * \details
+     * The record's page must be fixed.  If the result is vs_old and
+     * \e copy is not null, a copy of the image is returned in
+     * \e copy; the caller frees it with delete [] (char*).
+     */
+    static lookup_t lookup(xct_t* xd, const rid_t& rid, record_t** copy);
+
+    /// Like file_p::next_slot, but return the slots a snapshot sees.
+    static slotid_t next_slot(xct_t* xd, file_p& page, slotid_t curr);
+
+    /**\brief Make \e xd, which has just begun, a snapshot.
+     * \details
+     * The first snapshot to begin waits for the transactions that
+     * updated records before versions were being saved, giving up
+     * with eLOCKTIMEOUT after the transaction's timeout.
+     */
+    static rc_t     begin_snapshot(xct_t* xd);
+
+    // called by xct_t as a transaction ends
+    static void     end_writer(xct_t* xd, bool committed);
+    static void     end_snapshot(xct_t* xd);
+
+    // Clean up for shutting down storage manager.
+    static void     shutdown();
+
+private:
+    static rc_t     _quiesce(xct_t* self);
+
+    static bool volatile        _versioning;
+};
+
+#endif
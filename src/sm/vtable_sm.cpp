@@ -63,7 +63,9 @@ class prologue_rc_t;
  *  ss_m::lock_collect()                            *
  *  ss_m::bp_collect()                                    *
  *  ss_m::thread_collect()                            *
+ *  ss_m::lock_profile_collect()                        *
  *  ss_m::xct_collect()                                    *
+ *  ss_m::xct_latency_collect()                            *
  *  ss_m::stats_collect()                                *
  *  wrappers for hidden things                                  *
  *--------------------------------------------------------------*/
@@ -79,6 +81,13 @@ ss_m::xct_collect( vtable_t & res, bool names_too)
     return RC(eOUTOFMEMORY);
 }
 rc_t
+ss_m::xct_latency_collect( vtable_t & res, bool names_too, bool reset) 
+{
+    if(xct_t::latency_collect(res, names_too)) return RC(eOUTOFMEMORY);
+    if(reset) xct_t::latency_reset();
+    return RCOK;
+}
+rc_t
 ss_m::lock_collect( vtable_t& res, bool names_too) 
 {
     if(lm->collect(res, names_too)==0) return RCOK;
@@ -110,3 +119,32 @@ ss_m::thread_collect( vtable_t & res, bool names_too)
     if(smthread_t::collect(res, names_too)==0) return RCOK;
     return RC(eOUTOFMEMORY);
 }
+
+rc_t
+ss_m::enable_lock_profile(bool reset) 
+{
+    lock_profile_t::enable(reset);
+    return RCOK;
+}
+
+rc_t
+ss_m::disable_lock_profile() 
+{
+    lock_profile_t::disable();
+    return RCOK;
+}
+
+/**\brief Collect a virtual table of lock and latch waits.
+ *
+ * \details
+ * See also:
+ * - lock_profile_attr_index (index into attributes of a
+ * vtable_row_t for a lock).
+ */
+rc_t
+ss_m::lock_profile_collect( vtable_t & res, bool names_too, int top_n,
+        bool by_site) 
+{
+    if(lock_profile_t::collect(res, names_too, top_n, by_site)==0) return RCOK;
+    return RC(eOUTOFMEMORY);
+}
@@ -60,11 +60,102 @@ const char *xct_vtable_attr_names[] = {
     "Tid",
     "State",
     "Coord",
-    "Force-readonly"
+    "Force-readonly",
+    "Age us",
+    "Lock wait us",
+    "Latch wait us",
+    "IO wait us",
+    "Log flush wait us",
+    "Log space wait us"
 };
 
 static vtable_names_init_t names_init(xct_last, xct_vtable_attr_names);
 
+const char *xct_latency_attr_names[] = {
+    "Wait kind",
+    "Xcts",
+    "Total us",
+    "Max us",
+    "p50 us",
+    "p99 us",
+    "<4us",
+    "<16us",
+    "<64us",
+    "<256us",
+    "<1ms",
+    "<4ms",
+    "<16ms",
+    "<66ms",
+    "<262ms",
+    "<1s",
+    ">=1s"
+};
+
+static vtable_names_init_t latency_names_init(xct_latency_last, 
+        xct_latency_attr_names);
+
+// row names of the latency table: the xct_wait_ts, then whole xcts
+static const char *xct_latency_kinds[xct_wait_kinds+1] = {
+    "lock",
+    "latch",
+    "io",
+    "log flush",
+    "log space",
+    "xct"
+};
+
+/**\brief One row of the latency vtable. */
+struct xct_latency_row_t {
+    const char*                 kind;
+    const xct_latency_hist_t*   h;
+
+    void vtable_collect(vtable_row_t &t) {
+        t.set_string(xct_latency_kind_attr, kind);
+        t.set_base(xct_latency_count_attr, w_base_t::base_stat_t(h->count()));
+        t.set_base(xct_latency_total_us_attr, 
+                w_base_t::base_stat_t(h->total_us));
+        t.set_base(xct_latency_max_us_attr, w_base_t::base_stat_t(h->max_us));
+        t.set_base(xct_latency_p50_us_attr, 
+                w_base_t::base_stat_t(h->percentile_us(0.50)));
+        t.set_base(xct_latency_p99_us_attr, 
+                w_base_t::base_stat_t(h->percentile_us(0.99)));
+        for(int b=0; b < xct_latency_hist_t::buckets; b++) {
+            t.set_base(xct_latency_bucket_attr+b, 
+                    w_base_t::base_stat_t(h->hist[b]));
+        }
+    }
+    static void vtable_collect_names(vtable_row_t &t) {
+        latency_names_init.collect_names(t);
+    }
+};
+
+/**\brief Collect the transaction latency histograms.
+ * \details
+ * The last row is the latency of whole transactions, from begin to
+ * the end of commit or abort; the others count only the transactions
+ * that waited for that kind of thing at all.
+ */
+int
+xct_t::latency_collect( vtable_t& v, bool names_too)
+{
+    w_assert1(xct_latency_last - xct_latency_bucket_attr 
+            == xct_latency_hist_t::buckets);
+    int n = xct_wait_kinds+1;
+    if(names_too) n++;
+    // totals may be wider than the attribute names
+    int size = latency_names_init.max_size();
+    if(size < 24) size = 24;
+    if(v.init(n, xct_latency_last, size)) 
+        return -1;
+    vtable_func<xct_latency_row_t> f(v);
+    if(names_too) f.insert_names();
+    for(int w=0; w <= xct_wait_kinds; w++) {
+        xct_latency_row_t row = { xct_latency_kinds[w], &_latency[w] };
+        f(row);
+    }
+    return 0; //no error
+}
+
 int
 xct_t::collect( vtable_t& v, bool names_too)
 {
@@ -132,6 +223,12 @@ xct_t::vtable_collect(vtable_row_t &t)
     // xct_forced_readonly_attr
     t.set_string(xct_forced_readonly_attr, 
             (forced_readonly()?"true":"false"));
+
+    t.set_base(xct_age_us_attr, w_base_t::base_stat_t(age()/1000));
+    for(int w=0; w < xct_wait_kinds; w++) {
+        t.set_base(xct_lock_wait_us_attr+w, 
+                w_base_t::base_stat_t(wait_time(xct_wait_t(w))/1000));
+    }
 }
 
 void        
@@ -59,6 +59,8 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 #define XCT_C
 
 #include <new>
+#include <algorithm>
+#include <cstring>
 #define SM_LEVEL 0
 #include "sm_int_1.h"
 
@@ -82,6 +84,7 @@ Rome Research Laboratory Contract No. F30602-97-2-0247.
 #include <sstream>
 #include "crash.h"
 #include "chkpt.h"
+#include "vstore.h"
 
 #ifdef EXPLICIT_TEMPLATE
 template class w_list_t<xct_t, queue_based_lock_t>;
@@ -119,20 +122,32 @@ SPECIALIZE_CS(xct_t, int _dummy, (_dummy=0),
 
 /*********************************************************************
  *
- *  The xct list is sorted for easy access to the oldest and
- *  youngest transaction. All instantiated xct_t objects are
- *  in the list.
+ *  The registry of active transactions, and tid allocation.
  *
- *  Here are the transaction list and the mutex that protects it.
+ *  Every xct_t that holds a tid is registered here from the time it
+ *  begins until it ends.
  *
  *********************************************************************/
 
-/* There are several ways we need to protect the list of active
+/* There are several ways we need to protect the registry of active
    transactions:
 
-   1. We must always know the oldest and newest transaction (ie the
-      list is sorted). This is accomplished by virtue of the list
-      being a variant of the MCS spinlock.
+   1. Beginning and ending a transaction must not touch any cache
+      line that all threads share. The registry is split into slabs,
+      and a thread registers its transactions in the slab picked by
+      its thread id, under that slab's own spin lock, so only threads
+      that share a slab ever contend. Each slab keeps a count and the
+      smallest tid registered in it, so num_active_xcts() and
+      oldest_tid() read one slab header each and take no locks.
+
+      Tids come from per-thread ranges of tid_batch tids carved off
+      the global counter. They still name transactions uniquely and
+      in a total order, but only roughly in order of age: a thread
+      may hand out a tid from its range after another thread has
+      taken a larger one. So oldest_tid() is the smallest tid of the
+      transactions registered right now, which is what
+      page_s::space_t::_check_reserve needs (whoever reserved space on
+      a page was registered when it did so).
 
    2. No transaction is allowed to change state during a checkpoint
       because of a race between making the change and logging it. The
@@ -151,60 +166,212 @@ SPECIALIZE_CS(xct_t, int _dummy, (_dummy=0),
       split apart properly so checkpointing doesn't interfere with
       normal operation so much -- FRJ
 
-   3. No transaction's list node may be freed while iteration is in
-      progress (this is orthogonal to #2 -- checkpointing happens to
-      do #3 as part of #2, but #3 can happen by itself). We accomplish
-      this by reference counting all iterators; garbage collection
-      does not occur if the count is nonzero.
-
-   4. Mount/dismount cannot begin while any transaction is active, and
-      no transaction may begin while a (dis)mount is in progress. We
-      enforce these conditions by attempting to add a fake transaction
-      to the list; if the list is not empty the attempt fails and
-      dis(mount) cannot begin. Otherwise we purposefully delay
-      propagating the tid, preventing any new transaction(s) from
-      acquiring a tid until the operation completes.
+   3. No transaction may be freed while an iterator is looking at
+      it. Transactions leave the registry only when they end (with
+      chkpt_serial_m held for read) or through xct_i::erase_and_next,
+      and an xct_i holds chkpt_serial_m for write unless its creator
+      already does. That makes chkpt_serial_m the grace period: an
+      iterator takes a snapshot of the registry, sorted by tid, when
+      it is created, and everything in the snapshot stays valid until
+      the iterator goes away.
  */
 
-enum { NODE_DELETED=-2, NODE_LEFT=-1, NODE_ACTIVE, NODE_HEAD };
-
-struct xct_link {
-    xct_link*	_next;
-    tid_t	_tid;
-    xct_t*	_owner;
-    int		_node_state;
-    bool 	_fake;
-    xct_link volatile* 		vthis() { return this; }
-    xct_link(xct_t* owner, bool fake=false)
-	: _next(0), _owner(owner), _node_state(NODE_ACTIVE), _fake(fake)
+enum { xct_slabs = 32, xct_slab_slots = 16, tid_batch = 32 };
+
+/* A read of an optimistic transaction: see xct_t::occ_read. */
+struct occ_read_t {
+    lockid_t    name;   // the lock not taken
+    lpid_t      pid;    // the page read
+    lsn_t       lsn;    // its lsn at the time
+    bool        read;   // pid and lsn are set
+
+    bool operator<(const occ_read_t& other) const { return pid < other.pid; }
+};
+
+
+struct xct_slot_t {
+    xct_t*      xd;     // null if the slot is free
+    tid_t       tid;
+
+    xct_slot_t() : xd(0) { }
+
+    bool operator<(const xct_slot_t &other) const {
+        return tid < other.tid;
+    }
+};
+
+/* One slab of the registry.  Slabs are aligned so that no two
+   share a cache line.
+ */
+struct xct_slab_t {
+    tatas_lock          _lock;  // protects everything below
+    int volatile        _count;
+    tid_t::datum_t volatile _min_tid; // smallest registered, w_base_t::uint8_max if empty
+    int                 _capacity;
+    xct_slot_t*         _slots;
+    xct_slot_t          _first_slots[xct_slab_slots];
+
+    xct_slab_t()
+        : _count(0), _min_tid(w_base_t::uint8_max), _capacity(xct_slab_slots),
+          _slots(_first_slots)
     {
     }
-    int cas_state(int expected, int to_assign) {
-	return atomic_cas_32((unsigned int*) &_node_state, expected, to_assign);
+    ~xct_slab_t() {
+        w_assert1(_count == 0);
+        if(_slots != _first_slots) delete [] _slots;
     }
-    xct_link* _reclaim_and_next(xct_link* sentinel);
-};
 
-struct xct_list {
-    xct_list();
-    ~xct_list();
-    void insert(xct_link* xd);
-    void insert_existing_unsafe(xct_t* xd);
-    void remove(xct_link* xd);
-    tid_t oldest_tid() { return anchor()->_tid.next(); }
+    int insert(xct_t* xd, const tid_t &t);
+    void remove(int slot);
+} __attribute__((aligned(64)));
+
+struct xct_registry_t {
+    xct_slab_t                  _slabs[xct_slabs];
+    // tids below this one have been handed out to threads
+    tid_t::datum_t volatile     _tid_next;
+    // bumped whenever _tid_next is moved past the per-thread ranges
+    int volatile                _tid_gen;
+
+    xct_registry_t() : _tid_next(tid_t::null.next().get_value()), _tid_gen(0) { }
+
+    void insert(xct_t* xd, const tid_t &t);
+    void remove(xct_t* xd);
+    tid_t new_tid();
+    void note_tid(const tid_t &t);
+    xct_t* look_up(const tid_t &t);
+    tid_t oldest_tid();
+    tid_t youngest_tid() { return tid_t(*&_tid_next).prev(); }
+    int count();
+} _xlist;
+
+// this thread's range of tids: [_tid_batch_next, _tid_batch_end)
+static __thread tid_t::datum_t _tid_batch_next(0);
+static __thread tid_t::datum_t _tid_batch_end(0);
+static __thread int _tid_batch_gen(0);
 
-    xct_link _anchor;
-    xct_link* volatile _tail;
-    
-    xct_link* swap_tail(xct_link* xd) {
-	return (xct_link*) atomic_swap_ptr(&_tail, xd);
+int xct_slab_t::insert(xct_t* xd, const tid_t &t)
+{
+    CRITICAL_SECTION(cs, _lock);
+    int i;
+    if(_count == _capacity) {
+        xct_slot_t* slots = new xct_slot_t[2*_capacity];
+        std::copy(_slots, _slots+_capacity, slots);
+        if(_slots != _first_slots) delete [] _slots;
+        _slots = slots;
+        i = _capacity;
+        _capacity *= 2;
     }
-    xct_link* cas_tail(xct_link* old_tail, xct_link* new_tail) {
-	return (xct_link*) atomic_cas_ptr(&_tail, old_tail, new_tail);
+    else {
+        for(i=0; _slots[i].xd; i++) ;
     }
+    _slots[i].xd = xd;
+    _slots[i].tid = t;
+    if(t.get_value() < _min_tid) _min_tid = t.get_value();
+    _count++;
+    return i;
+}
 
-    xct_link* anchor() { return &_anchor; }
-} _xlist;
+void xct_slab_t::remove(int slot)
+{
+    CRITICAL_SECTION(cs, _lock);
+    w_assert1(_slots[slot].xd);
+    tid_t::datum_t t = _slots[slot].tid.get_value();
+    _slots[slot].xd = 0;
+    _count--;
+    if(t == _min_tid) {
+        tid_t::datum_t m = w_base_t::uint8_max;
+        for(int i=0; i < _capacity; i++) {
+            if(_slots[i].xd && _slots[i].tid.get_value() < m)
+                m = _slots[i].tid.get_value();
+        }
+        _min_tid = m;
+    }
+}
+
+void xct_registry_t::insert(xct_t* xd, const tid_t &t)
+{
+    w_assert1(xd->_xslab < 0);
+    int s = me()->id % xct_slabs;
+    xd->_xslot = _slabs[s].insert(xd, t);
+    xd->_xslab = s;
+}
+
+void xct_registry_t::remove(xct_t* xd)
+{
+    if(xd->_xslab < 0)
+        return;
+    _slabs[xd->_xslab].remove(xd->_xslot);
+    xd->_xslab = xd->_xslot = -1;
+}
+
+/* Hand out the next tid of this thread's range, taking a new range
+ * from the global counter if it ran out (or was overtaken by
+ * note_tid).
+ */
+tid_t xct_registry_t::new_tid()
+{
+    if(_tid_batch_next == _tid_batch_end || _tid_batch_gen != *&_tid_gen) {
+        _tid_batch_gen = *&_tid_gen;
+        membar_consumer();
+        _tid_batch_end = atomic_add_64_nv(&_tid_next, tid_batch);
+        _tid_batch_next = _tid_batch_end - tid_batch;
+        INC_TSTAT(xct_tid_batches);
+    }
+    return tid_t(_tid_batch_next++);
+}
+
+/* Make sure no tid up to \e t is ever handed out again; used for
+ * the tids that recovery finds in the log.
+ */
+void xct_registry_t::note_tid(const tid_t &t)
+{
+    tid_t::datum_t want = t.get_value() + 1;
+    tid_t::datum_t cur = *&_tid_next;
+    while(cur < want) {
+        tid_t::datum_t old = atomic_cas_64(&_tid_next, cur, want);
+        if(old == cur) {
+            // ranges handed out before this point may be below t
+            membar_producer();
+            atomic_inc(_tid_gen);
+            break;
+        }
+        cur = old;
+    }
+}
+
+tid_t xct_registry_t::oldest_tid()
+{
+    // with nothing registered, the oldest is the next tid to go out
+    tid_t::datum_t m = *&_tid_next;
+    for(int s=0; s < xct_slabs; s++) {
+        tid_t::datum_t t = *&_slabs[s]._min_tid;
+        if(t < m) m = t;
+    }
+    return tid_t(m);
+}
+
+xct_t* xct_registry_t::look_up(const tid_t &t)
+{
+    for(int s=0; s < xct_slabs; s++) {
+        xct_slab_t &slab = _slabs[s];
+        if(!*&slab._count)
+            continue;
+        CRITICAL_SECTION(cs, slab._lock);
+        for(int i=0; i < slab._capacity; i++) {
+            if(slab._slots[i].xd && slab._slots[i].tid == t)
+                return slab._slots[i].xd;
+        }
+    }
+    return 0;
+}
+
+int xct_registry_t::count()
+{
+    int n = 0;
+    for(int s=0; s < xct_slabs; s++)
+        n += *&_slabs[s]._count;
+    return n;
+}
 
 xct_i::maybe_lock::maybe_lock(bool already_locked)
     : _already_locked(already_locked)
@@ -218,119 +385,77 @@ xct_i::maybe_lock::~maybe_lock() {
 	chkpt_serial_m::chkpt_release();
 }
 
-/* Iterators provide a thread-safe but dynamic view of the transaction
-   list. Transactions are free to begin and end while an iterator is
-   active, and garbage collection will be coordinated to avoid invalid
-   pointer accesses.
+/* Iterators provide a thread-safe snapshot of the registry, in tid
+   order.  Transactions are free to begin while an iterator is
+   active; they just aren't part of the snapshot.
 
    WARNING: threads risk deadlock if they create multiple iterators at once
  */
 xct_i::xct_i(bool already_locked)
     : _lock(already_locked)
-    , _end_xd(*&_xlist._tail)
-    , _cur_xd(_end_xd? _xlist.anchor() : 0)
+    , _snap(0)
+    , _count(0)
+    , _cur(0)
 {
+    int capacity = 0;
+    for(int s=0; s < xct_slabs; s++) {
+        xct_slab_t &slab = _xlist._slabs[s];
+        if(!*&slab._count)
+            continue;
+        CRITICAL_SECTION(cs, slab._lock);
+        if(_count + slab._count > capacity) {
+            capacity = 2*(_count + slab._count);
+            xct_slot_t* snap = new xct_slot_t[capacity];
+            std::copy(_snap, _snap+_count, snap);
+            delete [] _snap;
+            _snap = snap;
+        }
+        for(int i=0; i < slab._capacity; i++) {
+            if(slab._slots[i].xd)
+                _snap[_count++] = slab._slots[i];
+        }
+    }
+    std::sort(_snap, _snap+_count);
 }
+
 xct_i::~xct_i() {
+    delete [] _snap;
 }
 
-xct_t* xct_i::next(bool can_delete) {
-    /* no thread can leave while the iterator is active so we can walk
-       the list at our leisure, skipping or deleting nodes which
-       already left.
-       
-       NOTE: new transactions can still join the list, so we have to
-       end when we reach the tail we originally saw rather than
-       checking tail repeatedly.
-
-       NOTE: the list is (and will stay) in a consistent state
-       because transactions can only remove nodes if we don't hold the
-       lock (and we do). This means we can skip NODE_LEFT nodes instead
-       of trying to reclaim them, though we'll delete them if allowed to.
-
-       NOTE: if we hit a null next pointer, we know that the
-       transaction cannot have started because it does not have a tid
-       yet. However, its successors may have read its just-set tid and
-       continued on without it. This means we cannot stop iterating
-       until we reach _end_xd
-
+xct_t* xct_i::next(bool /*can_delete*/) {
+    /* A transaction in the snapshot may have been erased by
+       erase_and_next() since (by this iterator, or by the caller of an
+       xct_i(true) running alone, e.g. recovery), in which case it is
+       no longer registered and we skip it.
      */
-    while(_cur_xd != _end_xd) {
-	xct_link* n;
-	while( !(n=_cur_xd->vthis()->_next) ) ;
-	if(NODE_LEFT == n->vthis()->_node_state) {
-	    if(can_delete) {
-                if (n == *&_xlist._tail) {
-                    w_assert1(n == _end_xd);
-                    if (_xlist.anchor()->_next == n)
-                        _xlist.anchor()->_next = 0;
-                    _cur_xd = _end_xd = _xlist._tail = 0;
-                }
-                else {
-                    // unlink+delete the next and retry
-                    // NOTE: single-threaded => no atomic ops
-                    _cur_xd->_next = n->_next;
-                    delete n;
-                }
-	    }
-	    else {
-		// next!
-		_cur_xd = n;
-	    }
-	}
-	else {
-	    // success!
-	    _cur_xd = n;
-	    return n->_owner;
-	}
+    while(_cur < _count) {
+        xct_slot_t &s = _snap[_cur++];
+        if(s.xd->_xslab >= 0)
+            return s.xd;
     }
     return 0;
 }
 
 xct_t* xct_i::erase_and_next() {
-    // keep this in sync with list remove (esp. NODE_HEAD)
-    if(_cur_xd == _end_xd)
+    if(_cur == 0 || _cur > _count)
 	return 0;
-
-    xct_link* old_xd = _cur_xd;
-    if (old_xd->_owner) {
-        old_xd->_owner->_xlink = 0;
-        old_xd->_owner = 0;
-    }
-    xct_t* n = next(true);
-    if (old_xd->_node_state == NODE_HEAD) {
-        xct_link* anchor = _xlist.anchor();
-        if (_cur_xd) {
-            anchor->_tid = _cur_xd->_tid;
-            _cur_xd->_node_state = NODE_HEAD;
-        }
-        anchor->_next = _cur_xd;
-        delete old_xd;
-    }
-    else {
-        old_xd->_node_state = NODE_LEFT;
-    }
-    return n;
+    _xlist.remove(_snap[_cur-1].xd);
+    return next(true);
 }
 
 
 
-static void pretty_print(ostream &out, xct_list const* /* rec */) {
-    xct_link* cur = &_xlist._anchor;
-    out << "[anchor: " << cur->_tid << "]  ";
-    while( (cur=cur->_next) ) {
-	out << cur->_tid;
-	if(cur->_node_state == NODE_LEFT)
-	    out << "*";
-	else if(cur->_node_state == NODE_HEAD)
-	    out << "(H)";
-	
-	out << "  ";
+static void pretty_print(ostream &out, xct_registry_t const* /* rec */) {
+    xct_i it(true);
+    out << "[" << _xlist.count() << " active, next tid "
+        << tid_t(*&_xlist._tid_next) << "]  ";
+    while(xct_t* xd = it.next()) {
+	out << xd->tid() << "  ";
     }
 }
 #include <sstream>
 char const*
-db_pretty_print(xct_list const* rec, int /* i=0 */, char const* /* s=0 */) {
+db_pretty_print(xct_registry_t const* rec, int /* i=0 */, char const* /* s=0 */) {
     static stringstream out;
     static string str;
     out.str("");
@@ -339,197 +464,6 @@ db_pretty_print(xct_list const* rec, int /* i=0 */, char const* /* s=0 */) {
     return str.c_str();
 }
 
-xct_list::xct_list()
-  : _anchor(0, true)
-  , _tail(0)
-{
-    _anchor._tid = tid_t::null.next();
-}
-
-xct_list::~xct_list() {
-    w_assert1(0 == _anchor._next);
-}
-
-
-/* Insert a link at the end of the list
- */
-void xct_list::insert(xct_link* xd) {
-    xd->_tid = tid_t::null;
-    xd->_next = 0;
-    xd->_node_state = NODE_ACTIVE;
-    membar_producer();
-    xct_link* pred = swap_tail(xd);
-    if(pred) {
-	// wait for their tid to become valid
-	while( pred->vthis()->_tid.invalid() ) { }
-	xd->_tid = pred->_tid.next();
-	membar_producer();
-	pred->_next = xd;
-    }
-    else {
-	// joined an empty list... use anchor's next_tid
-	xd->_tid = _anchor._tid;
-	xd->_node_state = NODE_HEAD;
-	membar_producer();
-	_anchor._next = xd;
-    }
-}
-
-void xct_list::insert_existing_unsafe(xct_t* owner) {
-    /* FRJ: this code is absolutely NOT thread-safe. It should only
-       used during recovery when single-thread access is
-       guaranteed. Note that by induction all current members of the
-       list were inserted by this same code segment.
-    */
-    xct_link* _xlink = owner->_xlink = new xct_link(owner);
-    tid_t t = _xlink->_tid = owner->tid();
-    w_assert1(not t.invalid());
-    w_assert1(smlevel_0::operating_mode == smlevel_0::t_in_analysis);
-
-    if(_tail) {
-	if(t < _tail->_tid) {
-	    // not eol
-	    if(t < _anchor._tid) {
-		// bol
-		_anchor._tid = t;
-		_xlink->_next = _anchor._next;
-		_anchor._next = _xlink;
-		_xlink->_node_state = NODE_HEAD;
-		_xlink->_next->_node_state = NODE_ACTIVE;
-	    }
-	    else {
-		// somewhere in the middle
-		xct_link* xd = &_anchor;
-		while(1) {
-		    xct_link* next = xd->_next;
-		    if(t < next->_tid) 
-			break;
-		    xd=next;
-		}
-		w_assert1(t != xd->_tid);
-		_xlink->_next = xd->_next;
-		xd->_next = _xlink;
-		_xlink->_node_state = NODE_ACTIVE;
-	    }
-	}
-	else {
-	    // eol
-	    _xlink->_next = NULL;
-	    _tail = _tail->_next = _xlink;
-	    _xlink->_node_state = NODE_ACTIVE;
-	}
-    }
-    else {
-	// empty list (eol+bol)
-	_anchor._tid = t;
-	_xlink->_next = NULL;
-	_tail = _anchor._next = _xlink;
-	_xlink->_node_state = NODE_HEAD;
-    }
-}
-
-void xct_list::remove(xct_link* xd) {
-    if (not xd)
-        return;
-
-    xct_link* next;
-    if(xd->_owner) {
-	xd->_owner->_xlink = 0;
-	xd->_owner = 0;
-    }
-
-    /* There are three possible outcomes of an attempt to hand off:
-
-       1. We finish before becoming NODE_HEAD. In this case we do nothing more.
-
-       2. Otherwise (as NODE_HEAD), we update the anchor with info from our potential successor, then...
-
-       2a. Succeed in marking our successor as NODE_HEAD. In this case we do nothing more
-       
-       3. Otherwise (as NODE_HEAD and failing to mark our successor)
-       check whether our successor is the current NODE_HEAD. This
-       indicates we already tried to reclaim it but could not because
-       it is at EOQ. In this case do nothing more (joining threads
-       know to check whether their predecessor is the
-       head).
-
-       3a. Otherwise, start over, but still aware of being NODE_HEAD
-     */
-    next = xd->vthis()->_next;
-    if(next) {
-    reclaim:
-	// have successor
-	if(NODE_LEFT == next->vthis()->_node_state) {
-	    // successor left
-	    xct_link* after_next = next->vthis()->_next;
-	    if(after_next) {
-		// we can reclaim this successor
-		xd->_next = after_next;
-		membar_producer();
-		delete next;
-		next = after_next;
-		goto reclaim;
-	    }
-	    // else successor may be eoq... don't bother
-	}
-	// else successor still active... don't bother
-    }
-    // else we may be eoq... don't bother
-    
-    // try to escape...
-    int s = xd->cas_state(NODE_ACTIVE, NODE_LEFT);
-    if(NODE_ACTIVE != s) {
-	// caught at queue head... look for a successor
-	if(next) {
-	    // potential successor found
-	    w_assert1(NODE_HEAD == s);
-	handoff:
-	    _anchor._tid = next->_tid;
-	    _anchor._next = next;
-	    membar_enter();
-	    delete xd; // done with this no matter what...
-	    xd = next; 
-	    int s2 = xd->cas_state(NODE_ACTIVE, NODE_HEAD);
-	    if(NODE_ACTIVE != s2) {
-		// too slow... node already left
-		w_assert1(NODE_LEFT == s2);
-		next = xd->vthis()->_next;
-		if(next) {
-		    // it can be reclaimed
-		    goto handoff;
-		}
-		else {
-		    // successor may be eoq... try to reset queue
-		    goto clear_queue;
-		}
-	    }
-	    // else done -- handoff succeeded!
-	}
-	else {
-	    // no apparent successor... try to reset the queue
-	clear_queue:
-	    /* clear out the anchor... no race w/ anchor node because
-	       only one node can be queue head and tail simultaneously
-	     */
-	    _anchor._tid = xd->_tid.next();
-	    _anchor._next = 0;
-	    membar_producer();
-	    if(xd == *&_tail && xd == cas_tail(xd, 0)) {
-		// done -- succeeded at clearing queue
-		delete xd;
-	    }
-	    else {
-		// wait for new arrival to introduce itself
-		while( !(next=xd->vthis()->_next) ) ;
-
-		// link the newly formed list into the anchor
-		_anchor._next = next; 
-		goto handoff;
-	    }
-	}
-    }
-    // else done -- we escaped!
-}
 
 
 /*********************************************************************
@@ -580,9 +514,8 @@ xct_t::new_xct(const tid_t& t, state_t s, const lsn_t& last_lsn,
 {
 
     // Uses user(recovery)-provided tid
-    /* FRJ: VERY important to only call this constructor during
-       recovery because we have to wander the _xlist in completely
-       thread-unsafe ways if we discover any tids out of order.
+    /* Only recovery may supply its own tids. The registry notes them
+       (see init()) so that new transactions never reuse them.
      */
     w_assert1(operating_mode == t_in_analysis);
     w_assert1(not t.invalid());
@@ -721,15 +654,13 @@ xct_t::cleanup(bool dispose_prepared)
  *  xct_t::num_active_xcts()
  *
  *  Return the number of active transactions (equivalent to the
- *  size of _xlist.
+ *  size of _xlist).  Takes no locks, so the answer may be stale.
  *
  *********************************************************************/
 w_base_t::uint4_t
 xct_t::num_active_xcts()
 {
-    w_base_t::uint4_t num = 0;
-    for(xct_i it; it.next(); num++) { }
-    return  num;
+    return _xlist.count();
 }
 
 
@@ -744,11 +675,7 @@ xct_t::num_active_xcts()
 xct_t* 
 xct_t::look_up(const tid_t& tid)
 {
-    xct_t* xd;
-    xct_i iter(true);
-
-    while ((xd = iter.next()) && xd->tid() < tid);
-    return (xd && xd->tid() == tid)? xd : 0;
+    return _xlist.look_up(tid);
 }
 
 xct_lock_info_t*
@@ -1240,21 +1167,32 @@ xct_t::restore_log_state(switch_t s)
 }
 
 
-#warning Assumes caller holds chkpt_serial_m. Seg fault otherwise
+/*********************************************************************
+ *
+ *  xct_t::youngest_tid()
+ *
+ *  Return the largest tid handed out so far (possibly to a thread's
+ *  range of tids rather than to a transaction).
+ *
+ *********************************************************************/
 tid_t
 xct_t::youngest_tid()
 {
-    xct_i it(true);
-    xct_link* who;
-    if(it._end_xd) {
-	tid_t tid;
-	while( it._end_xd->vthis()->_tid.invalid() ) { }
-	who = it._end_xd;
-    }
-    else {
-	who = _xlist.anchor();
-    }
-    return who->_tid;
+    return _xlist.youngest_tid();
+}
+
+/*********************************************************************
+ *
+ *  xct_t::note_tid()
+ *
+ *  Called by recovery for each tid it finds in the log, so that 
+ *  no transaction started afterward reuses it.
+ *
+ *********************************************************************/
+void
+xct_t::note_tid(const tid_t &t)
+{
+    _xlist.note_tid(t);
 }
 
 
@@ -1446,10 +1384,90 @@ DECLARE_TLS(block_alloc<logrec_t>, logrec_pool);
 #endif
 
 void xct_t::join_xlist() {
-    w_assert1(!_xlink);
-    _xlink = new xct_link(this);
-    _xlist.insert(_xlink);
-    _core->_lock_info->set_tid(_xlink->_tid);
+    tid_t t = _xlist.new_tid();
+    _xlist.insert(this, t);
+    _core->_lock_info->set_tid(t);
+}
+
+xct_latency_hist_t xct_t::_latency[xct_wait_kinds+1];
+
+void
+xct_latency_hist_t::add(hrtime_t ns)
+{
+    w_base_t::uint8_t us = ns / 1000;
+    int b = 0;
+    for(w_base_t::uint8_t limit=4; b < buckets-1 && us >= limit; limit *= 4)
+        b++;
+    atomic_inc(hist[b]);
+    atomic_add_64((uint64_t volatile*) &total_us, us);
+    // benign race: a concurrent larger maximum may be lost
+    if(us > max_us) max_us = us;
+}
+
+w_base_t::uint8_t
+xct_latency_hist_t::count() const
+{
+    w_base_t::uint8_t n = 0;
+    for(int b=0; b < buckets; b++) 
+        n += hist[b];
+    return n;
+}
+
+w_base_t::uint8_t
+xct_latency_hist_t::percentile_us(double p) const
+{
+    w_base_t::uint8_t n = count();
+    w_base_t::uint8_t seen = 0;
+    w_base_t::uint8_t limit = 4;
+    for(int b=0; b < buckets-1; b++, limit *= 4) {
+        seen += hist[b];
+        if(seen > 0 && seen >= p*n) 
+            return limit;
+    }
+    return max_us;
+}
+
+void
+xct_wait_timer_t::_charge()
+{
+    _xd->add_wait_time(_kind, gethrtime() - _start);
+}
+
+void
+xct_t::latency_reset()
+{
+    memset((void*) _latency, 0, sizeof(_latency));
+}
+
+void
+xct_t::_begin_timing()
+{
+    _begin_time = gethrtime();
+    for(int w=0; w < xct_wait_kinds; w++) 
+        _wait_time[w] = 0;
+}
+
+/*
+ * Called by the thread ending the transaction, while it is still
+ * attached, so that the sm stats of an instrumented transaction
+ * get its breakdown.
+ * Only the waits that happened go into the wait histograms: their
+ * counts are those of the transactions that waited at all.
+ */
+void
+xct_t::_record_latency()
+{
+    hrtime_t age = gethrtime() - _begin_time;
+    _latency[xct_wait_kinds].add(age);
+    ADD_TSTAT(xct_latency_us, age/1000);
+    for(int w=0; w < xct_wait_kinds; w++) {
+        if(_wait_time[w]) _latency[w].add(_wait_time[w]);
+    }
+    ADD_TSTAT(xct_lock_wait_us, _wait_time[xct_wait_lock]/1000);
+    ADD_TSTAT(xct_latch_wait_us, _wait_time[xct_wait_latch]/1000);
+    ADD_TSTAT(xct_io_wait_us, _wait_time[xct_wait_io]/1000);
+    ADD_TSTAT(xct_log_flush_wait_us, _wait_time[xct_wait_log_flush]/1000);
+    ADD_TSTAT(xct_log_space_wait_us, _wait_time[xct_wait_log_space]/1000);
 }
 
 rc_t
@@ -1525,12 +1543,15 @@ xct_t::xct_t()
     if (!_log_buf)  {
         W_FATAL(eOUTOFMEMORY);
     }
+    // kept while the xct is cached, see init()
+    _occ_reads = 0;
+    _occ_capacity = 0;
 }
 
 void xct_t::init(xct_core* core, sm_stats_info_t* stats,
 		 const lsn_t& last_lsn, const lsn_t& undo_nxt)
 {
-    _xlink = 0;
+    _xslab = _xslot = -1;
     __stats = stats;
     __saved_sdesc_cache_t = 0;
     __saved_sdesc_owner = !me()->sdesc_cache();
@@ -1545,6 +1566,14 @@ void xct_t::init(xct_core* core, sm_stats_info_t* stats,
     _core = core;
     _first_lsn = _last_lsn = _undo_nxt = lsn_t::null;
     _rolling_back = false;
+    _snapshot = false;
+    _snapshot_stamp = 0;
+    _vs_writer = 0;
+    _vs_wrote = false;
+    _occ = false;
+    _occ_asked = false;
+    _occ_nreads = 0;
+    _begin_timing();
 	
     w_assert1(tid() == core->_lock_info->tid());
     SetDefaultEscalationThresholds();
@@ -1561,8 +1590,10 @@ void xct_t::init(xct_core* core, sm_stats_info_t* stats,
     
     if(tid().invalid()) 
 	join_xlist();
-    else 
-	_xlist.insert_existing_unsafe(this);
+    else {
+	_xlist.note_tid(tid());
+	_xlist.insert(this, tid());
+    }
 }
 
 xct_t::xct_core::~xct_core()
@@ -1598,6 +1629,7 @@ xct_t::~xct_t()
     if(__saved_sdesc_cache_t) {
 	delete __saved_sdesc_cache_t;
     }
+    delete [] _occ_reads;
     
     // caller deletes core...
 }
@@ -1723,10 +1755,169 @@ xct_t::change_state(state_t new_state)
     while ((d = i.next()))  {
         d->xct_state_changed(old_state, new_state);
     }
-    if(new_state == xct_ended)
-	_xlist.remove(_xlink);
+    if(_vs_writer && 
+            (new_state == xct_freeing_space || new_state == xct_ended)) {
+        version_store_t::end_writer(this, old_state != xct_aborting);
+    }
+    if(new_state == xct_ended) {
+        if(_snapshot) version_store_t::end_snapshot(this);
+        _vs_wrote = false;
+        _occ = false;
+	_xlist.remove(this);
+    }
+}
+
+
+/*
+ * Optimistic transactions.
+ *
+ * lock_m does not take the share locks of an optimistic transaction
+ * on records, pages and btree keys; it notes each of them here
+ * instead, and the code that does the read then calls occ_read
+ * with the page fixed, to note the page's lsn.  At commit, the
+ * transaction checks that none of those pages changed and that no
+ * one else holds the locks it did not take.  Updates are locked as
+ * usual, so they stay invisible to others until the commit.
+ *
+ * A read noted by lock_m that no occ_read follows cannot be
+ * validated, and fails validation.  A thread whose optimistic
+ * transactions fail occ_max_failures times in a row runs them
+ * with locks until one commits.
+ */
+static const int occ_max_failures = 3;
+// failures in a row of this thread's optimistic transactions
+static __thread int _occ_failures(0);
+
+void
+xct_t::begin_optimistic()
+{
+    w_assert1(!_snapshot && _occ_nreads == 0);
+    _occ_asked = true;
+    if(_occ_failures < occ_max_failures) {
+        _occ = true;
+        INC_TSTAT(occ_xct_cnt);
+    } else {
+        INC_TSTAT(occ_fallback_cnt);
+    }
+}
+
+void
+xct_t::occ_skip_lock(const lockid_t& name)
+{
+    w_assert1(_occ);
+    if(_occ_nreads == _occ_capacity) {
+        int capacity = _occ_capacity? 2*_occ_capacity : 16;
+        occ_read_t* reads = new occ_read_t[capacity];
+        if(!reads) W_FATAL(eOUTOFMEMORY);
+        std::copy(_occ_reads, _occ_reads + _occ_nreads, reads);
+        delete [] _occ_reads;
+        _occ_reads = reads;
+        _occ_capacity = capacity;
+    }
+    occ_read_t& r = _occ_reads[_occ_nreads++];
+    r.name = name;
+    r.pid = lpid_t::null;
+    r.read = false;
 }
 
+// true if another transaction is changing what r read
+static bool occ_conflict(const occ_read_t& r)
+{
+    if(smlevel_0::lm->held_by_other(r.name, smlevel_0::SH)) return true;
+    // a page lock covers the records on the page
+    return r.name.lspace() == lockid_t::t_record &&
+        smlevel_0::lm->held_by_other(lockid_t(r.pid), smlevel_0::IS);
+}
+
+rc_t
+xct_t::occ_read(const lockid_t& name, const page_p& page, bool lock_it)
+{
+    if(!_occ) return RCOK;
+    const lockid_t page_name(page.pid());
+    // the lock was skipped just before the read, so look only at the
+    // reads that have not been done yet
+    for(int i = _occ_nreads-1; i >= 0 && !_occ_reads[i].read; i--) {
+        occ_read_t& r = _occ_reads[i];
+        if(r.name == name || r.name == page_name) {
+            if(lock_it) {
+                // Take the lock after all, but don't wait for it
+                // with the page fixed.
+                const lockid_t skipped = r.name;
+                _occ_reads[i] = _occ_reads[--_occ_nreads];
+                _occ = false;
+                rc_t rc = lm->lock(skipped, SH, t_long, WAIT_IMMEDIATE);
+                _occ = true;
+                if(rc.is_error()) {
+                    _occ_failures++;
+                    INC_TSTAT(occ_read_conflict_cnt);
+                    return RC(eOCCCONFLICT);
+                }
+                break;
+            }
+            r.pid = page.pid();
+            r.lsn = page.lsn();
+            r.read = true;
+            // Never read what another transaction is changing:
+            // validating it could not tell whether that one committed.
+            if(occ_conflict(r)) {
+                _occ_failures++;
+                INC_TSTAT(occ_read_conflict_cnt);
+                return RC(eOCCCONFLICT);
+            }
+            break;
+        }
+    }
+    return RCOK;
+}
+
+/*
+ * Our own update of a page we read moves its lsn on; move the lsn of
+ * our reads on with it, unless someone else changed the page first.
+ */
+void
+xct_t::_occ_wrote(const lpid_t& pid, const lsn_t& old_lsn, 
+        const lsn_t& new_lsn)
+{
+    for(int i = 0; i < _occ_nreads; i++) {
+        occ_read_t& r = _occ_reads[i];
+        if(r.read && r.lsn == old_lsn && r.pid == pid) r.lsn = new_lsn;
+    }
+}
+
+rc_t
+xct_t::_occ_validate()
+{
+    if(!_occ_asked) return RCOK;
+
+    bool ok = true;
+    for(int i = 0; ok && i < _occ_nreads; i++) {
+        ok = _occ_reads[i].read;
+    }
+
+    // one page at a time, each latched only while its reads are checked
+    std::sort(_occ_reads, _occ_reads + _occ_nreads);
+    page_p page;
+    for(int i = 0; ok && i < _occ_nreads; i++) {
+        const occ_read_t& r = _occ_reads[i];
+        if(!page.is_fixed() || page.pid() != r.pid) {
+            page.unfix();
+            store_flag_t store_flags = st_bad;
+            // a page that went away has changed
+            ok = !page.fix(r.pid, page_p::t_any_p, LATCH_SH, 
+                    0, store_flags).is_error();
+        }
+        ok = ok && page.lsn() == r.lsn && !occ_conflict(r);
+    }
+    page.unfix();
+
+    if(!ok) {
+        _occ_failures++;
+        INC_TSTAT(occ_validate_fail_cnt);
+        return RC(eOCCCONFLICT);
+    }
+    _occ_failures = 0;
+    return RCOK;
+}
 
 /**\todo Figure out how log space warnings will interact with mtxct */
 void
@@ -1853,6 +2044,8 @@ xct_t::prepare()
         return RC(eINQUARK);
     }
 
+    W_DO(_occ_validate());
+
     // must convert all these stores before entering the prepared state
     // just as if we were committing.
     W_DO( ConvertAllLoadStoresToRegularStores() );
@@ -2146,6 +2339,11 @@ xct_t::_commit(uint4_t flags,lsn_t* plastlsn)
         return RC(eINQUARK);
     }
 
+    if(_core->_state == xct_active) {
+        // a prepared xct was validated by prepare()
+        W_DO(_occ_validate());
+    }
+
     w_assert1(1 == atomic_inc_nv(_core->_xct_ended));
 
     W_DO( ConvertAllLoadStoresToRegularStores() );
@@ -2257,6 +2455,7 @@ xct_t::_commit(uint4_t flags,lsn_t* plastlsn)
         }
     }
 
+    _record_latency();
     me()->detach_xct(this);        // no transaction for this thread
     INC_TSTAT(commit_xct_cnt);
 
@@ -2287,6 +2486,7 @@ xct_t::_commit(uint4_t flags,lsn_t* plastlsn)
 
         me()->attach_xct(this);
         INC_TSTAT(begin_xct_cnt);
+        _begin_timing();
         _core->_state = xct_chaining; // to allow us to change state back
         // to active: there's an assert about this where we don't
         // have context to know that it's where we're chaining.
@@ -2399,6 +2599,7 @@ xct_t::_abort()
         W_COERCE( lm->unlock_duration(t_long, true, true) );
     }
 
+    _record_latency();
     me()->detach_xct(this);        // no transaction for this thread
     INC_TSTAT(abort_xct_cnt);
     return RCOK;
@@ -2474,20 +2675,53 @@ xct_t::dispose()
     ClearAllLoadStores();
     _core->_state = xct_ended; // unclean!
     me()->detach_xct(this);
-    _xlist.remove(this->_xlink);
+    _xlist.remove(this);
     return RCOK;
 }
 
 
+/*
+ * Has another writer build a log record, and fills in the
+ * transaction's part of the record's header; keeps what 
+ * _flush_logbuf needs to know about the record once it is in the
+ * log, where it may be flushed and overwritten at any time.
+ */
+class xct_logrec_writer_t : public logrec_writer_t {
+    const logrec_writer_t& _w;
+    tid_t                  _tid;
+    lsn_t                  _last;
+public:
+    mutable bool           undoable_clr;
+    mutable bool           cpsn;
+    mutable lsn_t          undo_nxt;
+
+    xct_logrec_writer_t(const logrec_writer_t& w, const tid_t& tid,
+                        const lsn_t& last)
+        : _w(w), _tid(tid), _last(last), 
+          undoable_clr(false), cpsn(false) {}
+
+    smsize_t length() const { return _w.length(); }
+    logrec_t* construct(void* where) const {
+        logrec_t* r = _w.construct(where);
+        r->fill_xct_attr(_tid, _last);
+        undoable_clr = r->is_undoable_clr();
+        cpsn = r->is_cpsn();
+        if(cpsn) undo_nxt = r->undo_nxt();
+        return r;
+    }
+};
+
 /*********************************************************************
  *
- *  xct_t::_flush_logbuf()
+ *  xct_t::_flush_logbuf(w)
  *
  *  Write the log record buffered and update lsn pointers.
+ *  If there is a writer, have the log build the record in place
+ *  instead; the buffer is only scratch space for it.
  *
  *********************************************************************/
 w_rc_t
-xct_t::_flush_logbuf()
+xct_t::_flush_logbuf(const logrec_writer_t* w)
 {
     DBGX( << " _flush_logbuf: _log_bytes_rsvd " << _log_bytes_rsvd  
             << " _log_bytes_ready " << _log_bytes_ready
@@ -2500,7 +2734,7 @@ xct_t::_flush_logbuf()
 
     w_assert2(is_1thread_log_mutex_mine() || one_thread_attached());
 
-    if (_last_log)  {
+    if (_last_log && !w)  {
 
         DBGX ( << " xct_t::_flush_logbuf " << _last_lsn);
         // Fill in the _prev field of the log rec if this record hasn't
@@ -2522,10 +2756,33 @@ xct_t::_flush_logbuf()
         LOGTRACE( << setiosflags(ios::right) << _last_lsn
                       << resetiosflags(ios::right) << " I: " << *_last_log 
                       << " ... " );
+    }
+
+    if (_last_log)  {
         if(log) {
         logrec_t* l = _last_log;
         _last_log = 0;
+
+        // what we need to know about the record once it is in
+        long bytes_used;
+        bool undoable_clr;
+        bool cpsn;
+        lsn_t undo_nxt;
+        if(w) {
+            xct_logrec_writer_t xw(*w, tid(), _last_lsn);
+            W_DO( log->insert(xw, l, &_last_lsn) );
+            bytes_used = xw.length();
+            undoable_clr = xw.undoable_clr;
+            cpsn = xw.cpsn;
+            undo_nxt = xw.undo_nxt;
+        } 
+        else {
             W_DO( log->insert(*l, &_last_lsn) );
+            bytes_used = l->length();
+            undoable_clr = l->is_undoable_clr();
+            cpsn = l->is_cpsn();
+            undo_nxt = l->undo_nxt();
+        }
         
         /* LOG_RESERVATIONS
 
@@ -2545,7 +2802,6 @@ xct_t::_flush_logbuf()
            compensations and undo was already accounted for)
         */
         if(smlevel_0::operating_mode == t_forward_processing) {
-        long bytes_used = l->length();
         if(_rolling_back || state() != xct_active) {
 #if USE_LOG_RESERVATIONS
             w_assert0(_log_bytes_rsvd >= bytes_used);
@@ -2586,8 +2842,8 @@ xct_t::_flush_logbuf()
                     _first_lsn = _last_lsn;
     
             _undo_nxt = (
-                    l->is_undoable_clr() ? _last_lsn :
-                    l->is_cpsn() ? l->undo_nxt() : _last_lsn);
+                    undoable_clr ? _last_lsn :
+                    cpsn ? undo_nxt : _last_lsn);
         } // log non-null
     }
 
@@ -2892,13 +3148,7 @@ xct_t::give_logbuf(logrec_t* l, const page_p *page)
     goto done;
     
     if(last_mod_page.is_fixed() ) {
-        w_assert2(last_mod_page.latch_mode() == LATCH_NLX ||
-		  last_mod_page.latch_mode() == LATCH_EX);
-        // WAL: stuff the lsn into the page so the buffer manager
-        // can force the log to that lsn before writing the page.
-        last_mod_page.set_lsns(_last_lsn);
-        last_mod_page.unfix_dirty();
-        w_assert1(last_mod_page.check_lsn_invariant());
+        _set_page_lsns(last_mod_page);
     }
 
  done:
@@ -2907,6 +3157,49 @@ xct_t::give_logbuf(logrec_t* l, const page_p *page)
     return rc;
 }
 
+// As above, but the log builds the record, in place in the log
+// buffer; the logrec from get_logbuf is only its scratch space.
+rc_t
+xct_t::give_logbuf(const logrec_writer_t& w, const page_p *page)
+{
+    FUNC(xct_t::give_logbuf);
+        
+    // ALREADY PROTECTED from get_logbuf() call
+    w_assert2(is_1thread_log_mutex_mine());
+    w_assert1(_last_log == _log_buf);
+
+    // WAL: hang onto the page, as above
+    page_p last_mod_page;
+    if(page != (page_p *)0) {
+        w_assert1(page->latch_mode() == LATCH_NLX ||
+		  page->latch_mode() == LATCH_EX);
+        last_mod_page = *page; // refixes
+    } 
+
+    rc_t rc = _flush_logbuf(&w); 
+    if(!rc.is_error() && last_mod_page.is_fixed()) {
+        _set_page_lsns(last_mod_page);
+    }
+
+    release_1thread_log_mutex(); // this is give_logbuf
+    return rc;
+}
+
+// WAL: stuff the lsn of the record just inserted into the page it
+// changed, so the buffer manager can force the log to that lsn 
+// before writing the page.
+void
+xct_t::_set_page_lsns(page_p& last_mod_page)
+{
+    w_assert2(last_mod_page.latch_mode() == LATCH_NLX ||
+              last_mod_page.latch_mode() == LATCH_EX);
+    lsn_t old_lsn = last_mod_page.lsn();
+    last_mod_page.set_lsns(_last_lsn);
+    if(_occ) _occ_wrote(last_mod_page.pid(), old_lsn, _last_lsn);
+    last_mod_page.unfix_dirty();
+    w_assert1(last_mod_page.check_lsn_invariant());
+}
+
 
 /*********************************************************************
  *
@@ -118,10 +118,14 @@ class xct_prepare_fi_log; // forward
 class xct_prepare_lk_log; // forward
 class sm_quark_t; // forward
 class smthread_t; // forward
-class xct_list;
-class xct_link;
+struct xct_registry_t;
+struct xct_slot_t;
+class version_store_t; // forward
+struct vs_writer_t; // forward
+struct occ_read_t; // forward
 
 class logrec_t; // forward
+class logrec_writer_t; // forward
 class page_p; // forward
 
 class stid_list_elem_t  {
@@ -144,6 +148,22 @@ class stid_list_elem_t  {
 };
 
 
+/**\brief Histogram of transaction latencies or wait times.
+ * \details
+ * Bucket b counts the times under 4^(b+1) microseconds;
+ * the last bucket counts everything longer.
+ */
+struct xct_latency_hist_t {
+    enum { buckets = 11 };
+    w_base_t::uint8_t volatile  total_us;
+    w_base_t::uint8_t volatile  max_us;
+    w_base_t::uint8_t volatile  hist[buckets];
+
+    void                add(hrtime_t ns);
+    w_base_t::uint8_t   count() const;
+    /// Upper bound (microseconds) of the bucket holding percentile p.
+    w_base_t::uint8_t   percentile_us(double p) const;
+};
 
 
 /**\brief A transaction. Internal to the storage manager.
@@ -158,7 +178,8 @@ class xct_t : public smlevel_1 {
     friend class block_alloc<xct_t>;
 #endif
     friend class xct_i;
-    friend struct xct_list;
+    friend struct xct_registry_t;
+    friend class version_store_t;
     friend class smthread_t;
     friend class restart_m;
     friend class lock_m;
@@ -216,6 +237,25 @@ public:
     void                        vtable_collect(vtable_row_t &);
     static void                 vtable_collect_names(vtable_row_t &);
 
+    /// Collect the latency histograms, one row per xct_wait_t and one
+    /// for the whole transaction.
+    static int                  latency_collect(vtable_t&, bool names_too);
+    static void                 latency_reset();
+
+    /// Nanoseconds since the transaction began.
+    hrtime_t                    age() const { 
+                                    return gethrtime() - _begin_time; 
+                                }
+    /// Nanoseconds spent waiting for \e w so far.
+    hrtime_t                    wait_time(xct_wait_t w) const { 
+                                    return _wait_time[w]; 
+                                }
+    void                        add_wait_time(xct_wait_t w, hrtime_t ns) {
+                                    // more than one thread may be attached
+                                    atomic_add_64((uint64_t volatile*)
+                                                  &_wait_time[w], ns);
+                                }
+
     state_t                     state() const;
     void                        set_timeout(timeout_in_ms t) ;
 
@@ -228,6 +268,24 @@ public:
     void                         force_readonly();
     bool                         forced_readonly() const;
 
+    /// True for a snapshot transaction (see version_store_t).
+    bool                         is_snapshot() const { return _snapshot; }
+    /// The commit stamp as of which a snapshot transaction reads.
+    w_base_t::uint8_t            snapshot_stamp() const { 
+                                    return _snapshot_stamp; 
+                                 }
+
+    /// True for an optimistic transaction; see ss_m::begin_xct(xct_cc_t,...).
+    bool                         is_occ() const { return _occ; }
+    void                         begin_optimistic();
+    // lock_m calls this for each read lock it does not take
+    void                         occ_skip_lock(const lockid_t& name);
+    // then the reader calls this with the page of the record or key
+    // fixed; lock_it if the read went beyond that page
+    rc_t                         occ_read(const lockid_t& name, 
+                                          const page_p& page,
+                                          bool lock_it = false);
+
     vote_t                       vote() const;
     bool                         is_extern2pc() const;
     rc_t                         enter2pc(const gtid_t &g);
@@ -298,6 +356,7 @@ public:
     static xct_t*               look_up(const tid_t& tid);
     static tid_t                oldest_tid();        // with min tid value
     static tid_t                youngest_tid();        // with max tid value
+    static void                 note_tid(const tid_t& tid); // used by restart
 
     // used by sm.cpp:
     static w_base_t::uint4_t    num_active_xcts();
@@ -362,6 +421,8 @@ public:
     bool                        is_log_on() const;
     rc_t                        get_logbuf(logrec_t*&, const page_p *p = 0);
     rc_t                        give_logbuf(logrec_t*, const page_p *p = 0);
+    rc_t                        give_logbuf(const logrec_writer_t&, 
+                                            const page_p *p = 0);
 
     //
     //        Used by I/O layer
@@ -466,7 +527,8 @@ public:
 // DATA
 /////////////////////////////////////////////////////////////////
 protected:
-    xct_link*			 _xlink;
+    int				 _xslab; // registry slab, or -1 if not registered
+    int				 _xslot; // slot within that slab
     void 			 join_xlist();
     enum xct_end_type { xct_end_nolog, xct_end_commit, xct_end_abort };
     rc_t			 _xct_ended(xct_end_type type);
@@ -530,7 +592,8 @@ private:
 									u_long&             aborts,
 									bool                 reset);
 
-    w_rc_t                     _flush_logbuf();
+    w_rc_t                     _flush_logbuf(const logrec_writer_t* w = 0);
+    void                       _set_page_lsns(page_p& last_mod_page);
     w_rc_t                     _sync_logbuf(bool block=true);
     void                       _teardown(bool is_chaining);
 
@@ -668,10 +731,37 @@ private:
 
      xct_core*                   _core;
 
+     hrtime_t                    _begin_time;
+     hrtime_t volatile           _wait_time[xct_wait_kinds];
+     // one per xct_wait_t, then the latency of whole transactions
+     static xct_latency_hist_t   _latency[xct_wait_kinds+1];
+
+     void                        _begin_timing();
+     void                        _record_latency();
+
+     // snapshot reads and record versions; see version_store_t
+     bool                        _snapshot;
+     w_base_t::uint8_t           _snapshot_stamp;
+     vs_writer_t*                _vs_writer; // versions we saved
+     bool volatile               _vs_wrote;  // updated a record
+
+     // optimistic reads: the locks not taken, to be validated at commit
+     bool                        _occ;
+     bool                        _occ_asked; // begun optimistic
+     occ_read_t*                 _occ_reads;
+     int                         _occ_nreads;
+     int                         _occ_capacity;
+
+     void                        _occ_wrote(const lpid_t& pid,
+                                           const lsn_t& old_lsn, 
+                                           const lsn_t& new_lsn);
+     rc_t                        _occ_validate();
+
 public:
     tid_t                       tid() const;
 };
 
+
 /**\cond skip */
 class auto_release_anchor_t {
 private:
@@ -803,10 +893,9 @@ private:
 /**\endcond skip */
 
 
-/* Iterators provide a thread-safe but non-static view of the
-   transaction list. Transactions are free to begin and end while an
-   iterator is active, and garbage collection will be coordinated to
-   avoid invalid pointer accesses.
+/* Iterators provide a thread-safe snapshot of the transaction
+   registry, in tid order. Transactions are free to begin while an
+   iterator is active, but cannot end until it goes away.
  */
 struct xct_i {
     struct maybe_lock {
@@ -815,8 +904,9 @@ struct xct_i {
 	~maybe_lock();
     };
     maybe_lock _lock;
-    xct_link* _end_xd;
-    xct_link* _cur_xd;
+    xct_slot_t* _snap;
+    int _count;
+    int _cur;
     xct_i(bool already_locked=false);
     ~xct_i();
     xct_t* next(bool can_delete=false);
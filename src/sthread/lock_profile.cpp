@@ -0,0 +1,331 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+// -*- mode:c++; c-basic-offset:4 -*-
+
+#include "w_defines.h"
+#include <w.h>
+#include <w_strstream.h>
+#include "atomic_templates.h"
+
+#include "sthread.h"
+#include "sthread_vtable_enum.h"
+#include "lock_profile.h"
+
+#include <cstring>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+const char *lock_profile_attr_names[] =
+{
+    "Lock",
+    "Lock kind",
+    "Lock name",
+    "Call site",
+    "Waits",
+    "Total wait us",
+    "Max wait us",
+    "Waits <1us",
+    "Waits <10us",
+    "Waits <100us",
+    "Waits <1ms",
+    "Waits <10ms",
+    "Waits >=10ms",
+    0
+};
+
+static vtable_names_init_t names_init(lock_profile_last, lock_profile_attr_names);
+
+/*
+ * Waits on one lock from one call site.
+ * A slot is free while its kind is null; the owning thread
+ * fills in the key first and the kind last.
+ */
+struct lp_entry_t {
+    const void*     object;
+    const void*     site;
+    const char*     kind;
+    const char*     name;   // filled in by collect only
+    hrtime_t        waits;
+    hrtime_t        wait_ns;
+    hrtime_t        max_ns;
+    hrtime_t        hist[lock_profile_t::hist_buckets];
+
+    void add(const lp_entry_t &other);
+    bool operator<(const lp_entry_t &other) const {
+        return wait_ns > other.wait_ns; // hottest first
+    }
+
+    void vtable_collect(vtable_row_t &t);
+    static void vtable_collect_names(vtable_row_t &t) {
+        names_init.collect_names(t);
+    }
+};
+
+/*
+ * One thread's waits.  Tables are never freed: when a thread ends
+ * its table goes back to the pool, still holding its waits, and the
+ * next thread to wait on a lock adopts it.
+ */
+struct lp_table_t {
+    enum { size = 256, probe = 16 };
+    lp_entry_t      slots[size];
+    lp_entry_t      other;    // waits that found no free slot
+    int volatile    epoch;    // waits are from this epoch of reset()s
+    bool volatile   in_use;
+    lp_table_t*     next;
+};
+
+bool volatile lock_profile_t::_enabled(false);
+
+// guards lp_tables and lp_names
+static pthread_mutex_t lp_lock = PTHREAD_MUTEX_INITIALIZER;
+static lp_table_t* volatile lp_tables(NULL);
+static int volatile lp_epoch(0);
+
+typedef std::map<const void*, const char*> lp_name_map;
+static lp_name_map* lp_names(NULL);
+
+static __thread lp_table_t* lp_mine(NULL);
+static __thread lock_profile_t::waiter_t* lp_current(NULL);
+
+static void lp_clear(lp_table_t* t, int epoch)
+{
+    memset(t->slots, 0, sizeof(t->slots));
+    memset(&t->other, 0, sizeof(t->other));
+    t->other.kind = "(other)";
+    membar_producer();
+    t->epoch = epoch;
+}
+
+static lp_table_t* lp_table()
+{
+    lp_table_t* t = lp_mine;
+    if(!t) {
+        CRITICAL_SECTION(cs, lp_lock);
+        for(t=lp_tables; t; t=t->next) {
+            if(!t->in_use) break;
+        }
+        if(!t) {
+            t = new lp_table_t;
+            lp_clear(t, lp_epoch);
+            t->next = lp_tables;
+            membar_producer();
+            lp_tables = t;
+        }
+        t->in_use = true;
+        lp_mine = t;
+    }
+    int epoch = *&lp_epoch;
+    if(t->epoch != epoch) lp_clear(t, epoch);
+    return t;
+}
+
+static lp_entry_t* lp_find(lp_table_t* t, const void* object, const void* site)
+{
+    w_base_t::uint8_t h = (w_base_t::uint8_t(object) ^ w_base_t::uint8_t(site))
+        * 0x9e3779b97f4a7c15ull;
+    int i = int(h >> 56);
+    for(int n=0; n < lp_table_t::probe; n++, i = (i+1) % lp_table_t::size) {
+        lp_entry_t* e = &t->slots[i];
+        if(!e->kind) {
+            e->object = object;
+            e->site = site;
+            return e;
+        }
+        if(e->object == object && e->site == site)
+            return e;
+    }
+    return &t->other;
+}
+
+static void lp_record(const void* object, const char* kind, const void* site,
+        hrtime_t ns)
+{
+    lp_entry_t* e = lp_find(lp_table(), object, site);
+    e->waits++;
+    e->wait_ns += ns;
+    if(ns > e->max_ns) e->max_ns = ns;
+    int b = 0;
+    for(hrtime_t limit=1000; b < lock_profile_t::hist_buckets-1 && ns >= limit;
+            limit *= 10)
+        b++;
+    e->hist[b]++;
+    if(!e->kind) {
+        membar_producer();
+        e->kind = kind;
+    }
+}
+
+void lp_entry_t::add(const lp_entry_t &other)
+{
+    waits += other.waits;
+    wait_ns += other.wait_ns;
+    if(other.max_ns > max_ns) max_ns = other.max_ns;
+    for(int i=0; i < lock_profile_t::hist_buckets; i++)
+        hist[i] += other.hist[i];
+}
+
+void lp_entry_t::vtable_collect(vtable_row_t &t)
+{
+    {
+        w_ostrstream o;
+        o << object << ends;
+        t.set_string(lock_profile_object_attr, o.c_str());
+    }
+    t.set_string(lock_profile_kind_attr, kind);
+    t.set_string(lock_profile_name_attr, name? name : "-");
+    if(site) {
+        w_ostrstream o;
+        o << site << ends;
+        t.set_string(lock_profile_site_attr, o.c_str());
+    } else {
+        t.set_string(lock_profile_site_attr, "-");
+    }
+    t.set_base(lock_profile_waits_attr, w_base_t::base_stat_t(waits));
+    t.set_base(lock_profile_wait_us_attr, w_base_t::base_stat_t(wait_ns/1000));
+    t.set_base(lock_profile_max_us_attr, w_base_t::base_stat_t(max_ns/1000));
+    for(int i=0; i < lock_profile_t::hist_buckets; i++)
+        t.set_base(lock_profile_1us_attr+i, w_base_t::base_stat_t(hist[i]));
+}
+
+void lock_profile_t::enable(bool reset_too)
+{
+    if(reset_too) reset();
+    _enabled = true;
+}
+
+void lock_profile_t::disable()
+{
+    _enabled = false;
+}
+
+void lock_profile_t::reset()
+{
+    // each table clears itself the next time its thread records a
+    // wait; collect() ignores the tables that have not done so yet.
+    atomic_inc(lp_epoch);
+}
+
+void lock_profile_t::set_name(const void* object, const char* name)
+{
+    CRITICAL_SECTION(cs, lp_lock);
+    if(!lp_names) lp_names = new lp_name_map;
+    (*lp_names)[object] = name;
+}
+
+void lock_profile_t::clear_name(const void* object)
+{
+    CRITICAL_SECTION(cs, lp_lock);
+    if(lp_names) lp_names->erase(object);
+}
+
+void lock_profile_t::on_thread_destroy()
+{
+    if(lp_mine) {
+        lp_mine->in_use = false;
+        lp_mine = NULL;
+    }
+}
+
+void lock_profile_t::waiter_t::_begin(const void* object, const char* kind,
+        const void* site)
+{
+    if(lp_current) {
+        // a lock built from this one is already timing this wait
+        _timer = lp_current;
+        return;
+    }
+    _timer = this;
+    _object = object;
+    _kind = kind;
+    _site = site;
+    _start = 0;
+    lp_current = this;
+}
+
+void lock_profile_t::waiter_t::_end()
+{
+    lp_current = NULL;
+    if(_start) lp_record(_object, _kind, _site, gethrtime() - _start);
+}
+
+/**\brief Merge the per-thread tables into a virtual table.
+ * \details
+ * Not atomic: threads keep recording while we read their tables, so
+ * the counts may be a little stale.
+ */
+int lock_profile_t::collect(vtable_t &v, bool names_too, int top_n,
+        bool by_site)
+{
+    typedef std::pair<const void*, const void*> key_t;
+    typedef std::map<key_t, lp_entry_t> merge_map;
+    merge_map merged;
+    std::vector<lp_entry_t> rows;
+    {
+        CRITICAL_SECTION(cs, lp_lock);
+        int epoch = *&lp_epoch;
+        for(lp_table_t* t=lp_tables; t; t=t->next) {
+            if(t->epoch != epoch) continue;
+            for(int i=0; i <= lp_table_t::size; i++) {
+                const lp_entry_t &e = (i < lp_table_t::size)? t->slots[i] : t->other;
+                if(!e.kind || !e.waits) continue;
+                membar_consumer();
+                key_t k(e.object, by_site? e.site : NULL);
+                merge_map::iterator it = merged.find(k);
+                if(it == merged.end()) {
+                    lp_entry_t &m = merged[k];
+                    m = e;
+                    m.site = k.second;
+                    m.name = NULL;
+                    if(lp_names) {
+                        lp_name_map::const_iterator n = lp_names->find(e.object);
+                        if(n != lp_names->end()) m.name = n->second;
+                    }
+                } else {
+                    it->second.add(e);
+                }
+            }
+        }
+    }
+    for(merge_map::const_iterator it=merged.begin(); it != merged.end(); ++it)
+        rows.push_back(it->second);
+    std::sort(rows.begin(), rows.end());
+    if(top_n > 0 && int(rows.size()) > top_n)
+        rows.resize(top_n);
+
+    int nrows = rows.size();
+    if(names_too) nrows++;
+    // values include pointers and lock names, which may be longer than
+    // the attribute names
+    int value_size = names_init.max_size();
+    if(value_size < 32) value_size = 32;
+    if(v.init(nrows, lock_profile_last, value_size)) return -1;
+
+    vtable_func<lp_entry_t> f(v);
+    if(names_too) f.insert_names();
+    for(size_t i=0; i < rows.size(); i++)
+        f(rows[i]);
+    return 0;
+}
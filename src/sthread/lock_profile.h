@@ -0,0 +1,131 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+
+                         All Rights Reserved.
+
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+// -*- mode:c++; c-basic-offset:4 -*-
+
+#ifndef LOCK_PROFILE_H
+#define LOCK_PROFILE_H
+
+class vtable_t;
+
+/**\brief Opt-in contention profiler for the sthread synchronization
+ * primitives.
+ *
+ * \details
+ * While profiling is enabled, every acquire that has to wait
+ * (tatas_lock, queue_based_lock_t, mcs_rwlock, occ_rwlock, the
+ * spin_park locks, and latch_t) is timed from the moment the thread
+ * notices the lock is taken until it holds the lock.  The wait is
+ * charged to the triple (object, kind, call site), where the call
+ * site is the code address that called the acquire.
+ * Uncontended acquires cost one test of a global flag and are not
+ * counted.
+ *
+ * Each thread accumulates its waits in a private table, so recording
+ * takes no shared locks and writes no shared cache lines.
+ * collect() merges the tables of all threads (live and exited) into
+ * a virtual table, sorted by total wait time, one row per
+ * object and call site (or per object if the sites are folded).
+ * The attributes are listed in lock_profile_attr_index.
+ *
+ * Long-lived locks may be given a name with set_name(), which
+ * collect() reports next to the object address.
+ */
+class lock_profile_t {
+public:
+    /// Wait-time histogram buckets: <1us, <10us, <100us, <1ms, <10ms, more.
+    enum { hist_buckets = 6 };
+
+    /// True iff waits are being profiled.
+    static bool         enabled() { return *&_enabled; }
+    /// Start profiling. If \e reset, throw away what was recorded so far.
+    static void         enable(bool reset=true);
+    /// Stop profiling.  What was recorded is kept for collect().
+    static void         disable();
+    /// Throw away all recorded waits.
+    static void         reset();
+
+    /// Name a lock for collect(). The name is not copied.
+    static void         set_name(const void *object, const char *name);
+    /// Forget the name of a lock that is going away.
+    static void         clear_name(const void *object);
+
+    /**\brief Fill a virtual table with the hottest locks.
+     * @param[out] v  The virtual table to populate.
+     * @param[in] names_too  If true, make the first row the attribute names.
+     * @param[in] top_n  Report at most this many rows; 0 means all.
+     * @param[in] by_site  If false, fold all call sites of an object
+     *            into one row.
+     * Returns 0 on success, -1 if out of memory.
+     */
+    static int          collect(vtable_t &v, bool names_too,
+                                int top_n, bool by_site);
+
+    /// Called when an sthread ends: hand its table back to the pool.
+    static void         on_thread_destroy();
+
+    /**\brief Times one wait on a lock.
+     * \details
+     * Construct one of these on entry to an out-of-line acquire path
+     * and call waiting() once the lock turns out to be taken.
+     * The wait is recorded when the waiter goes out of scope.
+     * Waiters nest: while one is timing, waiters constructed by
+     * the locks it is built from (e.g. the queue lock inside a
+     * mcs_rwlock) only start its clock, so each wait is charged once,
+     * to the outermost lock.
+     */
+    class waiter_t {
+    public:
+        waiter_t(const void *object, const char *kind, const void *site)
+            : _timer(0)
+        {
+            if(enabled()) _begin(object, kind, site);
+        }
+        ~waiter_t() { if(_timer == this) _end(); }
+        /// The lock is taken; start the clock if it isn't running.
+        void waiting() { if(_timer && !_timer->_start) _timer->_start = gethrtime(); }
+    private:
+        void            _begin(const void *object, const char *kind,
+                               const void *site);
+        void            _end();
+
+        waiter_t*       _timer; // outermost waiter, or 0 if not profiling
+        const void*     _object;
+        const char*     _kind;
+        const void*     _site;
+        hrtime_t        _start;
+    };
+
+private:
+    static bool volatile _enabled;
+};
+
+/**\brief Time a wait on \e object, charging it to our caller.
+ * \details
+ * Must be used directly in the out-of-line acquire function, so that
+ * the return address is the code that asked for the lock.
+ */
+#define LOCK_PROFILE_WAITER(w, object, kind) \
+    lock_profile_t::waiter_t w(object, kind, __builtin_return_address(0))
+
+#endif
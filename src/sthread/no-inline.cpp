@@ -31,6 +31,8 @@
 #include "srwlock.h"
 
 void mcs_lock::spin_on_waiting(qnode* me) {
+    LOCK_PROFILE_WAITER(w, this, "queue_based_lock_t");
+    w.waiting();
     while(me->vthis()->_waiting) ;
 }
 
@@ -43,20 +45,27 @@ mcs_lock::qnode* mcs_lock::spin_on_next(qnode* me) {
 
 void mcs_rwlock::_spin_on_writer() 
 {
+    if(!has_writer()) return;
+    LOCK_PROFILE_WAITER(w, this, "mcs_rwlock");
+    w.waiting();
     while(has_writer()) ;
     // callers do membar_enter
 }
 
 void mcs_rwlock::_spin_on_readers() 
 {
+    LOCK_PROFILE_WAITER(w, this, "mcs_rwlock");
+    w.waiting();
     while(has_reader()) ;
     // callers do membar_enter
 }
 
 void occ_rwlock::acquire_read()
 {
+    LOCK_PROFILE_WAITER(w, this, "occ_rwlock");
     int count = atomic_add_32_nv(&_active_count, READER);
     while(count & WRITER) {
+        w.waiting();
         // block
         count = atomic_add_32_nv(&_active_count, -READER);
         {
@@ -77,9 +86,11 @@ void occ_rwlock::acquire_read()
 
 void occ_rwlock::acquire_write()
 {
+    LOCK_PROFILE_WAITER(w, this, "occ_rwlock");
     // only one writer allowed in at a time...
     CRITICAL_SECTION(cs, _read_write_mutex);    
     while(*&_active_count & WRITER) {
+        w.waiting();
         DO_PTHREAD(pthread_cond_wait(&_read_cond, &_read_write_mutex));
     }
     
@@ -89,9 +100,15 @@ void occ_rwlock::acquire_write()
 
     // drain readers
     while(count != WRITER) {
+        w.waiting();
         DO_PTHREAD(pthread_cond_wait(&_write_cond, &_read_write_mutex));
         count = *&_active_count;
     }
 }
 
-void tatas_lock::spin() { while(*&(_holder.handle)) ; }
+void tatas_lock::spin() {
+    if(!*&(_holder.handle)) return;
+    LOCK_PROFILE_WAITER(w, this, "tatas_lock");
+    w.waiting();
+    while(*&(_holder.handle)) ;
+}
@@ -0,0 +1,212 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+   
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+   
+                         All Rights Reserved.
+   
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+   
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+/* The slow paths of the spin_park locks; see spin_park.h */
+#include "w_defines.h"
+#include <w.h>
+#include "atomic_templates.h"
+
+#include "sthread.h"
+#include "sthread_stats.h"
+#include "spin_park.h"
+
+#include <unistd.h>
+#include <sched.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#ifndef FUTEX_WAIT_PRIVATE
+#define FUTEX_WAIT_PRIVATE FUTEX_WAIT
+#define FUTEX_WAKE_PRIVATE FUTEX_WAKE
+#endif
+#endif
+
+int volatile spin_park_base_t::_spin_limit(-1);
+
+int spin_park_base_t::calibrate()
+{
+    int limit = 0;
+    if(sysconf(_SC_NPROCESSORS_ONLN) > 1) {
+        // time a loop shaped like the waiting loops below
+        enum { trial = 100000 };
+        unsigned int volatile word = 1;
+        hrtime_t start = gethrtime();
+        for(int i=0; i < trial && *&word; i++) ;
+        hrtime_t ns = gethrtime() - start;
+        if(ns <= 0) ns = 1;
+        double l = double(trial) * spin_usecs * 1000 / ns;
+        limit = (l > 1e8)? int(1e8) : int(l);
+        if(limit == 0) limit = 1;
+    }
+    // benign race: every caller computes about the same value
+    _spin_limit = limit;
+    return limit;
+}
+
+void spin_park_base_t::park(unsigned int volatile *addr, unsigned int val)
+{
+#ifdef __linux__
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#else
+    if(*addr == val) sched_yield();
+#endif
+}
+
+void spin_park_base_t::unpark_all(unsigned int volatile *addr)
+{
+#ifdef __linux__
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 0x7fffffff, NULL, NULL, 0);
+#else
+    (void) addr; // parked threads only yield
+#endif
+}
+
+void spin_park_base_t::unpark_one(unsigned int volatile *addr)
+{
+#ifdef __linux__
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+    (void) addr; // parked threads only yield
+#endif
+}
+
+void spin_park_base_t::record(bool parked, hrtime_t ns)
+{
+    if(!parked) {
+        INC_STH_STATS(spl_spin);
+        return;
+    }
+    INC_STH_STATS(spl_park);
+    if(ns < 10000) {
+        INC_STH_STATS(spl_park_10us);
+    } else if(ns < 100000) {
+        INC_STH_STATS(spl_park_100us);
+    } else if(ns < 1000000) {
+        INC_STH_STATS(spl_park_1ms);
+    } else if(ns < 10000000) {
+        INC_STH_STATS(spl_park_10ms);
+    } else {
+        INC_STH_STATS(spl_park_long);
+    }
+}
+
+void spin_park_lock::_acquire_slow()
+{
+    LOCK_PROFILE_WAITER(w, this, "spin_park_lock");
+    w.waiting();
+    for(int i=spin_limit(); i > 0; i--) {
+        if(*&_state == FREE && atomic_cas_32(&_state, FREE, HELD) == FREE) {
+            record(false, 0);
+            return;
+        }
+    }
+
+    // Once we have parked we take the lock as PARKED, since we
+    // cannot tell whether anyone else is still parked behind us; 
+    // at worst the next release makes one useless wakeup.
+    hrtime_t start = gethrtime();
+    while(atomic_swap_32(&_state, PARKED) != FREE) 
+        park(&_state, PARKED);
+    record(true, gethrtime() - start);
+}
+
+void spin_park_rwlock::_acquire_read_slow()
+{
+    LOCK_PROFILE_WAITER(w, this, "spin_park_rwlock");
+    w.waiting();
+    int spins = spin_limit();
+    hrtime_t start = 0;
+    for(;;) {
+        unsigned int s = *&_state;
+        if(!(s & WRITER)) {
+            if(atomic_cas_32(&_state, s, s+READER) == s) break;
+            continue;
+        }
+        if(spins > 0) {
+            spins--;
+            continue;
+        }
+        if(!start) start = gethrtime();
+        // make sure the writer knows to wake us
+        if(!(s & PARKED) && atomic_cas_32(&_state, s, s|PARKED) != s) 
+            continue;
+        park(&_state, s|PARKED);
+    }
+    record(start != 0, start? gethrtime() - start : 0);
+}
+
+void spin_park_rwlock::_acquire_write_slow()
+{
+    LOCK_PROFILE_WAITER(w, this, "spin_park_rwlock");
+    w.waiting();
+    int spins = spin_limit();
+    hrtime_t start = 0;
+
+    // announce ourselves: this keeps new readers out...
+    for(;;) {
+        unsigned int s = *&_state;
+        if(!(s & WRITER)) {
+            if(atomic_cas_32(&_state, s, s|WRITER) == s) break;
+            continue;
+        }
+        if(spins > 0) {
+            spins--;
+            continue;
+        }
+        if(!start) start = gethrtime();
+        if(!(s & PARKED) && atomic_cas_32(&_state, s, s|PARKED) != s) 
+            continue;
+        park(&_state, s|PARKED);
+    }
+
+    // ...then wait for the readers already in to drain
+    for(;;) {
+        unsigned int s = *&_state;
+        if(s < READER) break;
+        if(spins > 0) {
+            spins--;
+            continue;
+        }
+        if(!start) start = gethrtime();
+        if(!(s & PARKED) && atomic_cas_32(&_state, s, s|PARKED) != s) 
+            continue;
+        park(&_state, s|PARKED);
+    }
+    record(start != 0, start? gethrtime() - start : 0);
+}
+
+void spin_park_rwlock::_release_slow(unsigned int s)
+{
+    // Parked threads wait either for the writer to leave or for
+    // the readers to drain; while readers remain neither can proceed.
+    if(s >= READER) return;
+
+    // Clear PARKED and wake everyone; any thread that still has to
+    // wait sets PARKED again before it parks.
+    for(;;) {
+        s = *&_state;
+        if(!(s & PARKED)) return; // someone else did the wakeup
+        if(atomic_cas_32(&_state, s, s & ~PARKED) == s) break;
+    }
+    unpark_all(&_state);
+}
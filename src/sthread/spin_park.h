@@ -0,0 +1,207 @@
+/* -*- mode:C++; c-basic-offset:4 -*-
+     Shore-MT -- Multi-threaded port of the SHORE storage manager
+   
+                       Copyright (c) 2007-2009
+      Data Intensive Applications and Systems Labaratory (DIAS)
+               Ecole Polytechnique Federale de Lausanne
+   
+                         All Rights Reserved.
+   
+   Permission to use, copy, modify and distribute this software and
+   its documentation is hereby granted, provided that both the
+   copyright notice and this permission notice appear in all copies of
+   the software, derivative works or modified versions, and any
+   portions thereof, and that both notices appear in supporting
+   documentation.
+   
+   This code is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS
+   DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER
+   RESULTING FROM THE USE OF THIS SOFTWARE.
+*/
+
+// -*- mode:c++; c-basic-offset:4 -*-
+
+#ifndef SPIN_PARK_H
+#define SPIN_PARK_H
+
+/**\brief Bounded spinning before parking, shared by the spin_park locks.
+ *
+ * \details
+ * A thread that finds a spin_park lock held first spins for about
+ * spin_usecs microseconds (converted once to a count of spin-loop
+ * iterations by calibrate()), on the bet that the holder is running
+ * and about to release.  If the lock is still held after that, the
+ * thread parks in the kernel (a futex on Linux, sched_yield elsewhere) 
+ * until a releasing thread wakes it.
+ *
+ * On a uniprocessor the spin limit is 0: the holder cannot make
+ * progress while we spin, so waiters park right away.
+ *
+ * Spins, parks and park times are counted in the sthread stats
+ * (spl_* in sthread_stats.dat).
+ */
+class spin_park_base_t {
+public:
+    enum { spin_usecs = 20 };
+
+    /// Number of spin-loop iterations to try before parking.
+    static int spin_limit() {
+        int l = *&_spin_limit;
+        return (l >= 0)? l : calibrate();
+    }
+    /// Measure the spin loop and set the spin limit. Idempotent.
+    static int calibrate();
+
+protected:
+    /// Park while *addr == val.  May return spuriously.
+    static void park(unsigned int volatile *addr, unsigned int val);
+    /// Wake all threads parked on addr.
+    static void unpark_all(unsigned int volatile *addr);
+    /// Wake one thread parked on addr.
+    static void unpark_one(unsigned int volatile *addr);
+    /// Count a lock acquire that had to spin and maybe park.
+    static void record(bool parked, hrtime_t parked_ns);
+
+private:
+    static int volatile _spin_limit;
+};
+
+/**\brief A mutex that spins for a bounded time, then parks.
+ *
+ * \details
+ * A drop-in replacement for tatas_lock where the lock holder can
+ * be descheduled (more threads than cores, threads blocking in I/O
+ * while holding the lock).  Uncontended acquire and release are
+ * one atomic operation each, as with tatas_lock.
+ *
+ *  See also: \ref REFSYNC
+ */
+struct spin_park_lock : public spin_park_base_t {
+    spin_park_lock() : _state(FREE) { _holder.bits = 0; }
+
+    /// Try to acquire the lock immediately.
+    bool try_lock() {
+        if(*&_state != FREE || 
+                atomic_cas_32(&_state, FREE, HELD) != FREE) 
+            return false;
+        membar_enter();
+        _holder.handle = pthread_self();
+        return true;
+    }
+
+    /// Acquire the lock, spinning then parking as long as necessary. 
+    void acquire() {
+        w_assert1(!is_mine());
+        if(atomic_cas_32(&_state, FREE, HELD) != FREE) 
+            _acquire_slow(); // spin_park.cpp
+        membar_enter();
+        _holder.handle = pthread_self();
+        w_assert1(is_mine());
+    }
+
+    /// Release the lock
+    void release() {
+        w_assert1(is_mine());
+        _holder.bits = 0;
+        membar_exit();
+        if(atomic_swap_32(&_state, FREE) == PARKED) 
+            unpark_one(&_state);
+    }
+
+    /// True if this thread is the lock holder
+    bool is_mine() const { return *&_state != FREE &&
+        pthread_equal(_holder.handle, pthread_self()) ? true : false; }
+
+private:
+    // FREE -> HELD on the fast path; a waiter that gives up spinning
+    // moves the state to PARKED so that release knows to wake someone.
+    enum { FREE=0, HELD=1, PARKED=2 };
+    unsigned int volatile _state;
+    union {
+        pthread_t         handle;
+        uint64_t          bits;
+    } volatile _holder; // for is_mine() only
+    void _acquire_slow();
+};
+
+/**\brief A multiple-reader/single-writer lock that spins, then parks.
+ *
+ * \details
+ * Same interface and writer preference as occ_rwlock: a writer 
+ * announces itself (which keeps new readers out), then waits for the
+ * readers to drain.  Unlike occ_rwlock, neither side goes through a
+ * pthread mutex on the uncontended path, and a waiter spins for a
+ * bounded time before parking.
+ *
+ *  See also: \ref REFSYNC
+ */
+struct spin_park_rwlock : public spin_park_base_t {
+    spin_park_rwlock() : _state(0) { 
+        _read_lock._lock = this;
+        _write_lock._lock = this; 
+    }
+
+    /// The normal way to acquire a read lock.
+    void acquire_read() {
+        unsigned int s = *&_state;
+        if((s & WRITER) || atomic_cas_32(&_state, s, s+READER) != s)
+            _acquire_read_slow(); // spin_park.cpp
+        membar_enter();
+    }
+    /// The normal way to release a read lock.
+    void release_read() {
+        membar_exit();
+        w_assert1(READER <= *&_state);
+        unsigned int s = atomic_add_32_nv(&_state, -READER);
+        if(s & PARKED) _release_slow(s);
+    }
+    /// The normal way to acquire a write lock.
+    void acquire_write() {
+        if(atomic_cas_32(&_state, 0, WRITER) != 0)
+            _acquire_write_slow(); // spin_park.cpp
+        membar_enter();
+    }
+    /// The normal way to release a write lock.
+    void release_write() {
+        membar_exit();
+        w_assert1(*&_state & WRITER);
+        unsigned int s = atomic_add_32_nv(&_state, -WRITER);
+        if(s & PARKED) _release_slow(s);
+    }
+
+    /**\cond skip */
+    /// Exposed for critical_section<>. Do not use directly.
+    struct spl_rlock {
+        spin_park_rwlock* _lock;
+        void acquire() { _lock->acquire_read(); }
+        void release() { _lock->release_read(); }
+    };
+    /// Exposed for critical_section<>. Do not use directly.
+    struct spl_wlock {
+        spin_park_rwlock* _lock;
+        void acquire() { _lock->acquire_write(); }
+        void release() { _lock->release_write(); }
+    };
+
+    /// Exposed for the latch manager.. Do not use directly.
+    spl_rlock *read_lock() { return &_read_lock; }
+    /// Exposed for the latch manager.. Do not use directly.
+    spl_wlock *write_lock() { return &_write_lock; }
+    /**\endcond skip */
+
+private:
+    // READER per reader, plus WRITER if a writer holds or is draining
+    // readers, plus PARKED if anyone may be parked on _state.
+    enum { WRITER=1, PARKED=2, READER=4 };
+    unsigned int volatile _state;
+    spl_rlock _read_lock;
+    spl_wlock _write_lock;
+
+    void _acquire_read_slow();
+    void _acquire_write_slow();
+    void _release_slow(unsigned int s);
+};
+
+#endif
@@ -85,6 +85,8 @@ bool mcs_rwlock::attempt_read()
 
 void mcs_rwlock::acquire_read() 
 {
+    // the spins below start the clock if we have to wait
+    LOCK_PROFILE_WAITER(w, this, "mcs_rwlock");
     /* attempt to CAS first. If no writers around, or no intervening
      * add'l readers, we're done
      */
@@ -152,6 +154,7 @@ void mcs_rwlock::acquire_write()
      * 2. We don't want to make readers deal with the gap between
      * us updating _holders and actually acquiring the MCS lock.
      */
+    LOCK_PROFILE_WAITER(w, this, "mcs_rwlock");
     CRITICAL_SECTION(cs, (parent_lock*) this);
     _add_when_writer_leaves(WRITER);
     w_assert1(has_writer()); // me!
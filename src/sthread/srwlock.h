@@ -129,9 +129,11 @@ public:
 	return (holders == WRITER || _is_plp) ? 1 : holders/2; }
 
     /// True iff has one or more readers.
-    bool has_reader() const { return !_is_plp && (*&_holders & ~WRITER); }
+    /// Threads holding it in plp mode don't count: they never wait,
+    /// and no one waits for them.
+    bool has_reader() const { return *&_holders & ~WRITER; }
     /// True iff has a writer (never more than 1) 
-    bool has_writer() const { return !_is_plp && (*&_holders & WRITER); }
+    bool has_writer() const { return *&_holders & WRITER; }
 
     // pin: for plp
     void set_plp(bool is_reader) { _is_plp = true; _is_reader = is_reader; }
@@ -829,6 +829,7 @@ void sthread_t::_start()
     }
 
     /* Returned from run(). Current thread is ending. */
+    lock_profile_t::on_thread_destroy();
     {
         CRITICAL_SECTION(cs, _wait_lock);
         w_assert3(me() == this);
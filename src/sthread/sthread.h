@@ -559,6 +559,14 @@ typedef mcs_lock queue_based_lock_t;
 #include <srwlock.h>
 #endif
 
+#ifndef SPIN_PARK_H
+#include <spin_park.h>
+#endif
+
+#ifndef LOCK_PROFILE_H
+#include <lock_profile.h>
+#endif
+
 /**\brief A multiple-reader/single-writer lock based on pthreads (blocking)
  *
  * Use this to protect data structures that get hammered by
@@ -1119,6 +1127,15 @@ SPECIALIZE_CS(occ_rwlock::occ_rlock, int _dummy, (_dummy=0),
 SPECIALIZE_CS(occ_rwlock::occ_wlock, int _dummy, (_dummy=0), 
     _mutex->acquire(), _mutex->release());
 
+SPECIALIZE_CS(spin_park_lock, int _dummy, (_dummy=0), 
+    _mutex->acquire(), _mutex->release());
+
+SPECIALIZE_CS(spin_park_rwlock::spl_rlock, int _dummy, (_dummy=0), 
+    _mutex->acquire(), _mutex->release());
+
+SPECIALIZE_CS(spin_park_rwlock::spl_wlock, int _dummy, (_dummy=0), 
+    _mutex->acquire(), _mutex->release());
+
 
 
 inline sthread_t::priority_t
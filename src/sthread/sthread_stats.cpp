@@ -66,5 +66,16 @@ ostream &operator <<(ostream &o, const sthread_stats &s)
         o << endl;
     }
 
+    if (s.spl_spin || s.spl_park) {
+        o << "SPIN_PARK LOCKS:" << endl
+            << "  spun: " << s.spl_spin
+            << "  parked: " << s.spl_park << endl;
+        o << "\tparked <10us: " << s.spl_park_10us
+            << "  <100us: " << s.spl_park_100us
+            << "  <1ms: " << s.spl_park_1ms
+            << "  <10ms: " << s.spl_park_10ms
+            << "  >=10ms: " << s.spl_park_long << endl;
+    }
+
     return o;
 }
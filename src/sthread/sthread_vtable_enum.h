@@ -58,6 +58,32 @@ enum sthread_vtable_attr_index {
 
 extern const char *sthread_vtable_attr_names[];  // in vtable_sthread.cpp
 
+/*
+ * Attributes of a row of the lock contention profile: one lock
+ * (and call site) per row.  See lock_profile_t::collect.
+ */
+enum lock_profile_attr_index {
+    lock_profile_object_attr,
+    lock_profile_kind_attr,
+    lock_profile_name_attr,
+    lock_profile_site_attr,
+    lock_profile_waits_attr,
+    lock_profile_wait_us_attr,
+    lock_profile_max_us_attr,
+    /* histogram of waits, lock_profile_t::hist_buckets of them */
+    lock_profile_1us_attr,
+    lock_profile_10us_attr,
+    lock_profile_100us_attr,
+    lock_profile_1ms_attr,
+    lock_profile_10ms_attr,
+    lock_profile_long_attr,
+
+    /* last number! */
+    lock_profile_last
+};
+
+extern const char *lock_profile_attr_names[];  // in lock_profile.cpp
+
 /*<std-footer incl-file-exclusion='VTABLE_ENUM_H'>  -- do not edit anything below this line -- */
 
 #endif          /*</std-footer>*/
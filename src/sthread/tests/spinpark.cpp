@@ -0,0 +1,197 @@
+/*<std-header orig-src='shore'>
+
+ $Id: spinpark.cpp,v 1.1 $
+
+SHORE -- Scalable Heterogeneous Object REpository
+
+Copyright (c) 1994-99 Computer Sciences Department, University of
+                      Wisconsin -- Madison
+All Rights Reserved.
+
+Permission to use, copy, modify and distribute this software and its
+documentation is hereby granted, provided that both the copyright
+notice and this permission notice appear in all copies of the
+software, derivative works or modified versions, and any portions
+thereof, and that both notices appear in supporting documentation.
+
+THE AUTHORS AND THE COMPUTER SCIENCES DEPARTMENT OF THE UNIVERSITY
+OF WISCONSIN - MADISON ALLOW FREE USE OF THIS SOFTWARE IN ITS
+"AS IS" CONDITION, AND THEY DISCLAIM ANY LIABILITY OF ANY KIND
+FOR ANY DAMAGES WHATSOEVER RESULTING FROM THE USE OF THIS SOFTWARE.
+
+This software was developed with support by the Advanced Research
+Project Agency, ARPA order number 018 (formerly 8230), monitored by
+the U.S. Army Research Laboratory under contract DAAB07-91-C-Q518.
+Further funding for this work was provided by DARPA through
+Rome Research Laboratory Contract No. F30602-97-2-0247.
+
+*/
+
+#include "w_defines.h"
+
+/*  -- do not edit anything above this line --   </std-header>*/
+
+
+#include <w.h>
+#include <sthread.h>
+#include <sthread_stats.h>
+#include <sthread_vtable_enum.h>
+#include <w_getopt.h>
+#include <iostream>
+#include <w_strstream.h>
+
+/*
+ * Many more threads than cores hammering a spin_park_lock and a 
+ * spin_park_rwlock, sometimes yielding the cpu while holding them,
+ * so that waiters have to give up spinning and park.
+ * With -p, profile the waits and check the profile against the
+ * spin/park counts.
+ */
+
+class spl_thread_t : public sthread_t {
+public:
+	spl_thread_t(int i);
+
+protected:
+	void	run();
+
+private:
+	int	idx;
+};
+
+int	NumThreads = 16;
+int	NumIters = 20000;
+bool	verbose = false;
+bool	profile = false;
+
+spin_park_lock		mutex;
+long			counter = 0;	// protected by mutex
+
+spin_park_rwlock	rwlock;
+long volatile		guarded[2] = { 0, 0 };	// protected by rwlock
+
+spl_thread_t::spl_thread_t(int i)
+:
+  sthread_t(t_regular),
+  idx(i)
+{
+	w_ostrstream_buf s(40);		// XXX magic number
+
+	s << "spl[" << idx << "]" << ends;
+	rename(s.c_str());
+}
+
+void spl_thread_t::run()
+{
+	for (int i = 0; i < NumIters; i++)  {
+		{
+			CRITICAL_SECTION(cs, mutex);
+			w_assert1(mutex.is_mine());
+			long c = counter;
+			if ((i & 0xff) == idx) 
+				yield();
+			counter = c + 1;
+		}
+
+		if ((i & 7) == 0) {
+			CRITICAL_SECTION(cs, rwlock.write_lock());
+			guarded[0] = i;
+			if ((i & 0xff) == idx) 
+				yield();
+			guarded[1] = i;
+		} else {
+			CRITICAL_SECTION(cs, rwlock.read_lock());
+			long a = guarded[0];
+			if ((i & 0xff) == idx) 
+				yield();
+			w_assert0(a == guarded[1]);
+		}
+	}
+	w_assert1(!mutex.is_mine());
+}
+
+int parse_args(int argc, char **argv)
+{
+	int errors = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "n:i:vp")) != EOF) {
+		switch (c) {
+		case 'n':
+			NumThreads = atoi(optarg);
+			break;
+		case 'i':
+			NumIters = atoi(optarg);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		case 'p':
+			profile = true;
+			break;
+		default:
+			errors++;
+			break;
+		}
+	}
+	if (errors || NumThreads < 1) {
+		cerr << "usage: " << argv[0] 
+			<< " [-n threads] [-i iterations] [-v] [-p]" << endl;
+	}
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	if (parse_args(argc, argv))
+		return 1;
+
+	cout << "spin limit " << spin_park_base_t::spin_limit() 
+		<< " iterations" << endl;
+
+	if (profile) {
+		lock_profile_t::set_name(&mutex, "spinpark mutex");
+		lock_profile_t::set_name(&rwlock, "spinpark rwlock");
+		lock_profile_t::enable();
+	}
+
+	spl_thread_t **threads = new spl_thread_t *[NumThreads];
+	int i;
+	for (i = 0; i < NumThreads; i++)  {
+		threads[i] = new spl_thread_t(i);
+		W_COERCE(threads[i]->fork());
+	}
+	for (i = 0; i < NumThreads; i++)  {
+		W_COERCE(threads[i]->join());
+		delete threads[i];
+	}
+	delete [] threads;
+
+	w_assert0(counter == long(NumThreads) * NumIters);
+	cout << NumThreads << " threads, " << counter << " increments; "
+		<< SthreadStats.spl_spin << " acquires spun, "
+		<< SthreadStats.spl_park << " parked" << endl;
+
+	if (profile) {
+		lock_profile_t::disable();
+		vtable_t vt;
+		if (lock_profile_t::collect(vt, true, 0, false))
+			W_FATAL(fcOUTOFMEMORY);
+
+		// every trip through a slow path is one profiled wait
+		long waits = 0;
+		for (i = 1; i < vt.quant(); i++) {
+			if (strncmp(vt[i][lock_profile_kind_attr], "spin_park", 9) == 0)
+				waits += atol(vt[i][lock_profile_waits_attr]);
+		}
+		cout << waits << " waits profiled" << endl;
+		w_assert0(waits == long(SthreadStats.spl_spin + SthreadStats.spl_park));
+		if (verbose) 
+			vt.operator<<(cout);
+	}
+
+	if (verbose)
+		sthread_t::dump_stats(cout);
+
+	return 0;
+}
@@ -139,11 +139,13 @@ while (<INPUT>) {
     my ($type, $attr, $arg) = split(/[ \t\n]+/, $_, 3);
     chop $arg;
 
-    my ($xflag, $sync, $redo, $undo, $format, $aflag, $logical) = split(//, $attr);
+    my ($xflag, $sync, $redo, $undo, $format, $aflag, $logical, $direct) 
+	= split(//, $attr);
+    $direct = 0 unless defined($direct);
     my $cat = &get_cat($redo, $undo, $format, $logical);
     
     printf(TYPE "\tt_$type = %d,\n", $unique++);
-    &def_rec($type, $xflag, $aflag, $sync, $redo, $undo, $cat, $arg);
+    &def_rec($type, $xflag, $aflag, $sync, $redo, $undo, $direct, $cat, $arg);
 				# 
     print REDO "\tcase t_$type : \n";
     if ($redo) {
@@ -184,7 +186,7 @@ sub get_cat {
 }
 
 sub def_rec {
-    my ($type, $xflag, $aflag, $sync, $redo, $undo, $cat, $arg) = @_;
+    my ($type, $xflag, $aflag, $sync, $redo, $undo, $direct, $cat, $arg) = @_;
     my ($class) = $type . "_log";
     my ($has_idx);
 
@@ -202,13 +204,48 @@ sub def_rec {
 	
 	$redo_stmt
 	$undo_stmt
-    };
-
 CLASSDEF
 	;
 
     #($real = $arg) =~ s/[\(\)]|const //g;
     $arg =~ s/\((.*)\)/$1/;
+
+    if ($direct) {
+	# The writer holds on to the arguments (they outlive it) and
+	# the record provides data_length(), the size of the data part
+	# the constructor will fill in.
+	my (@param, @decl, @init, @mem);
+	foreach my $p (split(/, /, $arg)) {
+	    $p =~ /^(.*\S)\s+(\w+)$/ or die "cannot parse argument $p\n";
+	    my ($t, $n) = ($1, $2);
+	    $t .= " const&" unless ($t =~ /&$/);
+	    push(@param, "$t $n");
+	    push(@decl, "$t _$n;");
+	    push(@init, "_$n($n)");
+	    push(@mem, "_$n");
+	}
+	my $params = join(", ", @param);
+	my $decls = join("\n\t    ", @decl);
+	my $inits = join(", ", @init);
+	my $mems = join(", ", @mem);
+	print DEF<<WRITERDEF;
+	static smsize_t data_length($arg);
+
+	class writer_t : public logrec_writer_t {
+	    $decls
+	  public:
+	    writer_t($params) : $inits {}
+	    smsize_t length() const {
+		return logrec_t::length_for($class\::data_length($mems));
+	    }
+	    logrec_t* construct(void* where) const {
+		return new (where) $class($mems);
+	    }
+	};
+WRITERDEF
+	;
+    }
+    print DEF "    };\n\n";
     # see if arg contains "int idx"
     $arg =~ /int\s+idx/ && do { $has_idx=1; };
     my $real = join(', ', grep(s/^.*\s+(\w+)$/$1/, split(/, /, $arg)));
@@ -240,12 +277,22 @@ CLASSDEF
 	} else {
 	    print STUB "        W_DO(xd->get_logbuf(logrec));\n";
 	}
+	if ($direct) {
+	    # built in place in the log buffer by give_logbuf
+	    my $w = "$class\::writer_t($real)";
+	    if ($page eq "page") {
+		print STUB "        W_DO(xd->give_logbuf($w, &page));\n";
+	    } else {
+		print STUB "        W_DO(xd->give_logbuf($w));\n";
+	    }
+	} else {
         print STUB "        new (logrec) $class($real);\n";	   
 	if ($page eq "page") {
 	    print STUB "        W_DO(xd->give_logbuf(logrec, &page));\n";
 	} else {
 	    print STUB "        W_DO(xd->give_logbuf(logrec));\n";
 	}
+	}
 	if ($sync) {
 	    print STUB "        W_COERCE( smlevel_0::log->flush_all() );\n";
 	}